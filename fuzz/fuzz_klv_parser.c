@@ -1,8 +1,12 @@
 /*
  * AFL Fuzzing Harness for DSV4L2 KLV Parser
  *
- * Fuzzes the dsv4l2_parse_klv() function with random KLV data
- * to find crashes, hangs, and memory errors.
+ * Fuzzes dsv4l2_parse_klv() and the resumable dsv4l2_klv_parser_*() API
+ * with random KLV data to find crashes, hangs, and memory errors. The
+ * input is also replayed in chunks (sizes taken from the input itself)
+ * through a small item array; any disagreement with the one-shot parse
+ * aborts, so resume bugs show up as crashes. The one-shot parse ignores
+ * a trailing fragment under 17 bytes, which the replay leaves out.
  *
  * Build with AFL:
  *   make fuzz
@@ -19,10 +23,70 @@
 #include <unistd.h>
 
 #define MAX_INPUT_SIZE (64 * 1024)  /* 64 KB max input */
+#define CHUNK_ITEMS    8            /* Small item array to exercise resume */
+
+static uint8_t input_buf[MAX_INPUT_SIZE];
+static uint8_t arena[MAX_INPUT_SIZE];
+
+/**
+ * Replay the input in chunks and compare with the one-shot result
+ */
+static void fuzz_chunked(const uint8_t *data, size_t len,
+                         const dsv4l2_klv_item_t *ref, size_t ref_count, int ref_rc)
+{
+    dsv4l2_klv_parser_t parser;
+    dsv4l2_klv_item_t items[CHUNK_ITEMS];
+    size_t pos = 0, seen = 0, step = 0;
+    int rc = 0;
+
+    dsv4l2_klv_parser_init(&parser, items, CHUNK_ITEMS, arena, sizeof(arena));
+
+    while (pos < len && rc >= 0) {
+        /* Chunk sizes 1..64 driven by the input bytes */
+        size_t chunk = (size_t)(data[step++ % len] & 0x3F) + 1;
+        size_t off = 0;
+
+        if (chunk > len - pos) {
+            chunk = len - pos;
+        }
+
+        while (off < chunk) {
+            size_t i;
+
+            rc = dsv4l2_klv_parser_feed(&parser, data + pos + off, chunk - off);
+            if (rc < 0) {
+                break;
+            }
+            off += (size_t)rc;
+
+            /* Compare and drain completed items */
+            for (i = 0; i < parser.count; i++, seen++) {
+                if (ref_rc == 0 &&
+                    (seen >= ref_count ||
+                     memcmp(items[i].key.bytes, ref[seen].key.bytes, 16) != 0 ||
+                     items[i].length != ref[seen].length ||
+                     memcmp(items[i].value, ref[seen].value, items[i].length) != 0)) {
+                    abort();
+                }
+            }
+            dsv4l2_klv_parser_clear(&parser);
+        }
+
+        pos += chunk;
+    }
+
+    if (rc >= 0) {
+        rc = dsv4l2_klv_parser_finish(&parser);
+    }
+
+    /* Chunking must not change the outcome */
+    if ((rc < 0) != (ref_rc < 0) || (ref_rc == 0 && seen != ref_count)) {
+        abort();
+    }
+}
 
 int main(int argc, char **argv)
 {
-    uint8_t input_buf[MAX_INPUT_SIZE];
     ssize_t input_len;
     dsv4l2_klv_buffer_t klv_buffer;
     dsv4l2_klv_item_t *items = NULL;
@@ -50,10 +114,9 @@ int main(int argc, char **argv)
     }
 
     /* Set up KLV buffer */
+    memset(&klv_buffer, 0, sizeof(klv_buffer));
     klv_buffer.data = input_buf;
-    klv_buffer.size = input_len;
-    klv_buffer.used = input_len;
-    klv_buffer.format = DSV4L2_META_FORMAT_KLV;
+    klv_buffer.length = (size_t)input_len;
 
     /* Fuzz target: Parse KLV metadata */
     rc = dsv4l2_parse_klv(&klv_buffer, &items, &item_count);
@@ -63,7 +126,7 @@ int main(int argc, char **argv)
         /* Iterate through parsed items to exercise more code */
         for (size_t i = 0; i < item_count; i++) {
             /* Access item fields */
-            volatile uint8_t key_byte = items[i].key.data[0];
+            volatile uint8_t key_byte = items[i].key.bytes[0];
             volatile size_t length = items[i].length;
             volatile const uint8_t *value = items[i].value;
 
@@ -79,10 +142,23 @@ int main(int argc, char **argv)
                 dsv4l2_find_klv_item(items, item_count, &items[0].key);
             (void)found;
         }
+    }
+
+    /* Fuzz target: resumable parser on the same input. The one-shot parse
+     * ignores a short trailing fragment, so on success replay only the
+     * bytes its items cover. */
+    {
+        size_t replay = (size_t)input_len;
 
-        /* Clean up */
-        free(items);
+        if (rc == 0) {
+            replay = item_count > 0 ?
+                (size_t)(items[item_count - 1].value - input_buf) + items[item_count - 1].length : 0;
+        }
+        fuzz_chunked(input_buf, replay, items, item_count, rc);
     }
 
+    /* Clean up */
+    free(items);
+
     return 0;
 }
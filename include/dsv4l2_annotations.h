@@ -59,6 +59,10 @@
     typedef struct {
         uint8_t *data;
         size_t   len;
+        uint32_t index;         /* Driver buffer index (lease handle) */
+        uint32_t sequence;      /* Driver frame sequence number */
+        uint64_t timestamp_ns;  /* Driver capture timestamp */
+        int      dmabuf_fd;     /* dmabuf fd of the buffer, -1 if none */
     } DSMIL_SECRET("biometric_frame") dsv4l2_frame_t;
 
     typedef struct {
@@ -66,6 +70,45 @@
         size_t   len;
     } DSMIL_META("radiometric") dsv4l2_meta_t;
 
+    /* Per-stream drop and latency counters (video or metadata) */
+    typedef struct {
+        uint64_t frames;           /* Buffers dequeued */
+        uint64_t dropped;          /* Sequence numbers skipped by the driver */
+        uint64_t gaps;             /* Dequeues that followed a skip */
+        uint64_t latency_last_ns;  /* Capture-to-dequeue latency, last buffer */
+        uint64_t latency_avg_ns;   /* Moving average (1/16 weight) */
+        uint64_t latency_max_ns;
+        uint32_t buffer_count;     /* Buffers allocated */
+        uint32_t active_count;     /* Buffers in circulation (not parked) */
+    } dsv4l2_capture_stats_t;
+
+    /*
+     * Log-linear latency histogram (HDR-style, ~6% relative error)
+     *
+     * Values below 16 ns get one bucket each; above that every power of
+     * two is split into 16 linear sub-buckets. Values of 2^37 ns (~137 s)
+     * and more are clamped into the last bucket.
+     */
+    #define DSV4L2_HIST_SUB_BITS  4
+    #define DSV4L2_HIST_MAX_MSB   36
+    #define DSV4L2_HIST_BUCKETS   \
+        ((DSV4L2_HIST_MAX_MSB - DSV4L2_HIST_SUB_BITS + 2) << DSV4L2_HIST_SUB_BITS)
+
+    typedef struct {
+        uint64_t count;            /* Samples recorded */
+        uint64_t sum_ns;
+        uint64_t max_ns;
+        uint64_t buckets[DSV4L2_HIST_BUCKETS];
+    } dsv4l2_histogram_t;
+
+    /* Per-stream histograms */
+    typedef enum {
+        DSV4L2_HIST_LATENCY  = 0,  /* Driver timestamp to dequeue */
+        DSV4L2_HIST_INTERVAL = 1,  /* Driver timestamp delta between frames (jitter) */
+        DSV4L2_HIST_POLICY   = 2,  /* Time spent in the capture policy check */
+        DSV4L2_HIST_KINDS
+    } dsv4l2_hist_kind_t;
+
     typedef enum DSMIL_TEMPEST {
         DSV4L2_TEMPEST_DISABLED = 0,
         DSV4L2_TEMPEST_LOW      = 1,
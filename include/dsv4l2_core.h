@@ -34,9 +34,54 @@ void dsv4l2_close(dsv4l2_device_t *dev);
 
 /**
  * List all v4l2 devices on the system
+ *
+ * Opens (as "camera") every node the probe cache reports as a video
+ * capture device; nodes without capture support are never opened.
  */
 int dsv4l2_list_devices(dsv4l2_device_t ***devices, size_t *count);
 
+/* ========================================================================
+ * Device Probe Cache
+ * ======================================================================== */
+
+/* One /dev/video* node as seen by the lightweight probe */
+typedef struct {
+    char     path[32];           /* "/dev/videoN" */
+    char     driver[16];         /* VIDIOC_QUERYCAP strings */
+    char     card[32];
+    char     bus_info[32];
+    char     usb_id[10];         /* "vvvv:pppp" from sysfs, "" if not USB */
+    char     role[32];           /* Matching profile (by usb_id), else "camera" */
+    char     classification[32]; /* Matching profile, else "UNCLASSIFIED" */
+    uint32_t capabilities;       /* Physical device capabilities */
+    uint32_t device_caps;        /* Capabilities of this node */
+} dsv4l2_device_info_t;
+
+/**
+ * Snapshot the probed video nodes
+ *
+ * The first call probes every /dev/video* node in parallel with a single
+ * VIDIOC_QUERYCAP (no dsv4l2_open(): no profile, policy or TEMPEST setup)
+ * and starts a kernel uevent monitor that adds and removes cache entries
+ * as nodes appear and disappear. Later calls only copy the cache. Without
+ * the monitor (netlink unavailable) every call probes again.
+ *
+ * @param out Output array sorted by node number (caller must free)
+ * @param count Output entry count
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_probe_devices(dsv4l2_device_info_t **out, size_t *count);
+
+/**
+ * Drop the probe cache; the next dsv4l2_probe_devices() probes again.
+ */
+void dsv4l2_probe_invalidate(void);
+
+/**
+ * Stop the hotplug monitor and free the probe cache
+ */
+void dsv4l2_probe_shutdown(void);
+
 /**
  * Get device capabilities
  */
@@ -100,6 +145,84 @@ int dsv4l2_get_resolution(dsv4l2_device_t *dev, uint32_t *width, uint32_t *heigh
  */
 void dsv4l2_fourcc_to_string(uint32_t fourcc, char *str);
 
+/* ========================================================================
+ * Pixel Format Conversion
+ * ======================================================================== */
+
+/* Frames at least this large are converted on several threads (threads = 0) */
+#define DSV4L2_CONVERT_MT_MIN_PIXELS  (1024 * 1024)
+
+/*
+ * Image descriptor for conversion
+ *
+ * Packed formats use plane[0] only; NV12 keeps interleaved CbCr in
+ * plane[1]. A stride of 0 means tightly packed.
+ */
+typedef struct {
+    uint32_t fourcc;        /* V4L2_PIX_FMT_* */
+    uint32_t width;
+    uint32_t height;
+    uint8_t *plane[2];
+    uint32_t stride[2];     /* Bytes per line */
+} dsv4l2_image_t;
+
+/**
+ * Bytes needed for a tightly packed image (0 if the fourcc is unknown)
+ */
+size_t dsv4l2_image_size(uint32_t fourcc, uint32_t width, uint32_t height);
+
+/**
+ * Describe a tightly packed image in caller memory (e.g. a leased frame)
+ *
+ * @return 0 on success, -ENOTSUP for unknown fourccs, -ENOBUFS if len is short
+ */
+int dsv4l2_image_init(dsv4l2_image_t *img, uint32_t fourcc,
+                      uint32_t width, uint32_t height, void *data, size_t len);
+
+/**
+ * Describe a leased frame using the device's current format
+ *
+ * fmt comes from dsv4l2_get_format(); fetch it once per stream, not per frame.
+ */
+int dsv4l2_image_from_frame(dsv4l2_image_t *img, const struct v4l2_format *fmt,
+                            const dsv4l2_frame_t *frame);
+
+/**
+ * Check whether a conversion is implemented
+ *
+ * Sources: YUYV, UYVY. Destinations: RGB24, BGR24, GREY, NV12, or the
+ * source format itself (copy).
+ */
+int dsv4l2_convert_supported(uint32_t src_fourcc, uint32_t dst_fourcc);
+
+/**
+ * Convert an image into a caller-owned destination
+ *
+ * Source and destination must have the same width and height; the width
+ * must be even. Rows are split across threads (0 = automatic, threads
+ * only for frames of DSV4L2_CONVERT_MT_MIN_PIXELS or more).
+ *
+ * @return 0 on success, -EINVAL on bad geometry, -ENOTSUP for unsupported pairs
+ */
+int dsv4l2_convert_image(const dsv4l2_image_t *src, dsv4l2_image_t *dst,
+                         unsigned threads);
+
+/**
+ * Convert an image straight into a dmabuf (e.g. GPU/NPU input)
+ *
+ * The dmabuf is mapped for the call and bracketed with DMA_BUF_IOCTL_SYNC;
+ * it holds a tightly packed dst_fourcc image of the source size.
+ *
+ * @return 0 on success, -ENOBUFS if the dmabuf is too small, negative errno otherwise
+ */
+int dsv4l2_convert_to_dmabuf(const dsv4l2_image_t *src, int dmabuf_fd,
+                             uint32_t dst_fourcc, unsigned threads);
+
+/**
+ * Name of the conversion kernel set selected for this CPU
+ */
+const char *dsv4l2_convert_impl(void);
+
 /* ========================================================================
  * Buffer Management
  * ======================================================================== */
@@ -114,6 +237,34 @@ int dsv4l2_request_buffers(dsv4l2_device_t *dev, uint32_t count);
  */
 int dsv4l2_mmap_buffers(dsv4l2_device_t *dev);
 
+/**
+ * Export every MMAP buffer as a dmabuf fd (VIDIOC_EXPBUF)
+ *
+ * The library owns the fds (closed by dsv4l2_release_buffers()); leased
+ * frames carry theirs in frame->dmabuf_fd.
+ */
+int dsv4l2_export_buffers(dsv4l2_device_t *dev);
+
+/**
+ * Get the dmabuf fd of a buffer (-ENOENT if not exported or imported)
+ */
+int dsv4l2_get_buffer_fd(dsv4l2_device_t *dev, uint32_t index);
+
+/**
+ * Use caller-allocated dmabufs (e.g. GPU/NPU memory) as capture buffers
+ *
+ * Replaces any existing buffer set. The fds are duplicated.
+ */
+int dsv4l2_import_dmabuf(dsv4l2_device_t *dev, const int *fds, uint32_t count);
+
+/**
+ * Use caller-allocated memory (USERPTR, e.g. hugepages) as capture buffers
+ *
+ * Replaces any existing buffer set. The memory must outlive it.
+ */
+int dsv4l2_import_userptr(dsv4l2_device_t *dev, void *const *ptrs, size_t length,
+                          uint32_t count);
+
 /**
  * Queue a buffer for capture
  */
@@ -135,6 +286,58 @@ int dsv4l2_get_buffer(dsv4l2_device_t *dev, uint32_t index,
  */
 void dsv4l2_release_buffers(dsv4l2_device_t *dev);
 
+/**
+ * Let the queue depth follow observed drops (MMAP buffers, not streaming)
+ *
+ * Grows the buffer set towards max_buffers when the driver skips sequence
+ * numbers and parks buffers again, down to min_buffers, once the stream
+ * has been quiet. Pass 0, 0 to go back to a fixed depth.
+ */
+int dsv4l2_set_adaptive_depth(dsv4l2_device_t *dev, uint32_t min_buffers,
+                              uint32_t max_buffers);
+
+/**
+ * Snapshot drop, dequeue latency and queue depth counters
+ *
+ * Each dequeue that follows skipped sequence numbers also emits a
+ * FRAME_DROPPED event with the number of frames lost.
+ */
+int dsv4l2_get_capture_stats(dsv4l2_device_t *dev, dsv4l2_capture_stats_t *out);
+
+/**
+ * Snapshot one latency histogram of the device
+ *
+ * LATENCY and INTERVAL are fed by every dequeue with a monotonic driver
+ * timestamp; POLICY by every capture-path policy check. Recording uses
+ * relaxed atomics only, so a snapshot taken while frames arrive may be
+ * off by the samples in flight; count always equals the bucket sum.
+ *
+ * @param dev Device handle
+ * @param kind Histogram to read
+ * @param out Output histogram
+ * @return 0 on success, -EINVAL on bad arguments
+ */
+int dsv4l2_get_histogram(dsv4l2_device_t *dev, dsv4l2_hist_kind_t kind,
+                         dsv4l2_histogram_t *out);
+
+/**
+ * Add one sample to a histogram (lock-free, any thread)
+ */
+void dsv4l2_histogram_record(dsv4l2_histogram_t *h, uint64_t value_ns);
+
+/**
+ * Value at a percentile (e.g. 50.0, 99.0, 99.9)
+ *
+ * @return Upper bound of the bucket holding the percentile, capped at
+ *         max_ns; 0 for an empty histogram
+ */
+uint64_t dsv4l2_histogram_percentile(const dsv4l2_histogram_t *h, double pct);
+
+/**
+ * Accumulate src into dst (e.g. to aggregate several devices)
+ */
+void dsv4l2_histogram_merge(dsv4l2_histogram_t *dst, const dsv4l2_histogram_t *src);
+
 /* ========================================================================
  * Capture Operations
  * ======================================================================== */
@@ -149,6 +352,38 @@ int dsv4l2_start_streaming(dsv4l2_device_t *dev);
  */
 int dsv4l2_stop_streaming(dsv4l2_device_t *dev);
 
+/* ========================================================================
+ * Zero-copy Frame Leases
+ * ======================================================================== */
+
+/**
+ * Acquire a frame lease
+ *
+ * Dequeues the next filled buffer without copying. out->data points into
+ * the driver's mmap'd buffer and stays valid until the lease is released.
+ *
+ * @param dev Device handle
+ * @param out Output frame (data, len, index, sequence, timestamp_ns)
+ * @param timeout_ms Wait timeout in ms (-1 = block, 0 = poll only)
+ * @return 0 on success, -ENOBUFS if every buffer is leased,
+ *         -ETIMEDOUT/-EAGAIN if no frame is ready, negative errno otherwise
+ */
+int dsv4l2_frame_acquire(dsv4l2_device_t *dev, dsv4l2_frame_t *out,
+                         int timeout_ms);
+
+/**
+ * Release a frame lease
+ *
+ * Returns the buffer to the driver. The frame must have been obtained from
+ * dsv4l2_frame_acquire() or dsv4l2_capture_frames() on the same device and
+ * is cleared on success.
+ *
+ * @param dev Device handle
+ * @param frame Leased frame
+ * @return 0 on success, -EINVAL if the frame is not currently leased
+ */
+int dsv4l2_frame_release(dsv4l2_device_t *dev, dsv4l2_frame_t *frame);
+
 #ifdef __cplusplus
 }
 #endif
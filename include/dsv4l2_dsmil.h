@@ -9,6 +9,7 @@
 
 #include "dsv4l2_annotations.h"
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,6 +45,9 @@ dsmil_threatcon_t dsv4l2_get_threatcon(void);
 
 /**
  * Set THREATCON level
+ *
+ * EMERGENCY blocks capture on every open device, including devices
+ * without a TEMPEST control.
  */
 int dsv4l2_set_threatcon(dsmil_threatcon_t level);
 
@@ -52,6 +56,27 @@ int dsv4l2_set_threatcon(dsmil_threatcon_t level);
  */
 int dsv4l2_apply_threatcon(dsv4l2_device_t *dev);
 
+/* Threads used by dsv4l2_apply_threatcon_all() besides the caller */
+#define DSV4L2_THREATCON_MAX_WORKERS 16
+
+/* Per-device outcome of a THREATCON fan-out */
+typedef struct {
+    dsv4l2_device_t *dev;               /* Device handle */
+    int result;                         /* dsv4l2_set_tempest_state() result */
+    uint64_t latency_ns;                /* Fan-out start to completion */
+} dsv4l2_threatcon_result_t;
+
+/**
+ * Apply THREATCON to every open device concurrently
+ *
+ * Results are reported in registry order, up to max_results entries;
+ * count receives the number of open devices. Returns 0 unless a device
+ * with a TEMPEST control failed to transition, or -ENOMEM if the open
+ * devices could not be listed (no device was transitioned).
+ */
+int dsv4l2_apply_threatcon_all(dsv4l2_threatcon_result_t *results,
+                               size_t max_results, size_t *count);
+
 /**
  * Get layer policy
  */
@@ -59,6 +84,13 @@ int dsv4l2_get_layer_policy(uint32_t layer, dsv4l2_layer_policy_t **policy);
 
 /**
  * Check if capture is allowed for device
+ *
+ * Denied (-EPERM) when the user's clearance (DSV4L2_CLEARANCE) is below
+ * the device role and classification, at THREATCON EMERGENCY, in TEMPEST
+ * LOCKDOWN, or below the layer's minimum TEMPEST state. Every capture
+ * path applies the same clearance, EMERGENCY and LOCKDOWN rules from a
+ * per-device decision cached at open and refreshed when THREATCON or
+ * the device layer changes.
  */
 int dsv4l2_check_capture_allowed(dsv4l2_device_t *dev, const char *context);
 
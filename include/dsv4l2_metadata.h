@@ -75,15 +75,41 @@ typedef struct {
     uint64_t timestamp_ns;     /* Capture timestamp */
 } dsv4l2_telemetry_t;
 
+/* Timing / sync data */
+typedef struct {
+    uint64_t sensor_ts_ns;     /* Sensor clock at exposure start */
+    uint64_t sync_token;       /* Token shared with the matching video frame */
+    uint32_t frame_sequence;   /* Video frame sequence the token belongs to */
+    uint32_t flags;            /* Sensor-defined sync flags */
+    uint64_t timestamp_ns;     /* Capture timestamp */
+} dsv4l2_timing_t;
+
+/*
+ * Wire layouts of the fixed-format metadata buffers (little-endian,
+ * packed):
+ *
+ * IR_TEMP    u16 width, u16 height, f32 emissivity, f32 ambient_temp (K),
+ *            f32 calibration_c1, f32 calibration_c2,
+ *            then width*height u16 temperatures (Kelvin * 100)
+ * TELEMETRY  f64 latitude, f64 longitude, f32 altitude, f32 heading,
+ *            f32 pitch, f32 roll, f32 velocity[3]
+ * TIMING     u64 sensor_ts_ns, u64 sync_token, u32 frame_sequence, u32 flags
+ */
+#define DSV4L2_META_IR_HEADER_SIZE   20
+#define DSV4L2_META_TELEMETRY_SIZE   44
+#define DSV4L2_META_TIMING_SIZE      24
+
 /* Metadata buffer (generic container) */
 typedef struct {
     dsv4l2_meta_format_t format;
     uint64_t             timestamp_ns;
     uint32_t             sequence;
+    uint32_t             index;    /* Driver buffer index (lease handle) */
     union {
         dsv4l2_klv_buffer_t    klv;
         dsv4l2_ir_radiometric_t ir;
         dsv4l2_telemetry_t     telemetry;
+        dsv4l2_timing_t        timing;
     } data;
 } dsv4l2_metadata_t;
 
@@ -106,6 +132,27 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
                          dsv4l2_meta_format_t format,
                          dsv4l2_metadata_capture_t **out);
 
+/* Buffers requested by dsv4l2_open_metadata() */
+#define DSV4L2_META_DEFAULT_BUFFERS  4
+
+/**
+ * Open metadata capture stream with a chosen queue depth
+ *
+ * Like dsv4l2_open_metadata(), but requests buffer_count buffers; the
+ * stream uses however many the driver grants.
+ *
+ * @param dev Device handle
+ * @param format Expected metadata format
+ * @param buffer_count Buffers to request
+ * @param out Output metadata capture handle
+ * @return 0 on success, negative errno on error
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_open_metadata_depth(dsv4l2_device_t *dev,
+                               dsv4l2_meta_format_t format,
+                               uint32_t buffer_count,
+                               dsv4l2_metadata_capture_t **out);
+
 /**
  * Close metadata capture stream
  *
@@ -117,6 +164,9 @@ void dsv4l2_close_metadata(dsv4l2_metadata_capture_t *meta_cap);
  * Capture metadata buffer
  *
  * Dequeues a metadata buffer. Blocks if no buffer available.
+ * KLV data and the IR temperature map are heap copies owned by the
+ * caller (free them); see dsv4l2_metadata_acquire() and
+ * dsv4l2_capture_metadata_into() for allocation-free capture.
  *
  * @param meta_cap Metadata capture handle
  * @param out Output metadata buffer
@@ -126,20 +176,200 @@ DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
 int dsv4l2_capture_metadata(dsv4l2_metadata_capture_t *meta_cap,
                              dsv4l2_metadata_t *out);
 
+/**
+ * Acquire a metadata buffer lease
+ *
+ * Dequeues the next metadata buffer and decodes it in place: KLV data and
+ * the IR temperature map point into the driver's mmap'd buffer, which
+ * stays out of the driver queue until dsv4l2_metadata_release(). Nothing
+ * is allocated.
+ *
+ * @param meta_cap Metadata capture handle
+ * @param out Output metadata (out->index is the lease handle)
+ * @return 0 on success, -ENOBUFS if every buffer is leased,
+ *         -EAGAIN if no buffer is ready on a non-blocking fd,
+ *         -EINVAL if the buffer does not match its format's layout,
+ *         negative errno otherwise
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_metadata_acquire(dsv4l2_metadata_capture_t *meta_cap,
+                            dsv4l2_metadata_t *out);
+
+/**
+ * Release a metadata buffer lease
+ *
+ * @param meta_cap Metadata capture handle
+ * @param meta Metadata from dsv4l2_metadata_acquire()
+ * @return 0 on success, -EINVAL if meta is not currently leased
+ */
+int dsv4l2_metadata_release(dsv4l2_metadata_capture_t *meta_cap,
+                            const dsv4l2_metadata_t *meta);
+
+/**
+ * Capture a metadata buffer into caller-owned storage
+ *
+ * Copies the buffer into arena, requeues it right away and decodes from
+ * the copy, so pointers in out stay valid until the arena is reused.
+ * Nothing is allocated; one arena per in-flight buffer makes a pool.
+ *
+ * @param meta_cap Metadata capture handle
+ * @param out Output metadata
+ * @param arena Destination (aligned to at least 2 bytes)
+ * @param arena_size Arena size in bytes
+ * @return Bytes copied on success, -EMSGSIZE if the buffer did not fit
+ *         (it is dropped), negative errno otherwise
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_capture_metadata_into(dsv4l2_metadata_capture_t *meta_cap,
+                                 dsv4l2_metadata_t *out,
+                                 void *arena, size_t arena_size);
+
+/**
+ * Decode an IR_TEMP buffer in place
+ *
+ * out->temp_map points into data (which must be 2-byte aligned) and is
+ * not allocated.
+ *
+ * @return 0 on success, -EINVAL if data is short or misaligned
+ */
+int dsv4l2_decode_ir_temp(const uint8_t *data, size_t length,
+                          dsv4l2_ir_radiometric_t *out);
+
+/**
+ * Decode a TELEMETRY buffer
+ *
+ * @return 0 on success, -EINVAL if data is short
+ */
+int dsv4l2_decode_telemetry(const uint8_t *data, size_t length,
+                            dsv4l2_telemetry_t *out);
+
+/**
+ * Decode a TIMING buffer
+ *
+ * @return 0 on success, -EINVAL if data is short
+ */
+int dsv4l2_decode_timing(const uint8_t *data, size_t length,
+                         dsv4l2_timing_t *out);
+
+/**
+ * Snapshot drop and dequeue latency counters of a metadata stream
+ *
+ * Skipped sequence numbers are also reported as FRAME_DROPPED events.
+ *
+ * @param meta_cap Metadata capture handle
+ * @param out Output counters
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_get_metadata_stats(dsv4l2_metadata_capture_t *meta_cap,
+                              dsv4l2_capture_stats_t *out);
+
+/**
+ * Snapshot one latency histogram of a metadata stream
+ *
+ * Same semantics as dsv4l2_get_histogram(); metadata capture has no
+ * policy check, so DSV4L2_HIST_POLICY stays empty.
+ *
+ * @param meta_cap Metadata capture handle
+ * @param kind Histogram to read
+ * @param out Output histogram
+ * @return 0 on success, -EINVAL on bad arguments
+ */
+int dsv4l2_get_metadata_histogram(dsv4l2_metadata_capture_t *meta_cap,
+                                  dsv4l2_hist_kind_t kind,
+                                  dsv4l2_histogram_t *out);
+
 /**
  * Parse KLV metadata
  *
- * Parses raw KLV buffer into individual items.
+ * Parses raw KLV buffer into individual items. Wrapper around the
+ * resumable parser for a single contiguous buffer. Trailing bytes too
+ * short for a key and length (under 17) are ignored.
  *
  * @param buffer Raw KLV data
  * @param items Output array of KLV items (caller must free)
  * @param count Output item count
- * @return 0 on success, negative errno on error
+ * @return 0 on success, -EINVAL on a malformed or truncated item,
+ *         -ENOMEM on allocation failure
  */
 int dsv4l2_parse_klv(const dsv4l2_klv_buffer_t *buffer,
                      dsv4l2_klv_item_t **items,
                      size_t *count);
 
+/*
+ * Resumable KLV parser
+ *
+ * Accepts a KLV stream in chunks of any size and writes completed items
+ * into a caller-provided array. A value that lies entirely inside one
+ * chunk is referenced in place (the chunk must outlive the item); a
+ * value split across chunks is assembled in the caller's arena. The
+ * parser never allocates. Fields are private to metadata.c.
+ */
+typedef struct {
+    dsv4l2_klv_item_t *items;        /* Output items */
+    size_t             max_items;
+    size_t             count;        /* Items completed */
+    uint8_t           *arena;        /* Storage for split values (may be NULL) */
+    size_t             arena_size;
+    size_t             arena_used;
+
+    /* Partial item carried between chunks */
+    int                state;
+    int                error;        /* Sticky negative errno */
+    dsv4l2_klv_key_t   key;
+    uint32_t           fill;         /* Key or value bytes seen */
+    uint32_t           length;
+    uint32_t           length_bytes; /* Long-form length bytes left */
+    uint8_t           *value;        /* Arena destination of a split value */
+} dsv4l2_klv_parser_t;
+
+/**
+ * Initialise a resumable KLV parser
+ *
+ * @param parser Parser context
+ * @param items Item array
+ * @param max_items Capacity of items
+ * @param arena Storage for values split across chunks (NULL if the stream
+ *              always arrives in whole-item chunks)
+ * @param arena_size Arena size in bytes
+ */
+void dsv4l2_klv_parser_init(dsv4l2_klv_parser_t *parser,
+                            dsv4l2_klv_item_t *items, size_t max_items,
+                            void *arena, size_t arena_size);
+
+/**
+ * Feed the next chunk of a KLV stream
+ *
+ * Parsing stops early, at an item boundary, when the item array is full;
+ * consume the items, call dsv4l2_klv_parser_clear() and feed the rest of
+ * the chunk again.
+ *
+ * @param parser Parser context
+ * @param data Chunk
+ * @param length Chunk length
+ * @return Bytes consumed (less than length only if the item array filled),
+ *         -EINVAL on a malformed length, -ENOBUFS if a split value does not
+ *         fit in the arena; errors are sticky until dsv4l2_klv_parser_init()
+ */
+int dsv4l2_klv_parser_feed(dsv4l2_klv_parser_t *parser,
+                           const uint8_t *data, size_t length);
+
+/**
+ * Forget completed items and reuse the arena
+ *
+ * A partial item (and any split value already in the arena) is kept.
+ */
+void dsv4l2_klv_parser_clear(dsv4l2_klv_parser_t *parser);
+
+/**
+ * Check the stream ended cleanly
+ *
+ * A trailing fragment shorter than a key is ignored as padding.
+ *
+ * @return 0 if no item is cut short, -EINVAL if the stream ends inside a
+ *         length or value, or the sticky error
+ */
+int dsv4l2_klv_parser_finish(const dsv4l2_klv_parser_t *parser);
+
 /**
  * Get KLV item by key
  *
@@ -154,10 +384,74 @@ const dsv4l2_klv_item_t *dsv4l2_find_klv_item(const dsv4l2_klv_item_t *items,
                                                size_t count,
                                                const dsv4l2_klv_key_t *key);
 
+/* Keys defined by the library, as dense ids for indexed lookup */
+typedef enum {
+    DSV4L2_KLV_KEY_UAS_DATALINK_LS = 0,
+    DSV4L2_KLV_KEY_SENSOR_LATITUDE,
+    DSV4L2_KLV_KEY_SENSOR_LONGITUDE,
+    DSV4L2_KLV_KEY_SENSOR_ALTITUDE,
+    DSV4L2_KLV_KEY_COUNT
+} dsv4l2_klv_key_id_t;
+
+/* Parse-once index of the known keys in a packet */
+typedef struct {
+    const dsv4l2_klv_item_t *items[DSV4L2_KLV_KEY_COUNT];  /* First match, NULL if absent */
+    size_t                   unknown;                      /* Items with other keys */
+} dsv4l2_klv_index_t;
+
+/**
+ * Map a key to its library id (perfect hash, one compare)
+ *
+ * @return dsv4l2_klv_key_id_t, or -1 if the library does not define key
+ */
+int dsv4l2_klv_key_id(const dsv4l2_klv_key_t *key);
+
+/**
+ * Index parsed items by known key
+ *
+ * After one pass over the items every known key is an array lookup
+ * (idx->items[id]). The index points into items.
+ *
+ * @return 0 on success, -EINVAL on bad arguments
+ */
+int dsv4l2_klv_index_build(dsv4l2_klv_index_t *idx, const dsv4l2_klv_item_t *items,
+                           size_t count);
+
+/**
+ * Decode a MISB ST 0601 UAS Datalink Local Set value
+ *
+ * Walks the BER-OID tag / BER length pairs of the local set once and
+ * fills the telemetry fields it carries: precision time stamp (tag 2),
+ * platform heading, pitch and roll (5-7), sensor latitude, longitude and
+ * true altitude (13-15). Unknown tags, tags with an unexpected length and
+ * MISB "out of range" values leave the field untouched. No velocity tags
+ * exist in the local set, so velocity is not written.
+ *
+ * @param value Local set value (the UAS Datalink LS item's value)
+ * @param length Value length
+ * @param out Telemetry to update
+ * @return Number of fields written, -EINVAL if the local set is malformed
+ */
+int dsv4l2_decode_misb0601(const uint8_t *value, size_t length,
+                           dsv4l2_telemetry_t *out);
+
+/**
+ * Fill telemetry from an indexed packet
+ *
+ * Decodes the UAS Datalink LS if present, then the standalone sensor
+ * latitude/longitude/altitude keys (same encodings as tags 13-15).
+ *
+ * @return Number of fields written, negative errno on error
+ */
+int dsv4l2_klv_decode_telemetry(const dsv4l2_klv_index_t *idx,
+                                dsv4l2_telemetry_t *out);
+
 /**
  * Decode IR radiometric data
  *
  * Converts raw IR sensor data to temperature map using calibration.
+ * out->temp_map is allocated (caller frees); use dsv4l2_decode_ir_into()
+ * to decode into an existing map.
  *
  * @param raw_data Raw sensor data
  * @param width Image width
@@ -173,15 +467,165 @@ int dsv4l2_decode_ir_radiometric(const uint16_t *raw_data,
                                   const float *calibration,
                                   dsv4l2_ir_radiometric_t *out);
 
+/* Per-frame temperature statistics, in map units (Kelvin * 100) */
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    float    mean;
+} dsv4l2_ir_stats_t;
+
+/* Pixels per frame from which dsv4l2_decode_ir_into() uses threads by default */
+#define DSV4L2_IR_MT_MIN_PIXELS  (1024 * 1024)
+
+/**
+ * Decode IR radiometric data into a caller-provided map
+ *
+ * Same conversion as dsv4l2_decode_ir_radiometric() (T = c1 * raw + c2,
+ * clamped to 0-500 K, stored as Kelvin * 100) using the widest SIMD
+ * kernel the CPU supports. Rows are split across threads for large maps.
+ * Nothing is allocated and no event is emitted.
+ *
+ * @param raw_data Raw sensor data (width * height values)
+ * @param width Image width
+ * @param height Image height
+ * @param calibration Calibration constants {c1, c2}
+ * @param temp_map Output map (width * height values)
+ * @param threads Threads to use (0 = automatic, 1 = calling thread only)
+ * @param stats Filled with min/max/mean of the map if not NULL
+ * @return 0 on success, negative errno on error
+ */
+DSV4L2_SENSOR("ir_sensor", "L3", "CONFIDENTIAL")
+int dsv4l2_decode_ir_into(const uint16_t *raw_data,
+                          uint32_t width,
+                          uint32_t height,
+                          const float *calibration,
+                          uint16_t *temp_map,
+                          unsigned threads,
+                          dsv4l2_ir_stats_t *stats);
+
+/**
+ * IR decode kernel in use ("avx512", "avx2", "neon" or "generic")
+ */
+const char *dsv4l2_ir_decode_impl(void);
+
+/* ========================================================================
+ * Metadata History and Fusion
+ * ======================================================================== */
+
+/* Default frame/metadata alignment tolerance */
+#define DSV4L2_META_SYNC_TOLERANCE_NS  50000000ULL  /* 50 ms */
+
+/* dsv4l2_meta_history_find() flags */
+#define DSV4L2_META_FIND_INTERPOLATE  0x1  /* Interpolate telemetry between neighbours */
+
+/*
+ * Timestamp-sorted ring of recent metadata
+ *
+ * Entries own a copy of their payload (KLV bytes, IR temperature map), so
+ * they outlive the driver buffer. Safe to push and search from different
+ * threads.
+ */
+typedef struct dsv4l2_meta_history dsv4l2_meta_history_t;
+
+/**
+ * Create a metadata history ring
+ *
+ * @param depth Entries kept (oldest dropped first)
+ * @param payload_max Largest payload per entry in bytes (0 = fixed-size formats only)
+ * @param out Output ring
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_meta_history_create(uint32_t depth, size_t payload_max,
+                               dsv4l2_meta_history_t **out);
+
+/**
+ * Destroy a metadata history ring
+ */
+void dsv4l2_meta_history_destroy(dsv4l2_meta_history_t *hist);
+
+/**
+ * Add an entry, keeping the ring sorted by timestamp_ns
+ *
+ * KLV data and IR temperature map pointers in meta must point into
+ * payload; they are rebased onto the entry's own copy.
+ *
+ * @return 0 on success, -EMSGSIZE if payload_len exceeds payload_max,
+ *         -ESTALE if the ring is full and meta is older than every entry
+ */
+int dsv4l2_meta_history_push(dsv4l2_meta_history_t *hist, const dsv4l2_metadata_t *meta,
+                             const void *payload, size_t payload_len);
+
+/**
+ * Find the metadata aligned with a timestamp
+ *
+ * Binary-searches for the nearest entry within tolerance_ns. With
+ * DSV4L2_META_FIND_INTERPOLATE, telemetry bracketed by two entries is
+ * interpolated linearly to ts (heading and longitude wrap correctly).
+ *
+ * The payload of KLV and IR entries is copied into payload; with a NULL
+ * payload their data pointers are cleared (lengths are kept).
+ *
+ * @return 0 on success, -ENOENT if nothing lies within tolerance,
+ *         -EMSGSIZE if payload_size is too small
+ */
+int dsv4l2_meta_history_find(dsv4l2_meta_history_t *hist, uint64_t ts,
+                             uint64_t tolerance_ns, unsigned flags,
+                             dsv4l2_metadata_t *out, void *payload, size_t payload_size);
+
+/**
+ * Entries currently held
+ */
+uint32_t dsv4l2_meta_history_count(dsv4l2_meta_history_t *hist);
+
+/**
+ * Keep a history of everything dequeued from a metadata stream
+ *
+ * Every buffer dequeued afterwards (dsv4l2_capture_metadata(), leases,
+ * the reactor) is decoded into the ring. depth = 0 turns it off.
+ *
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_metadata_set_history(dsv4l2_metadata_capture_t *meta_cap, uint32_t depth);
+
+/**
+ * History ring of a metadata stream (NULL if not enabled)
+ */
+dsv4l2_meta_history_t *dsv4l2_metadata_get_history(dsv4l2_metadata_capture_t *meta_cap);
+
+/**
+ * Capture a video frame with its aligned metadata
+ *
+ * Captures like dsv4l2_capture_frame() (same lease rules and TEMPEST
+ * policy check), then looks the frame timestamp up in meta_cap's history.
+ * The history is fed by whoever dequeues the metadata stream, e.g. a
+ * reactor.
+ *
+ * @param tolerance_ns Maximum timestamp distance (0 = DSV4L2_META_SYNC_TOLERANCE_NS)
+ * @param flags DSV4L2_META_FIND_* flags
+ * @param payload Storage for a KLV/IR payload copy (may be NULL)
+ * @return 0 with aligned metadata, 1 if the frame was captured but no
+ *         metadata was within tolerance (out_meta->format is UNKNOWN),
+ *         -ENOTSUP if meta_cap has no history, negative errno otherwise
+ */
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_fused_capture_aligned(dsv4l2_device_t *video_dev,
+                                 dsv4l2_metadata_capture_t *meta_cap,
+                                 uint64_t tolerance_ns, unsigned flags,
+                                 dsv4l2_frame_t *out_frame,
+                                 dsv4l2_metadata_t *out_meta,
+                                 void *payload, size_t payload_size);
+
 /**
  * Synchronize frame and metadata timestamps
  *
- * Finds metadata buffer closest to frame timestamp for fusion.
+ * Finds metadata buffer closest to frame timestamp for fusion. For
+ * streams, dsv4l2_meta_history_find() does the same without a scan.
  *
  * @param frame_ts Frame timestamp (nanoseconds)
  * @param meta_buffers Array of metadata buffers
  * @param count Number of metadata buffers
- * @return Index of closest metadata buffer, or -1 if none within threshold
+ * @return Index of closest metadata buffer, or -1 if none within
+ *         DSV4L2_META_SYNC_TOLERANCE_NS
  */
 int dsv4l2_sync_metadata(uint64_t frame_ts,
                           const dsv4l2_metadata_t *meta_buffers,
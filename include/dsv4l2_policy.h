@@ -7,8 +7,8 @@
     extern "C" {
     #endif
 
-    /* Forward declaration for metadata handle (not yet defined) */
-    typedef struct dsv4l2_meta_handle dsv4l2_meta_handle_t;
+    /* Metadata stream handle (the same object as dsv4l2_metadata_capture_t) */
+    typedef struct dsv4l2_metadata_capture dsv4l2_meta_handle_t;
 
     dsv4l2_tempest_state_t
     dsv4l2_get_tempest_state(dsv4l2_device_t *dev)
@@ -28,6 +28,14 @@
                          dsv4l2_frame_t *out)
         DSMIL_REQUIRES_TEMPEST_CHECK;
 
+    /* Batch of zero-copy leases; returns the frame count */
+    int
+    dsv4l2_capture_frames(dsv4l2_device_t *dev,
+                          dsv4l2_frame_t *frames,
+                          size_t max_frames,
+                          int timeout_ms)
+        DSMIL_REQUIRES_TEMPEST_CHECK;
+
     int
     DSMIL_SECRET_REGION
     dsv4l2_capture_iris(dsv4l2_device_t *dev,
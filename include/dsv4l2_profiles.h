@@ -34,6 +34,18 @@ typedef struct {
     char filename[256];
 } dsv4l2_device_profile_t;
 
+/*
+ * Lookups are lock-free hash probes into the current profile snapshot.
+ * Returned pointers stay valid across reloads (old snapshots are retired,
+ * not freed) until dsv4l2_profiles_shutdown(). A reload does not change
+ * devices that are already open.
+ *
+ * Environment (used until dsv4l2_profiles_configure() is called):
+ *   DSV4L2_PROFILE_DIR    Profile directory (default: profiles,
+ *                         ../profiles, /etc/dsv4l2/profiles)
+ *   DSV4L2_PROFILE_CACHE  Binary profile cache file (default: none)
+ */
+
 /**
  * Find a profile by device ID (USB VID:PID)
  */
@@ -54,6 +66,47 @@ size_t dsv4l2_get_profile_count(void);
  */
 const dsv4l2_device_profile_t *dsv4l2_get_profile(size_t index);
 
+/**
+ * Select the profile directory and binary cache, and load them
+ *
+ * The cache is used when its stamp (names, sizes and mtimes of the
+ * directory's .yaml files) matches, and rewritten otherwise.
+ *
+ * @param dir Profile directory (NULL = environment / default search)
+ * @param cache_path Binary cache file (NULL = keep the current setting)
+ * @return Number of profiles loaded, -EBUSY while watching, negative
+ *         errno if the directory cannot be resolved
+ */
+int dsv4l2_profiles_configure(const char *dir, const char *cache_path);
+
+/**
+ * Re-read the profile directory and atomically swap in the new snapshot
+ *
+ * @return Number of profiles loaded, negative errno on error
+ */
+int dsv4l2_profiles_reload(void);
+
+/**
+ * Start hot reload: an inotify thread reloads the directory once profile
+ * files have been quiet for 100 ms after a change.
+ *
+ * @return 0 on success (or already watching), negative errno on error
+ */
+int dsv4l2_profiles_watch(void);
+
+/**
+ * Number of snapshots published so far (changes on every reload)
+ */
+uint32_t dsv4l2_profiles_generation(void);
+
+/**
+ * Stop hot reload and free all snapshots
+ *
+ * No profile pointer may be in use. The next lookup loads the default
+ * directory again.
+ */
+void dsv4l2_profiles_shutdown(void);
+
 #ifdef __cplusplus
 }
 #endif
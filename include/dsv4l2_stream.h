@@ -0,0 +1,220 @@
+/*
+ * DSV4L2 Streaming API
+ *
+ * Push-style capture on top of the zero-copy lease API:
+ * - Capture reactor: one thread services many video and metadata
+ *   streams through a single epoll set
+ * - Device streams: a dedicated (optionally real-time, pinned) dequeue
+ *   thread per device feeding a work-stealing pool of workers
+ */
+
+#ifndef DSV4L2_STREAM_H
+#define DSV4L2_STREAM_H
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_metadata.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ========================================================================
+ * Capture Reactor
+ * ======================================================================== */
+
+/* Reactor handle */
+typedef struct dsv4l2_reactor dsv4l2_reactor_t;
+
+/**
+ * Frame callback
+ *
+ * Called on the reactor thread with a leased frame. The callback owns the
+ * lease and must hand it back with dsv4l2_frame_release(), either before
+ * returning or later from another thread.
+ */
+typedef void (*dsv4l2_frame_cb)(dsv4l2_device_t *dev, dsv4l2_frame_t *frame,
+                                void *user_data);
+
+/**
+ * Metadata callback
+ *
+ * Called on the reactor thread for each dequeued metadata buffer. The
+ * metadata driver buffer is already requeued; heap data inside meta
+ * (e.g. meta->data.klv.data) belongs to the callback.
+ */
+typedef void (*dsv4l2_meta_cb)(dsv4l2_metadata_capture_t *meta_cap,
+                               dsv4l2_metadata_t *meta, void *user_data);
+
+/**
+ * Create a capture reactor
+ *
+ * @param out Output reactor handle
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_reactor_create(dsv4l2_reactor_t **out);
+
+/**
+ * Destroy a reactor (must not be running)
+ *
+ * Registered devices and metadata streams are not closed.
+ */
+void dsv4l2_reactor_destroy(dsv4l2_reactor_t *reactor);
+
+/**
+ * Register a video device
+ *
+ * Switches the fd to non-blocking mode and starts streaming if needed
+ * (buffers must already be requested). Frames are delivered to callback
+ * as they become ready, subject to the usual TEMPEST policy check.
+ *
+ * @return 0 on success, -EEXIST if already registered, negative errno on error
+ */
+int dsv4l2_reactor_add_device(dsv4l2_reactor_t *reactor, dsv4l2_device_t *dev,
+                              dsv4l2_frame_cb callback, void *user_data);
+
+/**
+ * Register a metadata stream
+ *
+ * A metadata stream sharing its device's fd is serviced from the same
+ * epoll registration.
+ *
+ * @return 0 on success, -EEXIST if already registered, negative errno on error
+ */
+int dsv4l2_reactor_add_metadata(dsv4l2_reactor_t *reactor,
+                                dsv4l2_metadata_capture_t *meta_cap,
+                                dsv4l2_meta_cb callback, void *user_data);
+
+/**
+ * Unregister a video device (not while the reactor is running)
+ *
+ * @return 0 on success, -ENOENT if not registered
+ */
+int dsv4l2_reactor_remove_device(dsv4l2_reactor_t *reactor, dsv4l2_device_t *dev);
+
+/**
+ * Unregister a metadata stream (not while the reactor is running)
+ *
+ * @return 0 on success, -ENOENT if not registered
+ */
+int dsv4l2_reactor_remove_metadata(dsv4l2_reactor_t *reactor,
+                                   dsv4l2_metadata_capture_t *meta_cap);
+
+/**
+ * Run one reactor iteration
+ *
+ * Waits up to timeout_ms for readiness and dispatches every ready
+ * stream.
+ *
+ * @param timeout_ms Wait timeout (-1 = block, 0 = poll only)
+ * @return Number of frames and metadata buffers delivered,
+ *         -ECANCELED if dsv4l2_reactor_stop() was called,
+ *         negative errno on error
+ */
+int dsv4l2_reactor_poll(dsv4l2_reactor_t *reactor, int timeout_ms);
+
+/**
+ * Run the reactor on the calling thread until dsv4l2_reactor_stop()
+ *
+ * @param cpu CPU to pin the calling thread to, -1 to leave affinity alone
+ * @return 0 when stopped, negative errno on error
+ */
+int dsv4l2_reactor_run(dsv4l2_reactor_t *reactor, int cpu);
+
+/**
+ * Stop a running reactor (safe from any thread or signal handler)
+ */
+void dsv4l2_reactor_stop(dsv4l2_reactor_t *reactor);
+
+/* ========================================================================
+ * Device Streams
+ * ======================================================================== */
+
+/* Stream handle */
+typedef struct dsv4l2_stream dsv4l2_stream_t;
+
+/**
+ * Stream frame callback
+ *
+ * Called on a pool worker. The frame is only valid for the duration of
+ * the call; its buffer goes back to the driver when the callback returns.
+ */
+typedef void (*dsv4l2_stream_cb)(dsv4l2_device_t *dev, const dsv4l2_frame_t *frame,
+                                 void *user_data);
+
+/* Stream options (see dsv4l2_stream_opts_init() for defaults) */
+typedef struct {
+    unsigned workers;           /* Processing workers (default 1) */
+    unsigned queue_depth;       /* Frames queued per worker (0 = buffer count,
+                                   or the adaptive maximum if larger) */
+    int      dequeue_cpu;       /* CPU for the dequeue thread, -1 = any */
+    int      worker_cpu_first;  /* Worker i runs on CPU first + i, -1 = any */
+    int      rt_priority;       /* SCHED_FIFO priority for dequeue, 0 = normal */
+} dsv4l2_stream_opts_t;
+
+/*
+ * Per-stage counters
+ *
+ * A frame moves driver -> queued (dequeued, waiting for a worker) ->
+ * processing (in a callback) -> driver. The depth_* fields are
+ * instantaneous queue depths; the rest are totals since start.
+ */
+typedef struct {
+    uint64_t frames_dequeued;   /* Frames taken from the driver */
+    uint64_t frames_processed;  /* Callbacks completed */
+    uint64_t frames_dropped;    /* Requeued unprocessed: every worker queue full */
+    uint64_t frames_stolen;     /* Frames run by a worker other than the one queued to */
+    uint32_t depth_driver;      /* Buffers owned by the driver */
+    uint32_t depth_queued;      /* Frames waiting for a worker */
+    uint32_t depth_processing;  /* Frames inside callbacks */
+    uint32_t max_depth_queued;  /* High-water mark of depth_queued */
+} dsv4l2_stream_stats_t;
+
+/**
+ * Fill stream options with defaults
+ */
+void dsv4l2_stream_opts_init(dsv4l2_stream_opts_t *opts);
+
+/**
+ * Start a push-style stream
+ *
+ * A dedicated thread dequeues frames (dsv4l2_frame_acquire(), so every
+ * frame passes the TEMPEST policy check) and hands them to the worker
+ * pool. Buffers must already be requested; only one stream (or other
+ * consumer) may dequeue from a device at a time.
+ *
+ * @param dev Device handle
+ * @param callback Frame callback (runs on workers)
+ * @param user_data Passed to callback
+ * @param opts Options, NULL for defaults
+ * @param out Output stream handle
+ * @return 0 on success, -EPERM if TEMPEST policy blocks capture or the
+ *         real-time priority is not permitted, negative errno otherwise
+ */
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_stream_start(dsv4l2_device_t *dev, dsv4l2_stream_cb callback,
+                        void *user_data, const dsv4l2_stream_opts_t *opts,
+                        dsv4l2_stream_t **out);
+
+/**
+ * Stop a stream
+ *
+ * Stops dequeuing, lets the workers finish the frames already queued and
+ * frees the stream. Streaming on the device is left on.
+ *
+ * @return 0, or the error that ended the dequeue thread early
+ */
+int dsv4l2_stream_stop(dsv4l2_stream_t *stream);
+
+/**
+ * Snapshot stream counters
+ */
+int dsv4l2_stream_get_stats(dsv4l2_stream_t *stream, dsv4l2_stream_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSV4L2_STREAM_H */
@@ -48,6 +48,7 @@ typedef enum {
     DSV4L2_EVENT_IRIS_CAPTURE         = 0x0042,
     DSV4L2_EVENT_META_READ            = 0x0050,
     DSV4L2_EVENT_FUSED_CAPTURE        = 0x0051,
+    DSV4L2_EVENT_COUNTER_SUMMARY      = 0x0060,  // Aggregated counts (see dsv4l2rt_summary_decode)
     DSV4L2_EVENT_ERROR                = 0x0100,
     DSV4L2_EVENT_POLICY_VIOLATION     = 0x0101,
     DSV4L2_EVENT_SECRET_LEAK_ATTEMPT  = 0x0102,
@@ -76,13 +77,50 @@ typedef struct {
     char     mission[32];        // Mission context (from -mdsv4l2-mission)
 } dsv4l2_event_t;
 
+/* ========================================================================
+ * Compact Event Layout
+ * ======================================================================== */
+
+/*
+ * Ring and compact-sink representation of an event: 24 bytes instead of
+ * 72, with role and mission replaced by IDs into a process-wide string
+ * table. Strings are interned on emit; each compact sink is told about a
+ * string once, before the first batch that can reference it. Ordinary
+ * sinks keep receiving expanded dsv4l2_event_t batches.
+ */
+#define DSV4L2RT_STRING_LEN       32      // Longest interned string (mission size)
+#define DSV4L2RT_STRING_MAX       1024    // Table capacity, IDs 0 .. MAX - 1
+#define DSV4L2RT_STRING_EMPTY     0       // ID of the empty string
+#define DSV4L2RT_STRING_OVERFLOW  0xFFFF  // Table full: expands to ""
+
+typedef struct {
+    uint64_t ts_ns;              // Nanosecond timestamp (CLOCK_MONOTONIC)
+    uint32_t dev_id;             // Device ID
+    uint16_t event_type;         // dsv4l2_event_type_t
+    uint8_t  severity;           // dsv4l2_severity_t
+    uint8_t  layer;              // DSMIL layer (L0-L8)
+    uint32_t aux;                // Event-specific data
+    uint16_t role_id;            // Interned role
+    uint16_t mission_id;         // Interned mission
+} dsv4l2rt_compact_event_t;
+
+/**
+ * Look up an interned string ("" for unknown IDs).
+ */
+const char *dsv4l2rt_string(uint16_t id);
+
+/**
+ * Expand a compact event into the full layout.
+ */
+void dsv4l2rt_event_expand(const dsv4l2rt_compact_event_t *in, dsv4l2_event_t *out);
+
 /* ========================================================================
  * Runtime Configuration
  * ======================================================================== */
 
 typedef enum {
     DSV4L2_PROFILE_OFF       = 0,  // No instrumentation
-    DSV4L2_PROFILE_OPS       = 1,  // Minimal counters (frames, errors, transitions)
+    DSV4L2_PROFILE_OPS       = 1,  // Minimal counters (frames, errors, transitions; no TEMPEST queries)
     DSV4L2_PROFILE_EXERCISE  = 2,  // Per-stream stats, metadata sampling
     DSV4L2_PROFILE_FORENSIC  = 3,  // Maximal logging (within policy)
 } dsv4l2_profile_t;
@@ -90,12 +128,23 @@ typedef enum {
 typedef struct {
     dsv4l2_profile_t profile;
     const char      *mission;
-    size_t           ring_buffer_size;  // Number of events to buffer
+    size_t           ring_buffer_size;  // Events per ring (0 = 4096, rounded up to a power of 2)
     int              enable_tpm_sign;   // TPM-signed event chunks for forensic integrity
     const char      *sink_type;         // "redis", "sqlite", "syslog", "file"
     const char      *sink_config;       // Connection string or path
+    size_t           flush_watermark;   // Buffered events that wake the flush thread (0 = capacity/4)
+    size_t           shard_count;       // Event rings (0/1 = one shared ring, DSV4L2RT_SHARDS_PER_CPU = one per CPU)
+    dsv4l2_severity_t min_severity;     // Drop events below this severity (CRITICAL always kept)
+    uint32_t         event_mask;        // DSV4L2RT_EVENT_BIT() of kept types (0 = profile default)
+    const char      *shm_name;          // Shared-memory ring for monitors (NULL = $DSV4L2_SHM or none)
+    dsv4l2_severity_t aggregate_below;  // OPS: count events below this severity in place (DEBUG = off)
+    uint32_t         aggregate_interval_ms; // Counter summary period (0 = 1000)
+    int              enable_io_uring;   // File sink writes via io_uring (or $DSV4L2_IO_URING=1)
 } dsv4l2rt_config_t;
 
+/* shard_count value requesting one ring per configured CPU */
+#define DSV4L2RT_SHARDS_PER_CPU ((size_t)-1)
+
 /* ========================================================================
  * Runtime API (called by DSLLVM-injected code)
  * ======================================================================== */
@@ -120,6 +169,88 @@ void dsv4l2rt_emit_simple(uint32_t dev_id,
                           dsv4l2_severity_t severity,
                           uint32_t aux);
 
+/* ========================================================================
+ * Inline Fast Path
+ * ======================================================================== */
+
+/*
+ * Event type bit for filter masks. Types 0x00g0-0x00g3 (g = 0..6) map to
+ * bits 4g..4g+3; the 0x010x error group maps to bits 28..31.
+ */
+#define DSV4L2RT_EVENT_BIT(type) \
+    (1u << ((((unsigned)(type) >> 8) ? 28u : (((unsigned)(type) >> 4) & 7u) * 4u) + \
+            ((unsigned)(type) & 3u)))
+
+#define DSV4L2RT_EVENT_MASK_ALL  0xFFFFFFFFu
+
+typedef enum {
+    DSV4L2RT_FILTER_UNINIT = 0,  // Runtime not initialized yet (emit auto-inits)
+    DSV4L2RT_FILTER_OFF    = 1,  // Profile OFF: drop everything
+    DSV4L2RT_FILTER_ACTIVE = 2,  // Apply min_severity and event_mask
+} dsv4l2rt_filter_state_t;
+
+/*
+ * Cached filter word, owned by the runtime. Read without locking by the
+ * inline check below so rejected events cost one load and a compare.
+ */
+typedef struct {
+    volatile int      state;         // dsv4l2rt_filter_state_t
+    volatile uint32_t min_severity;  // Drop events below this severity
+    volatile uint32_t event_mask;    // DSV4L2RT_EVENT_BIT() of kept types
+} dsv4l2rt_filter_t;
+
+extern dsv4l2rt_filter_t dsv4l2rt_filter;
+
+/**
+ * Check whether an event would be kept, before building it.
+ * CRITICAL events are never filtered while the runtime is active.
+ */
+static inline int dsv4l2rt_event_enabled(dsv4l2_event_type_t type,
+                                         dsv4l2_severity_t severity)
+{
+    int state = dsv4l2rt_filter.state;
+
+    if (state == DSV4L2RT_FILTER_ACTIVE) {
+        return severity >= DSV4L2_SEV_CRITICAL ||
+               ((uint32_t)severity >= dsv4l2rt_filter.min_severity &&
+                (dsv4l2rt_filter.event_mask & DSV4L2RT_EVENT_BIT(type)));
+    }
+
+    return state == DSV4L2RT_FILTER_UNINIT;
+}
+
+/**
+ * Override the profile's default filter.
+ *
+ * @param min_severity Lowest severity to keep
+ * @param event_mask OR of DSV4L2RT_EVENT_BIT() for kept types
+ * @return 0 on success, -EAGAIN if the runtime is not active
+ */
+int dsv4l2rt_set_filter(dsv4l2_severity_t min_severity, uint32_t event_mask);
+
+/*
+ * Call-site wrappers. With -DDSV4L2RT_DISABLED (PROFILE=off builds) the
+ * calls compile away entirely; otherwise the filter runs inline and the
+ * out-of-line emit is only reached for kept events. Use
+ * (dsv4l2rt_emit)(...) to bypass the wrapper.
+ */
+#ifdef DSV4L2RT_DISABLED
+#define dsv4l2rt_emit(ev) ((void)(ev))
+#define dsv4l2rt_emit_simple(dev_id, type, severity, aux) \
+    ((void)(dev_id), (void)(type), (void)(severity), (void)(aux))
+#else
+#define dsv4l2rt_emit(ev) do {                                           \
+        const dsv4l2_event_t *dsv4l2rt_ev_ = (ev);                       \
+        if (dsv4l2rt_event_enabled((dsv4l2_event_type_t)dsv4l2rt_ev_->event_type, \
+                                   (dsv4l2_severity_t)dsv4l2rt_ev_->severity)) \
+            (dsv4l2rt_emit)(dsv4l2rt_ev_);                               \
+    } while (0)
+#define dsv4l2rt_emit_simple(dev_id, type, severity, aux) do {           \
+        if (dsv4l2rt_event_enabled((type), (severity)))                  \
+            (dsv4l2rt_emit_simple)((dev_id), (type), (severity), (aux)); \
+    } while (0)
+#endif
+
 /**
  * Flush buffered events to the configured sink.
  * Can be called explicitly or triggered automatically by runtime.
@@ -147,12 +278,66 @@ typedef struct {
     uint64_t events_emitted;
     uint64_t events_dropped;
     uint64_t events_flushed;
-    size_t   buffer_usage;
-    size_t   buffer_capacity;
+    size_t   buffer_usage;       // Summed over all shards
+    size_t   buffer_capacity;    // Summed over all shards
+    size_t   shard_count;
+    uint64_t events_aggregated;  // Counted in place instead of buffered
 } dsv4l2rt_stats_t;
 
 void dsv4l2rt_get_stats(dsv4l2rt_stats_t *stats);
 
+/**
+ * Per-shard buffer stats (sharded mode), for sizing ring_buffer_size.
+ */
+typedef struct {
+    size_t   buffer_usage;
+    size_t   buffer_capacity;
+    uint64_t events_dropped;
+} dsv4l2rt_shard_stats_t;
+
+/**
+ * Get stats for one event ring.
+ *
+ * @param shard Shard index (0 .. stats.shard_count - 1)
+ * @param stats Output stats
+ * @return 0 on success, -ENOENT if shard is out of range, -EINVAL on NULL
+ */
+int dsv4l2rt_get_shard_stats(size_t shard, dsv4l2rt_shard_stats_t *stats);
+
+/* ========================================================================
+ * Counter Aggregation (OPS profile)
+ * ======================================================================== */
+
+/*
+ * With aggregate_below set, an OPS runtime does not buffer events below
+ * that severity. Each is added to a per-device, per-type counter (count
+ * and sum of aux: bytes for FRAME_ACQUIRED, frames for FRAME_DROPPED)
+ * and the counters are emitted as COUNTER_SUMMARY events every
+ * aggregate_interval_ms and on dsv4l2rt_flush(). Events at or above the
+ * threshold are buffered as usual. Totals are exact; an event racing a
+ * summary may be counted in the next window.
+ *
+ * A summary event carries dev_id, role and layer of the counted events,
+ * aux = counted event type and ts_ns = timestamp of the last counted
+ * event; the counts are packed into the mission field.
+ */
+#define DSV4L2RT_AGGREGATE_SLOTS  256   // (device, type) counters; overflow is buffered
+
+typedef struct {
+    uint16_t event_type;         // Counted dsv4l2_event_type_t
+    uint64_t count;              // Events in the window
+    uint64_t aux_sum;            // Sum of their aux values
+    uint64_t first_ts_ns;        // First counted event
+    uint64_t last_ts_ns;         // Last counted event
+} dsv4l2rt_summary_t;
+
+/**
+ * Decode a COUNTER_SUMMARY event.
+ *
+ * @return 0 on success, -EINVAL if ev is not a summary
+ */
+int dsv4l2rt_summary_decode(const dsv4l2_event_t *ev, dsv4l2rt_summary_t *out);
+
 /* ========================================================================
  * Integration Hooks (for DSMIL fabric)
  * ======================================================================== */
@@ -170,6 +355,95 @@ typedef void (*dsv4l2rt_sink_fn)(const dsv4l2_event_t *events,
  */
 int dsv4l2rt_register_sink(dsv4l2rt_sink_fn sink, void *user_data);
 
+/**
+ * Sink shutdown hook. Called from dsv4l2rt_shutdown() after the final
+ * flush, so the sink can drain its own queues and free user_data.
+ */
+typedef void (*dsv4l2rt_sink_close_fn)(void *user_data);
+
+/**
+ * Register a custom sink with a shutdown hook (close may be NULL).
+ */
+int dsv4l2rt_register_sink_ex(dsv4l2rt_sink_fn sink, dsv4l2rt_sink_close_fn close,
+                              void *user_data);
+
+/**
+ * Compact sink callbacks.
+ * The string callback runs once per interned string, in ID order, before
+ * the first batch that may reference it.
+ */
+typedef void (*dsv4l2rt_compact_sink_fn)(const dsv4l2rt_compact_event_t *events,
+                                         size_t count,
+                                         void *user_data);
+typedef void (*dsv4l2rt_string_fn)(uint16_t id, const char *str, void *user_data);
+
+/**
+ * Register a sink taking compact events (strings and close may be NULL).
+ * COUNTER_SUMMARY events arrive with aux = count (saturated) and
+ * mission_id = counted event type; byte sums need an expanded sink.
+ */
+int dsv4l2rt_register_compact_sink(dsv4l2rt_compact_sink_fn sink,
+                                   dsv4l2rt_string_fn strings,
+                                   dsv4l2rt_sink_close_fn close,
+                                   void *user_data);
+
+/**
+ * Register the human-readable log sink writing to fd.
+ * Registered automatically on stderr for EXERCISE/FORENSIC profiles.
+ * Lines are formatted on the flush thread and written with one writev()
+ * per batch.
+ */
+int dsv4l2rt_init_log_sink(int fd);
+
+/**
+ * Register the Redis pub/sub sink (requires HAVE_HIREDIS=1).
+ * Each batch is published as one message of packed dsv4l2_event_t records;
+ * events are spilled locally while the server is unreachable.
+ *
+ * @param host Redis host (NULL = 127.0.0.1)
+ * @param port Redis port
+ * @param channel Pub/sub channel (NULL = "dsv4l2:events")
+ * @return 0 on success, -1 on failure
+ */
+int dsv4l2rt_init_redis_sink(const char *host, int port, const char *channel);
+
+/* SQLite sink tuning (zeroed = defaults) */
+typedef struct {
+    const char      *synchronous;        // "OFF", "NORMAL" or "FULL" (NULL = "NORMAL")
+    size_t           commit_events;      // Events per transaction (0 = 4096)
+    uint32_t         commit_interval_ms; // Longest delay before a commit (0 = 1000)
+    size_t           queue_events;       // Writer queue capacity (0 = 65536)
+} dsv4l2rt_sqlite_config_t;
+
+/**
+ * Register the SQLite sink (requires HAVE_SQLITE3=1).
+ * Uses WAL journaling and a dedicated writer thread; the flush thread only
+ * copies batches into the writer queue (oldest events dropped when full).
+ * role/mission are interned in a strings table; the events_text view
+ * joins them back.
+ *
+ * @param db_path Database path
+ * @param config Tuning (NULL = defaults)
+ * @return 0 on success, -1 on failure
+ */
+int dsv4l2rt_init_sqlite_sink_ex(const char *db_path,
+                                 const dsv4l2rt_sqlite_config_t *config);
+
+/**
+ * Register the SQLite sink with default tuning.
+ */
+int dsv4l2rt_init_sqlite_sink(const char *db_path);
+
+/**
+ * Name of an event type ("UNKNOWN" if not a dsv4l2_event_type_t).
+ */
+const char *dsv4l2rt_event_name(uint16_t type);
+
+/**
+ * Name of a severity level ("UNKNOWN" if out of range).
+ */
+const char *dsv4l2rt_severity_name(uint16_t severity);
+
 /* ========================================================================
  * TPM / Forensic Support
  * ======================================================================== */
@@ -178,12 +452,15 @@ typedef struct {
     uint64_t chunk_id;
     uint64_t timestamp_ns;
     size_t   event_count;
-    uint8_t  tpm_signature[256];  // TPM-signed hash of event chunk
+    uint8_t  chain_digest[32];    // SHA-256(previous chain digest, header, events)
+    uint8_t  tpm_signature[256];  // Per-chunk signature; zero when covered by a signed Merkle root
 } dsv4l2rt_chunk_header_t;
 
 /**
  * Retrieve signed event chunk for forensic export.
- * Only available if enable_tpm_sign=1 in config.
+ * With enable_tpm_sign=1 the chunk is hash-chained (chain_digest) and
+ * covered by a batch root signed in the background; fetch its proof
+ * with dsv4l2_tpm_get_proof() after dsv4l2rt_flush().
  */
 int dsv4l2rt_get_signed_chunk(dsv4l2rt_chunk_header_t *header,
                                dsv4l2_event_t **events,
@@ -225,6 +502,320 @@ int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count,
 int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
                                  const uint8_t signature[256]);
 
+/*
+ * Signing pipeline
+ *
+ * Chunks are hash-chained as they are produced (each chain digest covers
+ * the previous one) and grouped into batches. A background thread builds
+ * a Merkle tree over each batch's chain digests and TPM-signs only the
+ * root, so a chunk costs one SHA-256 pass instead of one Esys_Sign().
+ * Any single chunk can later be verified from its inclusion proof.
+ */
+#define DSV4L2_TPM_BATCH_CHUNKS  16   // Default chunks per signed root
+#define DSV4L2_TPM_BATCH_MAX     64   // Largest batch
+#define DSV4L2_TPM_PROOF_DEPTH   6    // log2(DSV4L2_TPM_BATCH_MAX)
+
+typedef struct {
+    uint64_t batch_id;
+    uint64_t chunk_id;
+    uint32_t leaf_index;                          // Chunk position in batch
+    uint32_t leaf_count;                          // Chunks in batch
+    uint32_t depth;                               // Siblings used
+    uint32_t stub_signature;                      // 1 if no TPM signed the root
+    uint8_t  prev_digest[32];                     // Chain digest of the previous chunk
+    uint8_t  siblings[DSV4L2_TPM_PROOF_DEPTH][32];
+    uint8_t  root[32];                            // Merkle root
+    uint8_t  root_signature[256];                 // TPM signature over root
+} dsv4l2_tpm_proof_t;
+
+/**
+ * Start the signing pipeline with a new hash chain at chunk 0.
+ * dsv4l2rt_init with enable_tpm_sign uses dsv4l2_tpm_pipeline_resume()
+ * to continue the chain of a reopened chunk log.
+ *
+ * @param batch_chunks Chunks per signed root (0 = DSV4L2_TPM_BATCH_CHUNKS)
+ * @return 0 on success, -EINVAL if batch_chunks > DSV4L2_TPM_BATCH_MAX,
+ *         -errno on failure
+ */
+int dsv4l2_tpm_pipeline_start(size_t batch_chunks);
+
+/**
+ * Start the signing pipeline in the middle of an existing chain, e.g. a
+ * reopened chunk log: the first chunk gets first_chunk_id and is chained
+ * to prev_digest.
+ *
+ * @param batch_chunks Chunks per signed root (0 = DSV4L2_TPM_BATCH_CHUNKS)
+ * @param first_chunk_id ID of the next chunk
+ * @param prev_digest Chain digest of the previous chunk (NULL = new chain)
+ * @return As dsv4l2_tpm_pipeline_start()
+ */
+int dsv4l2_tpm_pipeline_resume(size_t batch_chunks, uint64_t first_chunk_id,
+                               const uint8_t prev_digest[32]);
+
+/**
+ * Seal the partial batch and wait until every sealed batch is signed.
+ */
+void dsv4l2_tpm_pipeline_flush(void);
+
+/**
+ * Flush and stop the signer thread. Proofs stay available until the next
+ * dsv4l2_tpm_pipeline_start().
+ */
+void dsv4l2_tpm_pipeline_stop(void);
+
+/**
+ * Append a chunk to the hash chain.
+ * Assigns header->chunk_id and fills header->chain_digest from
+ * header->timestamp_ns, header->event_count and the events.
+ *
+ * @return 0 on success, -EAGAIN if the pipeline is not running
+ */
+int dsv4l2_tpm_chain_chunk(dsv4l2rt_chunk_header_t *header,
+                           const dsv4l2_event_t *events);
+
+/**
+ * Append a chunk whose events were hashed incrementally.
+ * Same as dsv4l2_tpm_chain_chunk() with events_digest = SHA-256 of the
+ * header->event_count events.
+ *
+ * @return 0 on success, -EAGAIN if the pipeline is not running
+ */
+int dsv4l2_tpm_chain_digest(dsv4l2rt_chunk_header_t *header,
+                            const uint8_t events_digest[32]);
+
+/**
+ * Compute a chunk's chain digest (for offline chain verification):
+ * SHA-256(prev || chunk_id || timestamp_ns || event_count || SHA-256(events)),
+ * integers as little-endian u64.
+ */
+void dsv4l2_tpm_chunk_digest(const uint8_t prev_digest[32],
+                             const dsv4l2rt_chunk_header_t *header,
+                             const dsv4l2_event_t *events,
+                             uint8_t digest[32]);
+
+/**
+ * Get the inclusion proof of a chunk.
+ *
+ * @return 0 on success, -EAGAIN if its batch is not signed yet,
+ *         -ENOENT if the chunk is unknown or aged out of the history
+ */
+int dsv4l2_tpm_get_proof(uint64_t chunk_id, dsv4l2_tpm_proof_t *proof);
+
+/**
+ * Verify a single chunk against its inclusion proof and the signed root.
+ *
+ * @return 0 if valid, -EBADMSG if the chunk or proof does not match,
+ *         -ENOSYS if the root carries a stub signature (no TPM),
+ *         other -errno from signature verification
+ */
+int dsv4l2_tpm_verify_chunk(const dsv4l2rt_chunk_header_t *header,
+                            const dsv4l2_event_t *events,
+                            const dsv4l2_tpm_proof_t *proof);
+
+/* ========================================================================
+ * Event Log Reader
+ * ======================================================================== */
+
+/*
+ * The "file" sink writes each flushed batch as one chunk record and closes
+ * the log with a chunk index. The reader mmaps the file and hands out
+ * pointers into the mapping; they stay valid until dsv4l2rt_log_close().
+ */
+typedef struct dsv4l2rt_log dsv4l2rt_log_t;
+
+/**
+ * Open an event log written by the file sink.
+ * Logs without an index (unclean shutdown) are indexed by scanning.
+ *
+ * @param path Log file path
+ * @param out Output log handle
+ * @return 0 on success, -EINVAL if not an event log, -EPROTO on an
+ *         incompatible format version, -errno on failure
+ */
+int dsv4l2rt_log_open(const char *path, dsv4l2rt_log_t **out);
+
+/**
+ * Position the reader at the first event with ts_ns >= ts_ns.
+ *
+ * @return 0 on success, -ENODATA if every event is older
+ */
+int dsv4l2rt_log_seek(dsv4l2rt_log_t *log, uint64_t ts_ns);
+
+/**
+ * Read the next event.
+ *
+ * @return 0 on success, -ENODATA at end of log
+ */
+int dsv4l2rt_log_next(dsv4l2rt_log_t *log, const dsv4l2_event_t **ev);
+
+/**
+ * Read the next whole chunk (for signature verification).
+ *
+ * @return 0 on success, -ENODATA at end of log
+ */
+int dsv4l2rt_log_next_chunk(dsv4l2rt_log_t *log,
+                            const dsv4l2rt_chunk_header_t **header,
+                            const dsv4l2_event_t **events,
+                            size_t *count);
+
+/**
+ * Number of chunks in the log.
+ */
+size_t dsv4l2rt_log_chunk_count(const dsv4l2rt_log_t *log);
+
+/**
+ * Unmap and free a log handle.
+ */
+void dsv4l2rt_log_close(dsv4l2rt_log_t *log);
+
+/* ========================================================================
+ * Shared-Memory Event Ring
+ * ======================================================================== */
+
+/*
+ * With shm_name set (or DSV4L2_SHM in the environment) the runtime also
+ * mirrors every kept event into a POSIX shared-memory ring and publishes
+ * a stats snapshot after each flush. Monitors in other processes attach
+ * read-only; the producer never waits for them, so a reader that falls
+ * more than one ring behind loses the overwritten events.
+ */
+#define DSV4L2RT_SHM_DEFAULT_NAME "/dsv4l2rt"
+
+typedef struct dsv4l2rt_shm dsv4l2rt_shm_t;
+
+/**
+ * Attach to a producer's event ring.
+ * The reader starts at the newest event (tail mode).
+ *
+ * @param name Object name given to the producer ("/name" or "name")
+ * @param out Output reader handle
+ * @return 0 on success, -ENOENT if no producer published the ring,
+ *         -EINVAL if the object is not an event ring, -EPROTO on an
+ *         incompatible layout, -errno on failure
+ */
+int dsv4l2rt_shm_open(const char *name, dsv4l2rt_shm_t **out);
+
+/**
+ * Move the reader back to the oldest event still in the ring.
+ */
+void dsv4l2rt_shm_rewind(dsv4l2rt_shm_t *shm);
+
+/**
+ * Copy out events published since the previous read.
+ *
+ * @param events Output array
+ * @param max Capacity of events
+ * @param lost Events overwritten before they could be read (may be NULL)
+ * @return Number of events copied (0 if none yet), -EPIPE once the
+ *         producer has shut down and every event was read
+ */
+int dsv4l2rt_shm_read(dsv4l2rt_shm_t *shm, dsv4l2_event_t *events, size_t max,
+                      uint64_t *lost);
+
+/**
+ * Read the producer's latest stats snapshot (updated once per flush).
+ *
+ * @param published Events published into the ring so far (may be NULL)
+ * @return 0 on success, -EAGAIN if the snapshot kept changing
+ */
+int dsv4l2rt_shm_stats(const dsv4l2rt_shm_t *shm, dsv4l2rt_stats_t *stats,
+                       uint64_t *published);
+
+/**
+ * Producer process ID, or -EPIPE once the producer has shut down.
+ */
+int dsv4l2rt_shm_pid(const dsv4l2rt_shm_t *shm);
+
+/**
+ * Detach from an event ring.
+ */
+void dsv4l2rt_shm_close(dsv4l2rt_shm_t *shm);
+
+/* ========================================================================
+ * Asynchronous File I/O
+ * ======================================================================== */
+
+/*
+ * Optional io_uring backend shared by the file sink and frame recorders.
+ * A single submission thread per process keeps every caller's writes in
+ * flight; callers only queue requests and get a completion callback.
+ * Buffers taken from the staging arena are registered with the ring, so
+ * their writes skip the per-I/O page mapping. When io_uring is not
+ * available (old kernel, seccomp, DSV4L2_NO_IO_URING set)
+ * dsv4l2rt_io_start() fails and callers keep their synchronous path.
+ */
+#define DSV4L2RT_IO_ARENA_DEFAULT  ((size_t)8 << 20)
+
+#define DSV4L2RT_IO_FSYNC    (1u << 0)  // Linked fsync, run only if the write succeeds
+#define DSV4L2RT_IO_RELEASE  (1u << 1)  // Return buf to the arena after completion
+
+/**
+ * Completion callback, run on the submission thread.
+ * It may queue more I/O but must not call dsv4l2rt_io_sync() or
+ * dsv4l2rt_io_drain().
+ *
+ * @param result Bytes written (or 0 for a sync) on success, negative
+ *               errno on failure (-EIO for a short write)
+ */
+typedef void (*dsv4l2rt_io_done_fn)(void *user_data, int result);
+
+/**
+ * Start the I/O engine (reference counted).
+ *
+ * @param arena_size Staging arena bytes (0 = DSV4L2RT_IO_ARENA_DEFAULT);
+ *                   only the first caller's size is used
+ * @return 0 on success, negative errno if io_uring is unavailable
+ */
+int dsv4l2rt_io_start(size_t arena_size);
+
+/**
+ * Drop a reference; the last one completes all queued I/O and stops
+ * the engine.
+ */
+void dsv4l2rt_io_stop(void);
+
+/**
+ * Take a page-aligned buffer from the staging arena.
+ *
+ * @return Buffer, or NULL if the engine is not running or the arena is
+ *         exhausted (wait with dsv4l2rt_io_drain() or write synchronously)
+ */
+void *dsv4l2rt_io_buffer_alloc(size_t size);
+
+/**
+ * Return an arena buffer (NULL is ignored).
+ */
+void dsv4l2rt_io_buffer_free(void *buf);
+
+/**
+ * Queue a positional write.
+ *
+ * buf must stay valid until the callback runs. Writes to the same file
+ * may complete in any order.
+ *
+ * @param flags DSV4L2RT_IO_FSYNC and/or DSV4L2RT_IO_RELEASE
+ * @param done Completion callback (may be NULL)
+ * @return 0 if queued, -ENODEV if the engine is not running, negative
+ *         errno otherwise (the callback is not run)
+ */
+int dsv4l2rt_io_write(int fd, const void *buf, size_t len, uint64_t offset,
+                      unsigned flags, dsv4l2rt_io_done_fn done, void *user_data);
+
+/**
+ * fsync() a file after every write queued before the call has completed.
+ * Blocks until the fsync is done.
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int dsv4l2rt_io_sync(int fd);
+
+/**
+ * Wait until every queued write has completed and its callback returned.
+ *
+ * @return 0, or the negative errno of a fatal ring failure
+ */
+int dsv4l2rt_io_drain(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -3,8 +3,19 @@
  *
  * Measures performance of critical operations for regression testing.
  * Tracks performance over time to detect slowdowns.
+ *
+ * Every benchmark runs its operation in batches timed with
+ * CLOCK_MONOTONIC; the per-op time of each batch goes into a latency
+ * histogram, so results carry p50/p99/max next to the mean. Throughput
+ * is the best of several repeats. scripts/run_perf.sh (make perf)
+ * compares a run against perf/baseline.json.
+ *
+ * Usage: benchmark [-q] [-r repeats] [-t max_threads] [-d device]
+ *                  [-f frames] [output.json]
  */
 
+#define _GNU_SOURCE
+#include "dsv4l2_core.h"
 #include "dsv4l2_dsmil.h"
 #include "dsv4l2_metadata.h"
 #include "dsv4l2_profiles.h"
@@ -12,41 +23,162 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
 #include <time.h>
-#include <sys/time.h>
+#include <unistd.h>
 
 /* Benchmark iterations */
 #define ITERATIONS_SMALL  100000   /* 100K iterations */
 #define ITERATIONS_MEDIUM 10000    /* 10K iterations */
 #define ITERATIONS_LARGE  1000     /* 1K iterations */
 
+#define BATCH_FAST        64       /* Ops per timed batch for sub-µs operations */
+#define MAX_THREADS       64
+#define SINK_BATCH        8192     /* Events emitted between sink flushes */
+
+/* Run options */
+static struct {
+    unsigned    scale;             /* Iteration divisor (-q = 10) */
+    unsigned    repeats;           /* Best-of-N throughput */
+    unsigned    max_threads;       /* Contention sweep upper bound */
+    const char *device;            /* Capture device (NULL = first vivid node) */
+    unsigned    frames;            /* Frames for the capture benchmark */
+} opts = {
+    .scale = 1,
+    .repeats = 5,
+    .frames = 300,
+};
+
 /* Timing helpers */
-static double get_time_ms(void)
+static uint64_t get_time_ns(void)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return (tv.tv_sec * 1000.0) + (tv.tv_usec / 1000.0);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
 }
 
 /* Benchmark results */
 typedef struct {
-    const char *name;
+    char name[48];
     double ops_per_sec;
     double time_per_op_ns;
+    int has_tail;               /* Per-op latency percentiles below are valid */
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    double bytes_per_op;        /* > 0: throughput is also reported in MB/s */
+    unsigned threads;           /* > 0: multi-threaded run */
+    int informational;          /* Not gated (e.g. device-paced frame rate) */
 } benchmark_result_t;
 
-static benchmark_result_t results[32];
-static int result_count = 0;
+static benchmark_result_t *results = NULL;
+static size_t result_count = 0;
+static size_t result_capacity = 0;
+
+static benchmark_result_t *record_result(const char *name, uint64_t iterations,
+                                         uint64_t elapsed_ns)
+{
+    benchmark_result_t *r;
+
+    if (result_count == result_capacity) {
+        size_t new_cap = result_capacity ? result_capacity * 2 : 32;
+        benchmark_result_t *grown = realloc(results, new_cap * sizeof(*results));
+
+        if (!grown) {
+            fprintf(stderr, "Error: Out of memory for results\n");
+            exit(1);
+        }
+        results = grown;
+        result_capacity = new_cap;
+    }
+
+    r = &results[result_count++];
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    if (elapsed_ns == 0) {
+        elapsed_ns = 1;
+    }
+    r->ops_per_sec = iterations * 1e9 / elapsed_ns;
+    r->time_per_op_ns = (double)elapsed_ns / iterations;
+    return r;
+}
+
+static void record_tail(benchmark_result_t *r, const dsv4l2_histogram_t *h)
+{
+    if (h->count == 0) {
+        return;
+    }
+
+    r->has_tail = 1;
+    r->p50_ns = dsv4l2_histogram_percentile(h, 50.0);
+    r->p99_ns = dsv4l2_histogram_percentile(h, 99.0);
+    r->p999_ns = dsv4l2_histogram_percentile(h, 99.9);
+    r->max_ns = h->max_ns;
+}
+
+/* ========================================================================
+ * Timed runner
+ * ======================================================================== */
 
-static void record_result(const char *name, int iterations, double elapsed_ms)
+typedef void (*bench_op_fn)(void *ctx, uint64_t i);
+
+/**
+ * Run op() 'iterations' times per repeat, timing batches of 'batch' ops
+ *
+ * Throughput is the best repeat; the histogram collects the per-op time
+ * of every batch of every repeat.
+ */
+static benchmark_result_t *run_timed(const char *name, bench_op_fn op, void *ctx,
+                                     uint64_t iterations, uint32_t batch)
 {
-    double ops_per_sec = (iterations / elapsed_ms) * 1000.0;
-    double time_per_op_ns = (elapsed_ms * 1000000.0) / iterations;
+    static dsv4l2_histogram_t h;
+    uint64_t best = UINT64_MAX;
+    benchmark_result_t *r;
+
+    memset(&h, 0, sizeof(h));
+    iterations = iterations / opts.scale ? iterations / opts.scale : 1;
+    if (batch == 0) {
+        batch = 1;
+    }
+
+    for (unsigned rep = 0; rep < opts.repeats; rep++) {
+        uint64_t start = get_time_ns(), elapsed;
+
+        for (uint64_t i = 0; i < iterations; ) {
+            uint64_t n = iterations - i < batch ? iterations - i : batch;
+            uint64_t t0 = get_time_ns();
+
+            for (uint64_t j = 0; j < n; j++) {
+                op(ctx, i + j);
+            }
+            dsv4l2_histogram_record(&h, (get_time_ns() - t0) / n);
+            i += n;
+        }
+
+        elapsed = get_time_ns() - start;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
 
-    results[result_count].name = name;
-    results[result_count].ops_per_sec = ops_per_sec;
-    results[result_count].time_per_op_ns = time_per_op_ns;
-    result_count++;
+    r = record_result(name, iterations, best);
+    record_tail(r, &h);
+    return r;
+}
+
+/* ========================================================================
+ * Core operations
+ * ======================================================================== */
+
+static void op_emit(void *ctx, uint64_t i)
+{
+    (void)ctx;
+    dsv4l2rt_emit_simple(0x12345678, DSV4L2_EVENT_CAPTURE_START,
+                         DSV4L2_SEV_INFO, (uint32_t)i);
 }
 
 /* Benchmark 1: Event emission */
@@ -62,36 +194,38 @@ static void benchmark_event_emission(void)
     };
 
     dsv4l2rt_init(&config);
-
-    double start = get_time_ms();
-    for (int i = 0; i < ITERATIONS_SMALL; i++) {
-        dsv4l2rt_emit_simple(0x12345678, DSV4L2_EVENT_CAPTURE_START,
-                             DSV4L2_SEV_INFO, i);
-    }
-    double elapsed = get_time_ms() - start;
-
+    run_timed("event_emission", op_emit, NULL, ITERATIONS_SMALL, BATCH_FAST);
     dsv4l2rt_shutdown();
-
-    record_result("event_emission", ITERATIONS_SMALL, elapsed);
 }
 
 /* Benchmark 2: THREATCON operations */
+static void op_threatcon(void *ctx, uint64_t i)
+{
+    (void)ctx;
+    dsv4l2_set_threatcon((dsmil_threatcon_t)(i % 6));  /* Cycle through all levels */
+    volatile dsmil_threatcon_t t = dsv4l2_get_threatcon();
+    (void)t;
+}
+
 static void benchmark_threatcon(void)
 {
     dsv4l2_policy_init();
+    run_timed("threatcon_ops", op_threatcon, NULL, ITERATIONS_SMALL, BATCH_FAST);
+}
 
-    double start = get_time_ms();
-    for (int i = 0; i < ITERATIONS_SMALL; i++) {
-        dsv4l2_set_threatcon((i % 6));  /* Cycle through all levels */
-        volatile dsmil_threatcon_t t = dsv4l2_get_threatcon();
-        (void)t;
-    }
-    double elapsed = get_time_ms() - start;
+/* Benchmark 3: KLV parsing */
+static void op_klv_parse(void *ctx, uint64_t i)
+{
+    const dsv4l2_klv_buffer_t *buffer = ctx;
+    dsv4l2_klv_item_t *items = NULL;
+    size_t count = 0;
 
-    record_result("threatcon_ops", ITERATIONS_SMALL, elapsed);
+    (void)i;
+    if (dsv4l2_parse_klv(buffer, &items, &count) == 0 && items) {
+        free(items);
+    }
 }
 
-/* Benchmark 3: KLV parsing */
 static void benchmark_klv_parsing(void)
 {
     /* Create sample KLV data */
@@ -110,41 +244,157 @@ static void benchmark_klv_parsing(void)
         .sequence = 0
     };
 
-    double start = get_time_ms();
-    for (int i = 0; i < ITERATIONS_MEDIUM; i++) {
-        dsv4l2_klv_item_t *items = NULL;
-        size_t count = 0;
+    run_timed("klv_parsing", op_klv_parse, &buffer, ITERATIONS_MEDIUM, BATCH_FAST);
+}
+
+/* Benchmark 4: KLV parse throughput by payload size */
+static void benchmark_klv_sizes(void)
+{
+    static const struct { const char *name; size_t bytes; } sizes[] = {
+        { "klv_parse_256b", 256 },
+        { "klv_parse_4k",   4096 },
+        { "klv_parse_64k",  65536 },
+    };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        /* Back-to-back items: 16-byte key, BER length 32, 32-byte value */
+        const size_t item = 16 + 1 + 32;
+        size_t n = sizes[s].bytes / item, off = 0;
+        uint8_t *data = calloc(1, n * item);
+        dsv4l2_klv_buffer_t buffer;
+        benchmark_result_t *r;
+
+        if (!data) {
+            continue;
+        }
+        for (size_t k = 0; k < n; k++) {
+            static const uint8_t key[16] = {
+                0x06, 0x0e, 0x2b, 0x34, 0x02, 0x0b, 0x01, 0x01,
+                0x0e, 0x01, 0x03, 0x01, 0x01, 0x00, 0x00, 0x00
+            };
+
+            memcpy(data + off, key, sizeof(key));
+            data[off + 16] = 32;
+            memset(data + off + 17, (int)k, 32);
+            off += item;
+        }
+
+        memset(&buffer, 0, sizeof(buffer));
+        buffer.data = data;
+        buffer.length = off;
+
+        r = run_timed(sizes[s].name, op_klv_parse, &buffer,
+                      ITERATIONS_MEDIUM * 256 / (sizes[s].bytes / 16 + 1) + 100,
+                      sizes[s].bytes >= 65536 ? 1 : 16);
+        r->bytes_per_op = (double)off;
+        free(data);
+    }
+}
+
+/* Benchmark 5: IR radiometric decode throughput by frame size */
+typedef struct {
+    const uint16_t *raw;
+    uint16_t       *map;
+    uint32_t        width;
+    uint32_t        height;
+} ir_ctx_t;
+
+static void op_ir_decode(void *ctx, uint64_t i)
+{
+    const ir_ctx_t *ir = ctx;
+    static const float calibration[2] = { 0.04f, 0.0f };
+
+    (void)i;
+    dsv4l2_decode_ir_into(ir->raw, ir->width, ir->height, calibration,
+                          ir->map, 0, NULL);
+}
 
-        int rc = dsv4l2_parse_klv(&buffer, &items, &count);
-        if (rc == 0 && items) {
-            free(items);
+static void benchmark_ir_decode(void)
+{
+    static const struct { const char *name; uint32_t w, h; unsigned iters; } sizes[] = {
+        { "ir_decode_160x120",   160,  120,  ITERATIONS_MEDIUM },
+        { "ir_decode_640x512",   640,  512,  ITERATIONS_LARGE },
+        { "ir_decode_1280x1024", 1280, 1024, ITERATIONS_LARGE / 4 },
+    };
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t pixels = (size_t)sizes[s].w * sizes[s].h;
+        uint16_t *raw = malloc(pixels * sizeof(uint16_t));
+        uint16_t *map = malloc(pixels * sizeof(uint16_t));
+        benchmark_result_t *r;
+        ir_ctx_t ir;
+
+        if (!raw || !map) {
+            free(raw);
+            free(map);
+            continue;
         }
+        for (size_t p = 0; p < pixels; p++) {
+            raw[p] = (uint16_t)(7000 + (p * 31) % 1000);
+        }
+
+        ir.raw = raw;
+        ir.map = map;
+        ir.width = sizes[s].w;
+        ir.height = sizes[s].h;
+
+        r = run_timed(sizes[s].name, op_ir_decode, &ir, sizes[s].iters, 1);
+        r->bytes_per_op = (double)(pixels * sizeof(uint16_t));
+
+        free(raw);
+        free(map);
     }
-    double elapsed = get_time_ms() - start;
+}
 
-    record_result("klv_parsing", ITERATIONS_MEDIUM, elapsed);
+/* Benchmark 6: Profile lookup */
+static void op_profile_lookup(void *ctx, uint64_t i)
+{
+    (void)ctx;
+    volatile const dsv4l2_device_profile_t *p =
+        (i & 1) ? dsv4l2_find_profile("generic_webcam")
+                : dsv4l2_find_profile_by_role("camera");
+    (void)p;
 }
 
-/* Benchmark 4: IR radiometric temperature extraction */
+static void benchmark_profile_lookup(void)
+{
+    dsv4l2_get_profile_count();     /* Load outside the timed loop */
+    run_timed("profile_lookup", op_profile_lookup, NULL, ITERATIONS_SMALL, BATCH_FAST);
+}
 
-/* Benchmark 5: Profile loading */
+/* Benchmark 7: Clearance checking */
+static void op_clearance(void *ctx, uint64_t i)
+{
+    (void)ctx;
+    (void)i;
+    volatile int rc = dsv4l2_check_clearance("generic_webcam", "UNCLASSIFIED");
+    (void)rc;
+}
 
-/* Benchmark 6: Clearance checking */
 static void benchmark_clearance_check(void)
 {
     dsv4l2_policy_init();
+    run_timed("clearance_check", op_clearance, NULL, ITERATIONS_SMALL, BATCH_FAST);
+}
 
-    double start = get_time_ms();
-    for (int i = 0; i < ITERATIONS_SMALL; i++) {
-        volatile int rc = dsv4l2_check_clearance("generic_webcam", "UNCLASSIFIED");
-        (void)rc;
+/* Benchmark 8: Event buffer operations */
+static void op_event_buffer(void *ctx, uint64_t i)
+{
+    dsv4l2rt_chunk_header_t header;
+    dsv4l2_event_t *events = NULL;
+    size_t count = 0;
+
+    (void)ctx;
+    int rc = dsv4l2rt_get_signed_chunk(&header, &events, &count);
+    if (rc == 0 && events) {
+        free(events);
     }
-    double elapsed = get_time_ms() - start;
 
-    record_result("clearance_check", ITERATIONS_SMALL, elapsed);
+    /* Refill buffer */
+    dsv4l2rt_emit_simple(0x12345678, DSV4L2_EVENT_CAPTURE_START,
+                         DSV4L2_SEV_INFO, (uint32_t)i);
 }
 
-/* Benchmark 7: Event buffer operations */
 static void benchmark_event_buffer(void)
 {
     dsv4l2rt_config_t config = {
@@ -164,27 +414,355 @@ static void benchmark_event_buffer(void)
                              DSV4L2_SEV_INFO, i);
     }
 
-    double start = get_time_ms();
-    for (int i = 0; i < ITERATIONS_MEDIUM; i++) {
-        dsv4l2rt_chunk_header_t header;
-        dsv4l2_event_t *events = NULL;
-        size_t count = 0;
+    run_timed("event_buffer_ops", op_event_buffer, NULL, ITERATIONS_MEDIUM, 16);
+
+    dsv4l2rt_shutdown();
+}
+
+/* Benchmark 9: Histogram recording */
+static void op_histogram(void *ctx, uint64_t i)
+{
+    dsv4l2_histogram_t *h = ctx;
+    uint64_t v = 88172645463325252ULL ^ (i * 0x9E3779B97F4A7C15ULL);
+
+    /* xorshift: spread samples over all buckets */
+    v ^= v << 13;
+    v ^= v >> 7;
+    v ^= v << 17;
+    dsv4l2_histogram_record(h, v >> (v & 63));
+}
+
+static void benchmark_histogram_record(void)
+{
+    static dsv4l2_histogram_t h;
+
+    memset(&h, 0, sizeof(h));
+    run_timed("histogram_record", op_histogram, &h, ITERATIONS_SMALL, BATCH_FAST);
+}
+
+/* Benchmark 10: Event emission tail latency (each call timed) */
+static void benchmark_emission_tail(void)
+{
+    dsv4l2rt_config_t config = {
+        .profile = DSV4L2_PROFILE_OPS,
+        .mission = "benchmark",
+        .ring_buffer_size = 4096,
+        .enable_tpm_sign = 0,
+        .sink_type = NULL,
+        .sink_config = NULL
+    };
+
+    dsv4l2rt_init(&config);
+    run_timed("event_emission_tail", op_emit, NULL, ITERATIONS_SMALL, 1);
+    dsv4l2rt_shutdown();
+}
+
+/* ========================================================================
+ * Emit contention
+ * ======================================================================== */
+
+typedef struct {
+    const int          *go;
+    uint64_t            iterations;
+    uint64_t            start_ns;
+    uint64_t            end_ns;
+    dsv4l2_histogram_t  hist;
+} emit_worker_t;
+
+static void *emit_worker(void *arg)
+{
+    emit_worker_t *w = arg;
+
+    while (!__atomic_load_n(w->go, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+    w->start_ns = get_time_ns();
+    for (uint64_t i = 0; i < w->iterations; i += BATCH_FAST) {
+        uint64_t t0 = get_time_ns();
 
-        int rc = dsv4l2rt_get_signed_chunk(&header, &events, &count);
-        if (rc == 0 && events) {
-            free(events);
+        for (uint32_t j = 0; j < BATCH_FAST; j++) {
+            op_emit(NULL, i + j);
         }
+        dsv4l2_histogram_record(&w->hist, (get_time_ns() - t0) / BATCH_FAST);
+    }
+    w->end_ns = get_time_ns();
 
-        /* Refill buffer */
-        dsv4l2rt_emit_simple(0x12345678, DSV4L2_EVENT_CAPTURE_START,
-                             DSV4L2_SEV_INFO, i);
+    return NULL;
+}
+
+/**
+ * Emit from 'threads' threads at once into one runtime
+ *
+ * ops_per_sec is the aggregate over all threads, timed from the first
+ * worker starting to the last finishing; the tail is per emit.
+ */
+static void run_contention(const char *label, size_t shard_count, unsigned threads)
+{
+    static emit_worker_t workers[MAX_THREADS];
+    static dsv4l2_histogram_t merged;
+    pthread_t tids[MAX_THREADS];
+    uint64_t per_thread = ITERATIONS_SMALL / opts.scale;
+    uint64_t best = UINT64_MAX;
+    benchmark_result_t *r;
+    char name[48];
+    dsv4l2rt_config_t config = {
+        .profile = DSV4L2_PROFILE_OPS,
+        .mission = "benchmark",
+        .ring_buffer_size = 65536,
+        .shard_count = shard_count,
+    };
+
+    per_thread = (per_thread + BATCH_FAST - 1) / BATCH_FAST * BATCH_FAST;
+    memset(&merged, 0, sizeof(merged));
+
+    for (unsigned rep = 0; rep < opts.repeats; rep++) {
+        unsigned started = 0;
+        uint64_t first = UINT64_MAX, last = 0, elapsed;
+        int go = 0;
+
+        if (dsv4l2rt_init(&config) != 0) {
+            return;
+        }
+
+        for (unsigned t = 0; t < threads; t++) {
+            memset(&workers[t], 0, sizeof(workers[t]));
+            workers[t].go = &go;
+            workers[t].iterations = per_thread;
+            if (pthread_create(&tids[t], NULL, emit_worker, &workers[t]) != 0) {
+                break;
+            }
+            started++;
+        }
+
+        __atomic_store_n(&go, 1, __ATOMIC_RELEASE);
+        for (unsigned t = 0; t < started; t++) {
+            pthread_join(tids[t], NULL);
+        }
+
+        dsv4l2rt_shutdown();
+
+        if (started < threads) {
+            return;
+        }
+        for (unsigned t = 0; t < threads; t++) {
+            dsv4l2_histogram_merge(&merged, &workers[t].hist);
+            if (workers[t].start_ns < first) {
+                first = workers[t].start_ns;
+            }
+            if (workers[t].end_ns > last) {
+                last = workers[t].end_ns;
+            }
+        }
+        elapsed = last - first;
+        if (elapsed < best) {
+            best = elapsed;
+        }
     }
-    double elapsed = get_time_ms() - start;
 
-    dsv4l2rt_shutdown();
+    snprintf(name, sizeof(name), "emit_%s_%ut", label, threads);
+    r = record_result(name, per_thread * threads, best);
+    r->threads = threads;
+    record_tail(r, &merged);
+}
+
+/* Benchmark 11: Emit scaling over 1..N threads, shared ring and per-CPU shards */
+static void benchmark_emit_contention(void)
+{
+    unsigned t = 1;
+
+    for (;;) {
+        run_contention("shared", 0, t);
+        run_contention("sharded", DSV4L2RT_SHARDS_PER_CPU, t);
+
+        if (t == opts.max_threads) {
+            break;
+        }
+        t = t * 2 > opts.max_threads ? opts.max_threads : t * 2;
+    }
+}
+
+/* ========================================================================
+ * Sink throughput
+ * ======================================================================== */
+
+typedef int (*sink_setup_fn)(const char *path);
+
+/**
+ * Events per second from emit to durable sink, flushing every SINK_BATCH
+ *
+ * The tail is the per-event cost of each emit+flush batch; the final
+ * shutdown (sink close) is part of the throughput figure.
+ */
+static void run_sink(const char *name, dsv4l2rt_config_t *config,
+                     sink_setup_fn setup, const char *path)
+{
+    static dsv4l2_histogram_t h;
+    uint64_t events = (ITERATIONS_SMALL * 2) / opts.scale;
+    uint64_t best = UINT64_MAX;
+    benchmark_result_t *r;
+
+    memset(&h, 0, sizeof(h));
+    events = (events + SINK_BATCH - 1) / SINK_BATCH * SINK_BATCH;
+
+    for (unsigned rep = 0; rep < opts.repeats; rep++) {
+        uint64_t start, elapsed;
+
+        unlink(path);
+        if (dsv4l2rt_init(config) != 0) {
+            return;
+        }
+        if (setup && setup(path) != 0) {
+            dsv4l2rt_shutdown();
+            return;
+        }
+
+        start = get_time_ns();
+        for (uint64_t i = 0; i < events; i += SINK_BATCH) {
+            uint64_t t0 = get_time_ns();
+
+            for (uint32_t j = 0; j < SINK_BATCH; j++) {
+                op_emit(NULL, i + j);
+            }
+            dsv4l2rt_flush();
+            dsv4l2_histogram_record(&h, (get_time_ns() - t0) / SINK_BATCH);
+        }
+        dsv4l2rt_shutdown();
+        elapsed = get_time_ns() - start;
+
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    unlink(path);
+    r = record_result(name, events, best);
+    r->bytes_per_op = sizeof(dsv4l2_event_t);
+    record_tail(r, &h);
+}
 
-    record_result("event_buffer_ops", ITERATIONS_MEDIUM, elapsed);
+#ifdef HAVE_SQLITE3
+static int setup_sqlite(const char *path)
+{
+    return dsv4l2rt_init_sqlite_sink(path);
+}
+#endif
+
+#ifdef HAVE_HIREDIS
+static int setup_redis(const char *path)
+{
+    (void)path;
+    return dsv4l2rt_init_redis_sink(NULL, 6379, "dsv4l2:benchmark");
 }
+#endif
+
+/* Benchmark 12: File (pwritev and io_uring), SQLite and Redis sinks */
+static void benchmark_sinks(void)
+{
+    const char *path = "/tmp/dsv4l2_bench_sink.bin";
+    dsv4l2rt_config_t config = {
+        .profile = DSV4L2_PROFILE_OPS,
+        .mission = "benchmark",
+        .ring_buffer_size = SINK_BATCH * 2,
+        .sink_type = "file",
+        .sink_config = path,
+    };
+
+    run_sink("sink_file", &config, NULL, path);
+
+    config.enable_io_uring = 1;
+    run_sink("sink_file_io_uring", &config, NULL, path);
+
+    config.enable_io_uring = 0;
+    config.sink_type = NULL;
+    config.sink_config = NULL;
+#ifdef HAVE_SQLITE3
+    run_sink("sink_sqlite", &config, setup_sqlite, "/tmp/dsv4l2_bench_sink.db");
+#endif
+#ifdef HAVE_HIREDIS
+    run_sink("sink_redis", &config, setup_redis, "/tmp/dsv4l2_bench_sink.redis");
+#endif
+}
+
+/* ========================================================================
+ * End-to-end capture
+ * ======================================================================== */
+
+/**
+ * First vivid (virtual video test driver) capture node, if loaded
+ */
+static const char *find_vivid(char *path, size_t size)
+{
+    dsv4l2_device_info_t *devs = NULL;
+    size_t count = 0;
+    const char *found = NULL;
+
+    if (dsv4l2_probe_devices(&devs, &count) != 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(devs[i].driver, "vivid") == 0 &&
+            (devs[i].device_caps & V4L2_CAP_VIDEO_CAPTURE)) {
+            snprintf(path, size, "%s", devs[i].path);
+            found = path;
+            break;
+        }
+    }
+
+    free(devs);
+    return found;
+}
+
+/* Benchmark 13: Driver timestamp to frame-in-hand latency (vivid) */
+static int benchmark_capture_e2e(void)
+{
+    static dsv4l2_histogram_t h;
+    dsv4l2_device_t *dev = NULL;
+    char path[64];
+    const char *device = opts.device ? opts.device : find_vivid(path, sizeof(path));
+    uint64_t start, captured = 0;
+    benchmark_result_t *r;
+
+    if (!device || dsv4l2_open(device, "camera", &dev) != 0) {
+        return -ENODEV;
+    }
+    if (dsv4l2_start_streaming(dev) != 0) {
+        dsv4l2_close(dev);
+        return -EIO;
+    }
+
+    memset(&h, 0, sizeof(h));
+    start = get_time_ns();
+    while (captured < opts.frames) {
+        dsv4l2_frame_t frame;
+        uint64_t now;
+
+        if (dsv4l2_frame_acquire(dev, &frame, 2000) != 0) {
+            break;
+        }
+        now = get_time_ns();
+        dsv4l2_histogram_record(&h, now > frame.timestamp_ns ? now - frame.timestamp_ns : 0);
+        dsv4l2_frame_release(dev, &frame);
+        captured++;
+    }
+
+    dsv4l2_stop_streaming(dev);
+    dsv4l2_close(dev);
+
+    if (captured == 0) {
+        return -EIO;
+    }
+
+    /* Frame rate is paced by the device: report, don't gate, throughput */
+    r = record_result("capture_e2e", captured, get_time_ns() - start);
+    r->informational = 1;
+    record_tail(r, &h);
+    return 0;
+}
+
+/* ========================================================================
+ * Reporting
+ * ======================================================================== */
 
 /* Print results */
 static void print_results(void)
@@ -194,14 +772,24 @@ static void print_results(void)
     printf("║            DSV4L2 Performance Benchmark Results                 ║\n");
     printf("╚══════════════════════════════════════════════════════════════════╝\n");
     printf("\n");
-    printf("%-25s %15s %15s\n", "Benchmark", "Ops/sec", "Time/op (ns)");
-    printf("%-25s %15s %15s\n", "-------------------------", "---------------", "---------------");
-
-    for (int i = 0; i < result_count; i++) {
-        printf("%-25s %15.0f %15.1f\n",
-               results[i].name,
-               results[i].ops_per_sec,
-               results[i].time_per_op_ns);
+    printf("%-25s %15s %13s %10s %10s %10s %10s\n", "Benchmark", "Ops/sec",
+           "Time/op (ns)", "p50 (ns)", "p99 (ns)", "max (ns)", "MB/s");
+    printf("%-25s %15s %13s %10s %10s %10s %10s\n", "-------------------------",
+           "---------------", "-------------", "----------", "----------",
+           "----------", "----------");
+
+    for (size_t i = 0; i < result_count; i++) {
+        const benchmark_result_t *r = &results[i];
+        char mbps[16] = "-";
+
+        if (r->bytes_per_op > 0) {
+            snprintf(mbps, sizeof(mbps), "%.1f", r->ops_per_sec * r->bytes_per_op / 1e6);
+        }
+        printf("%-25s %15.0f %13.1f %10llu %10llu %10llu %10s\n",
+               r->name, r->ops_per_sec, r->time_per_op_ns,
+               (unsigned long long)r->p50_ns,
+               (unsigned long long)r->p99_ns,
+               (unsigned long long)r->max_ns, mbps);
     }
 
     printf("\n");
@@ -221,11 +809,30 @@ static void export_json(const char *filename)
     fprintf(f, "  \"timestamp\": %ld,\n", now);
     fprintf(f, "  \"benchmarks\": [\n");
 
-    for (int i = 0; i < result_count; i++) {
+    for (size_t i = 0; i < result_count; i++) {
+        const benchmark_result_t *r = &results[i];
+
         fprintf(f, "    {\n");
-        fprintf(f, "      \"name\": \"%s\",\n", results[i].name);
-        fprintf(f, "      \"ops_per_sec\": %.0f,\n", results[i].ops_per_sec);
-        fprintf(f, "      \"time_per_op_ns\": %.1f\n", results[i].time_per_op_ns);
+        fprintf(f, "      \"name\": \"%s\",\n", r->name);
+        fprintf(f, "      \"ops_per_sec\": %.0f,\n", r->ops_per_sec);
+        if (r->threads) {
+            fprintf(f, "      \"threads\": %u,\n", r->threads);
+        }
+        if (r->bytes_per_op > 0) {
+            fprintf(f, "      \"mb_per_sec\": %.1f,\n", r->ops_per_sec * r->bytes_per_op / 1e6);
+        }
+        if (r->informational) {
+            fprintf(f, "      \"gated\": false,\n");
+        }
+        if (r->has_tail) {
+            fprintf(f, "      \"time_per_op_ns\": %.1f,\n", r->time_per_op_ns);
+            fprintf(f, "      \"p50_ns\": %llu,\n", (unsigned long long)r->p50_ns);
+            fprintf(f, "      \"p99_ns\": %llu,\n", (unsigned long long)r->p99_ns);
+            fprintf(f, "      \"p999_ns\": %llu,\n", (unsigned long long)r->p999_ns);
+            fprintf(f, "      \"max_ns\": %llu\n", (unsigned long long)r->max_ns);
+        } else {
+            fprintf(f, "      \"time_per_op_ns\": %.1f\n", r->time_per_op_ns);
+        }
         fprintf(f, "    }%s\n", (i < result_count - 1) ? "," : "");
     }
 
@@ -237,50 +844,136 @@ static void export_json(const char *filename)
     printf("Results exported to: %s\n", filename);
 }
 
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-q] [-r repeats] [-t max_threads] [-d device] [-f frames] [output.json]\n", prog);
+    fprintf(stderr, "  -q  Quick run (10x fewer iterations)\n");
+    fprintf(stderr, "  -r  Repeats per benchmark, best throughput kept (default 5)\n");
+    fprintf(stderr, "  -t  Largest emit contention thread count (default: CPUs, at least 4)\n");
+    fprintf(stderr, "  -d  Capture device for the end-to-end test (default: first vivid node)\n");
+    fprintf(stderr, "  -f  Frames for the end-to-end test (default 300)\n");
+}
+
 int main(int argc, char **argv)
 {
-    const char *output_file = (argc > 1) ? argv[1] : "perf/baseline.json";
+    const char *output_file = "perf/baseline.json";
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "qr:t:d:f:h")) != -1) {
+        switch (opt) {
+            case 'q':
+                opts.scale = 10;
+                break;
+            case 'r':
+                opts.repeats = (unsigned)atoi(optarg);
+                break;
+            case 't':
+                opts.max_threads = (unsigned)atoi(optarg);
+                break;
+            case 'd':
+                opts.device = optarg;
+                break;
+            case 'f':
+                opts.frames = (unsigned)atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) {
+        output_file = argv[optind];
+    }
+
+    if (opts.repeats == 0) {
+        opts.repeats = 1;
+    }
+    if (opts.max_threads == 0) {
+        opts.max_threads = cpus > 4 ? (unsigned)cpus : 4;
+    }
+    if (opts.max_threads > MAX_THREADS) {
+        opts.max_threads = MAX_THREADS;
+    }
 
     printf("DSV4L2 Performance Benchmark Suite\n");
     printf("===================================\n");
     printf("\n");
-    printf("Running benchmarks...\n");
+    printf("Running benchmarks (best of %u, up to %u threads)...\n",
+           opts.repeats, opts.max_threads);
 
-    printf("  [1/5] Event emission... ");
+    printf("  [1/13] Event emission... ");
     fflush(stdout);
     benchmark_event_emission();
     printf("done\n");
 
-    printf("  [2/5] THREATCON operations... ");
+    printf("  [2/13] THREATCON operations... ");
     fflush(stdout);
     benchmark_threatcon();
     printf("done\n");
 
-    printf("  [3/5] KLV parsing... ");
+    printf("  [3/13] KLV parsing... ");
     fflush(stdout);
     benchmark_klv_parsing();
     printf("done\n");
 
-    printf("  [4/7] IR radiometric... ");
+    printf("  [4/13] KLV parse by payload size... ");
     fflush(stdout);
+    benchmark_klv_sizes();
     printf("done\n");
 
-    printf("  [5/7] Profile loading... ");
+    printf("  [5/13] IR radiometric decode (%s)... ", dsv4l2_ir_decode_impl());
     fflush(stdout);
+    benchmark_ir_decode();
     printf("done\n");
 
-    printf("  [4/5] Clearance checking... ");
+    printf("  [6/13] Profile lookup... ");
+    fflush(stdout);
+    benchmark_profile_lookup();
+    printf("done\n");
+
+    printf("  [7/13] Clearance checking... ");
     fflush(stdout);
     benchmark_clearance_check();
     printf("done\n");
 
-    printf("  [5/5] Event buffer operations... ");
+    printf("  [8/13] Event buffer operations... ");
     fflush(stdout);
     benchmark_event_buffer();
     printf("done\n");
 
+    printf("  [9/13] Histogram recording... ");
+    fflush(stdout);
+    benchmark_histogram_record();
+    printf("done\n");
+
+    printf("  [10/13] Emission tail latency... ");
+    fflush(stdout);
+    benchmark_emission_tail();
+    printf("done\n");
+
+    printf("  [11/13] Emit contention scaling... ");
+    fflush(stdout);
+    benchmark_emit_contention();
+    printf("done\n");
+
+    printf("  [12/13] Sink throughput... ");
+    fflush(stdout);
+    benchmark_sinks();
+    printf("done\n");
+
+    printf("  [13/13] End-to-end capture latency... ");
+    fflush(stdout);
+    if (benchmark_capture_e2e() == 0) {
+        printf("done\n");
+    } else {
+        printf("skipped (no vivid device; modprobe vivid or pass -d)\n");
+    }
+
     print_results();
     export_json(output_file);
 
+    dsv4l2_probe_shutdown();
+    free(results);
     return 0;
 }
@@ -17,6 +17,12 @@ NC='\033[0m'
 # Threshold for regression detection (default: 10% slower)
 THRESHOLD=${PERF_THRESHOLD:-10}
 
+# Threshold for p99 latency regressions (default: 0 = not gated)
+TAIL_THRESHOLD=${PERF_TAIL_THRESHOLD:-0}
+
+# Extra benchmark arguments (e.g. PERF_ARGS="-q -t 8")
+PERF_ARGS=${PERF_ARGS:-}
+
 # Baseline file
 BASELINE="perf/baseline.json"
 CURRENT="perf/current.json"
@@ -35,7 +41,7 @@ fi
 # Run benchmarks
 echo "Running performance benchmarks..."
 echo ""
-LD_LIBRARY_PATH="lib:$LD_LIBRARY_PATH" ./perf/benchmark "$CURRENT"
+LD_LIBRARY_PATH="lib:$LD_LIBRARY_PATH" ./perf/benchmark $PERF_ARGS "$CURRENT"
 echo ""
 
 # Check if baseline exists
@@ -53,47 +59,71 @@ echo "Comparing against baseline..."
 echo ""
 
 # Parse JSON and compare (simple awk-based parser)
-python3 << 'EOF'
+set +e
+PERF_THRESHOLD="$THRESHOLD" PERF_TAIL_THRESHOLD="$TAIL_THRESHOLD" \
+python3 - "$BASELINE" "$CURRENT" << 'EOF'
 import json
+import os
 import sys
 
 # Load data
-with open('perf/baseline.json', 'r') as f:
+with open(sys.argv[1], 'r') as f:
     baseline = json.load(f)
 
-with open('perf/current.json', 'r') as f:
+with open(sys.argv[2], 'r') as f:
     current = json.load(f)
 
 # Create lookup tables
 baseline_map = {b['name']: b for b in baseline['benchmarks']}
 current_map = {c['name']: c for c in current['benchmarks']}
 
+threshold = float(os.environ.get('PERF_THRESHOLD', '10'))
+tail_threshold = float(os.environ.get('PERF_TAIL_THRESHOLD', '0'))
+
 # Compare
-print(f"{'Benchmark':<25} {'Baseline':<15} {'Current':<15} {'Change':<12} {'Status'}")
-print(f"{'-'*25} {'-'*15} {'-'*15} {'-'*12} {'-'*10}")
+print(f"{'Benchmark':<25} {'Baseline':<15} {'Current':<15} {'Change':<12} {'p99':<12} {'Status'}")
+print(f"{'-'*25} {'-'*15} {'-'*15} {'-'*12} {'-'*12} {'-'*10}")
 
 regressions = []
 improvements = []
-threshold = 10  # 10% threshold
 
 for name in sorted(baseline_map.keys()):
     if name not in current_map:
+        # e.g. a sink or device not available in this build/host
+        print(f"{name:<25} {'':>13}   {'':>13}   {'':>11}  {'':>11}  MISSING")
         continue
 
-    baseline_ops = baseline_map[name]['ops_per_sec']
-    current_ops = current_map[name]['ops_per_sec']
+    base = baseline_map[name]
+    cur = current_map[name]
+    baseline_ops = base['ops_per_sec']
+    current_ops = cur['ops_per_sec']
 
-    change_pct = ((current_ops - baseline_ops) / baseline_ops) * 100.0
+    change_pct = ((current_ops - baseline_ops) / baseline_ops) * 100.0 if baseline_ops else 0.0
+
+    # p99 latency: higher is worse
+    tail_pct = None
+    if base.get('p99_ns') and 'p99_ns' in cur:
+        tail_pct = ((cur['p99_ns'] - base['p99_ns']) / base['p99_ns']) * 100.0
 
     status = "OK"
-    if change_pct < -threshold:
+    if not (base.get('gated', True) and cur.get('gated', True)):
+        status = "INFO"
+    elif change_pct < -threshold:
         status = "REGRESSION"
-        regressions.append((name, change_pct))
+        regressions.append((name, f"{-change_pct:.1f}% slower"))
+    elif tail_threshold > 0 and tail_pct is not None and tail_pct > tail_threshold:
+        status = "TAIL REGRESSION"
+        regressions.append((name, f"p99 {tail_pct:.1f}% higher"))
     elif change_pct > threshold:
         status = "IMPROVED"
         improvements.append((name, change_pct))
 
-    print(f"{name:<25} {baseline_ops:>13.0f}   {current_ops:>13.0f}   {change_pct:>+10.1f}%  {status}")
+    tail = f"{tail_pct:>+10.1f}%" if tail_pct is not None else f"{'-':>11}"
+    print(f"{name:<25} {baseline_ops:>13.0f}   {current_ops:>13.0f}   {change_pct:>+10.1f}%  {tail}  {status}")
+
+for name in sorted(current_map.keys()):
+    if name not in baseline_map:
+        print(f"{name:<25} {'':>13}   {current_map[name]['ops_per_sec']:>13.0f}   {'':>11}  {'':>11}  NEW")
 
 print("")
 print("="*80)
@@ -101,8 +131,8 @@ print("")
 
 if regressions:
     print(f"⚠️  PERFORMANCE REGRESSIONS DETECTED ({len(regressions)}):")
-    for name, change in regressions:
-        print(f"  - {name}: {change:.1f}% slower")
+    for name, what in regressions:
+        print(f"  - {name}: {what}")
     print("")
     sys.exit(1)
 elif improvements:
@@ -119,6 +149,7 @@ EOF
 
 # Check Python script exit code
 exit_code=$?
+set -e
 
 if [ $exit_code -eq 1 ]; then
     echo -e "${RED}Performance regression detected!${NC}"
@@ -3,68 +3,64 @@
  *
  * Handles v4l2 buffer allocation, queueing, and memory mapping.
  * Biometric devices have buffers tagged with DSMIL_SECRET_REGION.
+ *
+ * Each buffer carries an ownership state (IDLE/QUEUED/LEASED) so frames
+ * can be handed to consumers in place and returned to the driver with
+ * dsv4l2_frame_release() once they are done.
+ *
+ * Buffers are driver-allocated (MMAP, optionally exported as dmabuf fds
+ * for GPU/NPU import) or caller-allocated (DMABUF or USERPTR import).
+ * The lease API is the same for all three.
+ *
+ * Every dequeue is checked against the previous driver sequence number
+ * so driver-side drops show up as FRAME_DROPPED events. In adaptive
+ * mode the dequeuer also grows the MMAP buffer set when drops appear
+ * and parks buffers again once the stream has been quiet for a while.
  */
 
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
 #include "dsv4l2rt.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+
+/* Adaptive depth: dequeues per decision window */
+#define ADAPT_WINDOW          64
 
-/* Forward declarations */
-typedef struct dsv4l2_device_internal dsv4l2_device_internal_t;
-extern dsv4l2_device_internal_t *dsv4l2_get_internal(dsv4l2_device_t *dev);
-
-/* Buffer structure */
-typedef struct {
-    void *start;
-    size_t length;
-} dsv4l2_buffer_t;
-
-/* Internal device structure (partial - just what we need) */
-struct dsv4l2_device_internal {
-    dsv4l2_device_t public;
-    struct v4l2_capability cap;
-    dsv4l2_tempest_state_t tempest;
-    int tempest_ctrl_id;
-    char *profile_path;
-    char *classification;
-    int streaming;
-    uint32_t dev_id;
-
-    /* Buffer management (added here) */
-    dsv4l2_buffer_t *buffers;
-    uint32_t buffer_count;
-};
+/* Adaptive depth: gap-free windows before one buffer is parked */
+#define ADAPT_QUIET_WINDOWS   16
 
 /**
- * Request buffers from the device
+ * Request a buffer set of the given memory type
  *
- * @param dev Device handle
- * @param count Number of buffers to request
- * @return 0 on success, negative errno on error
+ * @return Number of buffers granted, negative errno on error
  */
-int dsv4l2_request_buffers(dsv4l2_device_t *dev, uint32_t count)
+static int request_buffers(dsv4l2_device_t *dev, uint32_t count, uint32_t memory)
 {
-    dsv4l2_device_internal_t *internal;
+    dsv4l2_device_internal_t *internal = dsv4l2_get_internal(dev);
     struct v4l2_requestbuffers req;
+    uint32_t i;
 
-    if (!dev || count == 0) {
-        return -EINVAL;
+    /* Drop any previous buffer set */
+    if (internal->buffers) {
+        dsv4l2_release_buffers(dev);
     }
 
-    internal = dsv4l2_get_internal(dev);
-
     /* Request buffers */
     memset(&req, 0, sizeof(req));
     req.count = count;
     req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
+    req.memory = memory;
 
     if (ioctl(dev->fd, VIDIOC_REQBUFS, &req) < 0) {
         return -errno;
@@ -76,7 +72,215 @@ int dsv4l2_request_buffers(dsv4l2_device_t *dev, uint32_t count)
         return -ENOMEM;
     }
 
+    for (i = 0; i < req.count; i++) {
+        internal->buffers[i].dmabuf_fd = -1;
+    }
+
     internal->buffer_count = req.count;
+    internal->buffer_capacity = req.count;
+    internal->memory = memory;
+    internal->leased_count = 0;
+    internal->implicit_lease = -1;
+    internal->seq.have_sequence = 0;
+
+    return (int)req.count;
+}
+
+/**
+ * Request buffers from the device
+ *
+ * @param dev Device handle
+ * @param count Number of buffers to request
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_request_buffers(dsv4l2_device_t *dev, uint32_t count)
+{
+    int rc;
+
+    if (!dev || count == 0) {
+        return -EINVAL;
+    }
+
+    rc = request_buffers(dev, count, V4L2_MEMORY_MMAP);
+    return rc < 0 ? rc : 0;
+}
+
+/**
+ * Export every buffer as a dmabuf fd (VIDIOC_EXPBUF)
+ *
+ * The fds stay owned by the library and are closed by
+ * dsv4l2_release_buffers(); import them elsewhere with dup() if they
+ * must outlive the buffer set. Leased frames carry the fd in
+ * frame->dmabuf_fd.
+ *
+ * @param dev Device handle (MMAP buffers requested)
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_export_buffers(dsv4l2_device_t *dev)
+{
+    dsv4l2_device_internal_t *internal;
+    uint32_t i;
+
+    if (!dev) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    if (!internal->buffers || internal->memory != V4L2_MEMORY_MMAP) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < internal->buffer_count; i++) {
+        struct v4l2_exportbuffer expbuf;
+
+        if (internal->buffers[i].dmabuf_fd >= 0) {
+            continue;  /* Already exported */
+        }
+
+        memset(&expbuf, 0, sizeof(expbuf));
+        expbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        expbuf.index = i;
+        expbuf.flags = O_RDWR | O_CLOEXEC;
+
+        if (ioctl(dev->fd, VIDIOC_EXPBUF, &expbuf) < 0) {
+            return -errno;
+        }
+
+        internal->buffers[i].dmabuf_fd = expbuf.fd;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the dmabuf fd of a buffer
+ *
+ * @return fd, -ENOENT if the buffer has none, -EINVAL on bad index
+ */
+int dsv4l2_get_buffer_fd(dsv4l2_device_t *dev, uint32_t index)
+{
+    dsv4l2_device_internal_t *internal;
+
+    if (!dev) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    if (index >= internal->buffer_count) {
+        return -EINVAL;
+    }
+
+    return internal->buffers[index].dmabuf_fd >= 0 ?
+           internal->buffers[index].dmabuf_fd : -ENOENT;
+}
+
+/**
+ * Import caller-allocated dmabufs as capture buffers
+ *
+ * Each fd is duplicated (the caller keeps its own). The dmabuf is also
+ * mapped for CPU access when the exporter allows it, so frame->data is
+ * set; otherwise frame->data is NULL and frame->dmabuf_fd is the way in.
+ *
+ * @param dev Device handle
+ * @param fds dmabuf fds, one per buffer
+ * @param count Number of buffers
+ * @return 0 on success, -ENOBUFS if the driver granted fewer buffers,
+ *         negative errno on error
+ */
+int dsv4l2_import_dmabuf(dsv4l2_device_t *dev, const int *fds, uint32_t count)
+{
+    dsv4l2_device_internal_t *internal;
+    uint32_t i;
+    int rc;
+
+    if (!dev || !fds || count == 0) {
+        return -EINVAL;
+    }
+
+    rc = request_buffers(dev, count, V4L2_MEMORY_DMABUF);
+    if (rc < 0) {
+        return rc;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    if ((uint32_t)rc < count) {
+        dsv4l2_release_buffers(dev);
+        return -ENOBUFS;
+    }
+
+    for (i = 0; i < count; i++) {
+        dsv4l2_buffer_t *b = &internal->buffers[i];
+        off_t size;
+
+        b->dmabuf_fd = fcntl(fds[i], F_DUPFD_CLOEXEC, 0);
+        if (b->dmabuf_fd < 0) {
+            rc = -errno;
+            dsv4l2_release_buffers(dev);
+            return rc;
+        }
+
+        /* dmabufs report their size through lseek */
+        size = lseek(b->dmabuf_fd, 0, SEEK_END);
+        lseek(b->dmabuf_fd, 0, SEEK_SET);
+        b->length = size > 0 ? (size_t)size : 0;
+
+        b->start = NULL;
+        if (b->length > 0) {
+            void *p = mmap(NULL, b->length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                           b->dmabuf_fd, 0);
+            if (p != MAP_FAILED) {
+                b->start = p;
+                b->mapped = 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Import caller-allocated memory (USERPTR) as capture buffers
+ *
+ * Suitable for hugepage-backed or accelerator-visible memory. The memory
+ * stays owned by the caller and must outlive the buffer set.
+ *
+ * @param dev Device handle
+ * @param ptrs Buffer addresses, one per buffer (page aligned)
+ * @param length Size of each buffer (at least the format's sizeimage)
+ * @param count Number of buffers
+ * @return 0 on success, -ENOBUFS if the driver granted fewer buffers,
+ *         negative errno on error
+ */
+int dsv4l2_import_userptr(dsv4l2_device_t *dev, void *const *ptrs, size_t length,
+                          uint32_t count)
+{
+    dsv4l2_device_internal_t *internal;
+    uint32_t i;
+    int rc;
+
+    if (!dev || !ptrs || length == 0 || count == 0) {
+        return -EINVAL;
+    }
+
+    rc = request_buffers(dev, count, V4L2_MEMORY_USERPTR);
+    if (rc < 0) {
+        return rc;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    if ((uint32_t)rc < count) {
+        dsv4l2_release_buffers(dev);
+        return -ENOBUFS;
+    }
+
+    for (i = 0; i < count; i++) {
+        internal->buffers[i].start = ptrs[i];
+        internal->buffers[i].length = length;
+    }
 
     return 0;
 }
@@ -98,7 +302,8 @@ int dsv4l2_mmap_buffers(dsv4l2_device_t *dev)
 
     internal = dsv4l2_get_internal(dev);
 
-    if (!internal->buffers || internal->buffer_count == 0) {
+    if (!internal->buffers || internal->buffer_count == 0 ||
+        internal->memory != V4L2_MEMORY_MMAP) {
         return -EINVAL;
     }
 
@@ -122,8 +327,10 @@ int dsv4l2_mmap_buffers(dsv4l2_device_t *dev)
                                           dev->fd, buf.m.offset);
 
         if (internal->buffers[i].start == MAP_FAILED) {
+            internal->buffers[i].start = NULL;
             return -errno;
         }
+        internal->buffers[i].mapped = 1;
     }
 
     return 0;
@@ -151,15 +358,482 @@ int dsv4l2_queue_buffer(dsv4l2_device_t *dev, uint32_t index)
         return -EINVAL;
     }
 
+    /* Parked by adaptive depth: the dequeuer decides when it comes back */
+    if (__atomic_load_n(&internal->buffers[index].state, __ATOMIC_ACQUIRE) ==
+        DSV4L2_BUF_PARKED) {
+        return 0;
+    }
+
     memset(&buf, 0, sizeof(buf));
     buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+    buf.memory = internal->memory;
     buf.index = index;
 
+    if (internal->memory == V4L2_MEMORY_DMABUF) {
+        buf.m.fd = internal->buffers[index].dmabuf_fd;
+        buf.length = internal->buffers[index].length;
+    } else if (internal->memory == V4L2_MEMORY_USERPTR) {
+        buf.m.userptr = (unsigned long)internal->buffers[index].start;
+        buf.length = internal->buffers[index].length;
+    }
+
+    /* Mark queued before QBUF so a concurrent DQBUF never sees a stale state */
+    __atomic_store_n(&internal->buffers[index].state, DSV4L2_BUF_QUEUED,
+                     __ATOMIC_RELEASE);
+
     if (ioctl(dev->fd, VIDIOC_QBUF, &buf) < 0) {
+        int rc = -errno;
+        __atomic_store_n(&internal->buffers[index].state, DSV4L2_BUF_IDLE,
+                         __ATOMIC_RELEASE);
+        return rc;
+    }
+
+    return 0;
+}
+
+/* ========================================================================
+ * Drop Tracking and Adaptive Depth
+ * ======================================================================== */
+
+/**
+ * Account one dequeued buffer
+ *
+ * A sequence number at or below the previous one means the stream was
+ * restarted rather than that frames were lost. Latency and frame interval
+ * are only measured for monotonic driver timestamps; the first buffer
+ * after STREAMON starts a new interval series.
+ *
+ * @param t Stream tracker
+ * @param buf Dequeued v4l2 buffer
+ * @return Number of frames the driver dropped before buf
+ */
+uint32_t dsv4l2_seq_track(dsv4l2_seq_tracker_t *t, const struct v4l2_buffer *buf)
+{
+    dsv4l2_capture_stats_t *st = &t->stats;
+    uint32_t gap = 0;
+
+    int restarted = !t->have_sequence;
+
+    if (t->have_sequence && (int32_t)(buf->sequence - t->last_sequence) > 1) {
+        gap = buf->sequence - t->last_sequence - 1;
+        __atomic_add_fetch(&st->dropped, gap, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&st->gaps, 1, __ATOMIC_RELAXED);
+    }
+    t->last_sequence = buf->sequence;
+    t->have_sequence = 1;
+    __atomic_add_fetch(&st->frames, 1, __ATOMIC_RELAXED);
+
+    if ((buf->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+        V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+        struct timespec now;
+        uint64_t now_ns, ts_ns, latency, avg;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        now_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+        ts_ns = buf->timestamp.tv_sec * 1000000000ULL +
+                buf->timestamp.tv_usec * 1000ULL;
+        latency = now_ns > ts_ns ? now_ns - ts_ns : 0;
+
+        dsv4l2_histogram_record(&t->hist[DSV4L2_HIST_LATENCY], latency);
+        if (!restarted && t->last_ts_ns && ts_ns > t->last_ts_ns) {
+            dsv4l2_histogram_record(&t->hist[DSV4L2_HIST_INTERVAL],
+                                    ts_ns - t->last_ts_ns);
+        }
+        t->last_ts_ns = ts_ns;
+
+        avg = __atomic_load_n(&st->latency_avg_ns, __ATOMIC_RELAXED);
+        avg = avg ? avg - avg / 16 + latency / 16 : latency;
+
+        __atomic_store_n(&st->latency_last_ns, latency, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->latency_avg_ns, avg, __ATOMIC_RELAXED);
+        if (latency > __atomic_load_n(&st->latency_max_ns, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&st->latency_max_ns, latency, __ATOMIC_RELAXED);
+        }
+    }
+
+    return gap;
+}
+
+/**
+ * Count buffers that can still be dequeued (neither leased nor parked)
+ *
+ * @param dev Internal device
+ * @return Number of buffers queued with the driver or idle
+ */
+uint32_t dsv4l2_buffer_available(dsv4l2_device_internal_t *dev)
+{
+    uint32_t total = __atomic_load_n(&dev->buffer_count, __ATOMIC_ACQUIRE);
+    uint32_t used = __atomic_load_n(&dev->leased_count, __ATOMIC_ACQUIRE) +
+                    __atomic_load_n(&dev->parked_count, __ATOMIC_ACQUIRE);
+
+    return used < total ? total - used : 0;
+}
+
+/**
+ * Map one MMAP buffer
+ *
+ * @return 0 on success, negative errno on error
+ */
+static int map_buffer(dsv4l2_device_t *dev, dsv4l2_buffer_t *b, uint32_t index)
+{
+    struct v4l2_buffer buf;
+    void *p;
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+
+    if (ioctl(dev->fd, VIDIOC_QUERYBUF, &buf) < 0) {
+        return -errno;
+    }
+
+    p = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+             dev->fd, buf.m.offset);
+    if (p == MAP_FAILED) {
         return -errno;
     }
 
+    b->start = p;
+    b->length = buf.length;
+    b->mapped = 1;
+    return 0;
+}
+
+/**
+ * Allocate, map and queue one more MMAP buffer (VIDIOC_CREATE_BUFS)
+ *
+ * The driver picks the index: the end of the set, or a slot freed by
+ * VIDIOC_REMOVE_BUFS.
+ *
+ * @return 0 on success, negative errno on error
+ */
+static int create_buffer(dsv4l2_device_t *dev, dsv4l2_device_internal_t *internal)
+{
+    struct v4l2_create_buffers create;
+    dsv4l2_buffer_t *b;
+    uint32_t index;
+    int rc;
+
+    memset(&create, 0, sizeof(create));
+    create.count = 1;
+    create.memory = V4L2_MEMORY_MMAP;
+    create.format.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+    if (ioctl(dev->fd, VIDIOC_G_FMT, &create.format) < 0) {
+        return -errno;
+    }
+
+    if (ioctl(dev->fd, VIDIOC_CREATE_BUFS, &create) < 0) {
+        return -errno;
+    }
+
+    index = create.index;
+    if (create.count == 0 || index >= internal->buffer_capacity) {
+        return -ENOBUFS;
+    }
+
+    b = &internal->buffers[index];
+    b->dmabuf_fd = -1;
+
+    rc = map_buffer(dev, b, index);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (index < internal->buffer_count) {
+        /* Refilled a removed slot */
+        __atomic_store_n(&b->state, DSV4L2_BUF_IDLE, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&internal->parked_count, 1, __ATOMIC_ACQ_REL);
+    } else {
+        __atomic_store_n(&internal->buffer_count, index + 1, __ATOMIC_RELEASE);
+    }
+
+    return dsv4l2_queue_buffer(dev, index);
+}
+
+/**
+ * Put one more buffer into circulation
+ *
+ * Cancels a pending park first, then requeues a parked buffer that still
+ * has its memory, and only then allocates a new one.
+ */
+static void grow_depth(dsv4l2_device_t *dev, dsv4l2_device_internal_t *internal)
+{
+    uint32_t pending = __atomic_load_n(&internal->park_pending, __ATOMIC_ACQUIRE);
+    uint32_t i;
+    int hole = 0;
+
+    while (pending > 0) {
+        if (__atomic_compare_exchange_n(&internal->park_pending, &pending,
+                                        pending - 1, 0, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            return;
+        }
+    }
+
+    for (i = 0; i < internal->buffer_count; i++) {
+        dsv4l2_buffer_t *b = &internal->buffers[i];
+
+        if (__atomic_load_n(&b->state, __ATOMIC_ACQUIRE) != DSV4L2_BUF_PARKED) {
+            continue;
+        }
+        if (!b->mapped) {
+            hole = 1;  /* Memory was removed; needs CREATE_BUFS */
+            continue;
+        }
+
+        __atomic_store_n(&b->state, DSV4L2_BUF_IDLE, __ATOMIC_RELEASE);
+        __atomic_sub_fetch(&internal->parked_count, 1, __ATOMIC_ACQ_REL);
+        dsv4l2_queue_buffer(dev, i);
+        return;
+    }
+
+    if (hole || internal->buffer_count < internal->adapt_max) {
+        create_buffer(dev, internal);
+    }
+}
+
+/**
+ * Schedule one buffer to be parked on its next release
+ */
+static void shrink_depth(dsv4l2_device_internal_t *internal)
+{
+    uint32_t out = __atomic_load_n(&internal->parked_count, __ATOMIC_ACQUIRE) +
+                   __atomic_load_n(&internal->park_pending, __ATOMIC_ACQUIRE);
+
+    if (internal->buffer_count > out &&
+        internal->buffer_count - out > internal->adapt_min) {
+        __atomic_add_fetch(&internal->park_pending, 1, __ATOMIC_ACQ_REL);
+    }
+}
+
+#ifdef VIDIOC_REMOVE_BUFS
+/**
+ * Hand the memory of parked buffers back to the driver
+ *
+ * If the driver refuses, the buffer is mapped again and stays parked.
+ */
+static void reclaim_parked(dsv4l2_device_t *dev, dsv4l2_device_internal_t *internal)
+{
+    uint32_t i;
+
+    for (i = 0; i < internal->buffer_count; i++) {
+        dsv4l2_buffer_t *b = &internal->buffers[i];
+        struct v4l2_remove_buffers remove;
+
+        if (__atomic_load_n(&b->state, __ATOMIC_ACQUIRE) != DSV4L2_BUF_PARKED ||
+            !b->mapped) {
+            continue;
+        }
+
+        munmap(b->start, b->length);
+        b->start = NULL;
+        b->mapped = 0;
+        if (b->dmabuf_fd >= 0) {
+            close(b->dmabuf_fd);
+            b->dmabuf_fd = -1;
+        }
+
+        memset(&remove, 0, sizeof(remove));
+        remove.index = i;
+        remove.count = 1;
+        remove.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+
+        if (ioctl(dev->fd, VIDIOC_REMOVE_BUFS, &remove) < 0) {
+            map_buffer(dev, b, i);
+            return;
+        }
+    }
+}
+#endif
+
+/**
+ * Feed one dequeue into the adaptive depth controller
+ *
+ * The first gap in a window grows the set by one buffer; a run of
+ * gap-free windows parks one again.
+ */
+static void adapt_depth(dsv4l2_device_t *dev, dsv4l2_device_internal_t *internal,
+                        uint32_t gap)
+{
+    if (gap > 0 && internal->adapt_gaps++ == 0) {
+        grow_depth(dev, internal);
+    }
+
+    if (++internal->adapt_frames < ADAPT_WINDOW) {
+        return;
+    }
+
+    if (internal->adapt_gaps > 0) {
+        internal->adapt_quiet = 0;
+    } else if (++internal->adapt_quiet >= ADAPT_QUIET_WINDOWS) {
+        shrink_depth(internal);
+        internal->adapt_quiet = 0;
+    }
+
+#ifdef VIDIOC_REMOVE_BUFS
+    reclaim_parked(dev, internal);
+#endif
+
+    internal->adapt_frames = 0;
+    internal->adapt_gaps = 0;
+}
+
+/**
+ * Park the buffer a release is handing back, if a shrink is pending
+ *
+ * @return 1 if the buffer was parked instead of requeued
+ */
+static int park_on_release(dsv4l2_device_internal_t *internal, dsv4l2_buffer_t *b)
+{
+    uint32_t pending = __atomic_load_n(&internal->park_pending, __ATOMIC_ACQUIRE);
+
+    while (pending > 0) {
+        if (__atomic_compare_exchange_n(&internal->park_pending, &pending,
+                                        pending - 1, 0, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&b->state, DSV4L2_BUF_PARKED, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&internal->parked_count, 1, __ATOMIC_ACQ_REL);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Let the queue depth follow observed drops
+ *
+ * The buffer set must be MMAP and not streaming. While enabled, the
+ * dequeuer adds a buffer (up to max_buffers) whenever the driver starts
+ * skipping sequence numbers and parks one (down to min_buffers) after
+ * about a thousand frames without a skip. Parked memory is handed back
+ * with VIDIOC_REMOVE_BUFS where the kernel headers provide it.
+ *
+ * @param dev Device handle
+ * @param min_buffers Lowest depth (0 together with max_buffers = 0 disables)
+ * @param max_buffers Highest depth
+ * @return 0 on success, -EINVAL on bad limits, -ENOTSUP without MMAP
+ *         buffers, -EBUSY while streaming, -ENOMEM on allocation failure
+ */
+int dsv4l2_set_adaptive_depth(dsv4l2_device_t *dev, uint32_t min_buffers,
+                              uint32_t max_buffers)
+{
+    dsv4l2_device_internal_t *internal;
+
+    if (!dev) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    /* Disable: keep the current depth */
+    if (min_buffers == 0 && max_buffers == 0) {
+        internal->adapt_max = 0;
+        internal->adapt_min = 0;
+        __atomic_store_n(&internal->park_pending, 0, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    if (min_buffers == 0 || min_buffers > max_buffers) {
+        return -EINVAL;
+    }
+
+    if (!internal->buffers || internal->memory != V4L2_MEMORY_MMAP) {
+        return -ENOTSUP;
+    }
+
+    if (internal->streaming) {
+        return -EBUSY;
+    }
+
+    /* Size the table for the limit now so the dequeuer never reallocates */
+    if (max_buffers > internal->buffer_capacity) {
+        dsv4l2_buffer_t *table;
+        uint32_t i;
+
+        table = realloc(internal->buffers, max_buffers * sizeof(*table));
+        if (!table) {
+            return -ENOMEM;
+        }
+
+        memset(&table[internal->buffer_capacity], 0,
+               (max_buffers - internal->buffer_capacity) * sizeof(*table));
+        for (i = internal->buffer_capacity; i < max_buffers; i++) {
+            table[i].dmabuf_fd = -1;
+        }
+
+        internal->buffers = table;
+        internal->buffer_capacity = max_buffers;
+    }
+
+    internal->adapt_min = min_buffers;
+    internal->adapt_max = max_buffers;
+    internal->adapt_frames = 0;
+    internal->adapt_gaps = 0;
+    internal->adapt_quiet = 0;
+
+    return 0;
+}
+
+/**
+ * Snapshot drop, latency and depth counters
+ *
+ * @param dev Device handle
+ * @param out Output counters
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_get_capture_stats(dsv4l2_device_t *dev, dsv4l2_capture_stats_t *out)
+{
+    dsv4l2_device_internal_t *internal;
+    const dsv4l2_capture_stats_t *st;
+    uint32_t count, out_of_circulation;
+
+    if (!dev || !out) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+    st = &internal->seq.stats;
+
+    out->frames = __atomic_load_n(&st->frames, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&st->dropped, __ATOMIC_RELAXED);
+    out->gaps = __atomic_load_n(&st->gaps, __ATOMIC_RELAXED);
+    out->latency_last_ns = __atomic_load_n(&st->latency_last_ns, __ATOMIC_RELAXED);
+    out->latency_avg_ns = __atomic_load_n(&st->latency_avg_ns, __ATOMIC_RELAXED);
+    out->latency_max_ns = __atomic_load_n(&st->latency_max_ns, __ATOMIC_RELAXED);
+
+    count = __atomic_load_n(&internal->buffer_count, __ATOMIC_ACQUIRE);
+    out_of_circulation = __atomic_load_n(&internal->parked_count, __ATOMIC_RELAXED) +
+                         __atomic_load_n(&internal->park_pending, __ATOMIC_RELAXED);
+
+    out->buffer_count = count;
+    out->active_count = count > out_of_circulation ? count - out_of_circulation : 0;
+
+    return 0;
+}
+
+/**
+ * Snapshot one latency histogram of the device
+ *
+ * @param dev Device handle
+ * @param kind Histogram to read
+ * @param out Output histogram
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_get_histogram(dsv4l2_device_t *dev, dsv4l2_hist_kind_t kind,
+                         dsv4l2_histogram_t *out)
+{
+    dsv4l2_device_internal_t *internal;
+
+    if (!dev || !out || (unsigned)kind >= DSV4L2_HIST_KINDS) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+    dsv4l2_hist_snapshot(&internal->seq.hist[kind], out);
+
     return 0;
 }
 
@@ -172,18 +846,39 @@ int dsv4l2_queue_buffer(dsv4l2_device_t *dev, uint32_t index)
  */
 int dsv4l2_dequeue_buffer(dsv4l2_device_t *dev, struct v4l2_buffer *buf)
 {
+    dsv4l2_device_internal_t *internal;
+    uint32_t gap;
+
     if (!dev || !buf) {
         return -EINVAL;
     }
 
+    internal = dsv4l2_get_internal(dev);
+
     memset(buf, 0, sizeof(*buf));
     buf->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf->memory = V4L2_MEMORY_MMAP;
+    buf->memory = internal->memory;
 
     if (ioctl(dev->fd, VIDIOC_DQBUF, buf) < 0) {
         return -errno;
     }
 
+    if (buf->index < internal->buffer_count) {
+        __atomic_store_n(&internal->buffers[buf->index].state, DSV4L2_BUF_IDLE,
+                         __ATOMIC_RELEASE);
+    }
+
+    /* Driver-side drops show up as skipped sequence numbers */
+    gap = dsv4l2_seq_track(&internal->seq, buf);
+    if (gap > 0) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
+                             DSV4L2_SEV_MEDIUM, gap);
+    }
+
+    if (internal->adapt_max > 0) {
+        adapt_depth(dev, internal, gap);
+    }
+
     return 0;
 }
 
@@ -237,15 +932,146 @@ void dsv4l2_release_buffers(dsv4l2_device_t *dev)
         return;
     }
 
-    /* Unmap all buffers */
+    /* Unmap our mappings and close owned dmabuf fds (USERPTR memory is the caller's) */
     for (i = 0; i < internal->buffer_count; i++) {
-        if (internal->buffers[i].start != NULL &&
-            internal->buffers[i].start != MAP_FAILED) {
+        if (internal->buffers[i].mapped) {
             munmap(internal->buffers[i].start, internal->buffers[i].length);
         }
+        if (internal->buffers[i].dmabuf_fd >= 0) {
+            close(internal->buffers[i].dmabuf_fd);
+        }
     }
 
     free(internal->buffers);
     internal->buffers = NULL;
     internal->buffer_count = 0;
+    internal->buffer_capacity = 0;
+    internal->leased_count = 0;
+    internal->implicit_lease = -1;
+
+    /* Back to fixed depth */
+    internal->adapt_min = 0;
+    internal->adapt_max = 0;
+    internal->parked_count = 0;
+    internal->park_pending = 0;
+}
+
+/**
+ * Mark a dequeued buffer as leased and describe it in a frame
+ *
+ * Called by the capture path right after VIDIOC_DQBUF. The buffer stays
+ * out of the driver queue until dsv4l2_frame_release().
+ *
+ * @param dev Internal device
+ * @param buf Dequeued v4l2 buffer
+ * @param out Output frame descriptor
+ */
+void dsv4l2_buffer_lease(dsv4l2_device_internal_t *dev,
+                         const struct v4l2_buffer *buf,
+                         dsv4l2_frame_t *out)
+{
+    dsv4l2_buffer_t *b = &dev->buffers[buf->index];
+
+    b->sequence = buf->sequence;
+    __atomic_store_n(&b->state, DSV4L2_BUF_LEASED, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&dev->leased_count, 1, __ATOMIC_ACQ_REL);
+
+    out->data = (uint8_t *)b->start;
+    out->len = buf->bytesused;
+    out->index = buf->index;
+    out->sequence = buf->sequence;
+    out->timestamp_ns = buf->timestamp.tv_sec * 1000000000ULL +
+                        buf->timestamp.tv_usec * 1000ULL;
+    out->dmabuf_fd = b->dmabuf_fd;
+}
+
+/**
+ * Return all buffers to IDLE after STREAMOFF
+ *
+ * STREAMOFF implicitly dequeues every buffer, so outstanding leases are
+ * void: their data stays mapped but will not be requeued by release.
+ * Parked buffers stay parked, and the next dequeue starts a new
+ * sequence run.
+ *
+ * @param dev Internal device
+ */
+void dsv4l2_buffer_reset(dsv4l2_device_internal_t *dev)
+{
+    uint32_t i;
+
+    for (i = 0; i < dev->buffer_count; i++) {
+        if (__atomic_load_n(&dev->buffers[i].state, __ATOMIC_ACQUIRE) ==
+            DSV4L2_BUF_PARKED) {
+            continue;  /* Stays out of circulation */
+        }
+        __atomic_store_n(&dev->buffers[i].state, DSV4L2_BUF_IDLE,
+                         __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&dev->leased_count, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&dev->park_pending, 0, __ATOMIC_RELEASE);
+    dev->implicit_lease = -1;
+    dev->seq.have_sequence = 0;
+}
+
+/**
+ * Release a leased frame back to the driver
+ *
+ * The frame must have been obtained with dsv4l2_frame_acquire() (or
+ * dsv4l2_capture_frame()) on the same device. Releasing twice, or
+ * releasing a frame whose buffer has since been reused, is rejected.
+ *
+ * @param dev Device handle
+ * @param frame Leased frame (data pointer is cleared on success)
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2_frame_release(dsv4l2_device_t *dev, dsv4l2_frame_t *frame)
+{
+    dsv4l2_device_internal_t *internal;
+    dsv4l2_buffer_t *b;
+    int expected = DSV4L2_BUF_LEASED;
+    int rc;
+
+    if (!dev || !frame) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    if (frame->index >= internal->buffer_count) {
+        return -EINVAL;
+    }
+
+    b = &internal->buffers[frame->index];
+
+    /* Stale frame descriptor: buffer already went round again */
+    if (b->sequence != frame->sequence) {
+        return -EINVAL;
+    }
+
+    /* Claim the lease; a second release fails here */
+    if (!__atomic_compare_exchange_n(&b->state, &expected, DSV4L2_BUF_IDLE,
+                                     0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return -EINVAL;
+    }
+
+    __atomic_sub_fetch(&internal->leased_count, 1, __ATOMIC_ACQ_REL);
+
+    /* The caller gave back a dsv4l2_capture_frame() frame itself */
+    if (internal->implicit_lease == (int)frame->index) {
+        internal->implicit_lease = -1;
+    }
+
+    /* Adaptive shrink: keep the buffer out of the driver queue */
+    if (park_on_release(internal, b)) {
+        frame->data = NULL;
+        return 0;
+    }
+
+    rc = dsv4l2_queue_buffer(dev, frame->index);
+    if (rc == 0) {
+        frame->data = NULL;
+    }
+
+    return rc;
 }
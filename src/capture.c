@@ -6,40 +6,128 @@
  * - Policy validation
  * - Telemetry for all capture events
  * - Secret region annotation for biometric capture
+ * - Zero-copy frame leases (acquire/release) over the mmap'd buffers
  */
 
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
+#include "dsv4l2_metadata.h"
 #include "dsv4l2rt.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #include <errno.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 
-/* Forward declarations */
-typedef struct dsv4l2_device_internal dsv4l2_device_internal_t;
-extern dsv4l2_device_internal_t *dsv4l2_get_internal(dsv4l2_device_t *dev);
-
-/* Buffer management functions */
-extern int dsv4l2_dequeue_buffer(dsv4l2_device_t *dev, struct v4l2_buffer *buf);
-extern int dsv4l2_queue_buffer(dsv4l2_device_t *dev, uint32_t index);
-extern int dsv4l2_get_buffer(dsv4l2_device_t *dev, uint32_t index,
-                              void **start, size_t *length);
-
-/* Internal device structure (partial) */
-struct dsv4l2_device_internal {
-    dsv4l2_device_t public;
-    struct v4l2_capability cap;
-    dsv4l2_tempest_state_t tempest;
-    int tempest_ctrl_id;
-    char *profile_path;
-    char *classification;
-    int streaming;
-    uint32_t dev_id;
-    void *buffers;
-    uint32_t buffer_count;
-};
+/* Default wait for a frame when the caller does not pass a timeout */
+#define DSV4L2_CAPTURE_TIMEOUT_MS 2000
+
+/**
+ * CLOCK_MONOTONIC in nanoseconds (policy check timing)
+ */
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Wait for a filled buffer and dequeue it
+ *
+ * Applies lease backpressure: if every buffer is currently leased the
+ * driver has nothing to fill, so fail fast instead of blocking.
+ *
+ * With a TEMPEST control subscription the same poll also waits for
+ * control events (POLLPRI). poll() reports both conditions together, so
+ * a transition queued before the frame became ready is applied, and
+ * policy re-checked, before the frame is dequeued.
+ *
+ * @param dev Device handle
+ * @param buf Output dequeued buffer
+ * @param timeout_ms Poll timeout (-1 = block, 0 = non-blocking)
+ * @return 0 on success, -ENOBUFS if all buffers are leased,
+ *         -EPERM if TEMPEST policy now blocks capture,
+ *         -ETIMEDOUT/-EAGAIN if no frame is ready, negative errno otherwise
+ */
+static int wait_and_dequeue(dsv4l2_device_t *dev, struct v4l2_buffer *buf,
+                            int timeout_ms)
+{
+    dsv4l2_device_internal_t *internal = dsv4l2_get_internal(dev);
+    struct pollfd pfd;
+    int rc;
+
+    if (internal->buffer_count == 0) {
+        return -EINVAL;
+    }
+
+    if (dsv4l2_buffer_available(internal) == 0) {
+        return -ENOBUFS;
+    }
+
+    pfd.fd = dev->fd;
+    pfd.events = POLLIN | (internal->tempest_subscribed ? POLLPRI : 0);
+
+    for (;;) {
+        pfd.revents = 0;
+
+        do {
+            rc = poll(&pfd, 1, timeout_ms);
+        } while (rc < 0 && errno == EINTR);
+
+        if (rc < 0) {
+            return -errno;
+        }
+        if (rc == 0) {
+            return timeout_ms == 0 ? -EAGAIN : -ETIMEDOUT;
+        }
+
+        if (pfd.revents & POLLPRI) {
+            dsv4l2_tempest_state_t state;
+
+            dsv4l2_tempest_dequeue_events(internal);
+            state = __atomic_load_n(&internal->tempest, __ATOMIC_ACQUIRE);
+            if (dsv4l2_policy_capture_check(internal, state, "dequeue") != 0) {
+                dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                                     DSV4L2_SEV_CRITICAL, state);
+                return -EPERM;
+            }
+
+            /* Control events are rare: restart the wait for a frame */
+            if (!(pfd.revents & POLLIN)) {
+                continue;
+            }
+        }
+
+        return dsv4l2_dequeue_buffer(dev, buf);
+    }
+}
+
+/**
+ * Requeue the buffer held on behalf of dsv4l2_capture_frame()
+ */
+static void release_implicit_lease(dsv4l2_device_t *dev)
+{
+    dsv4l2_device_internal_t *internal = dsv4l2_get_internal(dev);
+    dsv4l2_frame_t held;
+
+    if (internal->implicit_lease < 0) {
+        return;
+    }
+
+    memset(&held, 0, sizeof(held));
+    held.index = (uint32_t)internal->implicit_lease;
+    held.sequence = internal->implicit_sequence;
+    internal->implicit_lease = -1;
+
+    dsv4l2_frame_release(dev, &held);
+}
 
 /**
  * Start streaming
@@ -104,6 +192,9 @@ int dsv4l2_stop_streaming(dsv4l2_device_t *dev)
 
     internal->streaming = 0;
 
+    /* STREAMOFF dequeued everything: outstanding leases are void */
+    dsv4l2_buffer_reset(internal);
+
     /* Emit streaming stop event */
     dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_CAPTURE_STOP,
                          DSV4L2_SEV_INFO, 0);
@@ -116,9 +207,14 @@ int dsv4l2_stop_streaming(dsv4l2_device_t *dev)
  *
  * This function demonstrates DSLLVM enforcement:
  * - Annotated with DSMIL_REQUIRES_TEMPEST_CHECK
- * - MUST call dsv4l2_get_tempest_state() and dsv4l2_policy_check()
+ * - MUST call dsv4l2_get_tempest_state() and the policy check
+ *   (dsv4l2_policy_capture_check(), the cached form of dsv4l2_policy_check())
  * - DSLLVM will reject build if checks are missing
  *
+ * The frame is returned in place (no copy) and stays valid until the next
+ * dsv4l2_capture_frame() call on the same device, which hands the buffer
+ * back to the driver. Use dsv4l2_frame_acquire() to hold several frames.
+ *
  * @param dev Device handle
  * @param out Output frame buffer
  * @return 0 on success, negative errno on error
@@ -129,8 +225,6 @@ int dsv4l2_capture_frame(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
 {
     dsv4l2_device_internal_t *internal;
     struct v4l2_buffer buf;
-    void *buffer_start;
-    size_t buffer_len;
     int rc;
 
     if (!dev || !out) {
@@ -141,7 +235,12 @@ int dsv4l2_capture_frame(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
 
     /* CRITICAL: TEMPEST state check (REQUIRED by DSLLVM) */
     dsv4l2_tempest_state_t state = dsv4l2_get_tempest_state(dev);
-    if (dsv4l2_policy_check(state, "capture_frame") != 0) {
+    uint64_t policy_start = mono_ns();
+    int denied = dsv4l2_policy_capture_check(internal, state, "capture_frame") != 0;
+
+    dsv4l2_histogram_record(&internal->seq.hist[DSV4L2_HIST_POLICY],
+                            mono_ns() - policy_start);
+    if (denied) {
         /* Policy violation: emit event */
         dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
                              DSV4L2_SEV_CRITICAL, state);
@@ -156,36 +255,188 @@ int dsv4l2_capture_frame(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
         }
     }
 
+    /* Hand the previous frame back to the driver */
+    release_implicit_lease(dev);
+
     /* Dequeue buffer */
-    rc = dsv4l2_dequeue_buffer(dev, &buf);
+    rc = wait_and_dequeue(dev, &buf, DSV4L2_CAPTURE_TIMEOUT_MS);
     if (rc < 0) {
-        /* Emit frame dropped event */
-        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
-                             DSV4L2_SEV_MEDIUM, -rc);
+        /* Emit frame dropped event (policy blocks are already logged) */
+        if (rc != -EPERM) {
+            dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
+                                 DSV4L2_SEV_MEDIUM, -rc);
+        }
         return rc;
     }
 
-    /* Get buffer pointer */
-    rc = dsv4l2_get_buffer(dev, buf.index, &buffer_start, &buffer_len);
+    /* Fill output frame (buffer stays leased until the next call) */
+    dsv4l2_buffer_lease(internal, &buf, out);
+    internal->implicit_lease = (int)buf.index;
+    internal->implicit_sequence = out->sequence;
+
+    /* Emit frame acquired event */
+    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_INFO, buf.bytesused);
+
+    return 0;
+}
+
+/**
+ * Acquire a frame lease (zero-copy)
+ *
+ * Dequeues the next filled buffer and leases it to the caller. The buffer
+ * is not returned to the driver until dsv4l2_frame_release(), so
+ * out->data may be processed in place for as long as the lease is held.
+ * When every buffer is leased the call fails with -ENOBUFS instead of
+ * waiting on a queue the driver cannot fill.
+ *
+ * @param dev Device handle
+ * @param out Output frame (data, length, index, sequence, timestamp)
+ * @param timeout_ms Wait timeout (-1 = block, 0 = poll only)
+ * @return 0 on success, negative errno on error
+ */
+DSV4L2_SENSOR("camera", "L3", "UNCLASSIFIED")
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_frame_acquire(dsv4l2_device_t *dev, dsv4l2_frame_t *out,
+                         int timeout_ms)
+{
+    dsv4l2_device_internal_t *internal;
+    struct v4l2_buffer buf;
+    int rc;
+
+    if (!dev || !out) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    /* CRITICAL: TEMPEST state check (REQUIRED by DSLLVM) */
+    dsv4l2_tempest_state_t state = dsv4l2_get_tempest_state(dev);
+    uint64_t policy_start = mono_ns();
+    int denied = dsv4l2_policy_capture_check(internal, state, "frame_acquire") != 0;
+
+    dsv4l2_histogram_record(&internal->seq.hist[DSV4L2_HIST_POLICY],
+                            mono_ns() - policy_start);
+    if (denied) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                             DSV4L2_SEV_CRITICAL, state);
+        return -EPERM;
+    }
+
+    /* Ensure streaming is active */
+    if (!internal->streaming) {
+        rc = dsv4l2_start_streaming(dev);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    rc = wait_and_dequeue(dev, &buf, timeout_ms);
     if (rc < 0) {
-        dsv4l2_queue_buffer(dev, buf.index);
+        if (rc != -ENOBUFS && rc != -EPERM) {
+            dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
+                                 DSV4L2_SEV_MEDIUM, -rc);
+        }
         return rc;
     }
 
-    /* Fill output frame */
-    out->data = (uint8_t *)buffer_start;
-    out->len = buf.bytesused;
+    dsv4l2_buffer_lease(internal, &buf, out);
 
-    /* Emit frame acquired event */
     dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
                          DSV4L2_SEV_INFO, buf.bytesused);
 
-    /* Requeue buffer */
-    dsv4l2_queue_buffer(dev, buf.index);
-
     return 0;
 }
 
+/**
+ * Acquire every ready frame in one call (zero-copy batch)
+ *
+ * Amortizes the per-frame overhead of dsv4l2_frame_acquire() for
+ * high-rate sensors: the TEMPEST query, the policy check and the
+ * streaming check run once per batch. The call waits once for the first
+ * frame (the usual TEMPEST-aware wait), then drains the remaining ready
+ * buffers with VIDIOC_DQBUF until the driver has none left. One
+ * FRAME_ACQUIRED event carries the frame count. Any other dequeue error
+ * ends the batch early and emits FRAME_DROPPED, like
+ * dsv4l2_capture_frame(); the frames already taken are still returned.
+ *
+ * Each returned frame is a lease and must be released with
+ * dsv4l2_frame_release().
+ *
+ * @param dev Device handle
+ * @param frames Output frames
+ * @param max_frames Capacity of frames
+ * @param timeout_ms Wait for the first frame (-1 = block, 0 = poll only)
+ * @return Number of frames acquired (>= 1), negative errno on error
+ *         (same errors as dsv4l2_frame_acquire())
+ */
+DSV4L2_SENSOR("camera", "L3", "UNCLASSIFIED")
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_capture_frames(dsv4l2_device_t *dev, dsv4l2_frame_t *frames,
+                          size_t max_frames, int timeout_ms)
+{
+    dsv4l2_device_internal_t *internal;
+    struct v4l2_buffer buf;
+    size_t count = 0;
+    int rc;
+
+    if (!dev || !frames || max_frames == 0) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+
+    /* CRITICAL: TEMPEST state check (REQUIRED by DSLLVM), once per batch */
+    dsv4l2_tempest_state_t state = dsv4l2_get_tempest_state(dev);
+    uint64_t policy_start = mono_ns();
+    int denied = dsv4l2_policy_capture_check(internal, state, "capture_frames") != 0;
+
+    dsv4l2_histogram_record(&internal->seq.hist[DSV4L2_HIST_POLICY],
+                            mono_ns() - policy_start);
+    if (denied) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                             DSV4L2_SEV_CRITICAL, state);
+        return -EPERM;
+    }
+
+    /* Ensure streaming is active */
+    if (!internal->streaming) {
+        rc = dsv4l2_start_streaming(dev);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    /* Wait for the first frame (applies pending TEMPEST events) */
+    rc = wait_and_dequeue(dev, &buf, timeout_ms);
+
+    while (rc == 0) {
+        dsv4l2_buffer_lease(internal, &buf, &frames[count++]);
+
+        if (count == max_frames || dsv4l2_buffer_available(internal) == 0) {
+            break;
+        }
+
+        rc = dsv4l2_dequeue_buffer(dev, &buf);
+    }
+
+    /* Non-blocking fd: EAGAIN once every ready buffer is drained */
+    if (rc < 0 && (count == 0 || rc != -EAGAIN)) {
+        if (rc != -ENOBUFS && rc != -EPERM) {
+            dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
+                                 DSV4L2_SEV_MEDIUM, -rc);
+        }
+        if (count == 0) {
+            return rc;
+        }
+    }
+
+    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_INFO, (uint32_t)count);
+
+    return (int)count;
+}
+
 /**
  * Capture iris frame (biometric mode)
  *
@@ -211,8 +462,6 @@ int dsv4l2_capture_iris(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
 {
     dsv4l2_device_internal_t *internal;
     struct v4l2_buffer buf;
-    void *buffer_start;
-    size_t buffer_len;
     int rc;
 
     if (!dev || !out) {
@@ -236,7 +485,7 @@ int dsv4l2_capture_iris(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
     }
 
     /* General policy check */
-    if (dsv4l2_policy_check(state, "capture_iris") != 0) {
+    if (dsv4l2_policy_capture_check(internal, state, "capture_iris") != 0) {
         dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
                              DSV4L2_SEV_CRITICAL, state);
         return -EPERM;
@@ -250,16 +499,12 @@ int dsv4l2_capture_iris(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
         }
     }
 
-    /* Dequeue buffer (in secret region - constant-time enforced) */
-    rc = dsv4l2_dequeue_buffer(dev, &buf);
-    if (rc < 0) {
-        return rc;
-    }
+    /* Hand the previous frame back to the driver */
+    release_implicit_lease(dev);
 
-    /* Get buffer pointer */
-    rc = dsv4l2_get_buffer(dev, buf.index, &buffer_start, &buffer_len);
+    /* Dequeue buffer (in secret region - constant-time enforced) */
+    rc = wait_and_dequeue(dev, &buf, DSV4L2_CAPTURE_TIMEOUT_MS);
     if (rc < 0) {
-        dsv4l2_queue_buffer(dev, buf.index);
         return rc;
     }
 
@@ -268,25 +513,55 @@ int dsv4l2_capture_iris(dsv4l2_device_t *dev, dsv4l2_frame_t *out)
      * - printf/fprintf/syslog of this data
      * - send/sendto/write without encryption
      * - storage without dsv4l2_store_encrypted() */
-    out->data = (uint8_t *)buffer_start;
-    out->len = buf.bytesused;
-
-    /* Requeue buffer */
-    dsv4l2_queue_buffer(dev, buf.index);
+    dsv4l2_buffer_lease(internal, &buf, out);
+    internal->implicit_lease = (int)buf.index;
+    internal->implicit_sequence = out->sequence;
 
     return 0;
 }
 
+/**
+ * TEMPEST policy check and frame capture shared by the fused paths
+ */
+static int fused_capture_frame(dsv4l2_device_t *video_dev, dsv4l2_frame_t *out_frame)
+{
+    dsv4l2_device_internal_t *internal = dsv4l2_get_internal(video_dev);
+    dsv4l2_tempest_state_t vid_state;
+
+    /* Emit fused capture event */
+    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FUSED_CAPTURE,
+                         DSV4L2_SEV_MEDIUM, 0);
+
+    /* TEMPEST check for video device (metadata shares its fd and state) */
+    vid_state = dsv4l2_get_tempest_state(video_dev);
+
+    /* Policy check */
+    if (dsv4l2_policy_capture_check(internal, vid_state, "fused_capture") != 0) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                             DSV4L2_SEV_CRITICAL, vid_state);
+        return -EPERM;
+    }
+
+    /* Capture video frame */
+    return dsv4l2_capture_frame(video_dev, out_frame);
+}
+
 /**
  * Fused video + metadata capture
  *
  * Annotated as quantum candidate for L7/L8 offload.
  * DSLLVM can extract features for ML/AI processing.
  *
+ * Metadata comes from meta_dev's history (dsv4l2_metadata_set_history()),
+ * aligned within DSV4L2_META_SYNC_TOLERANCE_NS with telemetry
+ * interpolation. out_meta->data is a heap block holding a
+ * dsv4l2_metadata_t followed by its payload (caller frees it), or NULL if
+ * nothing was aligned.
+ *
  * @param video_dev Video device handle
- * @param meta_dev Metadata device handle (currently unused)
+ * @param meta_dev Metadata stream (may be NULL)
  * @param out_frame Output video frame
- * @param out_meta Output metadata (currently unused)
+ * @param out_meta Output metadata (may be NULL)
  * @return 0 on success, negative errno on error
  */
 DSV4L2_SENSOR("fused_sensor", "L3", "SECRET")
@@ -297,44 +572,91 @@ int dsv4l2_fused_capture(dsv4l2_device_t *video_dev,
                          dsv4l2_frame_t *out_frame,
                          dsv4l2_meta_t *out_meta)
 {
-    dsv4l2_device_internal_t *internal;
+    dsv4l2_meta_history_t *hist;
+    size_t payload_max, size;
+    uint8_t *block;
     int rc;
 
     if (!video_dev || !out_frame) {
         return -EINVAL;
     }
 
-    internal = dsv4l2_get_internal(video_dev);
+    rc = fused_capture_frame(video_dev, out_frame);
+    if (rc < 0) {
+        return rc;
+    }
 
-    /* Emit fused capture event */
-    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FUSED_CAPTURE,
-                         DSV4L2_SEV_MEDIUM, 0);
+    if (!out_meta) {
+        return 0;
+    }
+    out_meta->data = NULL;
+    out_meta->len = 0;
 
-    /* TEMPEST check for video device */
-    dsv4l2_tempest_state_t vid_state = dsv4l2_get_tempest_state(video_dev);
+    hist = dsv4l2_metadata_get_history(meta_dev);
+    if (!hist) {
+        return 0;
+    }
 
-    /* If metadata device provided, check its TEMPEST state too */
-    /* (Metadata device support to be implemented in Phase 5) */
-    (void)meta_dev;
+    payload_max = dsv4l2_meta_history_payload_max(hist);
+    size = sizeof(dsv4l2_metadata_t) + payload_max;
+    block = malloc(size);
+    if (!block) {
+        return -ENOMEM;
+    }
 
-    /* Policy check */
-    if (dsv4l2_policy_check(vid_state, "fused_capture") != 0) {
-        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
-                             DSV4L2_SEV_CRITICAL, vid_state);
-        return -EPERM;
+    rc = dsv4l2_meta_history_find(hist, out_frame->timestamp_ns,
+                                  DSV4L2_META_SYNC_TOLERANCE_NS,
+                                  DSV4L2_META_FIND_INTERPOLATE,
+                                  (dsv4l2_metadata_t *)(void *)block,
+                                  block + sizeof(dsv4l2_metadata_t), payload_max);
+    if (rc < 0) {
+        free(block);
+        return rc == -ENOENT ? 0 : rc;
     }
 
-    /* Capture video frame */
-    rc = dsv4l2_capture_frame(video_dev, out_frame);
+    out_meta->data = block;
+    out_meta->len = size;
+
+    return 0;
+}
+
+/**
+ * Capture a video frame with its aligned metadata
+ */
+DSV4L2_SENSOR("fused_sensor", "L3", "SECRET")
+DSMIL_QUANTUM_CANDIDATE("fused_capture")
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_fused_capture_aligned(dsv4l2_device_t *video_dev,
+                                 dsv4l2_metadata_capture_t *meta_cap,
+                                 uint64_t tolerance_ns, unsigned flags,
+                                 dsv4l2_frame_t *out_frame,
+                                 dsv4l2_metadata_t *out_meta,
+                                 void *payload, size_t payload_size)
+{
+    dsv4l2_meta_history_t *hist;
+    int rc;
+
+    if (!video_dev || !meta_cap || !out_frame || !out_meta) {
+        return -EINVAL;
+    }
+
+    hist = dsv4l2_metadata_get_history(meta_cap);
+    if (!hist) {
+        return -ENOTSUP;
+    }
+
+    rc = fused_capture_frame(video_dev, out_frame);
     if (rc < 0) {
         return rc;
     }
 
-    /* Capture metadata (stub for Phase 5) */
-    if (out_meta) {
-        out_meta->data = NULL;
-        out_meta->len = 0;
+    rc = dsv4l2_meta_history_find(hist, out_frame->timestamp_ns,
+                                  tolerance_ns ? tolerance_ns : DSV4L2_META_SYNC_TOLERANCE_NS,
+                                  flags, out_meta, payload, payload_size);
+    if (rc == -ENOENT) {
+        memset(out_meta, 0, sizeof(*out_meta));
+        return 1;
     }
 
-    return 0;
+    return rc;
 }
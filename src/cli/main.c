@@ -7,10 +7,13 @@
  *   scan    - Scan for v4l2 devices
  *   list    - List available devices with profiles
  *   info    - Show detailed device information
- *   capture - Capture frames from a device
- *   monitor - Monitor runtime events
+ *   capture - Capture frames from a device (-R: threaded recording)
+ *   monitor - Monitor runtime events (attaches to a shared-memory ring)
+ *             or the latency histograms of a device (-d)
  */
 
+#define _GNU_SOURCE
+
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
 #include "dsv4l2_core.h"
@@ -24,6 +27,12 @@
 #include <string.h>
 #include <unistd.h>
 #include <getopt.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 /* Command function prototypes */
 static int cmd_scan(int argc, char **argv);
@@ -68,6 +77,7 @@ static void print_usage(const char *progname)
     printf("  -v, --version  Show version information\n");
     printf("\nEnvironment Variables:\n");
     printf("  DSV4L2_PROFILE    Instrumentation profile (off/ops/exercise/forensic)\n");
+    printf("  DSV4L2_SHM        Shared-memory event ring name (producer and monitor)\n");
     printf("  DSV4L2_CLEARANCE  User clearance level (UNCLASSIFIED/CONFIDENTIAL/SECRET/TOP_SECRET)\n");
 }
 
@@ -76,7 +86,7 @@ static void print_usage(const char *progname)
  */
 static int cmd_scan(int argc, char **argv)
 {
-    dsv4l2_device_t **devices = NULL;
+    dsv4l2_device_info_t *nodes = NULL;
     size_t count = 0;
     int rc;
     size_t i;
@@ -86,7 +96,8 @@ static int cmd_scan(int argc, char **argv)
 
     printf("Scanning for v4l2 devices...\n\n");
 
-    rc = dsv4l2_list_devices(&devices, &count);
+    /* Probe only: nodes are never opened as devices */
+    rc = dsv4l2_probe_devices(&nodes, &count);
     if (rc != 0) {
         fprintf(stderr, "Error: Failed to list devices: %s\n", strerror(-rc));
         return 1;
@@ -94,23 +105,30 @@ static int cmd_scan(int argc, char **argv)
 
     if (count == 0) {
         printf("No v4l2 devices found.\n");
+        free(nodes);
         return 0;
     }
 
     printf("Found %zu device(s):\n\n", count);
 
     for (i = 0; i < count; i++) {
+        const dsv4l2_device_info_t *node = &nodes[i];
+
         printf("Device %zu:\n", i + 1);
-        printf("  Path:  %s\n", devices[i]->dev_path);
-        printf("  Role:  %s\n", devices[i]->role);
-        printf("  Layer: L%d\n", devices[i]->layer);
+        printf("  Path:   %s\n", node->path);
+        printf("  Card:   %s (%s)\n", node->card, node->driver);
+        printf("  USB ID: %s\n", node->usb_id[0] ? node->usb_id : "-");
+        printf("  Role:   %s (%s)\n", node->role, node->classification);
+        printf("  Type:  %s%s%s%s\n",
+               (node->device_caps & V4L2_CAP_VIDEO_CAPTURE) ? " capture" : "",
+               (node->device_caps & V4L2_CAP_VIDEO_CAPTURE_MPLANE) ? " capture-mplane" : "",
+               (node->device_caps & V4L2_CAP_META_CAPTURE) ? " metadata" : "",
+               (node->device_caps & (V4L2_CAP_VIDEO_M2M | V4L2_CAP_VIDEO_M2M_MPLANE)) ?
+                   " m2m" : "");
         printf("\n");
-
-        /* Close device */
-        dsv4l2_close(devices[i]);
     }
 
-    free(devices);
+    free(nodes);
     return 0;
 }
 
@@ -217,6 +235,390 @@ static int cmd_info(int argc, char **argv)
     return 0;
 }
 
+/* ========================================================================
+ * Recording
+ * ======================================================================== */
+
+#define RECORD_RING_SLOTS  32      /* Frames in flight to the writer (> any buffer count) */
+#define RECORD_ALIGN       4096    /* O_DIRECT offset/length alignment */
+#define RECORD_URING_ARENA (64u << 20)  /* io_uring staging for frames in flight */
+
+/* Set by SIGINT/SIGTERM to end an open-ended recording */
+static volatile sig_atomic_t record_stop = 0;
+
+static void record_signal(int sig)
+{
+    (void)sig;
+    record_stop = 1;
+}
+
+/*
+ * Capture thread -> writer thread handoff
+ *
+ * The capture thread only dequeues and pushes leases; the writer thread
+ * copies them to disk and releases them, so a slow disk costs driver
+ * buffers (visible as driver drops), never capture-thread stalls.
+ *
+ * With io_uring (-U) there is no writer thread: the capture thread copies
+ * each lease into the runtime's staging arena, returns it to the driver
+ * at once and queues the write; a full arena costs writer drops.
+ */
+typedef struct {
+    dsv4l2_device_t *dev;
+    pthread_mutex_t  lock;
+    pthread_cond_t   ready;
+    dsv4l2_frame_t   ring[RECORD_RING_SLOTS];
+    size_t           head;         /* Next slot to fill */
+    size_t           tail;         /* Next slot to write */
+    int              done;         /* Capture finished */
+
+    int              fd;
+    int              direct;       /* fd opened with O_DIRECT */
+    FILE            *index;        /* Sidecar: sequence,timestamp_ns,offset,length */
+    uint8_t         *bounce;       /* Aligned staging buffer (O_DIRECT) */
+    size_t           bounce_len;
+    uint64_t         offset;       /* Next write offset */
+    uint64_t         end;          /* End of the last frame's data */
+    uint64_t         frames;
+    uint64_t         bytes;
+    int              error;        /* First write error (negative errno) */
+    uint64_t         lost;         /* Queued frames whose write failed (io_uring) */
+} recorder_t;
+
+/**
+ * Write a whole buffer at an offset
+ */
+static int record_pwrite(int fd, const uint8_t *data, size_t len, uint64_t offset)
+{
+    while (len > 0) {
+        ssize_t n = pwrite(fd, data, len, (off_t)offset);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        data += n;
+        len -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+
+    return 0;
+}
+
+/**
+ * Write one leased frame and its index line
+ */
+static int record_frame(recorder_t *rec, const dsv4l2_frame_t *frame)
+{
+    size_t len = frame->len, padded = len;
+    const uint8_t *src = frame->data;
+    int rc;
+
+    if (rec->direct) {
+        /* O_DIRECT wants aligned memory, offset and length */
+        padded = (len + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+        if (padded > rec->bounce_len) {
+            void *buf = NULL;
+
+            if (posix_memalign(&buf, RECORD_ALIGN, padded) != 0) {
+                return -ENOMEM;
+            }
+            free(rec->bounce);
+            rec->bounce = buf;
+            rec->bounce_len = padded;
+        }
+        memcpy(rec->bounce, frame->data, len);
+        memset(rec->bounce + len, 0, padded - len);
+        src = rec->bounce;
+    }
+
+    rc = record_pwrite(rec->fd, src, padded, rec->offset);
+    if (rc < 0) {
+        return rc;
+    }
+
+    fprintf(rec->index, "%u,%llu,%llu,%zu\n", frame->sequence,
+            (unsigned long long)frame->timestamp_ns,
+            (unsigned long long)rec->offset, len);
+
+    rec->end = rec->offset + len;
+    rec->offset += padded;
+    rec->frames++;
+    rec->bytes += len;
+    return 0;
+}
+
+/**
+ * io_uring write completion (runtime submission thread)
+ */
+static void record_io_done(void *user_data, int result)
+{
+    recorder_t *rec = user_data;
+    int expected = 0;
+
+    if (result < 0) {
+        __atomic_compare_exchange_n(&rec->error, &expected, result, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&rec->lost, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Stage a leased frame in the io_uring arena and queue its write
+ *
+ * The lease may be released as soon as this returns. Arena buffers are
+ * page aligned, so O_DIRECT needs no bounce buffer.
+ */
+static int record_submit(recorder_t *rec, const dsv4l2_frame_t *frame)
+{
+    size_t len = frame->len, padded = len;
+    uint8_t *buf;
+    int rc;
+
+    rc = __atomic_load_n(&rec->error, __ATOMIC_RELAXED);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (rec->direct) {
+        padded = (len + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+    }
+
+    buf = dsv4l2rt_io_buffer_alloc(padded);
+    if (!buf) {
+        return -ENOBUFS;
+    }
+    memcpy(buf, frame->data, len);
+    memset(buf + len, 0, padded - len);
+
+    rc = dsv4l2rt_io_write(rec->fd, buf, padded, rec->offset, DSV4L2RT_IO_RELEASE,
+                           record_io_done, rec);
+    if (rc < 0) {
+        dsv4l2rt_io_buffer_free(buf);
+        return rc;
+    }
+
+    fprintf(rec->index, "%u,%llu,%llu,%zu\n", frame->sequence,
+            (unsigned long long)frame->timestamp_ns,
+            (unsigned long long)rec->offset, len);
+
+    rec->end = rec->offset + len;
+    rec->offset += padded;
+    rec->frames++;
+    rec->bytes += len;
+    return 0;
+}
+
+static void *record_writer(void *arg)
+{
+    recorder_t *rec = arg;
+
+    for (;;) {
+        dsv4l2_frame_t frame;
+
+        pthread_mutex_lock(&rec->lock);
+        while (rec->head == rec->tail && !rec->done) {
+            pthread_cond_wait(&rec->ready, &rec->lock);
+        }
+        if (rec->head == rec->tail) {
+            pthread_mutex_unlock(&rec->lock);
+            break;
+        }
+        frame = rec->ring[rec->tail % RECORD_RING_SLOTS];
+        pthread_mutex_unlock(&rec->lock);
+
+        /* After a write error keep draining so every lease is returned */
+        if (rec->error == 0) {
+            rec->error = record_frame(rec, &frame);
+        }
+
+        dsv4l2_frame_release(rec->dev, &frame);
+
+        pthread_mutex_lock(&rec->lock);
+        rec->tail++;
+        pthread_mutex_unlock(&rec->lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Record frames to a preallocated file from a separate writer thread
+ *
+ * @param dev Streaming device
+ * @param output Data file (the index goes to <output>.idx)
+ * @param num_frames Frames to record, <= 0 = until Ctrl+C
+ * @param direct Use O_DIRECT (falls back to buffered I/O if unsupported)
+ * @param uring Queue writes through io_uring (falls back to the writer thread)
+ * @return Process exit status
+ */
+static int record_capture(dsv4l2_device_t *dev, const char *output,
+                          int num_frames, int direct, int uring)
+{
+    recorder_t rec;
+    dsv4l2_capture_stats_t before, after;
+    char index_path[512];
+    struct timespec t0, t1;
+    struct sigaction sa;
+    pthread_t writer;
+    uint64_t ring_drops = 0, captured = 0;
+    double elapsed;
+    int rc = 0, preallocated = 0;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.dev = dev;
+    pthread_mutex_init(&rec.lock, NULL);
+    pthread_cond_init(&rec.ready, NULL);
+
+    rec.fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (direct ? O_DIRECT : 0), 0644);
+    if (rec.fd < 0 && direct && errno == EINVAL) {
+        fprintf(stderr, "Warning: O_DIRECT not supported on %s, using buffered I/O\n", output);
+        direct = 0;
+        rec.fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (rec.fd < 0) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", output, strerror(errno));
+        return 1;
+    }
+    rec.direct = direct;
+
+    snprintf(index_path, sizeof(index_path), "%s.idx", output);
+    rec.index = fopen(index_path, "w");
+    if (!rec.index) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", index_path, strerror(errno));
+        close(rec.fd);
+        return 1;
+    }
+    fprintf(rec.index, "sequence,timestamp_ns,offset,length\n");
+
+    if (uring) {
+        rc = dsv4l2rt_io_start(RECORD_URING_ARENA);
+        if (rc != 0) {
+            fprintf(stderr, "Warning: io_uring unavailable (%s), using a writer thread\n",
+                    strerror(-rc));
+            uring = 0;
+            rc = 0;
+        }
+    }
+
+    if (!uring && pthread_create(&writer, NULL, record_writer, &rec) != 0) {
+        fprintf(stderr, "Error: Cannot start writer thread\n");
+        fclose(rec.index);
+        close(rec.fd);
+        return 1;
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = record_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    memset(&before, 0, sizeof(before));
+    dsv4l2_get_capture_stats(dev, &before);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    while (!record_stop && (num_frames <= 0 || captured < (uint64_t)num_frames)) {
+        dsv4l2_frame_t frame;
+
+        rc = dsv4l2_frame_acquire(dev, &frame, 2000);
+        if (rc == -ENOBUFS) {
+            /* Writer holds every buffer: the driver drops meanwhile */
+            usleep(1000);
+            continue;
+        }
+        if (rc == -EINTR) {
+            continue;
+        }
+        if (rc != 0) {
+            fprintf(stderr, "Error: Failed to capture frame %llu: %s\n",
+                    (unsigned long long)captured + 1, strerror(-rc));
+            break;
+        }
+
+        /* Reserve the whole recording once the frame size is known */
+        if (!preallocated) {
+            size_t slot = direct ? (frame.len + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1)
+                                 : frame.len;
+
+            if (num_frames > 0 &&
+                fallocate(rec.fd, 0, 0, (off_t)slot * num_frames) < 0 &&
+                errno != EOPNOTSUPP) {
+                fprintf(stderr, "Warning: Cannot preallocate %s: %s\n", output, strerror(errno));
+            }
+            preallocated = 1;
+        }
+
+        if (uring) {
+            if (record_submit(&rec, &frame) != 0) {
+                ring_drops++;
+            }
+            dsv4l2_frame_release(dev, &frame);
+            captured++;
+            continue;
+        }
+
+        pthread_mutex_lock(&rec.lock);
+        if (rec.head - rec.tail < RECORD_RING_SLOTS) {
+            rec.ring[rec.head % RECORD_RING_SLOTS] = frame;
+            rec.head++;
+            pthread_cond_signal(&rec.ready);
+            pthread_mutex_unlock(&rec.lock);
+        } else {
+            pthread_mutex_unlock(&rec.lock);
+            dsv4l2_frame_release(dev, &frame);
+            ring_drops++;
+        }
+        captured++;
+    }
+
+    if (uring) {
+        dsv4l2rt_io_drain();
+        dsv4l2rt_io_stop();
+        rec.frames -= rec.lost;
+    } else {
+        pthread_mutex_lock(&rec.lock);
+        rec.done = 1;
+        pthread_cond_signal(&rec.ready);
+        pthread_mutex_unlock(&rec.lock);
+        pthread_join(writer, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    memset(&after, 0, sizeof(after));
+    dsv4l2_get_capture_stats(dev, &after);
+
+    /* Drop the unused preallocation and the last frame's padding */
+    if (ftruncate(rec.fd, (off_t)rec.end) < 0) {
+        fprintf(stderr, "Warning: Cannot trim %s: %s\n", output, strerror(errno));
+    }
+    close(rec.fd);
+    fclose(rec.index);
+    free(rec.bounce);
+    pthread_cond_destroy(&rec.ready);
+    pthread_mutex_destroy(&rec.lock);
+
+    elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    if (rec.error) {
+        fprintf(stderr, "Error: Write failed: %s\n", strerror(-rec.error));
+    }
+
+    printf("\nRecorded %llu frame(s), %.1f MB in %.2f s to %s%s%s\n",
+           (unsigned long long)rec.frames, rec.bytes / 1e6, elapsed, output,
+           direct ? " (O_DIRECT)" : "", uring ? " (io_uring)" : "");
+    printf("  Sustained:      %.1f MB/s, %.1f fps\n",
+           elapsed > 0 ? rec.bytes / 1e6 / elapsed : 0.0,
+           elapsed > 0 ? rec.frames / elapsed : 0.0);
+    printf("  Dropped:        %llu by the driver, %llu by the writer\n",
+           (unsigned long long)(after.dropped - before.dropped),
+           (unsigned long long)(ring_drops + (rec.error ? captured - ring_drops - rec.frames : 0)));
+    printf("  Index:          %s\n", index_path);
+
+    return (rc != 0 || rec.error) ? 1 : 0;
+}
+
 /**
  * Capture command - acquire frames
  */
@@ -227,7 +629,11 @@ static int cmd_capture(int argc, char **argv)
     const char *output_file = NULL;
     dsv4l2_device_t *dev = NULL;
     dsv4l2_frame_t frame;
+    FILE *out = NULL;
     int num_frames = 1;
+    int record = 0;
+    int direct = 0;
+    int uring = 0;
     int rc;
     int i;
 
@@ -237,11 +643,14 @@ static int cmd_capture(int argc, char **argv)
         {"role",    required_argument, 0, 'r'},
         {"output",  required_argument, 0, 'o'},
         {"count",   required_argument, 0, 'n'},
+        {"record",  no_argument,       0, 'R'},
+        {"direct",  no_argument,       0, 'D'},
+        {"uring",   no_argument,       0, 'U'},
         {0, 0, 0, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "d:r:o:n:", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "d:r:o:n:RDU", long_options, NULL)) != -1) {
         switch (opt) {
             case 'd':
                 device_path = optarg;
@@ -255,13 +664,34 @@ static int cmd_capture(int argc, char **argv)
             case 'n':
                 num_frames = atoi(optarg);
                 break;
+            case 'R':
+                record = 1;
+                break;
+            case 'D':
+                direct = 1;
+                break;
+            case 'U':
+                uring = 1;
+                break;
             default:
-                fprintf(stderr, "Usage: %s capture [-d device] [-r role] [-o output] [-n count]\n", argv[0]);
+                fprintf(stderr, "Usage: %s capture [-d device] [-r role] [-o output] [-n count] [-R [-D] [-U]]\n", argv[0]);
+                fprintf(stderr, "  -R  Record from a writer thread (-n 0 = until Ctrl+C)\n");
+                fprintf(stderr, "  -D  With -R, write with O_DIRECT\n");
+                fprintf(stderr, "  -U  With -R, queue writes through io_uring\n");
                 return 1;
         }
     }
 
-    printf("Capturing %d frame(s) from %s (role: %s)\n", num_frames, device_path, role);
+    if (record && !output_file) {
+        fprintf(stderr, "Error: Recording (-R) needs an output file (-o)\n");
+        return 1;
+    }
+
+    if (num_frames > 0 || !record) {
+        printf("Capturing %d frame(s) from %s (role: %s)\n", num_frames, device_path, role);
+    } else {
+        printf("Capturing from %s until Ctrl+C (role: %s)\n", device_path, role);
+    }
 
     /* Open device */
     rc = dsv4l2_open(device_path, role, &dev);
@@ -278,6 +708,23 @@ static int cmd_capture(int argc, char **argv)
         return 1;
     }
 
+    if (record) {
+        rc = record_capture(dev, output_file, num_frames, direct, uring);
+        dsv4l2_stop_streaming(dev);
+        dsv4l2_close(dev);
+        return rc;
+    }
+
+    if (output_file) {
+        out = fopen(output_file, "wb");
+        if (!out) {
+            fprintf(stderr, "Error: Cannot create %s: %s\n", output_file, strerror(errno));
+            dsv4l2_stop_streaming(dev);
+            dsv4l2_close(dev);
+            return 1;
+        }
+    }
+
     /* Capture frames */
     for (i = 0; i < num_frames; i++) {
         rc = dsv4l2_capture_frame(dev, &frame);
@@ -289,16 +736,16 @@ static int cmd_capture(int argc, char **argv)
         printf("Frame %d: %zu bytes\n", i + 1, frame.len);
 
         /* Write to file if specified */
-        if (output_file && frame.data) {
-            FILE *f = fopen(output_file, i == 0 ? "wb" : "ab");
-            if (f) {
-                fwrite(frame.data, 1, frame.len, f);
-                fclose(f);
-            }
+        if (out && frame.data) {
+            fwrite(frame.data, 1, frame.len, out);
         }
 
-        /* Free frame data */
-        free(frame.data);
+        /* frame.data points into the driver buffer: no free, it is
+         * requeued by the next capture call */
+    }
+
+    if (out) {
+        fclose(out);
     }
 
     /* Stop streaming */
@@ -313,40 +760,246 @@ static int cmd_capture(int argc, char **argv)
     return 0;
 }
 
+/* Set by SIGINT/SIGTERM to end the monitor loop */
+static volatile sig_atomic_t monitor_stop = 0;
+
+static void monitor_signal(int sig)
+{
+    (void)sig;
+    monitor_stop = 1;
+}
+
 /**
- * Monitor command - watch runtime events
+ * Print a producer stats snapshot
  */
-static int cmd_monitor(int argc, char **argv)
+static void monitor_print_stats(const dsv4l2rt_shm_t *shm)
 {
-    dsv4l2rt_config_t config;
     dsv4l2rt_stats_t stats;
-    int duration = 10;  /* Default 10 seconds */
+    uint64_t published = 0;
 
-    (void)argc;
-    (void)argv;
+    if (dsv4l2rt_shm_stats(shm, &stats, &published) != 0) {
+        return;
+    }
 
-    printf("Monitoring DSV4L2 runtime events...\n");
+    printf("\nRuntime Statistics:\n");
+    printf("  Events Emitted: %llu\n", (unsigned long long)stats.events_emitted);
+    printf("  Events Dropped: %llu\n", (unsigned long long)stats.events_dropped);
+    printf("  Events Flushed: %llu\n", (unsigned long long)stats.events_flushed);
+    printf("  Buffer Usage:   %zu / %zu\n", stats.buffer_usage, stats.buffer_capacity);
+    printf("  Published:      %llu\n", (unsigned long long)published);
+}
+
+/**
+ * Print p50/p99/p999 of the device histograms
+ */
+static void monitor_print_histograms(dsv4l2_device_t *dev)
+{
+    static const char *const names[DSV4L2_HIST_KINDS] = {
+        [DSV4L2_HIST_LATENCY]  = "Latency",
+        [DSV4L2_HIST_INTERVAL] = "Interval",
+        [DSV4L2_HIST_POLICY]   = "Policy",
+    };
+    static dsv4l2_histogram_t h;
+    int kind;
+
+    printf("%-9s %10s %10s %10s %10s %10s\n",
+           "", "samples", "p50 us", "p99 us", "p999 us", "max us");
+    for (kind = 0; kind < DSV4L2_HIST_KINDS; kind++) {
+        if (dsv4l2_get_histogram(dev, (dsv4l2_hist_kind_t)kind, &h) != 0) {
+            continue;
+        }
+        printf("%-9s %10llu %10.1f %10.1f %10.1f %10.1f\n", names[kind],
+               (unsigned long long)h.count,
+               dsv4l2_histogram_percentile(&h, 50.0) / 1000.0,
+               dsv4l2_histogram_percentile(&h, 99.0) / 1000.0,
+               dsv4l2_histogram_percentile(&h, 99.9) / 1000.0,
+               h.max_ns / 1000.0);
+    }
+}
+
+/**
+ * Capture from a device and report its latency histograms
+ *
+ * Histograms live in the capturing process, so this mode drives the
+ * capture itself; use the shared-memory mode to watch another process.
+ */
+static int monitor_device(const char *device_path, int duration, int stats_only)
+{
+    dsv4l2_device_t *dev = NULL;
+    dsv4l2_frame_t frame;
+    time_t start, last;
+    int rc;
+
+    rc = dsv4l2_open(device_path, "camera", &dev);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Failed to open device: %s\n", strerror(-rc));
+        return 1;
+    }
+
+    rc = dsv4l2_start_streaming(dev);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Failed to start streaming: %s\n", strerror(-rc));
+        dsv4l2_close(dev);
+        return 1;
+    }
+
+    printf("Monitoring capture latency on %s...\n", device_path);
     printf("Press Ctrl+C to stop\n\n");
 
-    /* Initialize runtime in forensic mode */
-    memset(&config, 0, sizeof(config));
-    config.profile = DSV4L2_PROFILE_FORENSIC;
+    start = last = time(NULL);
+    while (!monitor_stop && (duration <= 0 || time(NULL) - start < duration)) {
+        rc = dsv4l2_capture_frame(dev, &frame);
+        if (rc != 0 && rc != -ETIMEDOUT && rc != -EAGAIN) {
+            fprintf(stderr, "Error: Capture failed: %s\n", strerror(-rc));
+            break;
+        }
 
-    dsv4l2rt_init(&config);
+        /* Cumulative view once per second */
+        if (!stats_only && time(NULL) != last) {
+            last = time(NULL);
+            monitor_print_histograms(dev);
+            printf("\n");
+        }
+    }
 
-    /* Monitor for specified duration */
-    sleep(duration);
+    printf("\nCapture Latency (since start):\n");
+    monitor_print_histograms(dev);
 
-    /* Get final statistics */
-    dsv4l2rt_get_stats(&stats);
+    dsv4l2_stop_streaming(dev);
+    dsv4l2_close(dev);
 
-    printf("\nRuntime Statistics:\n");
-    printf("  Events Emitted: %llu\n", (unsigned long long)stats.events_emitted);
-    printf("  Events Dropped: %llu\n", (unsigned long long)stats.events_dropped);
-    printf("  Events Flushed: %llu\n", (unsigned long long)stats.events_flushed);
-    printf("  Buffer Usage:   %zu / %zu\n", stats.buffer_usage, stats.buffer_capacity);
+    return 0;
+}
+
+/**
+ * Monitor command - tail runtime events of another process
+ *
+ * Attaches to the shared-memory ring of a process started with
+ * DSV4L2_SHM=<name> (or dsv4l2rt_config_t.shm_name). With -d the
+ * command captures from the device itself and reports its latency,
+ * frame interval and policy check histograms instead.
+ */
+static int cmd_monitor(int argc, char **argv)
+{
+    const char *name = getenv("DSV4L2_SHM");
+    const char *device_path = NULL;
+    dsv4l2rt_shm_t *shm = NULL;
+    dsv4l2_event_t events[64];
+    struct sigaction sa;
+    uint64_t seen = 0, lost_total = 0;
+    int duration = 0;       /* 0 = until Ctrl+C or producer exit */
+    int stats_only = 0;
+    int from_oldest = 0;
+    time_t start;
+    int rc;
+
+    /* Parse arguments */
+    struct option long_options[] = {
+        {"shm",      required_argument, 0, 's'},
+        {"duration", required_argument, 0, 't'},
+        {"stats",    no_argument,       0, 'q'},
+        {"all",      no_argument,       0, 'a'},
+        {"device",   required_argument, 0, 'd'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:t:qad:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                name = optarg;
+                break;
+            case 't':
+                duration = atoi(optarg);
+                break;
+            case 'q':
+                stats_only = 1;
+                break;
+            case 'a':
+                from_oldest = 1;
+                break;
+            case 'd':
+                device_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s monitor [-s shm_name | -d device] [-t seconds] [-q] [-a]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = monitor_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    if (device_path) {
+        return monitor_device(device_path, duration, stats_only);
+    }
+
+    if (!name || !name[0]) {
+        name = DSV4L2RT_SHM_DEFAULT_NAME;
+    }
+
+    rc = dsv4l2rt_shm_open(name, &shm);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Cannot attach to event ring '%s': %s\n", name, strerror(-rc));
+        if (rc == -ENOENT) {
+            fprintf(stderr, "Start the producer with DSV4L2_SHM=%s\n", name);
+        }
+        return 1;
+    }
+
+    if (from_oldest) {
+        dsv4l2rt_shm_rewind(shm);
+    }
+
+    printf("Monitoring DSV4L2 runtime events (ring %s, pid %d)...\n",
+           name, dsv4l2rt_shm_pid(shm));
+    printf("Press Ctrl+C to stop\n\n");
+
+    start = time(NULL);
+    while (!monitor_stop && (duration <= 0 || time(NULL) - start < duration)) {
+        uint64_t lost = 0;
+        int i;
+
+        rc = dsv4l2rt_shm_read(shm, events, sizeof(events) / sizeof(events[0]), &lost);
+        if (rc == -EPIPE) {
+            printf("Producer shut down\n");
+            break;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "Error: Event ring read failed: %s\n", strerror(-rc));
+            break;
+        }
+
+        if (lost > 0 && !stats_only) {
+            printf("... %llu event(s) overwritten\n", (unsigned long long)lost);
+        }
+        lost_total += lost;
+        seen += (uint64_t)rc;
+
+        for (i = 0; i < rc && !stats_only; i++) {
+            const dsv4l2_event_t *ev = &events[i];
+
+            printf("%llu.%09llu dev=%08x %-20s %-8s aux=%u role=%.*s\n",
+                   (unsigned long long)(ev->ts_ns / 1000000000ULL),
+                   (unsigned long long)(ev->ts_ns % 1000000000ULL),
+                   ev->dev_id, dsv4l2rt_event_name(ev->event_type),
+                   dsv4l2rt_severity_name(ev->severity), ev->aux,
+                   (int)sizeof(ev->role), ev->role);
+        }
+
+        /* Reader-side polling only; the producer never blocks on us */
+        if (rc == 0) {
+            usleep(10000);
+        }
+    }
+
+    printf("\nEvents seen: %llu (%llu overwritten before read)\n",
+           (unsigned long long)seen, (unsigned long long)lost_total);
+    monitor_print_stats(shm);
 
-    dsv4l2rt_shutdown();
+    dsv4l2rt_shm_close(shm);
 
     return 0;
 }
@@ -10,9 +10,11 @@
 
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
 #include "dsv4l2rt.h"
 #include "dsv4l2_profiles.h"
 #include "dsv4l2_dsmil.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
@@ -24,30 +26,98 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <dirent.h>
-
-/* Internal device structure (extends public dsv4l2_device_t) */
-typedef struct dsv4l2_device_internal {
-    dsv4l2_device_t public;          /* Public device handle */
-
-    /* Internal state */
-    struct v4l2_capability cap;      /* Device capabilities */
-    dsv4l2_tempest_state_t tempest;  /* Current TEMPEST state */
-    int tempest_ctrl_id;             /* v4l2 control ID for TEMPEST */
-
-    /* Profile information */
-    char *profile_path;              /* Path to loaded profile */
-    char *classification;            /* Security classification */
-
-    /* Runtime state */
-    int streaming;                   /* 1 if streaming active */
-    uint32_t dev_id;                 /* Device ID (hash) */
-} dsv4l2_device_internal_t;
+#include <pthread.h>
 
 /* Forward declarations */
 static uint32_t hash_device_path(const char *path);
 static int load_device_profile(const char *path, const char *role,
                                 dsv4l2_device_internal_t *dev);
 
+/* Registry of open devices */
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static dsv4l2_device_internal_t *g_registry_head;
+static size_t g_registry_count;
+
+/**
+ * Add a device to the registry
+ */
+void dsv4l2_registry_add(dsv4l2_device_internal_t *dev)
+{
+    pthread_mutex_lock(&g_registry_lock);
+    dev->registry_prev = NULL;
+    dev->registry_next = g_registry_head;
+    if (g_registry_head) {
+        g_registry_head->registry_prev = dev;
+    }
+    g_registry_head = dev;
+    g_registry_count++;
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+/**
+ * Remove a device from the registry
+ */
+void dsv4l2_registry_remove(dsv4l2_device_internal_t *dev)
+{
+    pthread_mutex_lock(&g_registry_lock);
+    if (dev->registry_prev) {
+        dev->registry_prev->registry_next = dev->registry_next;
+    } else {
+        g_registry_head = dev->registry_next;
+    }
+    if (dev->registry_next) {
+        dev->registry_next->registry_prev = dev->registry_prev;
+    }
+    dev->registry_prev = NULL;
+    dev->registry_next = NULL;
+    g_registry_count--;
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
+/**
+ * Lock the registry and snapshot the open devices
+ *
+ * @param devices Output device array (NULL if no device is open), release
+ *                with dsv4l2_registry_release()
+ * @param count Output device count
+ * @return 0 with the registry locked, -ENOMEM (registry unlocked) if the
+ *         snapshot could not be allocated
+ */
+int dsv4l2_registry_acquire(dsv4l2_device_internal_t ***devices, size_t *count)
+{
+    dsv4l2_device_internal_t *dev;
+    size_t i = 0;
+
+    *devices = NULL;
+    *count = 0;
+
+    pthread_mutex_lock(&g_registry_lock);
+
+    if (g_registry_count > 0) {
+        *devices = calloc(g_registry_count, sizeof(**devices));
+        if (!*devices) {
+            pthread_mutex_unlock(&g_registry_lock);
+            return -ENOMEM;
+        }
+    }
+
+    for (dev = g_registry_head; dev; dev = dev->registry_next) {
+        (*devices)[i++] = dev;
+    }
+
+    *count = i;
+    return 0;
+}
+
+/**
+ * Free a registry snapshot and unlock the registry
+ */
+void dsv4l2_registry_release(dsv4l2_device_internal_t **devices)
+{
+    free(devices);
+    pthread_mutex_unlock(&g_registry_lock);
+}
+
 /**
  * Open a v4l2 device with role classification
  *
@@ -123,10 +193,21 @@ int dsv4l2_open(const char *path, const char *role, dsv4l2_device_t **out)
         return -EPERM;
     }
 
+    /* No buffers until dsv4l2_request_buffers() */
+    dev->implicit_lease = -1;
+
     /* Initialize TEMPEST state to DISABLED */
     dev->tempest = DSV4L2_TEMPEST_DISABLED;
     dev->tempest_ctrl_id = 0x9a0902;  /* Default control ID */
 
+    /* Track TEMPEST control changes instead of polling the control */
+    dsv4l2_tempest_subscribe(dev);
+
+    /* Precompute the capture policy decision */
+    dsv4l2_policy_decide(dev);
+
+    dsv4l2_registry_add(dev);
+
     /* Emit device open event */
     dsv4l2rt_emit_simple(dev->dev_id, DSV4L2_EVENT_DEVICE_OPEN,
                          DSV4L2_SEV_INFO, 0);
@@ -150,10 +231,19 @@ void dsv4l2_close(dsv4l2_device_t *dev)
 
     internal = (dsv4l2_device_internal_t *)dev;
 
+    /* Waits for any THREATCON fan-out still using the device */
+    dsv4l2_registry_remove(internal);
+
     /* Emit device close event */
     dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_DEVICE_CLOSE,
                          DSV4L2_SEV_INFO, 0);
 
+    /* Stop streaming and drop buffers (invalidates outstanding leases) */
+    if (internal->buffers) {
+        dsv4l2_stop_streaming(dev);
+        dsv4l2_release_buffers(dev);
+    }
+
     /* Close file descriptor */
     if (dev->fd >= 0) {
         close(dev->fd);
@@ -170,70 +260,53 @@ void dsv4l2_close(dsv4l2_device_t *dev)
 /**
  * List all v4l2 devices on the system
  *
+ * Only nodes the probe cache reports as video capture devices are
+ * opened, so metadata, output and M2M nodes cost nothing here.
+ *
  * @param devices Output array of device handles (caller must free)
  * @param count Output device count
  * @return 0 on success, negative errno on error
  */
 int dsv4l2_list_devices(dsv4l2_device_t ***devices, size_t *count)
 {
-    DIR *dir;
-    struct dirent *entry;
-    dsv4l2_device_t **dev_list = NULL;
-    size_t dev_count = 0;
-    size_t dev_capacity = 16;
+    dsv4l2_device_info_t *nodes = NULL;
+    dsv4l2_device_t **dev_list;
+    size_t node_count = 0, dev_count = 0;
+    size_t i;
     int rc;
 
     if (!devices || !count) {
         return -EINVAL;
     }
 
-    /* Allocate initial device list */
-    dev_list = calloc(dev_capacity, sizeof(dsv4l2_device_t *));
-    if (!dev_list) {
-        return -ENOMEM;
+    rc = dsv4l2_probe_devices(&nodes, &node_count);
+    if (rc < 0) {
+        return rc;
     }
 
-    /* Scan /dev for video devices */
-    dir = opendir("/dev");
-    if (!dir) {
-        free(dev_list);
-        return -errno;
+    dev_list = calloc(node_count ? node_count : 1, sizeof(dsv4l2_device_t *));
+    if (!dev_list) {
+        free(nodes);
+        return -ENOMEM;
     }
 
-    while ((entry = readdir(dir)) != NULL) {
-        char path[256];
-        struct stat st;
-
-        /* Check if this is a video device */
-        if (strncmp(entry->d_name, "video", 5) != 0) {
+    for (i = 0; i < node_count; i++) {
+        /*
+         * Test the node, not the physical device: a metadata node of a
+         * capture device also reports V4L2_CAP_VIDEO_CAPTURE in
+         * capabilities. device_caps already falls back to capabilities
+         * for drivers without V4L2_CAP_DEVICE_CAPS.
+         */
+        if (!(nodes[i].device_caps & V4L2_CAP_VIDEO_CAPTURE)) {
             continue;
         }
 
-        snprintf(path, sizeof(path), "/dev/%s", entry->d_name);
-
-        /* Verify it's a character device */
-        if (stat(path, &st) < 0 || !S_ISCHR(st.st_mode)) {
-            continue;
-        }
-
-        /* Try to open it */
-        rc = dsv4l2_open(path, "camera", &dev_list[dev_count]);
-        if (rc == 0) {
+        if (dsv4l2_open(nodes[i].path, "camera", &dev_list[dev_count]) == 0) {
             dev_count++;
-
-            /* Expand array if needed */
-            if (dev_count >= dev_capacity) {
-                dev_capacity *= 2;
-                dev_list = realloc(dev_list, dev_capacity * sizeof(dsv4l2_device_t *));
-                if (!dev_list) {
-                    closedir(dir);
-                    return -ENOMEM;
-                }
-            }
         }
     }
 
-    closedir(dir);
+    free(nodes);
 
     *devices = dev_list;
     *count = dev_count;
@@ -335,17 +408,23 @@ static uint32_t hash_device_path(const char *path)
 /**
  * Load device profile from profiles/ directory
  *
- * Tries to find a matching profile by device ID or role
+ * Tries to find a matching profile by USB VID:PID, then by role
  */
 static int load_device_profile(const char *path, const char *role,
                                 dsv4l2_device_internal_t *dev)
 {
     const dsv4l2_device_profile_t *profile = NULL;
+    char usb_id[10];
 
-    (void)path;  /* TODO: extract USB VID:PID from sysfs */
+    /* A profile for the exact USB VID:PID wins over the role default */
+    if (dsv4l2_probe_usb_id(path, usb_id, sizeof(usb_id)) == 0) {
+        profile = dsv4l2_find_profile(usb_id);
+    }
 
     /* Try to find profile by role */
-    profile = dsv4l2_find_profile_by_role(role);
+    if (!profile) {
+        profile = dsv4l2_find_profile_by_role(role);
+    }
 
     if (profile) {
         /* Apply profile settings */
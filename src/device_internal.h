@@ -0,0 +1,221 @@
+/*
+ * DSV4L2 Internal Device State
+ *
+ * Shared definition of the internal device structure used by all core
+ * modules. Every translation unit that needs more than the public
+ * dsv4l2_device_t handle includes this header so the layout stays in
+ * one place.
+ */
+
+#ifndef DSV4L2_DEVICE_INTERNAL_H
+#define DSV4L2_DEVICE_INTERNAL_H
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_policy.h"
+
+#include <linux/videodev2.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/* Ownership of a driver buffer */
+typedef enum {
+    DSV4L2_BUF_IDLE   = 0,  /* Dequeued, owned by the library */
+    DSV4L2_BUF_QUEUED = 1,  /* Queued with the driver */
+    DSV4L2_BUF_LEASED = 2,  /* Dequeued and leased to a consumer */
+    DSV4L2_BUF_PARKED = 3,  /* Out of circulation (adaptive depth shrink) */
+} dsv4l2_buffer_state_t;
+
+/* Buffer structure */
+typedef struct {
+    void    *start;          /* CPU mapping (NULL if the memory cannot be mapped) */
+    size_t   length;
+    int      state;          /* dsv4l2_buffer_state_t (atomic) */
+    uint32_t sequence;       /* Driver sequence of the current lease */
+    int      dmabuf_fd;      /* Exported or imported dmabuf fd (owned), -1 if none */
+    int      mapped;         /* 1 if start was mmap'd by the library */
+} dsv4l2_buffer_t;
+
+/*
+ * Sequence gap and dequeue latency tracking for one stream
+ *
+ * Updated only by the thread dequeuing the stream; counters are stored
+ * atomically so they can be snapshot from any thread.
+ */
+typedef struct {
+    dsv4l2_capture_stats_t stats;    /* buffer_count/active_count unused */
+    dsv4l2_histogram_t hist[DSV4L2_HIST_KINDS]; /* Latency, interval, policy */
+    uint32_t last_sequence;
+    int      have_sequence;          /* 0 until the first dequeue after STREAMON */
+    uint64_t last_ts_ns;             /* Driver timestamp of the previous buffer, 0 if none */
+} dsv4l2_seq_tracker_t;
+
+/*
+ * Precomputed capture policy decision
+ *
+ * Packed into one word that is published with a single atomic store, so
+ * capture threads never see a half-written decision. Valid while its
+ * generation matches the global policy generation and its layer matches
+ * the device's. The format bit records whether the device's format, read
+ * when the decision was made, fits g_layer_policies[layer]; set_format
+ * recomputes the decision.
+ *
+ *   bits  0-31  policy generation (0 = never computed)
+ *   bits 32-39  layer (DSV4L2_POLICY_LAYER_MAX for layers beyond it)
+ *   bits 40-41  minimum TEMPEST state for capture
+ *   bit  42     capture allowed
+ *   bit  43     format within the layer's resolution limit
+ */
+typedef uint64_t dsv4l2_policy_decision_t;
+
+#define DSV4L2_POLICY_LAYER_MAX  0xFFu
+
+#define DSV4L2_POLICY_PACK(gen, layer, min_tempest, allowed, format_ok) \
+    ((uint64_t)(uint32_t)(gen) | \
+     ((uint64_t)((layer) & DSV4L2_POLICY_LAYER_MAX) << 32) | \
+     ((uint64_t)((min_tempest) & 0x3) << 40) | \
+     ((uint64_t)((allowed) ? 1 : 0) << 42) | \
+     ((uint64_t)((format_ok) ? 1 : 0) << 43))
+#define DSV4L2_POLICY_GENERATION(d)  ((uint32_t)(d))
+#define DSV4L2_POLICY_LAYER(d)       ((uint32_t)((d) >> 32) & DSV4L2_POLICY_LAYER_MAX)
+#define DSV4L2_POLICY_MIN_TEMPEST(d) ((dsv4l2_tempest_state_t)(((d) >> 40) & 0x3))
+#define DSV4L2_POLICY_ALLOWED(d)     ((int)(((d) >> 42) & 1))
+#define DSV4L2_POLICY_FORMAT_OK(d)   ((int)(((d) >> 43) & 1))
+
+/* Internal device structure (extends public dsv4l2_device_t) */
+typedef struct dsv4l2_device_internal {
+    dsv4l2_device_t public;          /* Public device handle */
+
+    /* Internal state */
+    struct v4l2_capability cap;      /* Device capabilities */
+    dsv4l2_tempest_state_t tempest;  /* Current TEMPEST state (atomic) */
+    int tempest_ctrl_id;             /* v4l2 control ID for TEMPEST */
+    int tempest_subscribed;          /* 1 if V4L2_EVENT_CTRL keeps tempest current */
+
+    /* Profile information */
+    char *profile_path;              /* Path to loaded profile */
+    char *classification;            /* Security classification */
+
+    /* Runtime state */
+    int streaming;                   /* 1 if streaming active */
+    uint32_t dev_id;                 /* Device ID (hash) */
+
+    /* Buffer management */
+    dsv4l2_buffer_t *buffers;        /* Driver buffer table */
+    uint32_t buffer_count;
+    uint32_t memory;                 /* V4L2_MEMORY_MMAP/DMABUF/USERPTR */
+    uint32_t leased_count;           /* Buffers currently leased (atomic) */
+    int implicit_lease;              /* Buffer held by dsv4l2_capture_frame, -1 if none */
+    uint32_t implicit_sequence;      /* Driver sequence of that lease */
+    dsv4l2_seq_tracker_t seq;        /* Drop and latency counters */
+
+    /* Adaptive queue depth (all but park_pending/parked_count owned by the dequeuer) */
+    uint32_t adapt_min;              /* Depth limits, 0 = fixed depth */
+    uint32_t adapt_max;
+    uint32_t buffer_capacity;        /* Entries allocated in buffers */
+    uint32_t parked_count;           /* Buffers in the PARKED state (atomic) */
+    uint32_t park_pending;           /* Releases to park instead of requeue (atomic) */
+    uint32_t adapt_frames;           /* Dequeues in the current window */
+    uint32_t adapt_gaps;             /* Gapped dequeues in the current window */
+    uint32_t adapt_quiet;            /* Consecutive windows without gaps */
+
+    /* Policy */
+    dsv4l2_policy_decision_t policy; /* Cached capture decision (atomic) */
+
+    /* Device registry links (protected by the registry lock) */
+    struct dsv4l2_device_internal *registry_prev;
+    struct dsv4l2_device_internal *registry_next;
+} dsv4l2_device_internal_t;
+
+/* Get internal device structure from public handle */
+dsv4l2_device_internal_t *dsv4l2_get_internal(dsv4l2_device_t *dev);
+
+/*
+ * Lease bookkeeping (buffer.c)
+ *
+ * dsv4l2_buffer_lease() marks a freshly dequeued buffer as leased and fills
+ * the frame descriptor. dsv4l2_buffer_reset() returns every buffer to the
+ * IDLE state after STREAMOFF.
+ */
+void dsv4l2_buffer_lease(dsv4l2_device_internal_t *dev,
+                         const struct v4l2_buffer *buf,
+                         dsv4l2_frame_t *out);
+void dsv4l2_buffer_reset(dsv4l2_device_internal_t *dev);
+
+/*
+ * Buffers that can still be dequeued: neither leased nor parked
+ * (buffer.c)
+ */
+uint32_t dsv4l2_buffer_available(dsv4l2_device_internal_t *dev);
+
+/*
+ * Account one dequeued buffer (buffer.c)
+ *
+ * Updates the tracker's sequence and latency counters and returns the
+ * number of sequence numbers the driver skipped before buf.
+ */
+uint32_t dsv4l2_seq_track(dsv4l2_seq_tracker_t *t, const struct v4l2_buffer *buf);
+
+/*
+ * USB VID:PID ("vvvv:pppp") of a video node from sysfs (device_probe.c)
+ *
+ * Returns -ENOENT (and an empty string) for non-USB devices.
+ */
+int dsv4l2_probe_usb_id(const char *path, char *buf, size_t len);
+
+/*
+ * Copy a live histogram with relaxed loads (histogram.c)
+ */
+void dsv4l2_hist_snapshot(const dsv4l2_histogram_t *h, dsv4l2_histogram_t *out);
+
+/*
+ * TEMPEST state cache (tempest.c)
+ *
+ * dsv4l2_tempest_subscribe() subscribes to control-change events for
+ * tempest_ctrl_id and primes the cached state; if the driver does not
+ * support control events the state is read with VIDIOC_G_CTRL on every
+ * query instead. dsv4l2_tempest_dequeue_events() applies pending
+ * control-change events to the cache and returns the number applied.
+ */
+void dsv4l2_tempest_subscribe(dsv4l2_device_internal_t *dev);
+int dsv4l2_tempest_dequeue_events(dsv4l2_device_internal_t *dev);
+
+/*
+ * Device registry (device.c)
+ *
+ * Every device is registered by dsv4l2_open() and removed by
+ * dsv4l2_close(). dsv4l2_registry_acquire() takes the registry lock and
+ * returns a snapshot of the open devices (NULL if none); it fails with
+ * -ENOMEM, without holding the lock, if the snapshot cannot be
+ * allocated. The devices stay open until dsv4l2_registry_release(),
+ * because dsv4l2_close() waits for the lock.
+ */
+void dsv4l2_registry_add(dsv4l2_device_internal_t *dev);
+void dsv4l2_registry_remove(dsv4l2_device_internal_t *dev);
+int dsv4l2_registry_acquire(dsv4l2_device_internal_t ***devices, size_t *count);
+void dsv4l2_registry_release(dsv4l2_device_internal_t **devices);
+
+/* Fd a metadata stream is dequeued from (metadata.c) */
+struct dsv4l2_metadata_capture;
+int dsv4l2_metadata_fd(const struct dsv4l2_metadata_capture *meta_cap);
+
+/* Payload slot size of a metadata history ring (metadata.c) */
+struct dsv4l2_meta_history;
+size_t dsv4l2_meta_history_payload_max(const struct dsv4l2_meta_history *hist);
+
+/*
+ * Policy decision cache (policy/dsmil_bridge.c)
+ *
+ * dsv4l2_policy_decide() recomputes and publishes dev->policy at the
+ * current policy generation. dsv4l2_set_threatcon() bumps the
+ * generation, so every cached decision is recomputed on its next check.
+ *
+ * dsv4l2_policy_capture_check() is the per-frame form of
+ * dsv4l2_policy_check(): while the decision is current it costs the
+ * generation/layer compare and the allowed/LOCKDOWN test.
+ */
+dsv4l2_policy_decision_t dsv4l2_policy_decide(dsv4l2_device_internal_t *dev);
+int dsv4l2_policy_capture_check(dsv4l2_device_internal_t *dev,
+                                dsv4l2_tempest_state_t state,
+                                const char *context);
+
+#endif /* DSV4L2_DEVICE_INTERNAL_H */
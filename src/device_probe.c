@@ -0,0 +1,655 @@
+/*
+ * DSV4L2 Device Probe Cache
+ *
+ * Lightweight enumeration of /dev/video* nodes:
+ * - One VIDIOC_QUERYCAP per node on a bare fd, no dsv4l2_open()
+ * - USB VID:PID read from sysfs, matched against the loaded profiles
+ * - Nodes probed in parallel by a small pool of short-lived threads
+ * - Results cached and kept current by a kernel uevent (netlink)
+ *   monitor thread instead of rescanning /dev
+ *
+ * The cache is only trusted while the monitor runs; a uevent that cannot
+ * be applied (lost messages, node not ready yet) drops it so the next
+ * query probes again.
+ */
+
+#define _GNU_SOURCE
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_core.h"
+#include "dsv4l2_profiles.h"
+#include "device_internal.h"
+
+#include <linux/videodev2.h>
+#include <linux/netlink.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROBE_MAX_THREADS   8      /* Upper bound on probe threads */
+#define PROBE_UEVENT_SIZE   8192   /* Largest kernel uevent message */
+
+static struct {
+    pthread_mutex_t       lock;
+    dsv4l2_device_info_t *entries;     /* Sorted by node number */
+    size_t                count;
+    size_t                capacity;
+    int                   valid;       /* 1 if entries reflect the system */
+    uint64_t              generation;  /* Bumped by every applied uevent */
+
+    pthread_t             monitor;
+    int                   monitor_running;
+    int                   monitor_failed;  /* Netlink unavailable, do not retry */
+    int                   nlfd;
+    int                   wakefd;      /* eventfd for dsv4l2_probe_shutdown() */
+} probe = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .nlfd = -1,
+    .wakefd = -1,
+};
+
+/* ========================================================================
+ * Node Probe
+ * ======================================================================== */
+
+/**
+ * Read a one-line sysfs attribute
+ */
+static int read_sysfs_line(const char *path, char *buf, size_t len)
+{
+    ssize_t n;
+    int fd, rc;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    n = read(fd, buf, len - 1);
+    rc = n < 0 ? -errno : 0;
+    close(fd);
+    if (rc < 0) {
+        return rc;
+    }
+
+    while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == ' ')) {
+        n--;
+    }
+    buf[n] = '\0';
+
+    return n > 0 ? 0 : -ENOENT;
+}
+
+/**
+ * Look up the USB VID:PID of a video node in sysfs
+ *
+ * The video4linux device links to the USB interface; idVendor and
+ * idProduct live on its parent, the USB device.
+ *
+ * @param path Device node ("/dev/videoN")
+ * @param buf Output "vvvv:pppp"
+ * @param len Size of buf (at least 10)
+ * @return 0 on success, -ENOENT if the node is not a USB device
+ */
+int dsv4l2_probe_usb_id(const char *path, char *buf, size_t len)
+{
+    const char *name = strrchr(path, '/');
+    char attr[128], vid[8], pid[8];
+    const char *dir = "device";
+
+    name = name ? name + 1 : path;
+
+    snprintf(attr, sizeof(attr), "/sys/class/video4linux/%s/device/bInterfaceNumber", name);
+    if (access(attr, F_OK) == 0) {
+        dir = "device/..";
+    }
+
+    snprintf(attr, sizeof(attr), "/sys/class/video4linux/%s/%s/idVendor", name, dir);
+    if (read_sysfs_line(attr, vid, sizeof(vid)) != 0) {
+        buf[0] = '\0';
+        return -ENOENT;
+    }
+
+    snprintf(attr, sizeof(attr), "/sys/class/video4linux/%s/%s/idProduct", name, dir);
+    if (read_sysfs_line(attr, pid, sizeof(pid)) != 0) {
+        buf[0] = '\0';
+        return -ENOENT;
+    }
+
+    snprintf(buf, len, "%s:%s", vid, pid);
+    return 0;
+}
+
+/**
+ * Probe one node: QUERYCAP on a bare fd plus the sysfs USB ID
+ *
+ * Profile matching is left to the caller (the profile table is loaded
+ * lazily and not safe to initialize from several probe threads).
+ */
+static int probe_node(const char *path, dsv4l2_device_info_t *info)
+{
+    struct v4l2_capability cap;
+    int fd, rc;
+
+    fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    memset(&cap, 0, sizeof(cap));
+    rc = ioctl(fd, VIDIOC_QUERYCAP, &cap) < 0 ? -errno : 0;
+    close(fd);
+    if (rc < 0) {
+        return rc;
+    }
+
+    memset(info, 0, sizeof(*info));
+    snprintf(info->path, sizeof(info->path), "%s", path);
+    snprintf(info->driver, sizeof(info->driver), "%.*s",
+             (int)sizeof(cap.driver), (const char *)cap.driver);
+    snprintf(info->card, sizeof(info->card), "%.*s",
+             (int)sizeof(cap.card), (const char *)cap.card);
+    snprintf(info->bus_info, sizeof(info->bus_info), "%.*s",
+             (int)sizeof(cap.bus_info), (const char *)cap.bus_info);
+    info->capabilities = cap.capabilities;
+    info->device_caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ?
+                        cap.device_caps : cap.capabilities;
+
+    dsv4l2_probe_usb_id(path, info->usb_id, sizeof(info->usb_id));
+
+    return 0;
+}
+
+/**
+ * Fill role and classification from the profile matching the USB ID
+ */
+static void match_profile(dsv4l2_device_info_t *info)
+{
+    const dsv4l2_device_profile_t *profile = NULL;
+
+    if (info->usb_id[0]) {
+        profile = dsv4l2_find_profile(info->usb_id);
+    }
+
+    snprintf(info->role, sizeof(info->role), "%s", profile ? profile->role : "camera");
+    snprintf(info->classification, sizeof(info->classification), "%s",
+             profile ? profile->classification : "UNCLASSIFIED");
+}
+
+/**
+ * Node number of "/dev/videoN" (sort key)
+ */
+static unsigned long node_number(const char *path)
+{
+    const char *num = strrchr(path, 'o');
+
+    return num ? strtoul(num + 1, NULL, 10) : 0;
+}
+
+static int compare_nodes(const void *a, const void *b)
+{
+    unsigned long na = node_number(((const dsv4l2_device_info_t *)a)->path);
+    unsigned long nb = node_number(((const dsv4l2_device_info_t *)b)->path);
+
+    return na < nb ? -1 : na > nb;
+}
+
+/* ========================================================================
+ * Parallel Scan
+ * ======================================================================== */
+
+/* Work shared by the probe threads */
+typedef struct {
+    char                (*paths)[32];
+    dsv4l2_device_info_t *infos;
+    int                  *ok;
+    size_t                count;
+    size_t                next;        /* Next path to claim (atomic) */
+} probe_work_t;
+
+static void *probe_worker(void *arg)
+{
+    probe_work_t *work = arg;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) < work->count) {
+        work->ok[i] = probe_node(work->paths[i], &work->infos[i]) == 0;
+    }
+
+    return NULL;
+}
+
+/**
+ * Collect the /dev/video* character devices
+ */
+static int collect_nodes(char (**out)[32], size_t *count)
+{
+    char (*paths)[32] = NULL;
+    size_t n = 0, capacity = 0;
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir("/dev");
+    if (!dir) {
+        return -errno;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        char path[32];
+
+        if (strncmp(entry->d_name, "video", 5) != 0 ||
+            snprintf(path, sizeof(path), "/dev/%s", entry->d_name) >= (int)sizeof(path)) {
+            continue;
+        }
+        if (stat(path, &st) < 0 || !S_ISCHR(st.st_mode)) {
+            continue;
+        }
+
+        if (n == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 16;
+            char (*grown)[32] = realloc(paths, new_capacity * sizeof(*paths));
+
+            if (!grown) {
+                free(paths);
+                closedir(dir);
+                return -ENOMEM;
+            }
+            paths = grown;
+            capacity = new_capacity;
+        }
+        memcpy(paths[n++], path, sizeof(path));
+    }
+
+    closedir(dir);
+
+    *out = paths;
+    *count = n;
+    return 0;
+}
+
+/**
+ * Probe every node, in parallel when there are several
+ *
+ * @param out Output entries sorted by node number (caller frees)
+ * @param count Output entry count
+ * @return 0 on success, negative errno on error
+ */
+static int scan_nodes(dsv4l2_device_info_t **out, size_t *count)
+{
+    pthread_t tids[PROBE_MAX_THREADS];
+    probe_work_t work;
+    size_t i, n = 0, threads, started = 0;
+    int rc;
+
+    memset(&work, 0, sizeof(work));
+    rc = collect_nodes(&work.paths, &work.count);
+    if (rc < 0) {
+        return rc;
+    }
+
+    work.infos = calloc(work.count ? work.count : 1, sizeof(*work.infos));
+    work.ok = calloc(work.count ? work.count : 1, sizeof(*work.ok));
+    if (!work.infos || !work.ok) {
+        free(work.paths);
+        free(work.infos);
+        free(work.ok);
+        return -ENOMEM;
+    }
+
+    /* The calling thread always takes part; failed spawns just mean fewer helpers */
+    threads = work.count < PROBE_MAX_THREADS ? work.count : PROBE_MAX_THREADS;
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&tids[started], NULL, probe_worker, &work) != 0) {
+            break;
+        }
+        started++;
+    }
+    probe_worker(&work);
+    for (i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    /* Compact, then match profiles single-threaded */
+    for (i = 0; i < work.count; i++) {
+        if (work.ok[i]) {
+            if (n != i) {
+                work.infos[n] = work.infos[i];
+            }
+            match_profile(&work.infos[n]);
+            n++;
+        }
+    }
+    qsort(work.infos, n, sizeof(*work.infos), compare_nodes);
+
+    free(work.paths);
+    free(work.ok);
+
+    *out = work.infos;
+    *count = n;
+    return 0;
+}
+
+/* ========================================================================
+ * Hotplug Monitor
+ * ======================================================================== */
+
+/**
+ * Insert or replace a cache entry (probe.lock held)
+ */
+static int cache_put(const dsv4l2_device_info_t *info)
+{
+    size_t i;
+
+    for (i = 0; i < probe.count; i++) {
+        if (strcmp(probe.entries[i].path, info->path) == 0) {
+            probe.entries[i] = *info;
+            return 0;
+        }
+    }
+
+    if (probe.count == probe.capacity) {
+        size_t new_capacity = probe.capacity ? probe.capacity * 2 : 16;
+        dsv4l2_device_info_t *grown = realloc(probe.entries,
+                                              new_capacity * sizeof(*grown));
+
+        if (!grown) {
+            return -ENOMEM;
+        }
+        probe.entries = grown;
+        probe.capacity = new_capacity;
+    }
+
+    probe.entries[probe.count++] = *info;
+    qsort(probe.entries, probe.count, sizeof(*probe.entries), compare_nodes);
+    return 0;
+}
+
+/**
+ * Drop a cache entry (probe.lock held)
+ */
+static void cache_remove(const char *path)
+{
+    size_t i;
+
+    for (i = 0; i < probe.count; i++) {
+        if (strcmp(probe.entries[i].path, path) == 0) {
+            memmove(&probe.entries[i], &probe.entries[i + 1],
+                    (probe.count - i - 1) * sizeof(*probe.entries));
+            probe.count--;
+            return;
+        }
+    }
+}
+
+/**
+ * Apply one video4linux uevent to the cache
+ */
+static void apply_uevent(const char *action, const char *devname)
+{
+    dsv4l2_device_info_t info;
+    char path[32];
+    int rc = 0;
+
+    if (strncmp(devname, "video", 5) != 0 ||
+        snprintf(path, sizeof(path), "/dev/%s", devname) >= (int)sizeof(path)) {
+        return;
+    }
+
+    if (strcmp(action, "add") == 0) {
+        /* Probe outside the lock; a node that is not ready yet (udev still
+         * setting permissions) makes the next query rescan */
+        rc = probe_node(path, &info);
+        pthread_mutex_lock(&probe.lock);
+        if (rc == 0) {
+            match_profile(&info);
+            rc = cache_put(&info);
+        }
+        if (rc < 0) {
+            probe.valid = 0;
+        }
+    } else if (strcmp(action, "remove") == 0) {
+        pthread_mutex_lock(&probe.lock);
+        cache_remove(path);
+    } else {
+        return;
+    }
+
+    probe.generation++;
+    pthread_mutex_unlock(&probe.lock);
+}
+
+/**
+ * Parse a kernel uevent: "action@devpath\0KEY=value\0..."
+ */
+static void handle_uevent(const char *msg, size_t len)
+{
+    const char *action = NULL, *subsystem = NULL, *devname = NULL;
+    size_t off = strnlen(msg, len) + 1;
+
+    while (off < len) {
+        const char *kv = msg + off;
+
+        if (strncmp(kv, "ACTION=", 7) == 0) {
+            action = kv + 7;
+        } else if (strncmp(kv, "SUBSYSTEM=", 10) == 0) {
+            subsystem = kv + 10;
+        } else if (strncmp(kv, "DEVNAME=", 8) == 0) {
+            devname = kv + 8;
+        }
+        off += strnlen(kv, len - off) + 1;
+    }
+
+    if (action && subsystem && devname && strcmp(subsystem, "video4linux") == 0) {
+        /* DEVNAME is relative to /dev, but some kernels prefix it */
+        if (strncmp(devname, "/dev/", 5) == 0) {
+            devname += 5;
+        }
+        apply_uevent(action, devname);
+    }
+}
+
+static void *monitor_thread(void *arg)
+{
+    static char msg[PROBE_UEVENT_SIZE];
+    struct pollfd pfd[2];
+
+    (void)arg;
+
+    pfd[0].fd = probe.nlfd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = probe.wakefd;
+    pfd[1].events = POLLIN;
+
+    for (;;) {
+        struct sockaddr_nl sender;
+        struct iovec iov = { msg, sizeof(msg) - 1 };
+        struct msghdr mh;
+        ssize_t n;
+
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (pfd[1].revents) {
+            break;
+        }
+
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_name = &sender;
+        mh.msg_namelen = sizeof(sender);
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+
+        n = recvmsg(probe.nlfd, &mh, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == ENOBUFS) {
+                /* Socket overrun: events were lost */
+                pthread_mutex_lock(&probe.lock);
+                probe.valid = 0;
+                pthread_mutex_unlock(&probe.lock);
+            }
+            continue;
+        }
+
+        /* Only the kernel (port 0) may edit the cache */
+        if (mh.msg_namelen != sizeof(sender) || sender.nl_pid != 0) {
+            continue;
+        }
+
+        msg[n] = '\0';
+        handle_uevent(msg, (size_t)n);
+    }
+
+    return NULL;
+}
+
+/**
+ * Start the uevent monitor (probe.lock held)
+ */
+static int monitor_start(void)
+{
+    struct sockaddr_nl addr;
+    int rc;
+
+    probe.nlfd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (probe.nlfd < 0) {
+        return -errno;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;  /* Kernel uevents (udev's own feed is group 2) */
+    if (bind(probe.nlfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        rc = -errno;
+        goto fail;
+    }
+
+    probe.wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (probe.wakefd < 0) {
+        rc = -errno;
+        goto fail;
+    }
+
+    rc = pthread_create(&probe.monitor, NULL, monitor_thread, NULL);
+    if (rc != 0) {
+        rc = -rc;
+        goto fail;
+    }
+
+    probe.monitor_running = 1;
+    return 0;
+
+fail:
+    close(probe.nlfd);
+    probe.nlfd = -1;
+    if (probe.wakefd >= 0) {
+        close(probe.wakefd);
+        probe.wakefd = -1;
+    }
+    return rc;
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+int dsv4l2_probe_devices(dsv4l2_device_info_t **out, size_t *count)
+{
+    dsv4l2_device_info_t *entries = NULL, *copy;
+    size_t n = 0;
+    uint64_t generation;
+    int rc;
+
+    if (!out || !count) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&probe.lock);
+
+    /* Monitor first, so uevents racing with the scan are not missed */
+    if (!probe.monitor_running && !probe.monitor_failed) {
+        probe.monitor_failed = monitor_start() != 0;
+    }
+
+    if (!probe.valid) {
+        generation = probe.generation;
+        pthread_mutex_unlock(&probe.lock);
+
+        rc = scan_nodes(&entries, &n);
+        if (rc < 0) {
+            return rc;
+        }
+
+        pthread_mutex_lock(&probe.lock);
+        free(probe.entries);
+        probe.entries = entries;
+        probe.count = n;
+        probe.capacity = n;
+        /* A uevent applied mid-scan may have been overwritten: rescan next time */
+        probe.valid = probe.monitor_running && probe.generation == generation;
+    }
+
+    copy = malloc((probe.count ? probe.count : 1) * sizeof(*copy));
+    if (!copy) {
+        pthread_mutex_unlock(&probe.lock);
+        return -ENOMEM;
+    }
+    memcpy(copy, probe.entries, probe.count * sizeof(*copy));
+    *count = probe.count;
+
+    pthread_mutex_unlock(&probe.lock);
+
+    *out = copy;
+    return 0;
+}
+
+void dsv4l2_probe_invalidate(void)
+{
+    pthread_mutex_lock(&probe.lock);
+    probe.valid = 0;
+    pthread_mutex_unlock(&probe.lock);
+}
+
+void dsv4l2_probe_shutdown(void)
+{
+    uint64_t one = 1;
+    int running;
+
+    pthread_mutex_lock(&probe.lock);
+    running = probe.monitor_running;
+    probe.monitor_running = 0;
+    pthread_mutex_unlock(&probe.lock);
+
+    if (running) {
+        if (write(probe.wakefd, &one, sizeof(one)) < 0) {
+            /* Counter saturated: a wakeup is already pending */
+        }
+        pthread_join(probe.monitor, NULL);
+        close(probe.nlfd);
+        close(probe.wakefd);
+        probe.nlfd = -1;
+        probe.wakefd = -1;
+    }
+
+    pthread_mutex_lock(&probe.lock);
+    free(probe.entries);
+    probe.entries = NULL;
+    probe.count = 0;
+    probe.capacity = 0;
+    probe.valid = 0;
+    probe.monitor_failed = 0;
+    pthread_mutex_unlock(&probe.lock);
+}
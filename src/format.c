@@ -6,35 +6,32 @@
  * - Resolution configuration
  * - Frame rate control
  * - Telemetry for format changes
+ * - Pixel format conversion (SIMD kernels picked at runtime, row-parallel)
  */
 
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
 #include "dsv4l2rt.h"
+#include "dsv4l2_core.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
+#include <linux/dma-buf.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 
-/* Forward declarations */
-typedef struct dsv4l2_device_internal dsv4l2_device_internal_t;
-extern dsv4l2_device_internal_t *dsv4l2_get_internal(dsv4l2_device_t *dev);
-
-/* Internal device structure (partial) */
-struct dsv4l2_device_internal {
-    dsv4l2_device_t public;
-    struct v4l2_capability cap;
-    dsv4l2_tempest_state_t tempest;
-    int tempest_ctrl_id;
-    char *profile_path;
-    char *classification;
-    int streaming;
-    uint32_t dev_id;
-    void *buffers;
-    uint32_t buffer_count;
-};
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CVT_HAVE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define CVT_HAVE_NEON 1
+#endif
 
 /**
  * Enumerate supported pixel formats
@@ -137,6 +134,9 @@ int dsv4l2_set_format(dsv4l2_device_t *dev, struct v4l2_format *fmt)
         return -errno;
     }
 
+    /* The decision holds the format's fit against the layer limit */
+    dsv4l2_policy_decide(internal);
+
     /* Emit format change event if pixel format changed */
     if (old_fmt.fmt.pix.pixelformat != fmt->fmt.pix.pixelformat) {
         dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FORMAT_CHANGE,
@@ -299,3 +299,733 @@ void dsv4l2_fourcc_to_string(uint32_t fourcc, char *str)
     str[3] = (fourcc >> 24) & 0xFF;
     str[4] = '\0';
 }
+
+/* ========================================================================
+ * Pixel Format Conversion
+ * ======================================================================== */
+
+/*
+ * Colour math: BT.601 limited range in 6-bit fixed point, with 16-bit
+ * saturating intermediates so every kernel produces identical output:
+ *
+ *   yy = 75 * (Y - 16) + 32
+ *   R  = (yy + 102 * (V - 128)) >> 6
+ *   G  = (yy - 25 * (U - 128) - 52 * (V - 128)) >> 6
+ *   B  = (yy + 129 * (U - 128)) >> 6
+ *
+ * NV12 chroma is the rounded average of each pair of source rows.
+ */
+
+/* Upper bound on conversion threads */
+#define CVT_MAX_THREADS  8
+
+/* Byte positions inside a 4:2:2 macropixel (second luma sample is y + 2) */
+typedef struct {
+    uint8_t y;
+    uint8_t u;
+    uint8_t v;
+    uint8_t bgr;        /* Store B,G,R instead of R,G,B */
+} cvt_layout_t;
+
+/* Row kernels; width is even */
+typedef struct {
+    const char *name;
+    void (*rgb)(const uint8_t *src, uint8_t *dst, uint32_t width,
+                const cvt_layout_t *lay);
+    void (*grey)(const uint8_t *src, uint8_t *dst, uint32_t width,
+                 const cvt_layout_t *lay);
+    void (*uv)(const uint8_t *a, const uint8_t *b, uint8_t *dst, uint32_t width,
+               const cvt_layout_t *lay);
+} cvt_kernels_t;
+
+static inline int cvt_sat16(int x)
+{
+    return x < -32768 ? -32768 : (x > 32767 ? 32767 : x);
+}
+
+static inline uint8_t cvt_clamp8(int x)
+{
+    if (x < 0) {
+        return 0;
+    }
+    x >>= 6;
+    return x > 255 ? 255 : (uint8_t)x;
+}
+
+static inline void cvt_pixel(int y, int du, int dv, uint8_t *out, int bgr)
+{
+    int yy = (y - 16) * 75 + 32;
+    uint8_t r = cvt_clamp8(cvt_sat16(yy + 102 * dv));
+    uint8_t g = cvt_clamp8(cvt_sat16(yy - (25 * du + 52 * dv)));
+    uint8_t b = cvt_clamp8(cvt_sat16(yy + 129 * du));
+
+    out[0] = bgr ? b : r;
+    out[1] = g;
+    out[2] = bgr ? r : b;
+}
+
+static void cvt_rgb_generic(const uint8_t *src, uint8_t *dst, uint32_t width,
+                            const cvt_layout_t *lay)
+{
+    uint32_t x;
+
+    for (x = 0; x + 1 < width; x += 2) {
+        const uint8_t *m = src + 2 * x;
+        int du = m[lay->u] - 128;
+        int dv = m[lay->v] - 128;
+
+        cvt_pixel(m[lay->y], du, dv, dst + 3 * x, lay->bgr);
+        cvt_pixel(m[lay->y + 2], du, dv, dst + 3 * x + 3, lay->bgr);
+    }
+}
+
+static void cvt_grey_generic(const uint8_t *src, uint8_t *dst, uint32_t width,
+                             const cvt_layout_t *lay)
+{
+    uint32_t x;
+
+    for (x = 0; x < width; x++) {
+        dst[x] = src[2 * x + lay->y];
+    }
+}
+
+static void cvt_uv_generic(const uint8_t *a, const uint8_t *b, uint8_t *dst,
+                           uint32_t width, const cvt_layout_t *lay)
+{
+    uint32_t k;
+
+    /* CbCr byte k comes from macropixel k / 2 */
+    for (k = 0; k < width; k++) {
+        size_t idx = 4 * (size_t)(k / 2) + ((k & 1) ? lay->v : lay->u);
+
+        dst[k] = (uint8_t)((a[idx] + b[idx] + 1) >> 1);
+    }
+}
+
+static const cvt_kernels_t cvt_generic = {
+    "generic", cvt_rgb_generic, cvt_grey_generic, cvt_uv_generic
+};
+
+#ifdef CVT_HAVE_X86
+/**
+ * YUV 4:2:2 to RGB24/BGR24, 16 pixels per step with AVX2
+ */
+__attribute__((target("avx2")))
+static void cvt_rgb_avx2(const uint8_t *src, uint8_t *dst, uint32_t width,
+                         const cvt_layout_t *lay)
+{
+    /* 8 + 8 channel bytes -> 16 + 8 interleaved bytes */
+    const __m128i m_rg0 = _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5);
+    const __m128i m_b0  = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i m_rg1 = _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m_b1  = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i c16 = _mm256_set1_epi16(16);
+    const __m256i c32 = _mm256_set1_epi16(32);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    const __m256i c75 = _mm256_set1_epi16(75);
+    const __m256i c102 = _mm256_set1_epi16(102);
+    const __m256i c25 = _mm256_set1_epi16(25);
+    const __m256i c52 = _mm256_set1_epi16(52);
+    const __m256i c129 = _mm256_set1_epi16(129);
+    uint8_t sy[32], su[32], sv[32];
+    __m256i my, mu, mv;
+    uint32_t x = 0;
+    int j;
+
+    /* Per 128-bit lane: macropixel bytes -> 8 x u16 (Y, U, V per pixel) */
+    for (j = 0; j < 32; j++) {
+        int p = (j & 15) / 2;
+        int hi = j & 1;
+
+        sy[j] = hi ? 0x80 : (uint8_t)(2 * p + lay->y);
+        su[j] = hi ? 0x80 : (uint8_t)(4 * (p / 2) + lay->u);
+        sv[j] = hi ? 0x80 : (uint8_t)(4 * (p / 2) + lay->v);
+    }
+    my = _mm256_loadu_si256((const __m256i *)sy);
+    mu = _mm256_loadu_si256((const __m256i *)su);
+    mv = _mm256_loadu_si256((const __m256i *)sv);
+
+    for (; x + 16 <= width; x += 16) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i yy = _mm256_add_epi16(_mm256_mullo_epi16(
+                         _mm256_sub_epi16(_mm256_shuffle_epi8(s, my), c16), c75), c32);
+        __m256i du = _mm256_sub_epi16(_mm256_shuffle_epi8(s, mu), c128);
+        __m256i dv = _mm256_sub_epi16(_mm256_shuffle_epi8(s, mv), c128);
+        __m256i r = _mm256_srai_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(dv, c102)), 6);
+        __m256i g = _mm256_srai_epi16(_mm256_subs_epi16(yy, _mm256_add_epi16(
+                        _mm256_mullo_epi16(du, c25), _mm256_mullo_epi16(dv, c52))), 6);
+        __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(du, c129)), 6);
+        __m256i fg, th;
+        int lane;
+
+        if (lay->bgr) {
+            __m256i t = r;
+            r = b;
+            b = t;
+        }
+
+        /* Per lane: [first channel x8 | G x8] and [third channel x8] */
+        fg = _mm256_packus_epi16(r, g);
+        th = _mm256_packus_epi16(b, b);
+
+        for (lane = 0; lane < 2; lane++) {
+            __m128i rg = lane ? _mm256_extracti128_si256(fg, 1) : _mm256_castsi256_si128(fg);
+            __m128i bb = lane ? _mm256_extracti128_si256(th, 1) : _mm256_castsi256_si128(th);
+            uint8_t *o = dst + 3 * x + 24 * lane;
+
+            _mm_storeu_si128((__m128i *)o,
+                             _mm_or_si128(_mm_shuffle_epi8(rg, m_rg0), _mm_shuffle_epi8(bb, m_b0)));
+            _mm_storel_epi64((__m128i *)(o + 16),
+                             _mm_or_si128(_mm_shuffle_epi8(rg, m_rg1), _mm_shuffle_epi8(bb, m_b1)));
+        }
+    }
+
+    cvt_rgb_generic(src + 2 * x, dst + 3 * x, width - x, lay);
+}
+
+/**
+ * Take every other byte of 64 source bytes (starting at byte odd) with AVX2
+ */
+__attribute__((target("avx2")))
+static inline __m256i cvt_pick_avx2(__m256i a, __m256i b, int odd)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00FF);
+
+    if (odd) {
+        a = _mm256_srli_epi16(a, 8);
+        b = _mm256_srli_epi16(b, 8);
+    } else {
+        a = _mm256_and_si256(a, lo);
+        b = _mm256_and_si256(b, lo);
+    }
+
+    /* packus works per 128-bit lane; restore byte order */
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+}
+
+/**
+ * Luma plane, 32 pixels per step with AVX2
+ */
+__attribute__((target("avx2")))
+static void cvt_grey_avx2(const uint8_t *src, uint8_t *dst, uint32_t width,
+                          const cvt_layout_t *lay)
+{
+    uint32_t x = 0;
+
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * x));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * x + 32));
+
+        _mm256_storeu_si256((__m256i *)(dst + x), cvt_pick_avx2(a, b, lay->y));
+    }
+
+    cvt_grey_generic(src + 2 * x, dst + x, width - x, lay);
+}
+
+/**
+ * NV12 chroma row from two source rows, 32 bytes per step with AVX2
+ */
+__attribute__((target("avx2")))
+static void cvt_uv_avx2(const uint8_t *a, const uint8_t *b, uint8_t *dst,
+                        uint32_t width, const cvt_layout_t *lay)
+{
+    uint32_t k = 0;
+
+    for (; k + 32 <= width; k += 32) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(a + 2 * k));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(a + 2 * k + 32));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(b + 2 * k));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(b + 2 * k + 32));
+
+        /* Chroma bytes are the ones that are not luma */
+        _mm256_storeu_si256((__m256i *)(dst + k),
+                            cvt_pick_avx2(_mm256_avg_epu8(a0, b0), _mm256_avg_epu8(a1, b1),
+                                          !lay->y));
+    }
+
+    cvt_uv_generic(a + 2 * k, b + 2 * k, dst + k, width - k, lay);
+}
+
+static const cvt_kernels_t cvt_avx2 = {
+    "avx2", cvt_rgb_avx2, cvt_grey_avx2, cvt_uv_avx2
+};
+#endif /* CVT_HAVE_X86 */
+
+#ifdef CVT_HAVE_NEON
+/**
+ * One channel for 8 pixels: ((yy + c) >> 6) saturated to u8
+ */
+static inline uint8x8_t cvt_chan_neon(int16x8_t yy, int16x8_t c, int sub)
+{
+    int16x8_t v = sub ? vqsubq_s16(yy, c) : vqaddq_s16(yy, c);
+
+    return vqmovun_s16(vshrq_n_s16(v, 6));
+}
+
+/**
+ * YUV 4:2:2 to RGB24/BGR24, 16 pixels per step with NEON
+ */
+static void cvt_rgb_neon(const uint8_t *src, uint8_t *dst, uint32_t width,
+                         const cvt_layout_t *lay)
+{
+    uint32_t x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x8x4_t m = vld4_u8(src + 2 * x);
+        int16x8_t du = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(m.val[lay->u])), vdupq_n_s16(128));
+        int16x8_t dv = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(m.val[lay->v])), vdupq_n_s16(128));
+        int16x8_t rc = vmulq_n_s16(dv, 102);
+        int16x8_t gc = vaddq_s16(vmulq_n_s16(du, 25), vmulq_n_s16(dv, 52));
+        int16x8_t bc = vmulq_n_s16(du, 129);
+        uint8x8_t r[2], g[2], b[2];
+        uint8x8x2_t rz, gz, bz;
+        uint8x8x3_t o;
+        int k;
+
+        /* Even and odd luma samples share the macropixel's chroma */
+        for (k = 0; k < 2; k++) {
+            int16x8_t y = vreinterpretq_s16_u16(vmovl_u8(m.val[lay->y + 2 * k]));
+            int16x8_t yy = vaddq_s16(vmulq_n_s16(vsubq_s16(y, vdupq_n_s16(16)), 75),
+                                     vdupq_n_s16(32));
+
+            r[k] = cvt_chan_neon(yy, rc, 0);
+            g[k] = cvt_chan_neon(yy, gc, 1);
+            b[k] = cvt_chan_neon(yy, bc, 0);
+        }
+
+        rz = vzip_u8(r[0], r[1]);
+        gz = vzip_u8(g[0], g[1]);
+        bz = vzip_u8(b[0], b[1]);
+
+        for (k = 0; k < 2; k++) {
+            o.val[0] = lay->bgr ? bz.val[k] : rz.val[k];
+            o.val[1] = gz.val[k];
+            o.val[2] = lay->bgr ? rz.val[k] : bz.val[k];
+            vst3_u8(dst + 3 * x + 24 * k, o);
+        }
+    }
+
+    cvt_rgb_generic(src + 2 * x, dst + 3 * x, width - x, lay);
+}
+
+/**
+ * Luma plane, 16 pixels per step with NEON
+ */
+static void cvt_grey_neon(const uint8_t *src, uint8_t *dst, uint32_t width,
+                          const cvt_layout_t *lay)
+{
+    uint32_t x = 0;
+
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t m = vld2q_u8(src + 2 * x);
+
+        vst1q_u8(dst + x, m.val[lay->y]);
+    }
+
+    cvt_grey_generic(src + 2 * x, dst + x, width - x, lay);
+}
+
+/**
+ * NV12 chroma row from two source rows, 16 bytes per step with NEON
+ */
+static void cvt_uv_neon(const uint8_t *a, const uint8_t *b, uint8_t *dst,
+                        uint32_t width, const cvt_layout_t *lay)
+{
+    uint32_t k = 0;
+
+    for (; k + 16 <= width; k += 16) {
+        uint8x16x2_t ma = vld2q_u8(a + 2 * k);
+        uint8x16x2_t mb = vld2q_u8(b + 2 * k);
+
+        vst1q_u8(dst + k, vrhaddq_u8(ma.val[!lay->y], mb.val[!lay->y]));
+    }
+
+    cvt_uv_generic(a + 2 * k, b + 2 * k, dst + k, width - k, lay);
+}
+
+static const cvt_kernels_t cvt_neon = {
+    "neon", cvt_rgb_neon, cvt_grey_neon, cvt_uv_neon
+};
+#endif /* CVT_HAVE_NEON */
+
+/**
+ * Selected kernel set (resolved once)
+ */
+static const cvt_kernels_t *cvt_kernels(void)
+{
+    static const cvt_kernels_t *impl;
+    const cvt_kernels_t *k = __atomic_load_n(&impl, __ATOMIC_RELAXED);
+
+    if (!k) {
+        k = &cvt_generic;
+#ifdef CVT_HAVE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            k = &cvt_avx2;
+        }
+#endif
+#ifdef CVT_HAVE_NEON
+        k = &cvt_neon;
+#endif
+        __atomic_store_n(&impl, k, __ATOMIC_RELAXED);
+    }
+
+    return k;
+}
+
+const char *dsv4l2_convert_impl(void)
+{
+    return cvt_kernels()->name;
+}
+
+/* Conversion kinds */
+enum {
+    CVT_OP_COPY = 0,
+    CVT_OP_RGB,
+    CVT_OP_GREY,
+    CVT_OP_NV12,
+};
+
+/**
+ * Bytes per pixel of plane 0 (0 if unknown)
+ */
+static uint32_t cvt_bpp(uint32_t fourcc)
+{
+    switch (fourcc) {
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+        return 2;
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_BGR24:
+        return 3;
+    case V4L2_PIX_FMT_GREY:
+    case V4L2_PIX_FMT_NV12:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Fill an image descriptor for memory with the given plane-0 stride
+ */
+static int image_layout(dsv4l2_image_t *img, uint32_t fourcc, uint32_t width,
+                        uint32_t height, void *data, size_t len, uint32_t stride)
+{
+    uint32_t bpp = cvt_bpp(fourcc);
+    size_t need;
+
+    if (!img || !data) {
+        return -EINVAL;
+    }
+    if (bpp == 0) {
+        return -ENOTSUP;
+    }
+    if (stride == 0) {
+        stride = width * bpp;
+    }
+    if (stride < width * bpp) {
+        return -EINVAL;
+    }
+
+    memset(img, 0, sizeof(*img));
+    img->fourcc = fourcc;
+    img->width = width;
+    img->height = height;
+    img->plane[0] = data;
+    img->stride[0] = stride;
+
+    need = (size_t)stride * height;
+    if (fourcc == V4L2_PIX_FMT_NV12) {
+        img->plane[1] = img->plane[0] + need;
+        img->stride[1] = stride;
+        need += (size_t)stride * ((height + 1) / 2);
+    }
+
+    return len < need ? -ENOBUFS : 0;
+}
+
+size_t dsv4l2_image_size(uint32_t fourcc, uint32_t width, uint32_t height)
+{
+    uint32_t bpp = cvt_bpp(fourcc);
+    size_t size = (size_t)width * bpp * height;
+
+    if (fourcc == V4L2_PIX_FMT_NV12) {
+        size += (size_t)((width + 1) & ~1u) * ((height + 1) / 2);
+    }
+
+    return size;
+}
+
+int dsv4l2_image_init(dsv4l2_image_t *img, uint32_t fourcc,
+                      uint32_t width, uint32_t height, void *data, size_t len)
+{
+    return image_layout(img, fourcc, width, height, data, len, 0);
+}
+
+int dsv4l2_image_from_frame(dsv4l2_image_t *img, const struct v4l2_format *fmt,
+                            const dsv4l2_frame_t *frame)
+{
+    if (!fmt || !frame) {
+        return -EINVAL;
+    }
+
+    return image_layout(img, fmt->fmt.pix.pixelformat, fmt->fmt.pix.width,
+                        fmt->fmt.pix.height, frame->data, frame->len,
+                        fmt->fmt.pix.bytesperline);
+}
+
+/**
+ * Map a format pair to a conversion kind (-1 if unsupported)
+ */
+static int cvt_op(uint32_t src, uint32_t dst)
+{
+    if (src != V4L2_PIX_FMT_YUYV && src != V4L2_PIX_FMT_UYVY) {
+        return -1;
+    }
+
+    switch (dst) {
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_BGR24:
+        return CVT_OP_RGB;
+    case V4L2_PIX_FMT_GREY:
+        return CVT_OP_GREY;
+    case V4L2_PIX_FMT_NV12:
+        return CVT_OP_NV12;
+    default:
+        return dst == src ? CVT_OP_COPY : -1;
+    }
+}
+
+int dsv4l2_convert_supported(uint32_t src_fourcc, uint32_t dst_fourcc)
+{
+    return cvt_op(src_fourcc, dst_fourcc) >= 0;
+}
+
+/* A conversion and one row range of it */
+typedef struct {
+    const cvt_kernels_t *k;
+    cvt_layout_t lay;
+    int op;
+    dsv4l2_image_t src;     /* Strides resolved */
+    dsv4l2_image_t dst;
+} cvt_job_t;
+
+typedef struct {
+    const cvt_job_t *job;
+    uint32_t y0;
+    uint32_t y1;
+} cvt_slice_t;
+
+static void *cvt_slice_run(void *arg)
+{
+    cvt_slice_t *s = arg;
+    const cvt_job_t *j = s->job;
+    uint32_t w = j->src.width, y;
+
+    for (y = s->y0; y < s->y1; y++) {
+        const uint8_t *in = j->src.plane[0] + (size_t)y * j->src.stride[0];
+        uint8_t *out = j->dst.plane[0] + (size_t)y * j->dst.stride[0];
+
+        switch (j->op) {
+        case CVT_OP_COPY:
+            memcpy(out, in, (size_t)w * 2);
+            break;
+        case CVT_OP_RGB:
+            j->k->rgb(in, out, w, &j->lay);
+            break;
+        case CVT_OP_GREY:
+            j->k->grey(in, out, w, &j->lay);
+            break;
+        case CVT_OP_NV12:
+            j->k->grey(in, out, w, &j->lay);
+            if ((y & 1) == 0) {
+                /* An odd last row pairs with itself */
+                const uint8_t *next = (y + 1 < j->src.height) ? in + j->src.stride[0] : in;
+
+                j->k->uv(in, next, j->dst.plane[1] + (size_t)(y / 2) * j->dst.stride[1],
+                         w, &j->lay);
+            }
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Check an image descriptor and resolve zero strides
+ */
+static int cvt_resolve(const dsv4l2_image_t *in, dsv4l2_image_t *out)
+{
+    uint32_t bpp = cvt_bpp(in->fourcc);
+
+    *out = *in;
+    if (!out->plane[0]) {
+        return -EINVAL;
+    }
+    if (out->stride[0] == 0) {
+        out->stride[0] = out->width * bpp;
+    }
+    if (out->fourcc == V4L2_PIX_FMT_NV12) {
+        if (!out->plane[1]) {
+            return -EINVAL;
+        }
+        if (out->stride[1] == 0) {
+            out->stride[1] = out->width;
+        }
+    }
+
+    return 0;
+}
+
+DSV4L2_SENSOR("video_convert", "L3", "CONFIDENTIAL")
+int dsv4l2_convert_image(const dsv4l2_image_t *src, dsv4l2_image_t *dst,
+                         unsigned threads)
+{
+    cvt_slice_t slices[CVT_MAX_THREADS];
+    pthread_t tids[CVT_MAX_THREADS];
+    cvt_job_t job;
+    uint32_t units, per, unit = 0, rows_per_unit;
+    unsigned i, started = 0;
+    int op, rc;
+
+    if (!src || !dst) {
+        return -EINVAL;
+    }
+
+    op = cvt_op(src->fourcc, dst->fourcc);
+    if (op < 0) {
+        return -ENOTSUP;
+    }
+    if (src->width != dst->width || src->height != dst->height || (src->width & 1)) {
+        return -EINVAL;
+    }
+
+    rc = cvt_resolve(src, &job.src);
+    if (rc == 0) {
+        rc = cvt_resolve(dst, &job.dst);
+    }
+    if (rc < 0) {
+        return rc;
+    }
+
+    job.k = cvt_kernels();
+    job.op = op;
+    job.lay.y = (src->fourcc == V4L2_PIX_FMT_YUYV) ? 0 : 1;
+    job.lay.u = (src->fourcc == V4L2_PIX_FMT_YUYV) ? 1 : 0;
+    job.lay.v = job.lay.u + 2;
+    job.lay.bgr = (dst->fourcc == V4L2_PIX_FMT_BGR24);
+
+    /* Automatic: threads only pay off on large frames */
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = 1;
+        if ((size_t)src->width * src->height >= DSV4L2_CONVERT_MT_MIN_PIXELS && cpus > 1) {
+            threads = cpus < 4 ? (unsigned)cpus : 4;
+        }
+    }
+    if (threads > CVT_MAX_THREADS) {
+        threads = CVT_MAX_THREADS;
+    }
+
+    /* NV12 slices start on even rows so each owns whole chroma rows */
+    rows_per_unit = (op == CVT_OP_NV12) ? 2 : 1;
+    units = (src->height + rows_per_unit - 1) / rows_per_unit;
+    if (threads > units) {
+        threads = units ? units : 1;
+    }
+    per = units / threads;
+
+    for (i = 0; i < threads; i++) {
+        uint32_t n = (i == threads - 1) ? units - unit : per;
+        uint32_t y1 = (unit + n) * rows_per_unit;
+
+        slices[i].job = &job;
+        slices[i].y0 = unit * rows_per_unit;
+        slices[i].y1 = y1 < src->height ? y1 : src->height;
+        unit += n;
+    }
+
+    /* Slice 0 runs here; the rest on helper threads (inline if spawning fails) */
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, cvt_slice_run, &slices[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+
+    cvt_slice_run(&slices[0]);
+
+    for (i = started + 1; i < threads; i++) {
+        cvt_slice_run(&slices[i]);
+    }
+
+    for (i = 1; i <= started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    return 0;
+}
+
+/**
+ * Bracket CPU access to a dmabuf (fds without sync support, e.g. memfd, pass)
+ */
+static int dmabuf_sync(int fd, uint64_t flags)
+{
+    struct dma_buf_sync sync = { .flags = flags | DMA_BUF_SYNC_WRITE };
+
+    if (ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) < 0 && errno != ENOTTY) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+DSV4L2_SENSOR("video_convert", "L3", "CONFIDENTIAL")
+int dsv4l2_convert_to_dmabuf(const dsv4l2_image_t *src, int dmabuf_fd,
+                             uint32_t dst_fourcc, unsigned threads)
+{
+    dsv4l2_image_t dst;
+    size_t size;
+    off_t len;
+    void *map;
+    int rc;
+
+    if (!src || dmabuf_fd < 0) {
+        return -EINVAL;
+    }
+    if (!dsv4l2_convert_supported(src->fourcc, dst_fourcc)) {
+        return -ENOTSUP;
+    }
+
+    size = dsv4l2_image_size(dst_fourcc, src->width, src->height);
+
+    /* dmabufs report their size through lseek */
+    len = lseek(dmabuf_fd, 0, SEEK_END);
+    if (len < 0) {
+        return -errno;
+    }
+    lseek(dmabuf_fd, 0, SEEK_SET);
+    if ((size_t)len < size) {
+        return -ENOBUFS;
+    }
+
+    map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, dmabuf_fd, 0);
+    if (map == MAP_FAILED) {
+        return -errno;
+    }
+
+    rc = dmabuf_sync(dmabuf_fd, DMA_BUF_SYNC_START);
+    if (rc == 0) {
+        rc = dsv4l2_image_init(&dst, dst_fourcc, src->width, src->height, map, size);
+        if (rc == 0) {
+            rc = dsv4l2_convert_image(src, &dst, threads);
+        }
+        dmabuf_sync(dmabuf_fd, DMA_BUF_SYNC_END);
+    }
+
+    munmap(map, size);
+    return rc;
+}
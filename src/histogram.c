@@ -0,0 +1,149 @@
+/*
+ * DSV4L2 Latency Histograms
+ *
+ * Fixed-bucket log-linear histograms for the per-stream latency, frame
+ * interval and policy check timings. Recording is a handful of relaxed
+ * atomic adds, so it is safe from the capture hot path and from several
+ * threads at once; readers snapshot the buckets without locking.
+ */
+
+#include "dsv4l2_core.h"
+#include "device_internal.h"
+
+#include <string.h>
+
+/* Sub-buckets per power of two */
+#define HIST_SUB_COUNT  (1u << DSV4L2_HIST_SUB_BITS)
+
+/**
+ * Bucket index of a value
+ */
+static uint32_t hist_index(uint64_t v)
+{
+    uint32_t msb, group;
+
+    if (v < HIST_SUB_COUNT) {
+        return (uint32_t)v;
+    }
+
+    msb = 63 - (uint32_t)__builtin_clzll(v);
+    if (msb > DSV4L2_HIST_MAX_MSB) {
+        return DSV4L2_HIST_BUCKETS - 1;
+    }
+
+    group = msb - DSV4L2_HIST_SUB_BITS + 1;
+    return (group << DSV4L2_HIST_SUB_BITS) |
+           (uint32_t)((v >> (msb - DSV4L2_HIST_SUB_BITS)) & (HIST_SUB_COUNT - 1));
+}
+
+/**
+ * Smallest value that lands in a bucket
+ */
+static uint64_t hist_lower_bound(uint32_t idx)
+{
+    uint32_t group = idx >> DSV4L2_HIST_SUB_BITS;
+    uint64_t sub = idx & (HIST_SUB_COUNT - 1);
+
+    if (group == 0) {
+        return sub;
+    }
+
+    return (HIST_SUB_COUNT + sub) << (group - 1);
+}
+
+void dsv4l2_histogram_record(dsv4l2_histogram_t *h, uint64_t value_ns)
+{
+    uint64_t max;
+
+    if (!h) {
+        return;
+    }
+
+    __atomic_add_fetch(&h->buckets[hist_index(value_ns)], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->sum_ns, value_ns, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->count, 1, __ATOMIC_RELAXED);
+
+    max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (value_ns > max &&
+           !__atomic_compare_exchange_n(&h->max_ns, &max, value_ns, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Copy a live histogram
+ *
+ * count is rebuilt from the buckets so percentiles of the snapshot are
+ * self-consistent even while samples are being recorded.
+ */
+void dsv4l2_hist_snapshot(const dsv4l2_histogram_t *h, dsv4l2_histogram_t *out)
+{
+    uint64_t count = 0;
+    uint32_t i;
+
+    for (i = 0; i < DSV4L2_HIST_BUCKETS; i++) {
+        out->buckets[i] = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+        count += out->buckets[i];
+    }
+
+    out->count = count;
+    out->sum_ns = __atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED);
+    out->max_ns = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+}
+
+uint64_t dsv4l2_histogram_percentile(const dsv4l2_histogram_t *h, double pct)
+{
+    uint64_t rank, seen = 0, upper;
+    uint32_t i;
+
+    if (!h || h->count == 0) {
+        return 0;
+    }
+
+    if (pct <= 0.0) {
+        rank = 1;
+    } else if (pct >= 100.0) {
+        rank = h->count;
+    } else {
+        /* Nearest rank: smallest sample with at least pct% at or below it */
+        double r = h->count * (pct / 100.0);
+
+        rank = (uint64_t)r;
+        if ((double)rank < r || rank == 0) {
+            rank++;
+        }
+    }
+
+    for (i = 0; i < DSV4L2_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+
+    if (i >= DSV4L2_HIST_BUCKETS - 1) {
+        return h->max_ns;
+    }
+
+    upper = hist_lower_bound(i + 1) - 1;
+    return upper < h->max_ns ? upper : h->max_ns;
+}
+
+void dsv4l2_histogram_merge(dsv4l2_histogram_t *dst, const dsv4l2_histogram_t *src)
+{
+    uint32_t i;
+
+    if (!dst || !src) {
+        return;
+    }
+
+    for (i = 0; i < DSV4L2_HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+
+    dst->count += src->count;
+    dst->sum_ns += src->sum_ns;
+    if (src->max_ns > dst->max_ns) {
+        dst->max_ns = src->max_ns;
+    }
+}
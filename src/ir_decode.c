@@ -0,0 +1,412 @@
+/*
+ * DSV4L2 IR Radiometric Decode
+ *
+ * Converts raw radiometric counts to a temperature map (Kelvin * 100)
+ * with the linear calibration T = c1 * raw + c2, clamped to 0-500 K.
+ *
+ * The kernel is picked once at first use: AVX-512 or AVX2 on x86-64,
+ * NEON on AArch64, portable C otherwise. Every kernel collects min, max
+ * and sum in the same pass so callers never rescan the map. Large maps
+ * are split by rows across short-lived threads.
+ */
+
+#include "dsv4l2_metadata.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define IR_HAVE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define IR_HAVE_NEON 1
+#endif
+
+/* Upper bound on decode threads */
+#define IR_MAX_THREADS  8
+
+/* Running statistics of one slice */
+typedef struct {
+    uint64_t sum;
+    uint16_t min;
+    uint16_t max;
+} ir_acc_t;
+
+typedef void (*ir_kernel_fn)(const uint16_t *raw, uint16_t *out, size_t n,
+                             float c1, float c2, ir_acc_t *acc);
+
+/**
+ * Convert one pixel
+ */
+static inline uint16_t ir_pixel(uint16_t raw, float c1, float c2)
+{
+    float t = c1 * (float)raw + c2;
+
+    if (t < 0.0f) t = 0.0f;
+    if (t > 500.0f) t = 500.0f;
+
+    return (uint16_t)(t * 100.0f);
+}
+
+/**
+ * Convert pixels one at a time (portable, and the SIMD tails)
+ */
+static void ir_kernel_generic(const uint16_t *raw, uint16_t *out, size_t n,
+                              float c1, float c2, ir_acc_t *acc)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        uint16_t v = ir_pixel(raw[i], c1, c2);
+
+        out[i] = v;
+        acc->sum += v;
+        if (v < acc->min) acc->min = v;
+        if (v > acc->max) acc->max = v;
+    }
+}
+
+#ifdef IR_HAVE_X86
+/*
+ * Steps between flushes of the 32-bit sum lanes: a lane gains at most
+ * 50000 per pixel it sums (two per AVX2 step, one per AVX-512 step), so
+ * 16384 pixels per lane stay below 2^31.
+ */
+#define IR_FLUSH_VECTORS  16384
+
+/**
+ * Convert 16 pixels per step with AVX2
+ */
+__attribute__((target("avx2")))
+static void ir_kernel_avx2(const uint16_t *raw, uint16_t *out, size_t n,
+                           float c1, float c2, ir_acc_t *acc)
+{
+    const __m256 vc1 = _mm256_set1_ps(c1);
+    const __m256 vc2 = _mm256_set1_ps(c2);
+    const __m256 lo = _mm256_setzero_ps();
+    const __m256 hi = _mm256_set1_ps(500.0f);
+    const __m256 scale = _mm256_set1_ps(100.0f);
+    __m256i vmin = _mm256_set1_epi16((short)0xFFFF);
+    __m256i vmax = _mm256_setzero_si256();
+    __m256i vsum = _mm256_setzero_si256();
+    uint32_t lanes[8];
+    uint16_t mm[16];
+    size_t i = 0, pending = 0;
+    int k;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i r = _mm256_loadu_si256((const __m256i *)(raw + i));
+        __m256i r0 = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(r));
+        __m256i r1 = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(r, 1));
+        __m256 t0 = _mm256_add_ps(_mm256_mul_ps(vc1, _mm256_cvtepi32_ps(r0)), vc2);
+        __m256 t1 = _mm256_add_ps(_mm256_mul_ps(vc1, _mm256_cvtepi32_ps(r1)), vc2);
+        __m256i v0, v1, v;
+
+        t0 = _mm256_min_ps(_mm256_max_ps(t0, lo), hi);
+        t1 = _mm256_min_ps(_mm256_max_ps(t1, lo), hi);
+        v0 = _mm256_cvttps_epi32(_mm256_mul_ps(t0, scale));
+        v1 = _mm256_cvttps_epi32(_mm256_mul_ps(t1, scale));
+
+        /* packus works per 128-bit lane; restore pixel order */
+        v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v0, v1), 0xD8);
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+
+        vmin = _mm256_min_epu16(vmin, v);
+        vmax = _mm256_max_epu16(vmax, v);
+        vsum = _mm256_add_epi32(vsum, _mm256_add_epi32(v0, v1));
+
+        if (++pending == IR_FLUSH_VECTORS / 2) {
+            _mm256_storeu_si256((__m256i *)lanes, vsum);
+            for (k = 0; k < 8; k++) acc->sum += lanes[k];
+            vsum = _mm256_setzero_si256();
+            pending = 0;
+        }
+    }
+
+    _mm256_storeu_si256((__m256i *)lanes, vsum);
+    for (k = 0; k < 8; k++) acc->sum += lanes[k];
+
+    _mm256_storeu_si256((__m256i *)mm, vmin);
+    for (k = 0; k < 16; k++) if (mm[k] < acc->min) acc->min = mm[k];
+    _mm256_storeu_si256((__m256i *)mm, vmax);
+    for (k = 0; k < 16; k++) if (mm[k] > acc->max) acc->max = mm[k];
+
+    ir_kernel_generic(raw + i, out + i, n - i, c1, c2, acc);
+}
+
+/**
+ * Sum the 16 32-bit lanes of an AVX-512 accumulator in 64 bits
+ *
+ * Each lane stays below 2^31 between flushes, but their total does not.
+ */
+__attribute__((target("avx512f")))
+static inline uint64_t ir_reduce_sum_avx512(__m512i v)
+{
+    __m512i lo = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(v));
+    __m512i hi = _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(v, 1));
+
+    return (uint64_t)_mm512_reduce_add_epi64(_mm512_add_epi64(lo, hi));
+}
+
+/**
+ * Convert 16 pixels per step with AVX-512
+ */
+__attribute__((target("avx512f,avx2")))
+static void ir_kernel_avx512(const uint16_t *raw, uint16_t *out, size_t n,
+                             float c1, float c2, ir_acc_t *acc)
+{
+    const __m512 vc1 = _mm512_set1_ps(c1);
+    const __m512 vc2 = _mm512_set1_ps(c2);
+    const __m512 lo = _mm512_setzero_ps();
+    const __m512 hi = _mm512_set1_ps(500.0f);
+    const __m512 scale = _mm512_set1_ps(100.0f);
+    __m512i vmin = _mm512_set1_epi32(0xFFFF);
+    __m512i vmax = _mm512_setzero_si512();
+    __m512i vsum = _mm512_setzero_si512();
+    size_t i = 0, pending = 0;
+    uint32_t m;
+
+    for (; i + 16 <= n; i += 16) {
+        __m256i r = _mm256_loadu_si256((const __m256i *)(raw + i));
+        __m512 t = _mm512_add_ps(_mm512_mul_ps(vc1,
+                       _mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(r))), vc2);
+        __m512i v;
+
+        t = _mm512_min_ps(_mm512_max_ps(t, lo), hi);
+        v = _mm512_cvttps_epi32(_mm512_mul_ps(t, scale));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm512_cvtusepi32_epi16(v));
+
+        vmin = _mm512_min_epu32(vmin, v);
+        vmax = _mm512_max_epu32(vmax, v);
+        vsum = _mm512_add_epi32(vsum, v);
+
+        if (++pending == IR_FLUSH_VECTORS) {
+            acc->sum += ir_reduce_sum_avx512(vsum);
+            vsum = _mm512_setzero_si512();
+            pending = 0;
+        }
+    }
+
+    acc->sum += ir_reduce_sum_avx512(vsum);
+    m = (uint32_t)_mm512_reduce_min_epu32(vmin);
+    if (m < acc->min) acc->min = (uint16_t)m;
+    m = (uint32_t)_mm512_reduce_max_epu32(vmax);
+    if (m > acc->max) acc->max = (uint16_t)m;
+
+    ir_kernel_generic(raw + i, out + i, n - i, c1, c2, acc);
+}
+#endif /* IR_HAVE_X86 */
+
+#ifdef IR_HAVE_NEON
+/**
+ * Convert 8 pixels per step with NEON
+ */
+static void ir_kernel_neon(const uint16_t *raw, uint16_t *out, size_t n,
+                           float c1, float c2, ir_acc_t *acc)
+{
+    const float32x4_t vc1 = vdupq_n_f32(c1);
+    const float32x4_t vc2 = vdupq_n_f32(c2);
+    const float32x4_t lo = vdupq_n_f32(0.0f);
+    const float32x4_t hi = vdupq_n_f32(500.0f);
+    const float32x4_t scale = vdupq_n_f32(100.0f);
+    uint16x8_t vmin = vdupq_n_u16(0xFFFF);
+    uint16x8_t vmax = vdupq_n_u16(0);
+    uint64x2_t vsum = vdupq_n_u64(0);
+    size_t i = 0;
+    uint16_t m;
+
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t r = vld1q_u16(raw + i);
+        float32x4_t t0 = vaddq_f32(vmulq_f32(vc1, vcvtq_f32_u32(vmovl_u16(vget_low_u16(r)))), vc2);
+        float32x4_t t1 = vaddq_f32(vmulq_f32(vc1, vcvtq_f32_u32(vmovl_u16(vget_high_u16(r)))), vc2);
+        uint16x8_t v;
+
+        t0 = vminq_f32(vmaxq_f32(t0, lo), hi);
+        t1 = vminq_f32(vmaxq_f32(t1, lo), hi);
+        v = vcombine_u16(vmovn_u32(vcvtq_u32_f32(vmulq_f32(t0, scale))),
+                         vmovn_u32(vcvtq_u32_f32(vmulq_f32(t1, scale))));
+        vst1q_u16(out + i, v);
+
+        vmin = vminq_u16(vmin, v);
+        vmax = vmaxq_u16(vmax, v);
+        vsum = vpadalq_u32(vsum, vpaddlq_u16(v));
+    }
+
+    acc->sum += vgetq_lane_u64(vsum, 0) + vgetq_lane_u64(vsum, 1);
+    m = vminvq_u16(vmin);
+    if (m < acc->min) acc->min = m;
+    m = vmaxvq_u16(vmax);
+    if (m > acc->max) acc->max = m;
+
+    ir_kernel_generic(raw + i, out + i, n - i, c1, c2, acc);
+}
+#endif /* IR_HAVE_NEON */
+
+/**
+ * Pick the widest kernel this CPU supports
+ */
+static ir_kernel_fn ir_select(void)
+{
+#ifdef IR_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return ir_kernel_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return ir_kernel_avx2;
+    }
+#endif
+#ifdef IR_HAVE_NEON
+    return ir_kernel_neon;
+#endif
+    return ir_kernel_generic;
+}
+
+/**
+ * Selected kernel (resolved once)
+ */
+static ir_kernel_fn ir_kernel(void)
+{
+    static ir_kernel_fn impl;
+    ir_kernel_fn fn = __atomic_load_n(&impl, __ATOMIC_RELAXED);
+
+    if (!fn) {
+        fn = ir_select();
+        __atomic_store_n(&impl, fn, __ATOMIC_RELAXED);
+    }
+
+    return fn;
+}
+
+const char *dsv4l2_ir_decode_impl(void)
+{
+    ir_kernel_fn fn = ir_kernel();
+
+#ifdef IR_HAVE_X86
+    if (fn == ir_kernel_avx512) {
+        return "avx512";
+    }
+    if (fn == ir_kernel_avx2) {
+        return "avx2";
+    }
+#endif
+#ifdef IR_HAVE_NEON
+    if (fn == ir_kernel_neon) {
+        return "neon";
+    }
+#endif
+    (void)fn;
+    return "generic";
+}
+
+/* One row slice for a decode thread */
+typedef struct {
+    ir_kernel_fn    fn;
+    const uint16_t *raw;
+    uint16_t       *out;
+    size_t          n;
+    float           c1;
+    float           c2;
+    ir_acc_t        acc;
+} ir_slice_t;
+
+static void *ir_slice_run(void *arg)
+{
+    ir_slice_t *s = arg;
+
+    s->fn(s->raw, s->out, s->n, s->c1, s->c2, &s->acc);
+    return NULL;
+}
+
+/**
+ * Decode IR radiometric data into a caller-provided map
+ */
+DSV4L2_SENSOR("ir_sensor", "L3", "CONFIDENTIAL")
+int dsv4l2_decode_ir_into(const uint16_t *raw_data,
+                          uint32_t width,
+                          uint32_t height,
+                          const float *calibration,
+                          uint16_t *temp_map,
+                          unsigned threads,
+                          dsv4l2_ir_stats_t *stats)
+{
+    ir_slice_t slices[IR_MAX_THREADS];
+    pthread_t tids[IR_MAX_THREADS];
+    size_t pixels = (size_t)width * height;
+    ir_kernel_fn fn = ir_kernel();
+    ir_acc_t total = { 0, 0xFFFF, 0 };
+    uint32_t row = 0, rows_per;
+    unsigned i, started = 0;
+
+    if (!raw_data || !calibration || !temp_map) {
+        return -EINVAL;
+    }
+
+    /* Automatic: threads only pay off on large maps */
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        threads = 1;
+        if (pixels >= DSV4L2_IR_MT_MIN_PIXELS && cpus > 1) {
+            threads = cpus < 4 ? (unsigned)cpus : 4;
+        }
+    }
+    if (threads > IR_MAX_THREADS) {
+        threads = IR_MAX_THREADS;
+    }
+    if (threads > height) {
+        threads = height ? height : 1;
+    }
+
+    rows_per = height / threads;
+
+    for (i = 0; i < threads; i++) {
+        uint32_t rows = (i == threads - 1) ? height - row : rows_per;
+
+        slices[i].fn = fn;
+        slices[i].raw = raw_data + (size_t)row * width;
+        slices[i].out = temp_map + (size_t)row * width;
+        slices[i].n = (size_t)rows * width;
+        slices[i].c1 = calibration[0];
+        slices[i].c2 = calibration[1];
+        slices[i].acc.sum = 0;
+        slices[i].acc.min = 0xFFFF;
+        slices[i].acc.max = 0;
+        row += rows;
+    }
+
+    /* Slice 0 runs here; the rest on helper threads (inline if spawning fails) */
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(&tids[i], NULL, ir_slice_run, &slices[i]) != 0) {
+            break;
+        }
+        started = i;
+    }
+
+    ir_slice_run(&slices[0]);
+
+    for (i = started + 1; i < threads; i++) {
+        ir_slice_run(&slices[i]);
+    }
+
+    for (i = 1; i <= started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+
+    if (stats) {
+        for (i = 0; i < threads; i++) {
+            total.sum += slices[i].acc.sum;
+            if (slices[i].acc.min < total.min) total.min = slices[i].acc.min;
+            if (slices[i].acc.max > total.max) total.max = slices[i].acc.max;
+        }
+
+        stats->min = pixels ? total.min : 0;
+        stats->max = total.max;
+        stats->mean = pixels ? (float)((double)total.sum / (double)pixels) : 0.0f;
+    }
+
+    return 0;
+}
@@ -8,14 +8,25 @@
 #include "dsv4l2_metadata.h"
 #include "dsv4l2_policy.h"
 #include "dsv4l2rt.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <math.h>
+#include <stddef.h>
+
+/* Metadata driver buffer */
+typedef struct {
+    void    *start;            /* mmap'd data */
+    size_t   length;
+    int      leased;           /* 1 while held by dsv4l2_metadata_acquire() (atomic) */
+    uint32_t sequence;         /* Driver sequence of the current lease */
+} meta_buffer_t;
 
 /* Metadata capture internal structure */
 struct dsv4l2_metadata_capture {
@@ -24,10 +35,29 @@ struct dsv4l2_metadata_capture {
     dsv4l2_meta_format_t     format;       /* Expected format */
 
     /* Buffer management */
-    void                    *buffers[4];   /* mmap'd metadata buffers */
-    size_t                   buffer_sizes[4];
-    uint32_t                 buffer_count;
+    meta_buffer_t           *buffers;      /* Driver buffer table */
+    uint32_t                 buffer_count; /* Buffers granted by the driver */
     uint32_t                 sequence;     /* Frame sequence */
+    dsv4l2_seq_tracker_t     seq;          /* Drop and latency counters */
+    dsv4l2_meta_history_t   *history;      /* Recent metadata, NULL if disabled */
+};
+
+/* One history entry; payload is a fixed slot of payload_max bytes */
+typedef struct {
+    dsv4l2_metadata_t meta;         /* Pointers rebased into payload */
+    uint8_t          *payload;
+    size_t            payload_len;
+} hist_entry_t;
+
+/* Timestamp-sorted metadata ring */
+struct dsv4l2_meta_history {
+    pthread_mutex_t  lock;
+    hist_entry_t    *entries;
+    uint8_t         *payloads;      /* depth slots of payload_max bytes */
+    size_t           payload_max;
+    uint32_t         depth;
+    uint32_t         head;          /* Oldest entry */
+    uint32_t         count;
 };
 
 /* MISB STD 0601 UAS Datalink Local Set (16-byte Universal Label) */
@@ -52,6 +82,93 @@ const dsv4l2_klv_key_t DSV4L2_KLV_SENSOR_ALTITUDE = {
               0x07, 0x01, 0x02, 0x01, 0x02, 0x06, 0x02, 0x00}
 };
 
+/* Known keys by dsv4l2_klv_key_id_t */
+static const dsv4l2_klv_key_t *const klv_known_keys[DSV4L2_KLV_KEY_COUNT] = {
+    [DSV4L2_KLV_KEY_UAS_DATALINK_LS]  = &DSV4L2_KLV_UAS_DATALINK_LS,
+    [DSV4L2_KLV_KEY_SENSOR_LATITUDE]  = &DSV4L2_KLV_SENSOR_LATITUDE,
+    [DSV4L2_KLV_KEY_SENSOR_LONGITUDE] = &DSV4L2_KLV_SENSOR_LONGITUDE,
+    [DSV4L2_KLV_KEY_SENSOR_ALTITUDE]  = &DSV4L2_KLV_SENSOR_ALTITUDE,
+};
+
+/*
+ * Perfect hash over the known keys: bytes 4, 13 and 14 are the only ones
+ * that differ, and their XOR is distinct for each. Extend the slot table
+ * (and check for collisions) when adding a key.
+ */
+#define KLV_KEY_HASH(b)  (((b)[4] ^ (b)[13] ^ (b)[14]) & 7)
+
+static const int8_t klv_key_slots[8] = {
+    -1,
+    DSV4L2_KLV_KEY_SENSOR_LONGITUDE,   /* 0x01 ^ 0x04 ^ 0x04 */
+    DSV4L2_KLV_KEY_UAS_DATALINK_LS,    /* 0x02 ^ 0x00 ^ 0x00 */
+    -1,
+    -1,
+    DSV4L2_KLV_KEY_SENSOR_ALTITUDE,    /* 0x01 ^ 0x06 ^ 0x02 */
+    -1,
+    DSV4L2_KLV_KEY_SENSOR_LATITUDE,    /* 0x01 ^ 0x04 ^ 0x02 */
+};
+
+/* MISB ST 0601 raw encodings */
+enum {
+    MISB_NONE = 0,
+    MISB_U16,
+    MISB_I16,
+    MISB_I32,
+    MISB_U64,
+};
+
+/* Telemetry field types */
+enum {
+    FIELD_F64 = 0,
+    FIELD_F32,
+    FIELD_U64,
+};
+
+/* One local-set tag: engineering value = raw * scale + offset */
+typedef struct {
+    uint8_t  kind;     /* MISB_* (MISB_NONE = not decoded) */
+    uint8_t  type;     /* FIELD_* */
+    uint16_t field;    /* offsetof(dsv4l2_telemetry_t, ...) */
+    double   scale;
+    double   offset;
+} misb_tag_t;
+
+/* MISB ST 0601 tags that map onto dsv4l2_telemetry_t, indexed by tag */
+static const misb_tag_t misb0601_tags[16] = {
+    [2]  = { MISB_U64, FIELD_U64, offsetof(dsv4l2_telemetry_t, timestamp_ns),
+             1000.0, 0.0 },                                  /* Precision Time Stamp (us) */
+    [5]  = { MISB_U16, FIELD_F32, offsetof(dsv4l2_telemetry_t, heading),
+             360.0 / 65535.0, 0.0 },                         /* Platform Heading Angle */
+    [6]  = { MISB_I16, FIELD_F32, offsetof(dsv4l2_telemetry_t, pitch),
+             40.0 / 65534.0, 0.0 },                          /* Platform Pitch Angle */
+    [7]  = { MISB_I16, FIELD_F32, offsetof(dsv4l2_telemetry_t, roll),
+             100.0 / 65534.0, 0.0 },                         /* Platform Roll Angle */
+    [13] = { MISB_I32, FIELD_F64, offsetof(dsv4l2_telemetry_t, latitude),
+             180.0 / 4294967294.0, 0.0 },                    /* Sensor Latitude */
+    [14] = { MISB_I32, FIELD_F64, offsetof(dsv4l2_telemetry_t, longitude),
+             360.0 / 4294967294.0, 0.0 },                    /* Sensor Longitude */
+    [15] = { MISB_U16, FIELD_F32, offsetof(dsv4l2_telemetry_t, altitude),
+             19900.0 / 65535.0, -900.0 },                    /* Sensor True Altitude */
+};
+
+/**
+ * Unmap and free the metadata buffer table
+ */
+static void free_buffers(dsv4l2_metadata_capture_t *meta_cap)
+{
+    uint32_t i;
+
+    for (i = 0; i < meta_cap->buffer_count; i++) {
+        if (meta_cap->buffers[i].start) {
+            munmap(meta_cap->buffers[i].start, meta_cap->buffers[i].length);
+        }
+    }
+
+    free(meta_cap->buffers);
+    meta_cap->buffers = NULL;
+    meta_cap->buffer_count = 0;
+}
+
 /**
  * Open metadata capture stream
  */
@@ -59,6 +176,18 @@ DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
 int dsv4l2_open_metadata(dsv4l2_device_t *dev,
                          dsv4l2_meta_format_t format,
                          dsv4l2_metadata_capture_t **out)
+{
+    return dsv4l2_open_metadata_depth(dev, format, DSV4L2_META_DEFAULT_BUFFERS, out);
+}
+
+/**
+ * Open metadata capture stream with a chosen queue depth
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_open_metadata_depth(dsv4l2_device_t *dev,
+                               dsv4l2_meta_format_t format,
+                               uint32_t buffer_count,
+                               dsv4l2_metadata_capture_t **out)
 {
     dsv4l2_metadata_capture_t *meta_cap;
     struct v4l2_format fmt;
@@ -66,7 +195,7 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
     uint32_t i;
     int rc;
 
-    if (!dev || !out) {
+    if (!dev || !out || buffer_count == 0) {
         return -EINVAL;
     }
 
@@ -77,9 +206,8 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
     }
 
     meta_cap->fd = dev->fd;
-    meta_cap->dev_id = 0;  /* TODO: Get from device */
+    meta_cap->dev_id = dsv4l2_get_internal(dev)->dev_id;
     meta_cap->format = format;
-    meta_cap->buffer_count = 4;
     meta_cap->sequence = 0;
 
     /* Set metadata format */
@@ -96,7 +224,7 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
 
     /* Request metadata buffers */
     memset(&req, 0, sizeof(req));
-    req.count = meta_cap->buffer_count;
+    req.count = buffer_count;
     req.type = V4L2_BUF_TYPE_META_CAPTURE;
     req.memory = V4L2_MEMORY_MMAP;
 
@@ -106,9 +234,23 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
         return rc;
     }
 
-    /* Memory map metadata buffers */
+    if (req.count == 0) {
+        free(meta_cap);
+        return -ENOBUFS;
+    }
+
+    /* Track as many buffers as the driver granted */
+    meta_cap->buffers = calloc(req.count, sizeof(*meta_cap->buffers));
+    if (!meta_cap->buffers) {
+        rc = -ENOMEM;
+        goto fail;
+    }
+    meta_cap->buffer_count = req.count;
+
+    /* Memory map and queue metadata buffers */
     for (i = 0; i < meta_cap->buffer_count; i++) {
         struct v4l2_buffer buf;
+        void *p;
 
         memset(&buf, 0, sizeof(buf));
         buf.type = V4L2_BUF_TYPE_META_CAPTURE;
@@ -117,41 +259,22 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
 
         if (ioctl(meta_cap->fd, VIDIOC_QUERYBUF, &buf) < 0) {
             rc = -errno;
-            /* Cleanup mapped buffers */
-            while (i > 0) {
-                i--;
-                munmap(meta_cap->buffers[i], meta_cap->buffer_sizes[i]);
-            }
-            free(meta_cap);
-            return rc;
+            goto fail;
         }
 
-        meta_cap->buffer_sizes[i] = buf.length;
-        meta_cap->buffers[i] = mmap(NULL, buf.length,
-                                     PROT_READ | PROT_WRITE,
-                                     MAP_SHARED,
-                                     meta_cap->fd, buf.m.offset);
-
-        if (meta_cap->buffers[i] == MAP_FAILED) {
+        p = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                 meta_cap->fd, buf.m.offset);
+        if (p == MAP_FAILED) {
             rc = -errno;
-            /* Cleanup mapped buffers */
-            while (i > 0) {
-                i--;
-                munmap(meta_cap->buffers[i], meta_cap->buffer_sizes[i]);
-            }
-            free(meta_cap);
-            return rc;
+            goto fail;
         }
+        meta_cap->buffers[i].start = p;
+        meta_cap->buffers[i].length = buf.length;
 
         /* Queue buffer */
         if (ioctl(meta_cap->fd, VIDIOC_QBUF, &buf) < 0) {
             rc = -errno;
-            /* Cleanup all buffers */
-            for (i = 0; i <= buf.index; i++) {
-                munmap(meta_cap->buffers[i], meta_cap->buffer_sizes[i]);
-            }
-            free(meta_cap);
-            return rc;
+            goto fail;
         }
     }
 
@@ -159,11 +282,7 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
     i = V4L2_BUF_TYPE_META_CAPTURE;
     if (ioctl(meta_cap->fd, VIDIOC_STREAMON, &i) < 0) {
         rc = -errno;
-        for (i = 0; i < meta_cap->buffer_count; i++) {
-            munmap(meta_cap->buffers[i], meta_cap->buffer_sizes[i]);
-        }
-        free(meta_cap);
-        return rc;
+        goto fail;
     }
 
     /* Emit metadata stream open event */
@@ -172,6 +291,11 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
 
     *out = meta_cap;
     return 0;
+
+fail:
+    free_buffers(meta_cap);
+    free(meta_cap);
+    return rc;
 }
 
 /**
@@ -179,7 +303,6 @@ int dsv4l2_open_metadata(dsv4l2_device_t *dev,
  */
 void dsv4l2_close_metadata(dsv4l2_metadata_capture_t *meta_cap)
 {
-    uint32_t i;
     int type;
 
     if (!meta_cap) {
@@ -191,11 +314,8 @@ void dsv4l2_close_metadata(dsv4l2_metadata_capture_t *meta_cap)
     ioctl(meta_cap->fd, VIDIOC_STREAMOFF, &type);
 
     /* Unmap buffers */
-    for (i = 0; i < meta_cap->buffer_count; i++) {
-        if (meta_cap->buffers[i]) {
-            munmap(meta_cap->buffers[i], meta_cap->buffer_sizes[i]);
-        }
-    }
+    free_buffers(meta_cap);
+    dsv4l2_meta_history_destroy(meta_cap->history);
 
     /* Emit metadata stream close event */
     dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_DEVICE_CLOSE,
@@ -205,239 +325,1391 @@ void dsv4l2_close_metadata(dsv4l2_metadata_capture_t *meta_cap)
 }
 
 /**
- * Capture metadata buffer
+ * Get the fd a metadata stream is dequeued from
  */
-DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
-int dsv4l2_capture_metadata(dsv4l2_metadata_capture_t *meta_cap,
-                             dsv4l2_metadata_t *out)
+int dsv4l2_metadata_fd(const dsv4l2_metadata_capture_t *meta_cap)
 {
-    struct v4l2_buffer buf;
-    int rc = 0;
+    return meta_cap->fd;
+}
 
-    if (!meta_cap || !out) {
-        return -EINVAL;
-    }
+/* ========================================================================
+ * Dequeue and Decode
+ * ======================================================================== */
 
-    /* Dequeue metadata buffer */
-    memset(&buf, 0, sizeof(buf));
-    buf.type = V4L2_BUF_TYPE_META_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
+static int decode_meta(dsv4l2_meta_format_t format, const struct v4l2_buffer *buf,
+                       const uint8_t *data, dsv4l2_metadata_t *out);
+
+/**
+ * Dequeue one metadata buffer and account for driver-side drops
+ *
+ * With a history ring enabled, the buffer is also decoded into the ring.
+ */
+static int dequeue_meta(dsv4l2_metadata_capture_t *meta_cap, struct v4l2_buffer *buf)
+{
+    dsv4l2_metadata_t hist_meta;
+    uint32_t gap;
+
+    memset(buf, 0, sizeof(*buf));
+    buf->type = V4L2_BUF_TYPE_META_CAPTURE;
+    buf->memory = V4L2_MEMORY_MMAP;
 
-    if (ioctl(meta_cap->fd, VIDIOC_DQBUF, &buf) < 0) {
+    if (ioctl(meta_cap->fd, VIDIOC_DQBUF, buf) < 0) {
         return -errno;
     }
 
-    /* Fill output metadata */
-    memset(out, 0, sizeof(*out));
-    out->format = meta_cap->format;
-    out->timestamp_ns = buf.timestamp.tv_sec * 1000000000ULL +
-                        buf.timestamp.tv_usec * 1000ULL;
-    out->sequence = buf.sequence;
+    if (buf->index >= meta_cap->buffer_count) {
+        return -EIO;
+    }
 
-    /* Copy metadata based on format */
-    switch (meta_cap->format) {
-    case DSV4L2_META_FORMAT_KLV:
-        /* Copy KLV data */
-        out->data.klv.length = buf.bytesused;
-        out->data.klv.data = malloc(buf.bytesused);
-        if (!out->data.klv.data) {
-            rc = -ENOMEM;
-            goto requeue;
-        }
-        memcpy(out->data.klv.data, meta_cap->buffers[buf.index], buf.bytesused);
-        out->data.klv.timestamp_ns = out->timestamp_ns;
-        out->data.klv.sequence = buf.sequence;
-        break;
+    /* Driver-side drops show up as skipped sequence numbers */
+    gap = dsv4l2_seq_track(&meta_cap->seq, buf);
+    if (gap > 0) {
+        dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_FRAME_DROPPED,
+                             DSV4L2_SEV_MEDIUM, gap);
+    }
 
-    case DSV4L2_META_FORMAT_IR_TEMP:
-    case DSV4L2_META_FORMAT_TELEMETRY:
-    case DSV4L2_META_FORMAT_TIMING:
-        /* TODO: Format-specific parsing */
-        break;
+    if (meta_cap->history) {
+        const uint8_t *data = meta_cap->buffers[buf->index].start;
 
-    default:
-        rc = -ENOTSUP;
-        goto requeue;
+        if (decode_meta(meta_cap->format, buf, data, &hist_meta) == 0) {
+            dsv4l2_meta_history_push(meta_cap->history, &hist_meta, data, buf->bytesused);
+        }
     }
 
-    /* Emit metadata capture event */
-    dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
-                         DSV4L2_SEV_DEBUG, buf.sequence);
+    return 0;
+}
+
+/**
+ * Hand a metadata buffer back to the driver
+ */
+static void requeue_meta(dsv4l2_metadata_capture_t *meta_cap, uint32_t index)
+{
+    struct v4l2_buffer buf;
+
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_META_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
 
-requeue:
-    /* Re-queue buffer */
     if (ioctl(meta_cap->fd, VIDIOC_QBUF, &buf) < 0) {
         /* Re-queue failed - problematic but continue */
     }
+}
 
-    return rc;
+/* Little-endian field readers (wire layouts are unaligned) */
+static uint16_t rd_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t rd_le64(const uint8_t *p)
+{
+    return (uint64_t)rd_le32(p) | ((uint64_t)rd_le32(p + 4) << 32);
+}
+
+static float rd_f32(const uint8_t *p)
+{
+    uint32_t v = rd_le32(p);
+    float f;
+
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static double rd_f64(const uint8_t *p)
+{
+    uint64_t v = rd_le64(p);
+    double d;
+
+    memcpy(&d, &v, sizeof(d));
+    return d;
 }
 
 /**
- * Parse KLV metadata
- *
- * Implements basic BER (Basic Encoding Rules) length parsing
+ * Decode an IR_TEMP buffer in place
  */
-int dsv4l2_parse_klv(const dsv4l2_klv_buffer_t *buffer,
-                     dsv4l2_klv_item_t **items,
-                     size_t *count)
+int dsv4l2_decode_ir_temp(const uint8_t *data, size_t length,
+                          dsv4l2_ir_radiometric_t *out)
 {
-    dsv4l2_klv_item_t *item_array = NULL;
-    size_t item_count = 0;
-    size_t item_capacity = 16;
-    size_t pos = 0;
+    uint64_t map_bytes;
 
-    if (!buffer || !items || !count) {
+    if (!data || !out || length < DSV4L2_META_IR_HEADER_SIZE) {
         return -EINVAL;
     }
 
-    /* Allocate initial item array */
-    item_array = malloc(item_capacity * sizeof(dsv4l2_klv_item_t));
-    if (!item_array) {
-        return -ENOMEM;
-    }
+    out->width = rd_le16(data);
+    out->height = rd_le16(data + 2);
+    out->emissivity = rd_f32(data + 4);
+    out->ambient_temp = rd_f32(data + 8);
+    out->calibration_c1 = rd_f32(data + 12);
+    out->calibration_c2 = rd_f32(data + 16);
 
-    /* Parse KLV triplets */
-    while (pos + 16 + 1 < buffer->length) {  /* Key (16) + Length (1+) */
-        dsv4l2_klv_item_t *item;
-        uint32_t length;
-        uint8_t length_byte;
-
-        /* Expand array if needed */
-        if (item_count >= item_capacity) {
-            size_t new_capacity = item_capacity * 2;
-            dsv4l2_klv_item_t *new_array = realloc(item_array,
-                                                     new_capacity * sizeof(dsv4l2_klv_item_t));
-            if (!new_array) {
-                free(item_array);
-                return -ENOMEM;
-            }
-            item_array = new_array;
-            item_capacity = new_capacity;
-        }
+    map_bytes = (uint64_t)out->width * out->height * sizeof(uint16_t);
+    if (map_bytes > length - DSV4L2_META_IR_HEADER_SIZE) {
+        return -EINVAL;
+    }
 
-        item = &item_array[item_count];
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    /* The map is used as-is, which needs a little-endian host */
+    return -ENOTSUP;
+#endif
 
-        /* Parse key (16 bytes) */
-        memcpy(item->key.bytes, &buffer->data[pos], 16);
-        pos += 16;
+    if (((uintptr_t)(data + DSV4L2_META_IR_HEADER_SIZE)) & 1) {
+        return -EINVAL;
+    }
 
-        /* Parse length (BER encoding) */
-        length_byte = buffer->data[pos++];
-        if (length_byte & 0x80) {
-            /* Long form length */
-            uint32_t num_bytes = length_byte & 0x7F;
-            if (num_bytes > 4 || pos + num_bytes > buffer->length) {
-                free(item_array);
-                return -EINVAL;
-            }
+    out->temp_map = (uint16_t *)(uintptr_t)(data + DSV4L2_META_IR_HEADER_SIZE);
+    return 0;
+}
 
-            length = 0;
-            for (uint32_t i = 0; i < num_bytes; i++) {
-                length = (length << 8) | buffer->data[pos++];
-            }
-        } else {
-            /* Short form length */
-            length = length_byte;
-        }
+/**
+ * Decode a TELEMETRY buffer
+ */
+int dsv4l2_decode_telemetry(const uint8_t *data, size_t length,
+                            dsv4l2_telemetry_t *out)
+{
+    if (!data || !out || length < DSV4L2_META_TELEMETRY_SIZE) {
+        return -EINVAL;
+    }
 
-        /* Validate length */
-        if (pos + length > buffer->length) {
-            free(item_array);
-            return -EINVAL;
-        }
+    out->latitude = rd_f64(data);
+    out->longitude = rd_f64(data + 8);
+    out->altitude = rd_f32(data + 16);
+    out->heading = rd_f32(data + 20);
+    out->pitch = rd_f32(data + 24);
+    out->roll = rd_f32(data + 28);
+    out->velocity[0] = rd_f32(data + 32);
+    out->velocity[1] = rd_f32(data + 36);
+    out->velocity[2] = rd_f32(data + 40);
 
-        /* Store value pointer */
-        item->length = length;
-        item->value = &buffer->data[pos];
-        pos += length;
+    return 0;
+}
 
-        item_count++;
+/**
+ * Decode a TIMING buffer
+ */
+int dsv4l2_decode_timing(const uint8_t *data, size_t length,
+                         dsv4l2_timing_t *out)
+{
+    if (!data || !out || length < DSV4L2_META_TIMING_SIZE) {
+        return -EINVAL;
     }
 
-    *items = item_array;
-    *count = item_count;
+    out->sensor_ts_ns = rd_le64(data);
+    out->sync_token = rd_le64(data + 8);
+    out->frame_sequence = rd_le32(data + 16);
+    out->flags = rd_le32(data + 20);
+
     return 0;
 }
 
 /**
- * Find KLV item by key
+ * Fill a metadata descriptor from buffer contents, without copying
+ *
+ * Pointers in out (KLV data, IR temperature map) refer to data.
  */
-const dsv4l2_klv_item_t *dsv4l2_find_klv_item(const dsv4l2_klv_item_t *items,
-                                               size_t count,
-                                               const dsv4l2_klv_key_t *key)
+static int decode_meta(dsv4l2_meta_format_t format, const struct v4l2_buffer *buf,
+                       const uint8_t *data, dsv4l2_metadata_t *out)
 {
-    size_t i;
+    uint64_t ts = buf->timestamp.tv_sec * 1000000000ULL +
+                  buf->timestamp.tv_usec * 1000ULL;
+    int rc = 0;
 
-    if (!items || !key) {
-        return NULL;
-    }
+    memset(out, 0, sizeof(*out));
+    out->format = format;
+    out->timestamp_ns = ts;
+    out->sequence = buf->sequence;
+    out->index = buf->index;
 
-    for (i = 0; i < count; i++) {
-        if (memcmp(items[i].key.bytes, key->bytes, 16) == 0) {
-            return &items[i];
-        }
+    switch (format) {
+    case DSV4L2_META_FORMAT_KLV:
+        out->data.klv.data = (uint8_t *)(uintptr_t)data;
+        out->data.klv.length = buf->bytesused;
+        out->data.klv.timestamp_ns = ts;
+        out->data.klv.sequence = buf->sequence;
+        break;
+
+    case DSV4L2_META_FORMAT_IR_TEMP:
+        rc = dsv4l2_decode_ir_temp(data, buf->bytesused, &out->data.ir);
+        out->data.ir.timestamp_ns = ts;
+        break;
+
+    case DSV4L2_META_FORMAT_TELEMETRY:
+        rc = dsv4l2_decode_telemetry(data, buf->bytesused, &out->data.telemetry);
+        out->data.telemetry.timestamp_ns = ts;
+        break;
+
+    case DSV4L2_META_FORMAT_TIMING:
+        rc = dsv4l2_decode_timing(data, buf->bytesused, &out->data.timing);
+        out->data.timing.timestamp_ns = ts;
+        break;
+
+    default:
+        rc = -ENOTSUP;
+        break;
     }
 
-    return NULL;
+    return rc;
 }
 
 /**
- * Decode IR radiometric data
+ * Capture metadata buffer
  */
-DSV4L2_SENSOR("ir_sensor", "L3", "CONFIDENTIAL")
-int dsv4l2_decode_ir_radiometric(const uint16_t *raw_data,
-                                  uint32_t width,
-                                  uint32_t height,
-                                  const float *calibration,
-                                  dsv4l2_ir_radiometric_t *out)
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_capture_metadata(dsv4l2_metadata_capture_t *meta_cap,
+                             dsv4l2_metadata_t *out)
 {
-    uint32_t i, num_pixels;
-    float c1, c2;
+    struct v4l2_buffer buf;
+    void *copy = NULL;
+    int rc;
 
-    if (!raw_data || !calibration || !out) {
+    if (!meta_cap || !out) {
         return -EINVAL;
     }
 
-    num_pixels = width * height;
+    rc = dequeue_meta(meta_cap, &buf);
+    if (rc < 0) {
+        return rc;
+    }
 
-    /* Allocate temperature map */
-    out->temp_map = malloc(num_pixels * sizeof(uint16_t));
-    if (!out->temp_map) {
-        return -ENOMEM;
+    rc = decode_meta(meta_cap->format, &buf, meta_cap->buffers[buf.index].start, out);
+    if (rc < 0) {
+        goto requeue;
+    }
+
+    /* The driver buffer goes straight back: copy what points into it */
+    if (meta_cap->format == DSV4L2_META_FORMAT_KLV) {
+        copy = malloc(out->data.klv.length);
+        if (!copy) {
+            rc = -ENOMEM;
+            goto requeue;
+        }
+        memcpy(copy, out->data.klv.data, out->data.klv.length);
+        out->data.klv.data = copy;
+    } else if (meta_cap->format == DSV4L2_META_FORMAT_IR_TEMP) {
+        size_t map_bytes = (size_t)out->data.ir.width * out->data.ir.height *
+                           sizeof(uint16_t);
+
+        copy = malloc(map_bytes);
+        if (!copy) {
+            rc = -ENOMEM;
+            goto requeue;
+        }
+        memcpy(copy, out->data.ir.temp_map, map_bytes);
+        out->data.ir.temp_map = copy;
     }
 
-    /* Get calibration constants */
-    c1 = calibration[0];
-    c2 = calibration[1];
+    /* Emit metadata capture event */
+    dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_DEBUG, buf.sequence);
 
-    /* Convert raw values to temperature (Kelvin * 100) */
-    for (i = 0; i < num_pixels; i++) {
-        float raw_val = (float)raw_data[i];
-        float temp_kelvin;
+requeue:
+    requeue_meta(meta_cap, buf.index);
+    return rc;
+}
+
+/**
+ * Capture a metadata buffer into caller-owned storage
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_capture_metadata_into(dsv4l2_metadata_capture_t *meta_cap,
+                                 dsv4l2_metadata_t *out,
+                                 void *arena, size_t arena_size)
+{
+    struct v4l2_buffer buf;
+    int rc;
 
-        /* Simple linear calibration: T = c1 * raw + c2 */
-        temp_kelvin = c1 * raw_val + c2;
+    if (!meta_cap || !out || !arena) {
+        return -EINVAL;
+    }
 
-        /* Clamp to reasonable range (0-500K) */
-        if (temp_kelvin < 0.0f) temp_kelvin = 0.0f;
-        if (temp_kelvin > 500.0f) temp_kelvin = 500.0f;
+    rc = dequeue_meta(meta_cap, &buf);
+    if (rc < 0) {
+        return rc;
+    }
 
-        out->temp_map[i] = (uint16_t)(temp_kelvin * 100.0f);
+    if (buf.bytesused > arena_size) {
+        requeue_meta(meta_cap, buf.index);
+        return -EMSGSIZE;
     }
 
-    out->width = width;
-    out->height = height;
-    out->emissivity = 0.95f;  /* Default */
-    out->ambient_temp = 293.15f;  /* 20°C */
-    out->calibration_c1 = c1;
-    out->calibration_c2 = c2;
+    memcpy(arena, meta_cap->buffers[buf.index].start, buf.bytesused);
+    requeue_meta(meta_cap, buf.index);
 
-    /* Emit IR decode event */
-    dsv4l2rt_emit_simple(0, DSV4L2_EVENT_FRAME_ACQUIRED,
-                         DSV4L2_SEV_DEBUG, num_pixels);
+    rc = decode_meta(meta_cap->format, &buf, arena, out);
+    if (rc < 0) {
+        return rc;
+    }
 
-    return 0;
+    dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_DEBUG, buf.sequence);
+
+    return (int)buf.bytesused;
+}
+
+/**
+ * Acquire a metadata buffer lease
+ */
+DSV4L2_SENSOR("metadata_capture", "L3", "UNCLASSIFIED")
+int dsv4l2_metadata_acquire(dsv4l2_metadata_capture_t *meta_cap,
+                            dsv4l2_metadata_t *out)
+{
+    struct v4l2_buffer buf;
+    meta_buffer_t *b;
+    uint32_t i, leased = 0;
+    int rc;
+
+    if (!meta_cap || !out) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < meta_cap->buffer_count; i++) {
+        leased += (uint32_t)__atomic_load_n(&meta_cap->buffers[i].leased,
+                                            __ATOMIC_ACQUIRE);
+    }
+    if (leased >= meta_cap->buffer_count) {
+        return -ENOBUFS;
+    }
+
+    rc = dequeue_meta(meta_cap, &buf);
+    if (rc < 0) {
+        return rc;
+    }
+
+    b = &meta_cap->buffers[buf.index];
+
+    rc = decode_meta(meta_cap->format, &buf, b->start, out);
+    if (rc < 0) {
+        requeue_meta(meta_cap, buf.index);
+        return rc;
+    }
+
+    b->sequence = buf.sequence;
+    __atomic_store_n(&b->leased, 1, __ATOMIC_RELEASE);
+
+    dsv4l2rt_emit_simple(meta_cap->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_DEBUG, buf.sequence);
+
+    return 0;
+}
+
+/**
+ * Release a metadata buffer lease
+ */
+int dsv4l2_metadata_release(dsv4l2_metadata_capture_t *meta_cap,
+                            const dsv4l2_metadata_t *meta)
+{
+    meta_buffer_t *b;
+    int expected = 1;
+
+    if (!meta_cap || !meta || meta->index >= meta_cap->buffer_count) {
+        return -EINVAL;
+    }
+
+    b = &meta_cap->buffers[meta->index];
+
+    /* Stale descriptor: buffer already went round again */
+    if (b->sequence != meta->sequence) {
+        return -EINVAL;
+    }
+
+    /* Claim the lease; a second release fails here */
+    if (!__atomic_compare_exchange_n(&b->leased, &expected, 0, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return -EINVAL;
+    }
+
+    requeue_meta(meta_cap, meta->index);
+    return 0;
+}
+
+/**
+ * Snapshot drop and dequeue latency counters of a metadata stream
+ */
+int dsv4l2_get_metadata_stats(dsv4l2_metadata_capture_t *meta_cap,
+                              dsv4l2_capture_stats_t *out)
+{
+    const dsv4l2_capture_stats_t *st;
+
+    if (!meta_cap || !out) {
+        return -EINVAL;
+    }
+
+    st = &meta_cap->seq.stats;
+
+    out->frames = __atomic_load_n(&st->frames, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&st->dropped, __ATOMIC_RELAXED);
+    out->gaps = __atomic_load_n(&st->gaps, __ATOMIC_RELAXED);
+    out->latency_last_ns = __atomic_load_n(&st->latency_last_ns, __ATOMIC_RELAXED);
+    out->latency_avg_ns = __atomic_load_n(&st->latency_avg_ns, __ATOMIC_RELAXED);
+    out->latency_max_ns = __atomic_load_n(&st->latency_max_ns, __ATOMIC_RELAXED);
+    out->buffer_count = meta_cap->buffer_count;
+    out->active_count = meta_cap->buffer_count;
+
+    return 0;
+}
+
+/**
+ * Snapshot one latency histogram of a metadata stream
+ */
+int dsv4l2_get_metadata_histogram(dsv4l2_metadata_capture_t *meta_cap,
+                                  dsv4l2_hist_kind_t kind,
+                                  dsv4l2_histogram_t *out)
+{
+    if (!meta_cap || !out || (unsigned)kind >= DSV4L2_HIST_KINDS) {
+        return -EINVAL;
+    }
+
+    dsv4l2_hist_snapshot(&meta_cap->seq.hist[kind], out);
+
+    return 0;
+}
+
+/* ========================================================================
+ * KLV Parsing
+ * ======================================================================== */
+
+/* Resumable parser states */
+enum {
+    KLV_KEY = 0,       /* Reading the 16-byte key (fill = bytes seen) */
+    KLV_LEN,           /* Expecting the first BER length byte */
+    KLV_LEN_LONG,      /* Reading long-form length bytes */
+    KLV_VALUE,         /* Assembling a split value in the arena */
+};
+
+/**
+ * Stop parsing with a sticky error
+ */
+static int klv_fail(dsv4l2_klv_parser_t *p, int rc)
+{
+    p->error = rc;
+    return rc;
+}
+
+/**
+ * Complete the current item
+ */
+static void klv_emit(dsv4l2_klv_parser_t *p, const uint8_t *value)
+{
+    dsv4l2_klv_item_t *item = &p->items[p->count++];
+
+    item->key = p->key;
+    item->length = p->length;
+    item->value = value;
+
+    p->state = KLV_KEY;
+    p->fill = 0;
+}
+
+/**
+ * Start the value once its length is known
+ *
+ * @return New position in the chunk, negative errno on error
+ */
+static long klv_begin_value(dsv4l2_klv_parser_t *p, const uint8_t *data,
+                            size_t length, size_t pos)
+{
+    size_t avail = length - pos;
+
+    /* Whole value in this chunk: reference it in place */
+    if (p->length <= avail) {
+        klv_emit(p, data + pos);
+        return (long)(pos + p->length);
+    }
+
+    /* Split value: assemble it in the arena */
+    if (!p->arena || p->length > p->arena_size - p->arena_used) {
+        return klv_fail(p, -ENOBUFS);
+    }
+
+    p->value = p->arena + p->arena_used;
+    p->arena_used += p->length;
+    memcpy(p->value, data + pos, avail);
+    p->fill = (uint32_t)avail;
+    p->state = KLV_VALUE;
+
+    return (long)length;
+}
+
+/**
+ * Initialise a resumable KLV parser
+ */
+void dsv4l2_klv_parser_init(dsv4l2_klv_parser_t *parser,
+                            dsv4l2_klv_item_t *items, size_t max_items,
+                            void *arena, size_t arena_size)
+{
+    if (!parser) {
+        return;
+    }
+
+    memset(parser, 0, sizeof(*parser));
+    parser->items = items;
+    parser->max_items = items ? max_items : 0;
+    parser->arena = arena;
+    parser->arena_size = arena ? arena_size : 0;
+    parser->state = KLV_KEY;
+}
+
+/**
+ * Feed the next chunk of a KLV stream
+ */
+int dsv4l2_klv_parser_feed(dsv4l2_klv_parser_t *parser,
+                           const uint8_t *data, size_t length)
+{
+    dsv4l2_klv_parser_t *p = parser;
+    size_t pos = 0;
+
+    if (!p || (!data && length > 0)) {
+        return -EINVAL;
+    }
+
+    if (p->error) {
+        return p->error;
+    }
+
+    while (pos < length) {
+        size_t avail = length - pos;
+        long next;
+        uint32_t n;
+        uint8_t b;
+
+        if (p->state == KLV_KEY && p->fill == 0) {
+            /* Item boundary: stop here if there is nowhere to put it */
+            if (p->count >= p->max_items) {
+                break;
+            }
+
+            /* Fast path: a whole short-form item inside the chunk */
+            if (avail >= 17 && data[pos + 16] < 0x80 &&
+                data[pos + 16] <= avail - 17) {
+                dsv4l2_klv_item_t *item = &p->items[p->count++];
+
+                memcpy(item->key.bytes, data + pos, 16);
+                item->length = data[pos + 16];
+                item->value = data + pos + 17;
+                pos += 17 + item->length;
+                continue;
+            }
+        }
+
+        switch (p->state) {
+        case KLV_KEY:
+            n = 16 - p->fill;
+            if (n > avail) {
+                n = (uint32_t)avail;
+            }
+            memcpy(p->key.bytes + p->fill, data + pos, n);
+            p->fill += n;
+            pos += n;
+            if (p->fill == 16) {
+                p->state = KLV_LEN;
+                p->fill = 0;
+            }
+            break;
+
+        case KLV_LEN:
+            b = data[pos++];
+            if (!(b & 0x80)) {
+                /* Short form length */
+                p->length = b;
+            } else {
+                /* Long form length */
+                p->length_bytes = b & 0x7F;
+                p->length = 0;
+                if (p->length_bytes > 4) {
+                    return klv_fail(p, -EINVAL);
+                }
+                if (p->length_bytes > 0) {
+                    p->state = KLV_LEN_LONG;
+                    break;
+                }
+            }
+            next = klv_begin_value(p, data, length, pos);
+            if (next < 0) {
+                return (int)next;
+            }
+            pos = (size_t)next;
+            break;
+
+        case KLV_LEN_LONG:
+            p->length = (p->length << 8) | data[pos++];
+            if (--p->length_bytes > 0) {
+                break;
+            }
+            next = klv_begin_value(p, data, length, pos);
+            if (next < 0) {
+                return (int)next;
+            }
+            pos = (size_t)next;
+            break;
+
+        case KLV_VALUE:
+            n = p->length - p->fill;
+            if (n > avail) {
+                n = (uint32_t)avail;
+            }
+            memcpy(p->value + p->fill, data + pos, n);
+            p->fill += n;
+            pos += n;
+            if (p->fill == p->length) {
+                klv_emit(p, p->value);
+            }
+            break;
+        }
+    }
+
+    return (int)pos;
+}
+
+/**
+ * Forget completed items and reuse the arena
+ */
+void dsv4l2_klv_parser_clear(dsv4l2_klv_parser_t *parser)
+{
+    if (!parser) {
+        return;
+    }
+
+    parser->count = 0;
+
+    /* Keep a split value that is still being assembled */
+    if (parser->state == KLV_VALUE) {
+        memmove(parser->arena, parser->value, parser->fill);
+        parser->value = parser->arena;
+        parser->arena_used = parser->length;
+    } else {
+        parser->arena_used = 0;
+    }
+}
+
+/**
+ * Check the stream ended cleanly
+ */
+int dsv4l2_klv_parser_finish(const dsv4l2_klv_parser_t *parser)
+{
+    if (!parser) {
+        return -EINVAL;
+    }
+
+    if (parser->error) {
+        return parser->error;
+    }
+
+    /* A partial key is trailing padding; anything later is a cut item */
+    return parser->state == KLV_KEY ? 0 : -EINVAL;
+}
+
+/**
+ * Parse KLV metadata
+ *
+ * Implements basic BER (Basic Encoding Rules) length parsing
+ */
+int dsv4l2_parse_klv(const dsv4l2_klv_buffer_t *buffer,
+                     dsv4l2_klv_item_t **items,
+                     size_t *count)
+{
+    dsv4l2_klv_parser_t parser;
+    dsv4l2_klv_item_t *item_array;
+    size_t item_capacity = 16;
+    size_t pos = 0;
+    int rc;
+
+    if (!buffer || !items || !count) {
+        return -EINVAL;
+    }
+
+    /* Allocate initial item array */
+    item_array = malloc(item_capacity * sizeof(dsv4l2_klv_item_t));
+    if (!item_array) {
+        return -ENOMEM;
+    }
+
+    /* Contiguous buffer: every value is referenced in place, no arena */
+    dsv4l2_klv_parser_init(&parser, item_array, item_capacity, NULL, 0);
+
+    for (;;) {
+        dsv4l2_klv_item_t *new_array;
+
+        rc = dsv4l2_klv_parser_feed(&parser, buffer->data + pos,
+                                    buffer->length - pos);
+        if (rc < 0) {
+            break;
+        }
+
+        pos += (size_t)rc;
+        if (pos >= buffer->length) {
+            rc = dsv4l2_klv_parser_finish(&parser);
+            break;
+        }
+
+        /* Item array full: expand and continue */
+        new_array = realloc(item_array, item_capacity * 2 * sizeof(dsv4l2_klv_item_t));
+        if (!new_array) {
+            rc = -ENOMEM;
+            break;
+        }
+        item_array = new_array;
+        item_capacity *= 2;
+        parser.items = item_array;
+        parser.max_items = item_capacity;
+    }
+
+    /*
+     * Keep the one-shot contract: a cut value (the parser asking for more
+     * data) is malformed, and a trailing fragment too short to hold a key
+     * and a length byte is ignored.
+     */
+    if (rc == -ENOBUFS) {
+        rc = -EINVAL;
+    }
+    if (rc == -EINVAL) {
+        size_t parsed = 0;
+
+        if (parser.count > 0) {
+            const dsv4l2_klv_item_t *last = &item_array[parser.count - 1];
+
+            parsed = (size_t)(last->value - buffer->data) + last->length;
+        }
+        if (buffer->length - parsed < 17) {
+            rc = 0;
+        }
+    }
+
+    if (rc < 0) {
+        free(item_array);
+        return rc;
+    }
+
+    *items = item_array;
+    *count = parser.count;
+    return 0;
+}
+
+/**
+ * Find KLV item by key
+ */
+const dsv4l2_klv_item_t *dsv4l2_find_klv_item(const dsv4l2_klv_item_t *items,
+                                               size_t count,
+                                               const dsv4l2_klv_key_t *key)
+{
+    size_t i;
+
+    if (!items || !key) {
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (memcmp(items[i].key.bytes, key->bytes, 16) == 0) {
+            return &items[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Map a key to its library id
+ */
+int dsv4l2_klv_key_id(const dsv4l2_klv_key_t *key)
+{
+    int id;
+
+    if (!key) {
+        return -1;
+    }
+
+    id = klv_key_slots[KLV_KEY_HASH(key->bytes)];
+    if (id < 0 || memcmp(key->bytes, klv_known_keys[id]->bytes, 16) != 0) {
+        return -1;
+    }
+
+    return id;
+}
+
+/**
+ * Index parsed items by known key
+ */
+int dsv4l2_klv_index_build(dsv4l2_klv_index_t *idx, const dsv4l2_klv_item_t *items,
+                           size_t count)
+{
+    size_t i;
+
+    if (!idx || (!items && count > 0)) {
+        return -EINVAL;
+    }
+
+    memset(idx, 0, sizeof(*idx));
+
+    for (i = 0; i < count; i++) {
+        int id = dsv4l2_klv_key_id(&items[i].key);
+
+        if (id < 0) {
+            idx->unknown++;
+        } else if (!idx->items[id]) {
+            idx->items[id] = &items[i];  /* First match, like dsv4l2_find_klv_item() */
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Store one raw local-set value into its telemetry field
+ *
+ * @return 1 if the field was written, 0 if the value is skipped
+ */
+static int misb_store(const misb_tag_t *t, const uint8_t *v, uint32_t len,
+                      dsv4l2_telemetry_t *out)
+{
+    uint8_t *field = (uint8_t *)out + t->field;
+    uint64_t u = 0;
+    double raw;
+    uint32_t i;
+
+    static const uint8_t sizes[] = {
+        [MISB_U16] = 2, [MISB_I16] = 2, [MISB_I32] = 4, [MISB_U64] = 8,
+    };
+
+    if (len != sizes[t->kind]) {
+        return 0;
+    }
+
+    /* Big-endian on the wire */
+    for (i = 0; i < len; i++) {
+        u = (u << 8) | v[i];
+    }
+
+    switch (t->kind) {
+    case MISB_I16:
+        if (u == 0x8000) {
+            return 0;  /* "Out of range" */
+        }
+        raw = (double)(int16_t)u;
+        break;
+    case MISB_I32:
+        if (u == 0x80000000u) {
+            return 0;
+        }
+        raw = (double)(int32_t)u;
+        break;
+    default:
+        raw = (double)u;
+        break;
+    }
+
+    switch (t->type) {
+    case FIELD_U64: {
+        uint64_t ns = u * (uint64_t)t->scale;
+        memcpy(field, &ns, sizeof(ns));
+        break;
+    }
+    case FIELD_F32: {
+        float f = (float)(raw * t->scale + t->offset);
+        memcpy(field, &f, sizeof(f));
+        break;
+    }
+    default: {
+        double d = raw * t->scale + t->offset;
+        memcpy(field, &d, sizeof(d));
+        break;
+    }
+    }
+
+    return 1;
+}
+
+/**
+ * Decode a MISB ST 0601 UAS Datalink Local Set value
+ */
+int dsv4l2_decode_misb0601(const uint8_t *value, size_t length,
+                           dsv4l2_telemetry_t *out)
+{
+    size_t pos = 0;
+    int written = 0;
+
+    if ((!value && length > 0) || !out) {
+        return -EINVAL;
+    }
+
+    while (pos < length) {
+        uint32_t tag = 0, len;
+        uint8_t b;
+
+        /* BER-OID tag: 7 bits per byte, high bit = more */
+        do {
+            if (pos >= length || tag > (UINT32_MAX >> 7)) {
+                return -EINVAL;
+            }
+            b = value[pos++];
+            tag = (tag << 7) | (b & 0x7F);
+        } while (b & 0x80);
+
+        /* BER length */
+        if (pos >= length) {
+            return -EINVAL;
+        }
+        b = value[pos++];
+        if (b & 0x80) {
+            uint32_t n = b & 0x7F;
+
+            if (n > 4 || n > length - pos) {
+                return -EINVAL;
+            }
+            len = 0;
+            while (n--) {
+                len = (len << 8) | value[pos++];
+            }
+        } else {
+            len = b;
+        }
+
+        if (len > length - pos) {
+            return -EINVAL;
+        }
+
+        if (tag < sizeof(misb0601_tags) / sizeof(misb0601_tags[0]) &&
+            misb0601_tags[tag].kind != MISB_NONE) {
+            written += misb_store(&misb0601_tags[tag], &value[pos], len, out);
+        }
+
+        pos += len;
+    }
+
+    return written;
+}
+
+/**
+ * Fill telemetry from an indexed packet
+ */
+int dsv4l2_klv_decode_telemetry(const dsv4l2_klv_index_t *idx,
+                                dsv4l2_telemetry_t *out)
+{
+    static const struct {
+        dsv4l2_klv_key_id_t id;
+        uint8_t             tag;
+    } standalone[] = {
+        { DSV4L2_KLV_KEY_SENSOR_LATITUDE, 13 },
+        { DSV4L2_KLV_KEY_SENSOR_LONGITUDE, 14 },
+        { DSV4L2_KLV_KEY_SENSOR_ALTITUDE, 15 },
+    };
+    const dsv4l2_klv_item_t *ls;
+    int written = 0;
+    size_t i;
+
+    if (!idx || !out) {
+        return -EINVAL;
+    }
+
+    ls = idx->items[DSV4L2_KLV_KEY_UAS_DATALINK_LS];
+    if (ls) {
+        written = dsv4l2_decode_misb0601(ls->value, ls->length, out);
+        if (written < 0) {
+            return written;
+        }
+    }
+
+    for (i = 0; i < sizeof(standalone) / sizeof(standalone[0]); i++) {
+        const dsv4l2_klv_item_t *item = idx->items[standalone[i].id];
+
+        if (item) {
+            written += misb_store(&misb0601_tags[standalone[i].tag],
+                                  item->value, item->length, out);
+        }
+    }
+
+    return written;
+}
+
+/**
+ * Decode IR radiometric data
+ */
+DSV4L2_SENSOR("ir_sensor", "L3", "CONFIDENTIAL")
+int dsv4l2_decode_ir_radiometric(const uint16_t *raw_data,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  const float *calibration,
+                                  dsv4l2_ir_radiometric_t *out)
+{
+    uint32_t num_pixels;
+    int rc;
+
+    if (!raw_data || !calibration || !out) {
+        return -EINVAL;
+    }
+
+    num_pixels = width * height;
+
+    /* Allocate temperature map */
+    out->temp_map = malloc(num_pixels * sizeof(uint16_t));
+    if (!out->temp_map) {
+        return -ENOMEM;
+    }
+
+    /* Convert raw values to temperature (Kelvin * 100) */
+    rc = dsv4l2_decode_ir_into(raw_data, width, height, calibration,
+                               out->temp_map, 0, NULL);
+    if (rc < 0) {
+        free(out->temp_map);
+        out->temp_map = NULL;
+        return rc;
+    }
+
+    out->width = width;
+    out->height = height;
+    out->emissivity = 0.95f;  /* Default */
+    out->ambient_temp = 293.15f;  /* 20°C */
+    out->calibration_c1 = calibration[0];
+    out->calibration_c2 = calibration[1];
+
+    /* Emit IR decode event */
+    dsv4l2rt_emit_simple(0, DSV4L2_EVENT_FRAME_ACQUIRED,
+                         DSV4L2_SEV_DEBUG, num_pixels);
+
+    return 0;
+}
+
+/* ========================================================================
+ * Metadata History
+ * ======================================================================== */
+
+/* Entry at logical position i (0 = oldest) */
+#define HIST_AT(h, i)  (&(h)->entries[((h)->head + (i)) % (h)->depth])
+
+/**
+ * Payload pointer of a metadata descriptor (KLV data, IR map), NULL if none
+ */
+static const uint8_t *meta_payload_get(const dsv4l2_metadata_t *m)
+{
+    switch (m->format) {
+    case DSV4L2_META_FORMAT_KLV:
+        return m->data.klv.data;
+    case DSV4L2_META_FORMAT_IR_TEMP:
+        return (const uint8_t *)m->data.ir.temp_map;
+    default:
+        return NULL;
+    }
+}
+
+static void meta_payload_set(dsv4l2_metadata_t *m, uint8_t *p)
+{
+    if (m->format == DSV4L2_META_FORMAT_KLV) {
+        m->data.klv.data = p;
+    } else if (m->format == DSV4L2_META_FORMAT_IR_TEMP) {
+        m->data.ir.temp_map = (uint16_t *)(void *)p;
+    }
+}
+
+int dsv4l2_meta_history_create(uint32_t depth, size_t payload_max,
+                               dsv4l2_meta_history_t **out)
+{
+    dsv4l2_meta_history_t *h;
+    uint32_t i;
+
+    if (!out || depth == 0) {
+        return -EINVAL;
+    }
+
+    /* Keep every slot 8-byte aligned */
+    payload_max = (payload_max + 7) & ~(size_t)7;
+
+    h = calloc(1, sizeof(*h));
+    if (!h) {
+        return -ENOMEM;
+    }
+
+    h->entries = calloc(depth, sizeof(*h->entries));
+    if (payload_max) {
+        h->payloads = malloc(payload_max * depth);
+    }
+    if (!h->entries || (payload_max && !h->payloads)) {
+        free(h->entries);
+        free(h->payloads);
+        free(h);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < depth; i++) {
+        h->entries[i].payload = payload_max ? h->payloads + payload_max * i : NULL;
+    }
+
+    pthread_mutex_init(&h->lock, NULL);
+    h->payload_max = payload_max;
+    h->depth = depth;
+
+    *out = h;
+    return 0;
+}
+
+void dsv4l2_meta_history_destroy(dsv4l2_meta_history_t *hist)
+{
+    if (!hist) {
+        return;
+    }
+
+    pthread_mutex_destroy(&hist->lock);
+    free(hist->payloads);
+    free(hist->entries);
+    free(hist);
+}
+
+size_t dsv4l2_meta_history_payload_max(const dsv4l2_meta_history_t *hist)
+{
+    return hist->payload_max;
+}
+
+int dsv4l2_meta_history_push(dsv4l2_meta_history_t *hist, const dsv4l2_metadata_t *meta,
+                             const void *payload, size_t payload_len)
+{
+    const uint8_t *base = payload;
+    const uint8_t *ptr;
+    hist_entry_t *e;
+    uint32_t pos, lo, hi, i;
+
+    if (!hist || !meta) {
+        return -EINVAL;
+    }
+
+    /* Only KLV and IR entries carry a payload */
+    ptr = meta_payload_get(meta);
+    if (!ptr) {
+        payload_len = 0;
+    } else if (!base || ptr < base || ptr > base + payload_len) {
+        return -EINVAL;
+    }
+    if (payload_len > hist->payload_max) {
+        return -EMSGSIZE;
+    }
+
+    pthread_mutex_lock(&hist->lock);
+
+    /* In-order arrival appends; otherwise find the first newer entry */
+    pos = hist->count;
+    if (hist->count > 0 &&
+        meta->timestamp_ns < HIST_AT(hist, hist->count - 1)->meta.timestamp_ns) {
+        lo = 0;
+        hi = hist->count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+
+            if (HIST_AT(hist, mid)->meta.timestamp_ns <= meta->timestamp_ns) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        pos = lo;
+    }
+
+    /* Full: drop the oldest, unless the new entry would be it */
+    if (hist->count == hist->depth) {
+        if (pos == 0) {
+            pthread_mutex_unlock(&hist->lock);
+            return -ESTALE;
+        }
+        hist->head = (hist->head + 1) % hist->depth;
+        hist->count--;
+        pos--;
+    }
+
+    /* The free slot is at logical count; bubble it down to pos */
+    for (i = hist->count; i > pos; i--) {
+        hist_entry_t tmp = *HIST_AT(hist, i);
+
+        *HIST_AT(hist, i) = *HIST_AT(hist, i - 1);
+        *HIST_AT(hist, i - 1) = tmp;
+    }
+
+    e = HIST_AT(hist, pos);
+    e->meta = *meta;
+    e->payload_len = payload_len;
+    if (ptr) {
+        memcpy(e->payload, base, payload_len);
+        meta_payload_set(&e->meta, e->payload + (ptr - base));
+    }
+    hist->count++;
+
+    pthread_mutex_unlock(&hist->lock);
+    return 0;
+}
+
+/**
+ * Linear interpolation of an angle with wrap-around into [lo, lo + period)
+ */
+static double lerp_wrap(double a, double b, double w, double lo, double period)
+{
+    double d = b - a;
+    double r;
+
+    if (d > period / 2) {
+        d -= period;
+    } else if (d < -period / 2) {
+        d += period;
+    }
+
+    r = a + d * w;
+    if (r < lo) {
+        r += period;
+    } else if (r >= lo + period) {
+        r -= period;
+    }
+
+    return r;
+}
+
+/**
+ * Interpolate telemetry between two samples (w = 0 gives a)
+ */
+static void lerp_telemetry(const dsv4l2_telemetry_t *a, const dsv4l2_telemetry_t *b,
+                           double w, dsv4l2_telemetry_t *out)
+{
+    int k;
+
+    out->latitude = a->latitude + (b->latitude - a->latitude) * w;
+    out->longitude = lerp_wrap(a->longitude, b->longitude, w, -180.0, 360.0);
+    out->altitude = (float)(a->altitude + (b->altitude - a->altitude) * w);
+    out->heading = (float)lerp_wrap(a->heading, b->heading, w, 0.0, 360.0);
+    out->pitch = (float)(a->pitch + (b->pitch - a->pitch) * w);
+    out->roll = (float)lerp_wrap(a->roll, b->roll, w, -180.0, 360.0);
+    for (k = 0; k < 3; k++) {
+        out->velocity[k] = (float)(a->velocity[k] + (b->velocity[k] - a->velocity[k]) * w);
+    }
+}
+
+int dsv4l2_meta_history_find(dsv4l2_meta_history_t *hist, uint64_t ts,
+                             uint64_t tolerance_ns, unsigned flags,
+                             dsv4l2_metadata_t *out, void *payload, size_t payload_size)
+{
+    const hist_entry_t *a = NULL, *b = NULL, *best;
+    uint64_t da = UINT64_MAX, db = UINT64_MAX;
+    uint32_t lo = 0, hi;
+    const uint8_t *ptr;
+    int rc = 0;
+
+    if (!hist || !out) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&hist->lock);
+
+    /* First entry at or after ts; its predecessor is the one before */
+    hi = hist->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (HIST_AT(hist, mid)->meta.timestamp_ns < ts) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo > 0) {
+        a = HIST_AT(hist, lo - 1);
+        da = ts - a->meta.timestamp_ns;
+    }
+    if (lo < hist->count) {
+        b = HIST_AT(hist, lo);
+        db = b->meta.timestamp_ns - ts;
+    }
+
+    best = (da <= db) ? a : b;
+    if (!best || (best == a ? da : db) > tolerance_ns) {
+        rc = -ENOENT;
+        goto out;
+    }
+
+    /* Bracketed telemetry no further apart than twice the tolerance */
+    if ((flags & DSV4L2_META_FIND_INTERPOLATE) && a && b && db > 0 &&
+        a->meta.format == DSV4L2_META_FORMAT_TELEMETRY &&
+        b->meta.format == DSV4L2_META_FORMAT_TELEMETRY &&
+        da + db <= 2 * tolerance_ns) {
+        *out = best->meta;
+        lerp_telemetry(&a->meta.data.telemetry, &b->meta.data.telemetry,
+                       (double)da / (double)(da + db), &out->data.telemetry);
+        out->timestamp_ns = ts;
+        out->data.telemetry.timestamp_ns = ts;
+        goto out;
+    }
+
+    *out = best->meta;
+    ptr = meta_payload_get(&best->meta);
+    if (ptr) {
+        if (!payload) {
+            meta_payload_set(out, NULL);
+        } else if (payload_size < best->payload_len) {
+            rc = -EMSGSIZE;
+        } else {
+            memcpy(payload, best->payload, best->payload_len);
+            meta_payload_set(out, (uint8_t *)payload + (ptr - best->payload));
+        }
+    }
+
+out:
+    pthread_mutex_unlock(&hist->lock);
+    return rc;
+}
+
+uint32_t dsv4l2_meta_history_count(dsv4l2_meta_history_t *hist)
+{
+    uint32_t n;
+
+    if (!hist) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&hist->lock);
+    n = hist->count;
+    pthread_mutex_unlock(&hist->lock);
+
+    return n;
+}
+
+/**
+ * Keep a history of everything dequeued from a metadata stream
+ *
+ * Not safe while another thread is dequeuing the stream.
+ */
+int dsv4l2_metadata_set_history(dsv4l2_metadata_capture_t *meta_cap, uint32_t depth)
+{
+    dsv4l2_meta_history_t *h = NULL;
+    size_t payload_max = 0;
+    uint32_t i;
+    int rc;
+
+    if (!meta_cap) {
+        return -EINVAL;
+    }
+
+    /* Fixed-size formats decode entirely into the descriptor */
+    if (meta_cap->format == DSV4L2_META_FORMAT_KLV ||
+        meta_cap->format == DSV4L2_META_FORMAT_IR_TEMP) {
+        for (i = 0; i < meta_cap->buffer_count; i++) {
+            if (meta_cap->buffers[i].length > payload_max) {
+                payload_max = meta_cap->buffers[i].length;
+            }
+        }
+    }
+
+    if (depth > 0) {
+        rc = dsv4l2_meta_history_create(depth, payload_max, &h);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    dsv4l2_meta_history_destroy(meta_cap->history);
+    meta_cap->history = h;
+    return 0;
+}
+
+dsv4l2_meta_history_t *dsv4l2_metadata_get_history(dsv4l2_metadata_capture_t *meta_cap)
+{
+    return meta_cap ? meta_cap->history : NULL;
 }
 
 /**
@@ -449,7 +1721,7 @@ int dsv4l2_sync_metadata(uint64_t frame_ts,
 {
     int best_idx = -1;
     uint64_t best_delta = UINT64_MAX;
-    uint64_t threshold_ns = 50000000;  /* 50ms threshold */
+    uint64_t threshold_ns = DSV4L2_META_SYNC_TOLERANCE_NS;
     size_t i;
 
     if (!meta_buffers || count == 0) {
@@ -16,29 +16,16 @@
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
 #include "dsv4l2_profiles.h"
+#include "dsv4l2_dsmil.h"
+#include "dsv4l2_core.h"
 #include "dsv4l2rt.h"
+#include "../device_internal.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
-
-/* DSMIL THREATCON levels */
-typedef enum {
-    THREATCON_NORMAL    = 0,
-    THREATCON_ALPHA     = 1,
-    THREATCON_BRAVO     = 2,
-    THREATCON_CHARLIE   = 3,
-    THREATCON_DELTA     = 4,
-    THREATCON_EMERGENCY = 5,
-} dsmil_threatcon_t;
-
-/* Layer policy structure */
-typedef struct {
-    uint32_t layer;                     /* DSMIL layer (0-8) */
-    uint32_t max_width;                 /* Max resolution width */
-    uint32_t max_height;                /* Max resolution height */
-    dsv4l2_tempest_state_t min_tempest; /* Minimum TEMPEST state */
-} dsv4l2_layer_policy_t;
+#include <pthread.h>
+#include <time.h>
 
 /* Global policy state */
 static struct {
@@ -49,6 +36,14 @@ static struct {
     .initialized = 0,
 };
 
+/*
+ * Policy generation
+ *
+ * Bumped whenever an input to the per-device decisions changes. Starts at
+ * 1 so a zeroed decision is never mistaken for a current one.
+ */
+static uint32_t g_policy_generation = 1;
+
 /* Layer-specific policies */
 static const dsv4l2_layer_policy_t g_layer_policies[] = {
     /* L0: Hardware - no direct access */
@@ -118,6 +113,9 @@ int dsv4l2_set_threatcon(dsmil_threatcon_t level)
     dsv4l2_policy_init();
     g_policy.current_threatcon = level;
 
+    /* Invalidate cached capture decisions */
+    __atomic_add_fetch(&g_policy_generation, 1, __ATOMIC_RELEASE);
+
     return 0;
 }
 
@@ -144,6 +142,121 @@ int dsv4l2_apply_threatcon(dsv4l2_device_t *dev)
     return dsv4l2_set_tempest_state(dev, target_state);
 }
 
+/* Fan-out state shared by the THREATCON workers */
+typedef struct {
+    dsv4l2_device_internal_t **devices;
+    dsv4l2_threatcon_result_t *results;
+    size_t count;
+    size_t next;                        /* Next device to claim (atomic) */
+    dsv4l2_tempest_state_t target;
+    struct timespec start;
+} threatcon_fanout_t;
+
+/**
+ * Apply the target state to devices until none are left to claim
+ */
+static void *threatcon_worker(void *arg)
+{
+    threatcon_fanout_t *fanout = arg;
+    struct timespec now;
+    size_t i;
+
+    while ((i = __atomic_fetch_add(&fanout->next, 1, __ATOMIC_RELAXED)) < fanout->count) {
+        dsv4l2_threatcon_result_t *result = &fanout->results[i];
+
+        result->dev = &fanout->devices[i]->public;
+        result->result = dsv4l2_set_tempest_state(result->dev, fanout->target);
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        result->latency_ns = (uint64_t)(now.tv_sec - fanout->start.tv_sec) * 1000000000ULL +
+                             (uint64_t)now.tv_nsec - (uint64_t)fanout->start.tv_nsec;
+    }
+
+    return NULL;
+}
+
+/**
+ * Apply THREATCON to every open device concurrently
+ *
+ * Devices are transitioned in parallel by up to
+ * DSV4L2_THREATCON_MAX_WORKERS threads (the caller is one of them), so
+ * fleet-wide LOCKDOWN costs about one ioctl round trip, not one per
+ * device. Devices closed by other threads wait until the fan-out ends.
+ *
+ * @param results Optional per-device results (may be NULL)
+ * @param max_results Capacity of results
+ * @param count Optional output: number of open devices
+ * @return 0 if every device with a TEMPEST control was transitioned,
+ *         -ENOMEM if the open devices could not be listed, otherwise the
+ *         first failure (negative errno)
+ */
+int dsv4l2_apply_threatcon_all(dsv4l2_threatcon_result_t *results,
+                               size_t max_results, size_t *count)
+{
+    threatcon_fanout_t fanout;
+    pthread_t workers[DSV4L2_THREATCON_MAX_WORKERS];
+    size_t started = 0;
+    size_t wanted;
+    size_t i;
+    int rc = 0;
+
+    dsv4l2_policy_init();
+
+    memset(&fanout, 0, sizeof(fanout));
+    fanout.target = g_threatcon_tempest_map[g_policy.current_threatcon];
+    rc = dsv4l2_registry_acquire(&fanout.devices, &fanout.count);
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (fanout.count > 0) {
+        fanout.results = calloc(fanout.count, sizeof(*fanout.results));
+        if (!fanout.results) {
+            dsv4l2_registry_release(fanout.devices);
+            return -ENOMEM;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &fanout.start);
+
+    /* One worker per device beyond the first; the caller takes a share */
+    wanted = fanout.count > 1 ? fanout.count - 1 : 0;
+    if (wanted > DSV4L2_THREATCON_MAX_WORKERS) {
+        wanted = DSV4L2_THREATCON_MAX_WORKERS;
+    }
+    while (started < wanted &&
+           pthread_create(&workers[started], NULL, threatcon_worker, &fanout) == 0) {
+        started++;
+    }
+
+    threatcon_worker(&fanout);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    for (i = 0; i < fanout.count; i++) {
+        /* Devices without a TEMPEST control are reported, not failed */
+        if (rc == 0 && fanout.results[i].result != 0 &&
+            fanout.results[i].result != -ENOTSUP) {
+            rc = fanout.results[i].result;
+        }
+    }
+
+    if (results && fanout.count > 0) {
+        memcpy(results, fanout.results,
+               (fanout.count < max_results ? fanout.count : max_results) * sizeof(*results));
+    }
+    if (count) {
+        *count = fanout.count;
+    }
+
+    free(fanout.results);
+    dsv4l2_registry_release(fanout.devices);
+
+    return rc;
+}
+
 /**
  * Get layer policy
  *
@@ -162,6 +275,112 @@ int dsv4l2_get_layer_policy(uint32_t layer, dsv4l2_layer_policy_t **policy)
     return 0;
 }
 
+int dsv4l2_check_clearance(const char *role, const char *classification);
+
+/**
+ * Recompute a device's capture decision
+ *
+ * Folds everything that does not change between frames into the
+ * device: the layer policy lookup, the role and classification
+ * clearance mapping and the THREATCON restriction. Capture is denied
+ * when the user's clearance is below the device's (the check
+ * dsv4l2_open() makes) or at THREATCON EMERGENCY, which maps to
+ * LOCKDOWN; the latter also stops devices without a TEMPEST control,
+ * which dsv4l2_apply_threatcon() cannot move to LOCKDOWN. The current
+ * format is read once here and compared with the layer's resolution
+ * limit; a device whose format cannot be read is not held to it. The
+ * decision is built locally and published with one atomic store.
+ *
+ * @param dev Internal device
+ * @return The published decision
+ */
+dsv4l2_policy_decision_t dsv4l2_policy_decide(dsv4l2_device_internal_t *dev)
+{
+    dsv4l2_policy_decision_t decision;
+    dsv4l2_tempest_state_t min_tempest = DSV4L2_TEMPEST_DISABLED;
+    struct v4l2_format fmt;
+    uint32_t generation;
+    uint32_t layer = dev->public.layer;
+    int allowed;
+    int format_ok = 1;
+
+    dsv4l2_policy_init();
+
+    generation = __atomic_load_n(&g_policy_generation, __ATOMIC_ACQUIRE);
+
+    if (layer <= 8) {
+        min_tempest = g_layer_policies[layer].min_tempest;
+
+        if (dsv4l2_get_format(&dev->public, &fmt) == 0) {
+            format_ok = fmt.fmt.pix.width <= g_layer_policies[layer].max_width &&
+                        fmt.fmt.pix.height <= g_layer_policies[layer].max_height;
+        }
+    }
+    if (layer > DSV4L2_POLICY_LAYER_MAX) {
+        layer = DSV4L2_POLICY_LAYER_MAX;
+    }
+
+    allowed =
+        g_threatcon_tempest_map[g_policy.current_threatcon] != DSV4L2_TEMPEST_LOCKDOWN &&
+        dsv4l2_check_clearance(dev->public.role ? dev->public.role : "",
+                               dev->classification ? dev->classification : "UNCLASSIFIED") == 0;
+
+    decision = DSV4L2_POLICY_PACK(generation, layer, min_tempest, allowed, format_ok);
+    __atomic_store_n(&dev->policy, decision, __ATOMIC_RELEASE);
+
+    return decision;
+}
+
+/**
+ * Current decision of a device, recomputed if stale
+ */
+static inline dsv4l2_policy_decision_t policy_current(dsv4l2_device_internal_t *dev)
+{
+    dsv4l2_policy_decision_t decision = __atomic_load_n(&dev->policy, __ATOMIC_ACQUIRE);
+    uint32_t layer = dev->public.layer;
+
+    if (layer > DSV4L2_POLICY_LAYER_MAX) {
+        layer = DSV4L2_POLICY_LAYER_MAX;
+    }
+
+    /* Recompute after a THREATCON change or a layer reassignment */
+    if (DSV4L2_POLICY_GENERATION(decision) !=
+            __atomic_load_n(&g_policy_generation, __ATOMIC_ACQUIRE) ||
+        DSV4L2_POLICY_LAYER(decision) != layer) {
+        decision = dsv4l2_policy_decide(dev);
+    }
+
+    return decision;
+}
+
+/**
+ * Capture-path policy check
+ *
+ * Same rule as dsv4l2_policy_check() (LOCKDOWN blocks capture) plus the
+ * cached decision's allowed flag (clearance, THREATCON EMERGENCY). Runs on every dequeue, so it must
+ * stay a couple of integer compares.
+ *
+ * @param dev Internal device
+ * @param state TEMPEST state the caller just read
+ * @param context Capture context (for logging)
+ * @return 0 if allowed, -EPERM if blocked
+ */
+int dsv4l2_policy_capture_check(dsv4l2_device_internal_t *dev,
+                                dsv4l2_tempest_state_t state,
+                                const char *context)
+{
+    dsv4l2_policy_decision_t decision = policy_current(dev);
+
+    /* Context could be used for logging/audit */
+    (void)context;
+
+    if (!DSV4L2_POLICY_ALLOWED(decision) || state == DSV4L2_TEMPEST_LOCKDOWN) {
+        return -EPERM;
+    }
+
+    return 0;
+}
+
 /**
  * Check if capture is allowed for device
  *
@@ -170,40 +389,36 @@ int dsv4l2_get_layer_policy(uint32_t layer, dsv4l2_layer_policy_t **policy)
  * - Minimum TEMPEST requirements
  * - THREATCON-based restrictions
  *
+ * Uses the decision precomputed by dsv4l2_policy_decide(), so a check is
+ * a generation compare plus the TEMPEST compares.
+ *
  * @param dev Device handle
  * @param context Capture context (for logging)
  * @return 0 if allowed, -EPERM if blocked
  */
 int dsv4l2_check_capture_allowed(dsv4l2_device_t *dev, const char *context)
 {
+    dsv4l2_policy_decision_t decision;
     dsv4l2_tempest_state_t current_tempest;
-    const dsv4l2_layer_policy_t *layer_policy;
 
     if (!dev) {
         return -EINVAL;
     }
 
-    dsv4l2_policy_init();
+    decision = policy_current(dsv4l2_get_internal(dev));
 
-    /* Get current TEMPEST state */
-    current_tempest = dsv4l2_get_tempest_state(dev);
-
-    /* LOCKDOWN blocks all capture */
-    if (current_tempest == DSV4L2_TEMPEST_LOCKDOWN) {
+    /* Clearance, THREATCON and the layer's resolution limit */
+    if (!DSV4L2_POLICY_ALLOWED(decision) || !DSV4L2_POLICY_FORMAT_OK(decision)) {
         return -EPERM;
     }
 
-    /* Get layer policy */
-    if (dev->layer <= 8) {
-        layer_policy = &g_layer_policies[dev->layer];
-
-        /* Check minimum TEMPEST requirement for layer */
-        if (current_tempest < layer_policy->min_tempest) {
-            return -EPERM;
-        }
+    /* Get current TEMPEST state */
+    current_tempest = dsv4l2_get_tempest_state(dev);
 
-        /* TODO: Check resolution against layer policy
-         * (would need current format from device) */
+    /* LOCKDOWN blocks all capture; layers may require a minimum state */
+    if (current_tempest == DSV4L2_TEMPEST_LOCKDOWN ||
+        current_tempest < DSV4L2_POLICY_MIN_TEMPEST(decision)) {
+        return -EPERM;
     }
 
     /* Context could be used for logging/audit */
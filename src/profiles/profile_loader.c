@@ -3,11 +3,33 @@
  *
  * Simple YAML-like parser for device profile files.
  * Loads role, classification, TEMPEST controls, and device configuration.
+ *
+ * Profiles live in an immutable snapshot with open-addressed hash indexes
+ * by id and by role. Lookups are one atomic pointer load plus a probe and
+ * never take a lock; a reload builds a new snapshot and publishes it with
+ * a single release store (RCU-style). Replaced snapshots are retired, not
+ * freed, so profile pointers handed out earlier stay valid until
+ * dsv4l2_profiles_shutdown().
+ *
+ * An optional binary cache (the parsed profile array plus a stamp of the
+ * source files' names, sizes and mtimes) skips YAML parsing at startup
+ * while the directory is unchanged.
  */
 
+#define _GNU_SOURCE
+
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
-
+#include "dsv4l2_profiles.h"
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,86 +38,539 @@
 #include <errno.h>
 
 #define MAX_LINE 1024
-#define MAX_PROFILES 64
 
-/* Profile structure */
+#define PROFILE_CACHE_MAGIC    0x43505344u   /* "DSPC" */
+#define PROFILE_CACHE_VERSION  1
+#define PROFILE_SETTLE_MS      100           /* Quiet time before a hot reload */
+
+/* Binary cache file header, followed by count profiles */
 typedef struct {
-    char id[32];                    /* USB VID:PID or identifier */
-    char vendor[64];
-    char model[128];
-    char role[32];
-    char classification[32];
-    uint32_t layer;
-    int tempest_ctrl_id;
-
-    /* Format settings */
-    char pixel_format[8];
-    uint32_t width;
-    uint32_t height;
-    uint32_t fps;
-
-    /* Profile metadata */
-    char filename[256];
-} dsv4l2_device_profile_t;
-
-/* Global profile cache */
-static dsv4l2_device_profile_t g_profiles[MAX_PROFILES];
-static size_t g_profile_count = 0;
-static int g_profiles_loaded = 0;
+    uint32_t magic;                 /* PROFILE_CACHE_MAGIC */
+    uint32_t version;               /* PROFILE_CACHE_VERSION */
+    uint32_t profile_size;          /* sizeof(dsv4l2_device_profile_t) */
+    uint32_t count;
+    uint64_t stamp;                 /* Hash of the source directory listing */
+} profile_cache_header_t;
+
+/* Immutable profile snapshot (one allocation) */
+typedef struct profile_set {
+    struct profile_set *retired_next;   /* Older snapshots, freed at shutdown */
+    size_t count;
+    uint32_t mask;                      /* Index slots - 1 */
+    uint32_t *id_index;                 /* Profile index + 1, 0 = free */
+    uint32_t *role_index;
+    dsv4l2_device_profile_t *profiles;  /* Sorted by file name */
+} profile_set_t;
+
+/* Global profile store */
+static struct {
+    profile_set_t  *current;            /* Published snapshot (atomic) */
+    profile_set_t  *retired;            /* Replaced snapshots */
+    pthread_mutex_t lock;               /* Reloads only, never lookups */
+    char            dir[PATH_MAX];      /* Resolved profile directory, "" if none */
+    char            cache[PATH_MAX];    /* Binary cache path, "" if none */
+    int             configured;         /* dir and cache chosen */
+    uint32_t        generation;         /* Snapshots published (atomic) */
+
+    pthread_t       watcher;
+    int             watching;
+    int             inotify_fd;
+    int             wakefd;             /* eventfd for dsv4l2_profiles_shutdown() */
+} store = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .inotify_fd = -1,
+    .wakefd = -1,
+};
 
 /* Forward declarations */
 static int load_profile_file(const char *path, dsv4l2_device_profile_t *profile);
 static void trim_whitespace(char *str);
 static int parse_key_value(const char *line, char *key, char *value);
 
+/* ========================================================================
+ * Snapshot Index
+ * ======================================================================== */
+
+/**
+ * FNV-1a, continuing from h
+ */
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+
+    return h;
+}
+
+static uint32_t hash_key(const char *key)
+{
+    return (uint32_t)fnv1a(14695981039346656037ULL, key, strlen(key));
+}
+
+/**
+ * Index a profile under key; the first profile with a key wins
+ */
+static void index_insert(uint32_t *index, uint32_t mask, const char *key,
+                         const dsv4l2_device_profile_t *profiles, uint32_t pos,
+                         size_t key_offset)
+{
+    uint32_t slot = hash_key(key) & mask;
+
+    while (index[slot]) {
+        const char *other = (const char *)&profiles[index[slot] - 1] + key_offset;
+
+        if (strcmp(other, key) == 0) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    index[slot] = pos + 1;
+}
+
+static const dsv4l2_device_profile_t *index_find(const profile_set_t *set,
+                                                 const uint32_t *index,
+                                                 const char *key, size_t key_offset)
+{
+    uint32_t slot = hash_key(key) & set->mask;
+
+    while (index[slot]) {
+        const dsv4l2_device_profile_t *p = &set->profiles[index[slot] - 1];
+
+        if (strcmp((const char *)p + key_offset, key) == 0) {
+            return p;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+
+    return NULL;
+}
+
 /**
- * Load all profiles from profiles/ directory
+ * Build a snapshot from a profile array
  */
-static void load_all_profiles(void)
+static profile_set_t *build_set(const dsv4l2_device_profile_t *profiles, size_t count)
 {
-    DIR *dir;
+    profile_set_t *set;
+    size_t slots = 4;
+    size_t i;
+
+    /* Load factor <= 1/2 keeps probes short */
+    while (slots < count * 2) {
+        slots *= 2;
+    }
+
+    set = calloc(1, sizeof(*set) + count * sizeof(*profiles) +
+                    2 * slots * sizeof(uint32_t));
+    if (!set) {
+        return NULL;
+    }
+
+    set->count = count;
+    set->mask = (uint32_t)(slots - 1);
+    set->profiles = (dsv4l2_device_profile_t *)(set + 1);
+    set->id_index = (uint32_t *)(set->profiles + count);
+    set->role_index = set->id_index + slots;
+    if (count > 0) {
+        memcpy(set->profiles, profiles, count * sizeof(*profiles));
+    }
+
+    for (i = 0; i < count; i++) {
+        index_insert(set->id_index, set->mask, set->profiles[i].id, set->profiles,
+                     (uint32_t)i, offsetof(dsv4l2_device_profile_t, id));
+        index_insert(set->role_index, set->mask, set->profiles[i].role, set->profiles,
+                     (uint32_t)i, offsetof(dsv4l2_device_profile_t, role));
+    }
+
+    return set;
+}
+
+/* ========================================================================
+ * Directory Scan and Binary Cache
+ * ======================================================================== */
+
+/**
+ * Resolve the profile directory to an absolute path
+ *
+ * @param dir Requested directory, or NULL for $DSV4L2_PROFILE_DIR and the
+ *            default search (profiles, ../profiles, /etc/dsv4l2/profiles)
+ * @param out Output path
+ * @return 0 on success, -ENOENT if no directory exists
+ */
+static int resolve_dir(const char *dir, char *out)
+{
+    static const char *const defaults[] = {
+        "profiles", "../profiles", "/etc/dsv4l2/profiles",
+    };
+    const char *env = getenv("DSV4L2_PROFILE_DIR");
+    size_t i;
+
+    if (dir) {
+        return realpath(dir, out) ? 0 : -errno;
+    }
+    if (env && env[0]) {
+        return realpath(env, out) ? 0 : -errno;
+    }
+
+    for (i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+        struct stat st;
+
+        if (realpath(defaults[i], out) && stat(out, &st) == 0 && S_ISDIR(st.st_mode)) {
+            return 0;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static int is_profile_name(const char *name)
+{
+    size_t len = strlen(name);
+
+    return len > 5 && strcmp(name + len - 5, ".yaml") == 0;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * List the profile files of a directory
+ *
+ * @param names Output sorted file names (free each, then the array)
+ * @param count Output file count
+ * @param stamp Output hash of the names, sizes and mtimes
+ * @return 0 on success, negative errno on error
+ */
+static int list_sources(const char *dir, char ***names, size_t *count, uint64_t *stamp)
+{
+    char **list = NULL;
+    size_t n = 0, capacity = 0, i;
     struct dirent *entry;
-    char path[512];
+    uint64_t h;
+    DIR *d;
 
-    if (g_profiles_loaded) {
-        return;  /* Already loaded */
+    d = opendir(dir);
+    if (!d) {
+        return -errno;
     }
 
-    dir = opendir("profiles");
-    if (!dir) {
-        dir = opendir("../profiles");  /* Try parent directory */
-        if (!dir) {
-            dir = opendir("/etc/dsv4l2/profiles");  /* Try system directory */
+    while ((entry = readdir(d)) != NULL) {
+        if (!is_profile_name(entry->d_name)) {
+            continue;
+        }
+        if (n == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 16;
+            char **grown = realloc(list, new_capacity * sizeof(*list));
+
+            if (!grown) {
+                break;
+            }
+            list = grown;
+            capacity = new_capacity;
+        }
+        list[n] = strdup(entry->d_name);
+        if (list[n]) {
+            n++;
+        }
+    }
+    closedir(d);
+
+    qsort(list, n, sizeof(*list), compare_names);
+
+    h = fnv1a(14695981039346656037ULL, dir, strlen(dir) + 1);
+    for (i = 0; i < n; i++) {
+        char path[PATH_MAX + 256];
+        struct stat st;
+
+        snprintf(path, sizeof(path), "%s/%s", dir, list[i]);
+        memset(&st, 0, sizeof(st));
+        stat(path, &st);
+
+        h = fnv1a(h, list[i], strlen(list[i]) + 1);
+        h = fnv1a(h, &st.st_size, sizeof(st.st_size));
+        h = fnv1a(h, &st.st_mtim, sizeof(st.st_mtim));
+    }
+
+    *names = list;
+    *count = n;
+    *stamp = h;
+    return 0;
+}
+
+/**
+ * Load the binary cache if it matches stamp
+ *
+ * @return 0 with *out allocated, negative errno if missing or stale
+ */
+static int read_cache(const char *path, uint64_t stamp,
+                      dsv4l2_device_profile_t **out, size_t *count)
+{
+    profile_cache_header_t hdr;
+    dsv4l2_device_profile_t *profiles;
+    size_t i;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (!fp) {
+        return -errno;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+        hdr.magic != PROFILE_CACHE_MAGIC || hdr.version != PROFILE_CACHE_VERSION ||
+        hdr.profile_size != sizeof(dsv4l2_device_profile_t) || hdr.stamp != stamp) {
+        fclose(fp);
+        return -ESTALE;
+    }
+
+    profiles = calloc(hdr.count ? hdr.count : 1, sizeof(*profiles));
+    if (!profiles) {
+        fclose(fp);
+        return -ENOMEM;
+    }
+    if (fread(profiles, sizeof(*profiles), hdr.count, fp) != hdr.count) {
+        free(profiles);
+        fclose(fp);
+        return -ESTALE;
+    }
+    fclose(fp);
+
+    /* Never trust string termination from disk */
+    for (i = 0; i < hdr.count; i++) {
+        dsv4l2_device_profile_t *p = &profiles[i];
+
+        p->id[sizeof(p->id) - 1] = '\0';
+        p->vendor[sizeof(p->vendor) - 1] = '\0';
+        p->model[sizeof(p->model) - 1] = '\0';
+        p->role[sizeof(p->role) - 1] = '\0';
+        p->classification[sizeof(p->classification) - 1] = '\0';
+        p->pixel_format[sizeof(p->pixel_format) - 1] = '\0';
+        p->filename[sizeof(p->filename) - 1] = '\0';
+    }
+
+    *out = profiles;
+    *count = hdr.count;
+    return 0;
+}
+
+/**
+ * Write the binary cache (temporary file + rename, so readers never see
+ * a partial cache)
+ */
+static int write_cache(const char *path, uint64_t stamp,
+                       const dsv4l2_device_profile_t *profiles, size_t count)
+{
+    profile_cache_header_t hdr;
+    char tmp[PATH_MAX + 32];
+    FILE *fp;
+    int ok;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = PROFILE_CACHE_MAGIC;
+    hdr.version = PROFILE_CACHE_VERSION;
+    hdr.profile_size = sizeof(dsv4l2_device_profile_t);
+    hdr.count = (uint32_t)count;
+    hdr.stamp = stamp;
+
+    snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+    fp = fopen(tmp, "wb");
+    if (!fp) {
+        return -errno;
+    }
+
+    ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+         fwrite(profiles, sizeof(*profiles), count, fp) == count;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp, path) < 0) {
+        unlink(tmp);
+        return -EIO;
+    }
+
+    return 0;
+}
+
+/**
+ * Build a snapshot of the store directory (store.lock held)
+ *
+ * A missing directory yields an empty snapshot, matching the old
+ * behaviour of running without profiles.
+ */
+static profile_set_t *load_set(void)
+{
+    dsv4l2_device_profile_t *profiles = NULL;
+    profile_set_t *set;
+    char **names = NULL;
+    size_t name_count = 0, count = 0, i;
+    uint64_t stamp = 0;
+
+    if (store.dir[0] &&
+        list_sources(store.dir, &names, &name_count, &stamp) == 0 &&
+        !(store.cache[0] && read_cache(store.cache, stamp, &profiles, &count) == 0)) {
+        profiles = calloc(name_count ? name_count : 1, sizeof(*profiles));
+
+        for (i = 0; profiles && i < name_count; i++) {
+            char path[PATH_MAX + 256];
+
+            snprintf(path, sizeof(path), "%s/%s", store.dir, names[i]);
+            if (load_profile_file(path, &profiles[count]) == 0) {
+                strncpy(profiles[count].filename, names[i],
+                        sizeof(profiles[count].filename) - 1);
+                count++;
+            }
         }
+
+        if (profiles && store.cache[0]) {
+            write_cache(store.cache, stamp, profiles, count);
+        }
+    }
+
+    for (i = 0; i < name_count; i++) {
+        free(names[i]);
     }
+    free(names);
+
+    set = build_set(profiles, count);
+    free(profiles);
+
+    return set;
+}
+
+/**
+ * Publish a snapshot and retire the previous one (store.lock held)
+ */
+static void publish_set(profile_set_t *set)
+{
+    profile_set_t *old = store.current;
+
+    __atomic_store_n(&store.current, set, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&store.generation, 1, __ATOMIC_RELEASE);
 
-    if (!dir) {
-        /* No profiles directory found */
-        g_profiles_loaded = 1;
+    if (old) {
+        old->retired_next = store.retired;
+        store.retired = old;
+    }
+}
+
+/**
+ * Pick the default directory and cache unless configured (store.lock held)
+ */
+static void init_defaults(void)
+{
+    const char *cache = getenv("DSV4L2_PROFILE_CACHE");
+
+    if (store.configured) {
         return;
     }
 
-    while ((entry = readdir(dir)) != NULL && g_profile_count < MAX_PROFILES) {
-        /* Only load .yaml files */
-        if (strstr(entry->d_name, ".yaml") == NULL) {
-            continue;
+    if (resolve_dir(NULL, store.dir) != 0) {
+        store.dir[0] = '\0';
+    }
+    snprintf(store.cache, sizeof(store.cache), "%s", cache ? cache : "");
+    store.configured = 1;
+}
+
+/**
+ * Current snapshot, loading the profiles on first use
+ */
+static const profile_set_t *current_set(void)
+{
+    profile_set_t *set = __atomic_load_n(&store.current, __ATOMIC_ACQUIRE);
+
+    if (!set) {
+        pthread_mutex_lock(&store.lock);
+        if (!store.current) {
+            init_defaults();
+            set = load_set();
+            if (set) {
+                publish_set(set);
+            }
+        }
+        set = store.current;
+        pthread_mutex_unlock(&store.lock);
+    }
+
+    return set;
+}
+
+/* ========================================================================
+ * Hot Reload
+ * ======================================================================== */
+
+/**
+ * Drain pending inotify events
+ *
+ * @return 1 if any concerned a profile file (or events were lost)
+ */
+static int drain_inotify(int fd)
+{
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int relevant = 0;
+    ssize_t n;
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        char *p = buf;
+
+        while (p < buf + n) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+
+            if ((ev->mask & IN_Q_OVERFLOW) ||
+                (ev->len > 0 && is_profile_name(ev->name))) {
+                relevant = 1;
+            }
+            p += sizeof(*ev) + ev->len;
         }
+    }
+
+    return relevant;
+}
 
-        snprintf(path, sizeof(path), "profiles/%s", entry->d_name);
+static void *watcher_thread(void *arg)
+{
+    struct pollfd pfd[2];
 
-        dsv4l2_device_profile_t profile;
-        if (load_profile_file(path, &profile) == 0) {
-            memcpy(&g_profiles[g_profile_count], &profile, sizeof(profile));
-            strncpy(g_profiles[g_profile_count].filename, entry->d_name,
-                    sizeof(g_profiles[g_profile_count].filename) - 1);
-            g_profile_count++;
+    (void)arg;
+
+    pfd[0].fd = store.inotify_fd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = store.wakefd;
+    pfd[1].events = POLLIN;
+
+    for (;;) {
+        int rc = poll(pfd, 2, -1);
+
+        if (rc < 0 && errno != EINTR) {
+            break;
+        }
+        if (pfd[1].revents) {
+            break;
+        }
+        if (rc <= 0 || !drain_inotify(store.inotify_fd)) {
+            continue;
+        }
+
+        /* Editors and package managers touch several files: wait for quiet */
+        while ((rc = poll(pfd, 2, PROFILE_SETTLE_MS)) > 0 && !pfd[1].revents) {
+            drain_inotify(store.inotify_fd);
         }
+        if (pfd[1].revents) {
+            break;
+        }
+
+        dsv4l2_profiles_reload();
     }
 
-    closedir(dir);
-    g_profiles_loaded = 1;
+    return NULL;
 }
 
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
 /**
  * Find a profile by device ID (USB VID:PID)
  *
@@ -104,23 +579,15 @@ static void load_all_profiles(void)
  */
 const dsv4l2_device_profile_t *dsv4l2_find_profile(const char *id)
 {
-    size_t i;
+    const profile_set_t *set;
 
     if (!id) {
         return NULL;
     }
 
-    /* Ensure profiles are loaded */
-    load_all_profiles();
-
-    /* Search for matching profile */
-    for (i = 0; i < g_profile_count; i++) {
-        if (strcmp(g_profiles[i].id, id) == 0) {
-            return &g_profiles[i];
-        }
-    }
-
-    return NULL;
+    set = current_set();
+    return set ? index_find(set, set->id_index, id,
+                            offsetof(dsv4l2_device_profile_t, id)) : NULL;
 }
 
 /**
@@ -131,23 +598,15 @@ const dsv4l2_device_profile_t *dsv4l2_find_profile(const char *id)
  */
 const dsv4l2_device_profile_t *dsv4l2_find_profile_by_role(const char *role)
 {
-    size_t i;
+    const profile_set_t *set;
 
     if (!role) {
         return NULL;
     }
 
-    /* Ensure profiles are loaded */
-    load_all_profiles();
-
-    /* Search for matching profile */
-    for (i = 0; i < g_profile_count; i++) {
-        if (strcmp(g_profiles[i].role, role) == 0) {
-            return &g_profiles[i];
-        }
-    }
-
-    return NULL;
+    set = current_set();
+    return set ? index_find(set, set->role_index, role,
+                            offsetof(dsv4l2_device_profile_t, role)) : NULL;
 }
 
 /**
@@ -155,8 +614,9 @@ const dsv4l2_device_profile_t *dsv4l2_find_profile_by_role(const char *role)
  */
 size_t dsv4l2_get_profile_count(void)
 {
-    load_all_profiles();
-    return g_profile_count;
+    const profile_set_t *set = current_set();
+
+    return set ? set->count : 0;
 }
 
 /**
@@ -164,13 +624,169 @@ size_t dsv4l2_get_profile_count(void)
  */
 const dsv4l2_device_profile_t *dsv4l2_get_profile(size_t index)
 {
-    load_all_profiles();
+    const profile_set_t *set = current_set();
 
-    if (index >= g_profile_count) {
+    if (!set || index >= set->count) {
         return NULL;
     }
 
-    return &g_profiles[index];
+    return &set->profiles[index];
+}
+
+/**
+ * Point the store at a directory and binary cache, and load it
+ */
+int dsv4l2_profiles_configure(const char *dir, const char *cache_path)
+{
+    char resolved[PATH_MAX];
+    int rc;
+
+    rc = resolve_dir(dir, resolved);
+    if (rc < 0) {
+        return rc;
+    }
+
+    /* A watcher on the old directory would reload the wrong one */
+    if (__atomic_load_n(&store.watching, __ATOMIC_ACQUIRE)) {
+        return -EBUSY;
+    }
+
+    pthread_mutex_lock(&store.lock);
+    init_defaults();
+    snprintf(store.dir, sizeof(store.dir), "%s", resolved);
+    if (cache_path) {
+        snprintf(store.cache, sizeof(store.cache), "%s", cache_path);
+    }
+    pthread_mutex_unlock(&store.lock);
+
+    return dsv4l2_profiles_reload();
+}
+
+/**
+ * Re-read the profile directory and swap the snapshot
+ */
+int dsv4l2_profiles_reload(void)
+{
+    profile_set_t *set;
+    int count;
+
+    pthread_mutex_lock(&store.lock);
+    init_defaults();
+    set = load_set();
+    if (!set) {
+        pthread_mutex_unlock(&store.lock);
+        return -ENOMEM;
+    }
+    count = (int)set->count;
+    publish_set(set);
+    pthread_mutex_unlock(&store.lock);
+
+    return count;
+}
+
+/**
+ * Reload automatically when profile files change
+ */
+int dsv4l2_profiles_watch(void)
+{
+    int rc = 0;
+
+    current_set();
+
+    pthread_mutex_lock(&store.lock);
+
+    if (store.watching) {
+        goto out;
+    }
+    if (!store.dir[0]) {
+        rc = -ENOENT;
+        goto out;
+    }
+
+    store.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (store.inotify_fd < 0) {
+        rc = -errno;
+        goto out;
+    }
+    if (inotify_add_watch(store.inotify_fd, store.dir,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        rc = -errno;
+        goto fail;
+    }
+
+    store.wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (store.wakefd < 0) {
+        rc = -errno;
+        goto fail;
+    }
+
+    rc = pthread_create(&store.watcher, NULL, watcher_thread, NULL);
+    if (rc != 0) {
+        rc = -rc;
+        goto fail;
+    }
+
+    __atomic_store_n(&store.watching, 1, __ATOMIC_RELEASE);
+    goto out;
+
+fail:
+    close(store.inotify_fd);
+    store.inotify_fd = -1;
+    if (store.wakefd >= 0) {
+        close(store.wakefd);
+        store.wakefd = -1;
+    }
+
+out:
+    pthread_mutex_unlock(&store.lock);
+    return rc;
+}
+
+/**
+ * Snapshots published so far
+ */
+uint32_t dsv4l2_profiles_generation(void)
+{
+    return __atomic_load_n(&store.generation, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Stop hot reload and free every snapshot
+ */
+void dsv4l2_profiles_shutdown(void)
+{
+    profile_set_t *set, *next;
+    uint64_t one = 1;
+
+    if (__atomic_exchange_n(&store.watching, 0, __ATOMIC_ACQ_REL)) {
+        if (write(store.wakefd, &one, sizeof(one)) < 0) {
+            /* Counter saturated: a wakeup is already pending */
+        }
+        pthread_join(store.watcher, NULL);
+        close(store.inotify_fd);
+        close(store.wakefd);
+        store.inotify_fd = -1;
+        store.wakefd = -1;
+    }
+
+    pthread_mutex_lock(&store.lock);
+    set = store.current;
+    __atomic_store_n(&store.current, NULL, __ATOMIC_RELEASE);
+    if (set) {
+        set->retired_next = store.retired;
+    } else {
+        set = store.retired;
+    }
+    store.retired = NULL;
+    store.dir[0] = '\0';
+    store.cache[0] = '\0';
+    store.configured = 0;
+    pthread_mutex_unlock(&store.lock);
+
+    for (; set; set = next) {
+        next = set->retired_next;
+        free(set);
+    }
 }
 
 /**
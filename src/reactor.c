@@ -0,0 +1,654 @@
+/*
+ * DSV4L2 Capture Reactor
+ *
+ * Services many video and metadata streams from one thread:
+ * - All stream fds share one level-triggered epoll set
+ * - Ready video buffers are drained and delivered as frame leases
+ * - TEMPEST control events (EPOLLPRI) are applied before any frame
+ *   is delivered, exactly as in the pull API
+ * - An eventfd wakes the loop for dsv4l2_reactor_stop()
+ *
+ * When every buffer of a device is leased (or streaming stops), vb2
+ * reports EPOLLERR until a buffer is queued again, so the device is
+ * parked (removed from the epoll set) and rearmed once a lease is
+ * released. This holds while capture is blocked by policy too.
+ */
+
+#define _GNU_SOURCE
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
+#include "dsv4l2_stream.h"
+#include "dsv4l2rt.h"
+#include "device_internal.h"
+
+#include <linux/videodev2.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REACTOR_MAX_EVENTS    32   /* epoll events per wait */
+#define REACTOR_PARK_POLL_MS  1    /* Wait cap while a device is parked */
+#define REACTOR_DRAIN_MAX     64   /* Buffers drained per stream per wake */
+
+/* One epoll registration: a fd with its video and/or metadata stream */
+typedef struct {
+    int fd;
+    int armed;                          /* 1 while in the epoll set */
+    int parked;                         /* 1 while parked on leases */
+
+    dsv4l2_device_t *dev;               /* Video stream (NULL if none) */
+    dsv4l2_frame_cb frame_cb;
+    void *frame_user;
+
+    dsv4l2_metadata_capture_t *meta;    /* Metadata stream (NULL if none) */
+    dsv4l2_meta_cb meta_cb;
+    void *meta_user;
+} reactor_entry_t;
+
+struct dsv4l2_reactor {
+    int epfd;
+    int wakefd;                         /* eventfd for stop */
+    int stop;                           /* Stop requested (atomic) */
+
+    reactor_entry_t **entries;
+    size_t entry_count;
+    size_t entry_capacity;
+    size_t parked;                      /* Entries removed from epoll */
+};
+
+/**
+ * Switch a fd to non-blocking mode
+ */
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/**
+ * Find the registration for a fd
+ */
+static reactor_entry_t *find_entry(dsv4l2_reactor_t *reactor, int fd)
+{
+    size_t i;
+
+    for (i = 0; i < reactor->entry_count; i++) {
+        if (reactor->entries[i]->fd == fd) {
+            return reactor->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Events to wait for on a registration
+ */
+static uint32_t entry_events(const reactor_entry_t *entry)
+{
+    uint32_t events = EPOLLIN;
+
+    if (entry->dev && dsv4l2_get_internal(entry->dev)->tempest_subscribed) {
+        events |= EPOLLPRI;
+    }
+
+    return events;
+}
+
+/**
+ * Put a registration in the epoll set (or update its events)
+ */
+static int arm_entry(dsv4l2_reactor_t *reactor, reactor_entry_t *entry)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = entry_events(entry);
+    ev.data.ptr = entry;
+
+    if (epoll_ctl(reactor->epfd, entry->armed ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  entry->fd, &ev) < 0) {
+        return -errno;
+    }
+
+    entry->armed = 1;
+    return 0;
+}
+
+/**
+ * Take a registration out of the epoll set until its leases drop
+ */
+static void park_entry(dsv4l2_reactor_t *reactor, reactor_entry_t *entry)
+{
+    if (entry->armed) {
+        epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, entry->fd, NULL);
+        entry->armed = 0;
+        entry->parked = 1;
+        reactor->parked++;
+    }
+}
+
+/**
+ * Rearm parked devices that have a free buffer again
+ */
+static void rearm_parked(dsv4l2_reactor_t *reactor)
+{
+    size_t i;
+
+    for (i = 0; i < reactor->entry_count && reactor->parked > 0; i++) {
+        reactor_entry_t *entry = reactor->entries[i];
+        dsv4l2_device_internal_t *internal;
+
+        if (!entry->parked) {
+            continue;
+        }
+
+        internal = dsv4l2_get_internal(entry->dev);
+        if (internal->streaming &&
+            dsv4l2_buffer_available(internal) > 0 &&
+            arm_entry(reactor, entry) == 0) {
+            entry->parked = 0;
+            reactor->parked--;
+        }
+    }
+}
+
+/**
+ * Get or create the registration for a fd
+ */
+static reactor_entry_t *get_entry(dsv4l2_reactor_t *reactor, int fd, int *created)
+{
+    reactor_entry_t *entry = find_entry(reactor, fd);
+
+    *created = 0;
+    if (entry) {
+        return entry;
+    }
+
+    if (reactor->entry_count == reactor->entry_capacity) {
+        size_t capacity = reactor->entry_capacity ? reactor->entry_capacity * 2 : 8;
+        reactor_entry_t **entries = realloc(reactor->entries, capacity * sizeof(*entries));
+
+        if (!entries) {
+            return NULL;
+        }
+        reactor->entries = entries;
+        reactor->entry_capacity = capacity;
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
+        return NULL;
+    }
+
+    entry->fd = fd;
+    reactor->entries[reactor->entry_count++] = entry;
+    *created = 1;
+    return entry;
+}
+
+/**
+ * Drop a registration once it has no streams left
+ */
+static void put_entry(dsv4l2_reactor_t *reactor, reactor_entry_t *entry)
+{
+    size_t i;
+
+    if (entry->dev || entry->meta) {
+        return;
+    }
+
+    if (entry->armed) {
+        epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, entry->fd, NULL);
+    }
+    if (entry->parked) {
+        reactor->parked--;
+    }
+
+    for (i = 0; i < reactor->entry_count; i++) {
+        if (reactor->entries[i] == entry) {
+            reactor->entries[i] = reactor->entries[--reactor->entry_count];
+            break;
+        }
+    }
+
+    free(entry);
+}
+
+/**
+ * Create a capture reactor
+ */
+int dsv4l2_reactor_create(dsv4l2_reactor_t **out)
+{
+    dsv4l2_reactor_t *reactor;
+    struct epoll_event ev;
+    int rc;
+
+    if (!out) {
+        return -EINVAL;
+    }
+
+    reactor = calloc(1, sizeof(*reactor));
+    if (!reactor) {
+        return -ENOMEM;
+    }
+
+    reactor->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epfd < 0) {
+        rc = -errno;
+        free(reactor);
+        return rc;
+    }
+
+    reactor->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wakefd < 0) {
+        rc = -errno;
+        close(reactor->epfd);
+        free(reactor);
+        return rc;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;  /* NULL marks the wake fd */
+    if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, reactor->wakefd, &ev) < 0) {
+        rc = -errno;
+        close(reactor->wakefd);
+        close(reactor->epfd);
+        free(reactor);
+        return rc;
+    }
+
+    *out = reactor;
+    return 0;
+}
+
+/**
+ * Destroy a reactor
+ */
+void dsv4l2_reactor_destroy(dsv4l2_reactor_t *reactor)
+{
+    size_t i;
+
+    if (!reactor) {
+        return;
+    }
+
+    for (i = 0; i < reactor->entry_count; i++) {
+        free(reactor->entries[i]);
+    }
+    free(reactor->entries);
+
+    close(reactor->wakefd);
+    close(reactor->epfd);
+    free(reactor);
+}
+
+/**
+ * Register a video device
+ */
+int dsv4l2_reactor_add_device(dsv4l2_reactor_t *reactor, dsv4l2_device_t *dev,
+                              dsv4l2_frame_cb callback, void *user_data)
+{
+    dsv4l2_device_internal_t *internal;
+    reactor_entry_t *entry;
+    int created;
+    int rc;
+
+    if (!reactor || !dev || !callback) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+    if (internal->buffer_count == 0) {
+        return -EINVAL;
+    }
+
+    entry = find_entry(reactor, dev->fd);
+    if (entry && entry->dev) {
+        return -EEXIST;
+    }
+
+    rc = set_nonblocking(dev->fd);
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (!internal->streaming) {
+        rc = dsv4l2_start_streaming(dev);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    entry = get_entry(reactor, dev->fd, &created);
+    if (!entry) {
+        return -ENOMEM;
+    }
+
+    entry->dev = dev;
+    entry->frame_cb = callback;
+    entry->frame_user = user_data;
+
+    rc = arm_entry(reactor, entry);
+    if (rc < 0) {
+        entry->dev = NULL;
+        put_entry(reactor, entry);
+        return rc;
+    }
+
+    return 0;
+}
+
+/**
+ * Register a metadata stream
+ */
+int dsv4l2_reactor_add_metadata(dsv4l2_reactor_t *reactor,
+                                dsv4l2_metadata_capture_t *meta_cap,
+                                dsv4l2_meta_cb callback, void *user_data)
+{
+    reactor_entry_t *entry;
+    int fd;
+    int created;
+    int rc;
+
+    if (!reactor || !meta_cap || !callback) {
+        return -EINVAL;
+    }
+
+    fd = dsv4l2_metadata_fd(meta_cap);
+
+    entry = find_entry(reactor, fd);
+    if (entry && entry->meta) {
+        return -EEXIST;
+    }
+
+    rc = set_nonblocking(fd);
+    if (rc < 0) {
+        return rc;
+    }
+
+    entry = get_entry(reactor, fd, &created);
+    if (!entry) {
+        return -ENOMEM;
+    }
+
+    entry->meta = meta_cap;
+    entry->meta_cb = callback;
+    entry->meta_user = user_data;
+
+    if (created) {
+        rc = arm_entry(reactor, entry);
+        if (rc < 0) {
+            entry->meta = NULL;
+            put_entry(reactor, entry);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Unregister a video device
+ */
+int dsv4l2_reactor_remove_device(dsv4l2_reactor_t *reactor, dsv4l2_device_t *dev)
+{
+    reactor_entry_t *entry;
+
+    if (!reactor || !dev) {
+        return -EINVAL;
+    }
+
+    entry = find_entry(reactor, dev->fd);
+    if (!entry || entry->dev != dev) {
+        return -ENOENT;
+    }
+
+    entry->dev = NULL;
+    if (entry->meta) {
+        /* Drop EPOLLPRI; a shared fd parked on video leases resumes */
+        if (arm_entry(reactor, entry) == 0 && entry->parked) {
+            entry->parked = 0;
+            reactor->parked--;
+        }
+    }
+    put_entry(reactor, entry);
+    return 0;
+}
+
+/**
+ * Unregister a metadata stream
+ */
+int dsv4l2_reactor_remove_metadata(dsv4l2_reactor_t *reactor,
+                                   dsv4l2_metadata_capture_t *meta_cap)
+{
+    reactor_entry_t *entry;
+
+    if (!reactor || !meta_cap) {
+        return -EINVAL;
+    }
+
+    entry = find_entry(reactor, dsv4l2_metadata_fd(meta_cap));
+    if (!entry || entry->meta != meta_cap) {
+        return -ENOENT;
+    }
+
+    entry->meta = NULL;
+    put_entry(reactor, entry);
+    return 0;
+}
+
+/**
+ * Deliver every ready frame of a device
+ *
+ * The TEMPEST gate runs once per wake. Pending control events are
+ * applied first, so a LOCKDOWN queued before the frames became ready
+ * blocks their delivery (they are requeued, not leased).
+ *
+ * @return Number of frames delivered
+ */
+DSMIL_REQUIRES_TEMPEST_CHECK
+static int dispatch_video(dsv4l2_reactor_t *reactor, reactor_entry_t *entry,
+                          uint32_t events)
+{
+    dsv4l2_device_t *dev = entry->dev;
+    dsv4l2_device_internal_t *internal = dsv4l2_get_internal(dev);
+    struct v4l2_buffer buf;
+    dsv4l2_frame_t frame;
+    int delivered = 0;
+
+    /* Streaming stopped behind our back: vb2 reports EPOLLERR until restart */
+    if (!internal->streaming) {
+        park_entry(reactor, entry);
+        return 0;
+    }
+
+    if (events & EPOLLPRI) {
+        dsv4l2_tempest_dequeue_events(internal);
+    }
+
+    /* CRITICAL: TEMPEST state check (REQUIRED by DSLLVM) */
+    dsv4l2_tempest_state_t state = dsv4l2_get_tempest_state(dev);
+    if (dsv4l2_policy_capture_check(internal, state, "reactor") != 0) {
+        /*
+         * Nothing to hand back while every buffer is leased, and vb2
+         * keeps the fd ready: park instead of waking on every wait
+         */
+        if (dsv4l2_buffer_available(internal) == 0) {
+            park_entry(reactor, entry);
+            return 0;
+        }
+
+        if (events & EPOLLIN) {
+            dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                                 DSV4L2_SEV_CRITICAL, state);
+
+            /* Hand blocked frames straight back to the driver */
+            while (dsv4l2_dequeue_buffer(dev, &buf) == 0) {
+                dsv4l2_queue_buffer(dev, buf.index);
+            }
+        }
+        return 0;
+    }
+
+    while (delivered < REACTOR_DRAIN_MAX) {
+        if (dsv4l2_buffer_available(internal) == 0) {
+            park_entry(reactor, entry);
+            break;
+        }
+
+        if (dsv4l2_dequeue_buffer(dev, &buf) < 0) {
+            break;  /* EAGAIN: drained */
+        }
+
+        dsv4l2_buffer_lease(internal, &buf, &frame);
+        entry->frame_cb(dev, &frame, entry->frame_user);
+        delivered++;
+    }
+
+    if (delivered > 0) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_FRAME_ACQUIRED,
+                             DSV4L2_SEV_INFO, (uint32_t)delivered);
+    }
+
+    return delivered;
+}
+
+/**
+ * Deliver every ready metadata buffer of a stream
+ *
+ * @return Number of buffers delivered
+ */
+static int dispatch_metadata(reactor_entry_t *entry)
+{
+    dsv4l2_metadata_t meta;
+    int delivered = 0;
+
+    while (delivered < REACTOR_DRAIN_MAX &&
+           dsv4l2_capture_metadata(entry->meta, &meta) == 0) {
+        entry->meta_cb(entry->meta, &meta, entry->meta_user);
+        delivered++;
+    }
+
+    return delivered;
+}
+
+/**
+ * Run one reactor iteration
+ */
+int dsv4l2_reactor_poll(dsv4l2_reactor_t *reactor, int timeout_ms)
+{
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    int delivered = 0;
+    int n, i;
+
+    if (!reactor) {
+        return -EINVAL;
+    }
+
+    if (__atomic_load_n(&reactor->stop, __ATOMIC_ACQUIRE)) {
+        return -ECANCELED;
+    }
+
+    rearm_parked(reactor);
+
+    /* Parked devices are only rearmed here: bound the wait */
+    if (reactor->parked > 0 &&
+        (timeout_ms < 0 || timeout_ms > REACTOR_PARK_POLL_MS)) {
+        timeout_ms = REACTOR_PARK_POLL_MS;
+    }
+
+    n = epoll_wait(reactor->epfd, events, REACTOR_MAX_EVENTS, timeout_ms);
+    if (n < 0) {
+        return errno == EINTR ? 0 : -errno;
+    }
+
+    for (i = 0; i < n; i++) {
+        reactor_entry_t *entry = events[i].data.ptr;
+
+        if (!entry) {
+            /* Stop request (the wake fd is drained by dsv4l2_reactor_run) */
+            return -ECANCELED;
+        }
+
+        if (entry->dev) {
+            delivered += dispatch_video(reactor, entry, events[i].events);
+        }
+        if (entry->meta && (events[i].events & (EPOLLIN | EPOLLERR))) {
+            delivered += dispatch_metadata(entry);
+        }
+    }
+
+    return delivered;
+}
+
+/**
+ * Run the reactor until stopped
+ */
+int dsv4l2_reactor_run(dsv4l2_reactor_t *reactor, int cpu)
+{
+    int rc;
+
+    if (!reactor) {
+        return -EINVAL;
+    }
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            return -rc;
+        }
+    }
+
+    while ((rc = dsv4l2_reactor_poll(reactor, -1)) >= 0) {
+        /* Dispatch happens inside poll */
+    }
+
+    if (rc == -ECANCELED) {
+        uint64_t value;
+
+        /* Consume the stop request so the reactor can be run again */
+        if (read(reactor->wakefd, &value, sizeof(value)) < 0) {
+            /* Stop flagged before the wakeup was written */
+        }
+        __atomic_store_n(&reactor->stop, 0, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    return rc;
+}
+
+/**
+ * Stop a running reactor
+ */
+void dsv4l2_reactor_stop(dsv4l2_reactor_t *reactor)
+{
+    uint64_t one = 1;
+
+    if (!reactor) {
+        return;
+    }
+
+    __atomic_store_n(&reactor->stop, 1, __ATOMIC_RELEASE);
+    if (write(reactor->wakefd, &one, sizeof(one)) < 0) {
+        /* Counter saturated: a wakeup is already pending */
+    }
+}
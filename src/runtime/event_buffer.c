@@ -1,37 +1,106 @@
 /*
  * DSV4L2 Runtime - Full Event Buffer Implementation
  *
- * Ring buffer event system with multiple sinks (file, Redis, SQLite),
- * TPM signing for integrity, and telemetry aggregation.
+ * Lock-free ring buffer event system with multiple sinks (file, Redis,
+ * SQLite), TPM signing for integrity, and telemetry aggregation.
  */
 
+#define _GNU_SOURCE
 #include "dsv4l2rt.h"
+#include "event_log.h"
+#include "shm_ring.h"
+#include "string_table.h"
+#include "sha256.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 
 /* Ring buffer configuration */
-#define EVENT_BUFFER_SIZE 4096
+#define EVENT_BUFFER_SIZE     4096       /* Default capacity (events) */
+#define EVENT_BUFFER_MIN      16         /* Smallest ring we will build */
+#define EVENT_BUFFER_MAX      (1u << 24) /* Largest ring we will build */
+#define FLUSH_BATCH           256        /* Events per sink batch */
+#define FLUSH_INTERVAL_MS     1000       /* Idle flush period */
+#define MAX_SHARDS            256        /* Upper bound on per-CPU rings */
+#define AGG_INTERVAL_MS       1000       /* Default counter summary period */
 
-/* Event buffer (ring buffer) */
+#define CACHELINE_ALIGNED __attribute__((aligned(64)))
+
+/*
+ * Ring slot
+ *
+ * The sequence number tells producers and consumers who owns the slot:
+ * seq == pos       -> free for the producer claiming position pos
+ * seq == pos + 1   -> filled, ready for the consumer at position pos
+ *
+ * Events are stored compact (interned role/mission), so a slot is 32
+ * bytes and two share a cache line.
+ */
+typedef struct {
+    uint64_t                 seq;
+    dsv4l2rt_compact_event_t ev;
+} ring_slot_t;
+
+/*
+ * Event buffer (bounded lock-free MPMC ring)
+ *
+ * Producers (any emitting thread) claim a slot with one CAS on head;
+ * consumers (flush thread, explicit flush, drop-oldest) claim with one CAS
+ * on tail. No lock is taken on the emit path. The flush thread is only
+ * woken when the fill level crosses the watermark.
+ *
+ * In sharded mode there is one ring per CPU, so producers on different
+ * cores never touch the same cache lines.
+ */
 typedef struct {
-    dsv4l2_event_t  *events;       /* Event array */
-    size_t           capacity;      /* Buffer capacity */
-    size_t           head;          /* Write position */
-    size_t           tail;          /* Read position */
-    size_t           count;         /* Current count */
-    pthread_mutex_t  lock;          /* Buffer lock */
-    pthread_cond_t   cond;          /* Condition for flush thread */
+    ring_slot_t     *slots;                    /* Slot array */
+    size_t           capacity;                 /* Buffer capacity (power of 2) */
+    size_t           mask;                     /* capacity - 1 */
+    size_t           watermark;                /* Fill level that wakes flush */
+
+    uint64_t         head CACHELINE_ALIGNED;   /* Next enqueue position */
+    uint64_t         tail CACHELINE_ALIGNED;   /* Next dequeue position */
+    uint64_t         dropped CACHELINE_ALIGNED; /* Events dropped from this ring */
 } event_buffer_t;
 
-/* Event sink */
+/* Per-shard staging for the k-way merge (consumer side only) */
+typedef struct {
+    dsv4l2rt_compact_event_t *events;          /* FLUSH_BATCH events */
+    size_t           pos;                      /* Next event to merge */
+    size_t           len;                      /* Valid events */
+} shard_stage_t;
+
+/*
+ * In-place counter for one (device, event type) pair
+ *
+ * key is claimed once with a CAS and never released, so emitters only
+ * ever add to count/aux_sum; the summarizer swaps them back to zero.
+ * role/layer are filled in by the claiming thread before ready is set.
+ */
+typedef struct {
+    uint64_t         key;                      /* dev_id << 16 | type, 0 = free */
+    uint64_t         count;
+    uint64_t         aux_sum;
+    uint64_t         first_ts_ns;              /* 0 = no event in this window */
+    uint64_t         last_ts_ns;
+    uint32_t         layer;
+    int              ready;
+    char             role[16];
+} CACHELINE_ALIGNED agg_counter_t;
+
+/* Event sink (expanded callback, or compact + string callbacks) */
 typedef struct event_sink {
     dsv4l2rt_sink_fn     callback;
+    dsv4l2rt_compact_sink_fn compact;
+    dsv4l2rt_string_fn   strings;
+    uint16_t             strings_sent;  /* Interned strings announced so far */
+    dsv4l2rt_sink_close_fn close;       /* Called at shutdown (may be NULL) */
     void                *user_data;
     struct event_sink   *next;
 } event_sink_t;
@@ -40,7 +109,6 @@ typedef struct event_sink {
 static struct {
     int                  initialized;
     dsv4l2_profile_t     profile;
-    event_buffer_t       buffer;
     event_sink_t        *sinks;
     pthread_mutex_t      sink_lock;
 
@@ -49,75 +117,272 @@ static struct {
     uint64_t             events_dropped;
     uint64_t             events_flushed;
 
+    /* Event rings */
+    event_buffer_t      *shards;        /* One ring, or one per CPU */
+    size_t               shard_count;
+    shard_stage_t       *stages;        /* Merge staging (sharded mode) */
+    size_t              *heap;          /* Merge min-heap of shard indices */
+    pthread_mutex_t      drain_lock;    /* Serializes merging consumers */
+
     /* Flush thread */
     pthread_t            flush_thread;
     int                  flush_running;
+    int                  wake_pending;  /* Watermark wakeup posted */
+    pthread_mutex_t      flush_lock;    /* Flush thread wait lock */
+    pthread_cond_t       flush_cond;    /* Condition for flush thread */
 
     /* TPM signing */
     int                  tpm_enabled;
     uint32_t             chunk_sequence;
 
-    /* File sink */
-    int                  file_sink_fd;
-    char                 file_sink_path[256];
+    /* File sink (chunked log, see event_log.h) */
+    dsv4l2rt_log_writer_t *file_log;
+    uint64_t             file_chunk_sequence;
+
+    /* Shared-memory ring for external monitors (see shm_ring.h) */
+    dsv4l2rt_shm_writer_t *shm;
+
+    /* Counter aggregation (OPS, see dsv4l2rt.h) */
+    agg_counter_t       *agg;           /* DSV4L2RT_AGGREGATE_SLOTS counters */
+    uint32_t             agg_below;     /* Severities below this are counted */
+    uint32_t             agg_interval_ms;
+    uint64_t             agg_last_ns;   /* Last summary (flush thread) */
+    uint64_t             events_aggregated;
+    pthread_mutex_t      agg_lock;      /* Serializes summarizers */
 } runtime = {
     .initialized = 0,
     .profile = DSV4L2_PROFILE_OFF,
-    .file_sink_fd = -1,
+};
+
+/* Inline fast-path filter (see dsv4l2rt.h) */
+dsv4l2rt_filter_t dsv4l2rt_filter = {
+    .state = DSV4L2RT_FILTER_UNINIT,
+    .min_severity = DSV4L2_SEV_DEBUG,
+    .event_mask = DSV4L2RT_EVENT_MASK_ALL,
 };
 
 /* Forward declarations */
 static void *flush_thread_fn(void *arg);
-static int emit_to_sinks(const dsv4l2_event_t *events, size_t count);
+static int emit_to_sinks(const dsv4l2rt_compact_event_t *compact,
+                         dsv4l2_event_t *events, size_t count, int expanded,
+                         const uint8_t *events_digest);
+
+/**
+ * Round a requested ring size to a usable power of two
+ */
+static size_t ring_capacity(size_t requested)
+{
+    size_t cap = EVENT_BUFFER_MIN;
+
+    if (requested == 0) {
+        return EVENT_BUFFER_SIZE;
+    }
+    if (requested > EVENT_BUFFER_MAX) {
+        return EVENT_BUFFER_MAX;
+    }
+
+    while (cap < requested) {
+        cap <<= 1;
+    }
+
+    return cap;
+}
 
 /**
  * Initialize event buffer
  */
-static int init_event_buffer(event_buffer_t *buf, size_t capacity)
+static int init_event_buffer(event_buffer_t *buf, size_t capacity,
+                             size_t watermark)
 {
-    buf->events = calloc(capacity, sizeof(dsv4l2_event_t));
-    if (!buf->events) {
+    size_t i;
+
+    buf->slots = calloc(capacity, sizeof(ring_slot_t));
+    if (!buf->slots) {
         return -ENOMEM;
     }
 
+    for (i = 0; i < capacity; i++) {
+        buf->slots[i].seq = i;
+    }
+
     buf->capacity = capacity;
+    buf->mask = capacity - 1;
+    buf->watermark = (watermark == 0 || watermark > capacity) ?
+                     capacity / 4 : watermark;
     buf->head = 0;
     buf->tail = 0;
-    buf->count = 0;
-
-    pthread_mutex_init(&buf->lock, NULL);
-    pthread_cond_init(&buf->cond, NULL);
+    buf->dropped = 0;
 
     return 0;
 }
 
+/**
+ * Number of events currently buffered (approximate under concurrency)
+ */
+static size_t buffer_count(event_buffer_t *buf)
+{
+    uint64_t tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+    uint64_t head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+    uint64_t used = head > tail ? head - tail : 0;
+
+    return used > buf->capacity ? buf->capacity : (size_t)used;
+}
+
+/**
+ * Dequeue one event (any thread)
+ *
+ * @return 1 if an event was dequeued, 0 if the ring is empty
+ */
+static int buffer_pop(event_buffer_t *buf, dsv4l2rt_compact_event_t *out)
+{
+    uint64_t pos = __atomic_load_n(&buf->tail, __ATOMIC_RELAXED);
+    ring_slot_t *slot;
+
+    for (;;) {
+        slot = &buf->slots[pos & buf->mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - (pos + 1));
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&buf->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;  /* Empty (or producer still writing this slot) */
+        } else {
+            pos = __atomic_load_n(&buf->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (out) {
+        memcpy(out, &slot->ev, sizeof(*out));
+    }
+
+    /* Hand the slot back to producers one lap ahead */
+    __atomic_store_n(&slot->seq, pos + buf->capacity, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+ * Wake the flush thread (at most one pending wakeup)
+ */
+static void buffer_wake(void)
+{
+    if (__atomic_exchange_n(&runtime.wake_pending, 1, __ATOMIC_ACQ_REL)) {
+        return;  /* Already signalled, flush thread will drain */
+    }
+
+    pthread_mutex_lock(&runtime.flush_lock);
+    pthread_cond_signal(&runtime.flush_cond);
+    pthread_mutex_unlock(&runtime.flush_lock);
+}
+
+/*
+ * Last role/mission interned by this thread
+ *
+ * A producer thread usually serves one device under one mission, so the
+ * fields repeat from event to event; comparing them with the previous
+ * event's skips the hash and probe. The table never reuses IDs, so an
+ * entry stays valid across runtime restarts. All-zero fields map to
+ * DSV4L2RT_STRING_EMPTY (0), which the zeroed cache already holds.
+ */
+static __thread struct {
+    char     role[sizeof(((dsv4l2_event_t *)0)->role)];
+    char     mission[sizeof(((dsv4l2_event_t *)0)->mission)];
+    uint16_t role_id;
+    uint16_t mission_id;
+} intern_cache;
+
+/**
+ * Encode an event in the compact layout (interns role and mission)
+ */
+static void compact_event(const dsv4l2_event_t *ev, dsv4l2rt_compact_event_t *out)
+{
+    out->ts_ns = ev->ts_ns;
+    out->dev_id = ev->dev_id;
+    out->event_type = ev->event_type;
+    out->severity = (uint8_t)ev->severity;
+    out->layer = (uint8_t)ev->layer;
+    out->aux = ev->aux;
+
+    if (memcmp(intern_cache.role, ev->role, sizeof(ev->role)) != 0) {
+        intern_cache.role_id = dsv4l2rt_strtab_intern(ev->role, sizeof(ev->role));
+        memcpy(intern_cache.role, ev->role, sizeof(ev->role));
+    }
+    if (memcmp(intern_cache.mission, ev->mission, sizeof(ev->mission)) != 0) {
+        intern_cache.mission_id = dsv4l2rt_strtab_intern(ev->mission, sizeof(ev->mission));
+        memcpy(intern_cache.mission, ev->mission, sizeof(ev->mission));
+    }
+    out->role_id = intern_cache.role_id;
+    out->mission_id = intern_cache.mission_id;
+}
+
+/**
+ * Expand a batch, feeding each expanded event to hash if set
+ */
+static void expand_events(const dsv4l2rt_compact_event_t *in, size_t count,
+                          dsv4l2_event_t *out, dsv4l2_sha256_t *hash)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        dsv4l2rt_event_expand(&in[i], &out[i]);
+        if (hash) {
+            dsv4l2_sha256_update(hash, &out[i], sizeof(out[i]));
+        }
+    }
+}
+
 /**
  * Add event to ring buffer
+ *
+ * Lock-free. When the ring is full the oldest event is dropped to make
+ * room, so the newest telemetry always wins.
  */
 static int buffer_add_event(event_buffer_t *buf, const dsv4l2_event_t *ev)
 {
+    uint64_t pos = __atomic_load_n(&buf->head, __ATOMIC_RELAXED);
+    dsv4l2rt_compact_event_t compact;
+    ring_slot_t *slot;
     int dropped = 0;
 
-    pthread_mutex_lock(&buf->lock);
+    /* Intern before claiming, so the slot is only held for a 24-byte copy */
+    compact_event(ev, &compact);
 
-    /* Check if buffer is full */
-    if (buf->count >= buf->capacity) {
-        /* Drop oldest event (advance tail) */
-        buf->tail = (buf->tail + 1) % buf->capacity;
-        buf->count--;
-        dropped = 1;
-        runtime.events_dropped++;
-    }
+    for (;;) {
+        slot = &buf->slots[pos & buf->mask];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
 
-    /* Add event to head */
-    memcpy(&buf->events[buf->head], ev, sizeof(dsv4l2_event_t));
-    buf->head = (buf->head + 1) % buf->capacity;
-    buf->count++;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&buf->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* Full: drop oldest event (advance tail) */
+            if (buffer_pop(buf, NULL)) {
+                __sync_fetch_and_add(&buf->dropped, 1);
+                __sync_fetch_and_add(&runtime.events_dropped, 1);
+                dropped = 1;
+            }
+            pos = __atomic_load_n(&buf->head, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&buf->head, __ATOMIC_RELAXED);
+        }
+    }
 
-    /* Signal flush thread */
-    pthread_cond_signal(&buf->cond);
+    memcpy(&slot->ev, &compact, sizeof(compact));
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
 
-    pthread_mutex_unlock(&buf->lock);
+    /* Signal flush thread once the watermark is reached */
+    if (pos + 1 - __atomic_load_n(&buf->tail, __ATOMIC_RELAXED) >=
+        buf->watermark) {
+        buffer_wake();
+    }
 
     return dropped ? -EOVERFLOW : 0;
 }
@@ -125,91 +390,601 @@ static int buffer_add_event(event_buffer_t *buf, const dsv4l2_event_t *ev)
 /**
  * Get events from buffer
  */
-static size_t buffer_get_events(event_buffer_t *buf, dsv4l2_event_t *out, size_t max_count)
+static size_t buffer_get_events(event_buffer_t *buf, dsv4l2rt_compact_event_t *out,
+                                size_t max_count)
 {
-    size_t i, count;
+    size_t count = 0;
 
-    pthread_mutex_lock(&buf->lock);
+    while (count < max_count && buffer_pop(buf, &out[count])) {
+        count++;
+    }
 
-    count = (buf->count < max_count) ? buf->count : max_count;
+    return count;
+}
 
-    for (i = 0; i < count; i++) {
-        memcpy(&out[i], &buf->events[buf->tail], sizeof(dsv4l2_event_t));
-        buf->tail = (buf->tail + 1) % buf->capacity;
+/**
+ * Pick the ring for the calling thread
+ *
+ * Uses the current CPU so concurrent producers land on different rings.
+ * Threads that cannot query their CPU get a stable round-robin slot.
+ */
+static event_buffer_t *select_shard(void)
+{
+    static __thread int thread_slot = -1;
+    static unsigned int next_slot;
+    int cpu;
+
+    if (runtime.shard_count == 1) {
+        return &runtime.shards[0];
+    }
+
+    cpu = sched_getcpu();
+    if (cpu < 0) {
+        if (thread_slot < 0) {
+            thread_slot = (int)(__sync_fetch_and_add(&next_slot, 1) & 0x7fffffff);
+        }
+        cpu = thread_slot;
+    }
+
+    return &runtime.shards[(size_t)cpu % runtime.shard_count];
+}
+
+/**
+ * Refill a shard's merge stage from its ring
+ *
+ * @return Number of staged events
+ */
+static size_t stage_refill(size_t shard)
+{
+    shard_stage_t *st = &runtime.stages[shard];
+
+    st->pos = 0;
+    st->len = buffer_get_events(&runtime.shards[shard], st->events, FLUSH_BATCH);
+    return st->len;
+}
+
+/**
+ * Timestamp of the next staged event of a shard
+ */
+static uint64_t stage_head_ts(size_t shard)
+{
+    const shard_stage_t *st = &runtime.stages[shard];
+
+    return st->events[st->pos].ts_ns;
+}
+
+/**
+ * Restore the min-heap property below index i
+ */
+static void heap_sift_down(size_t *heap, size_t n, size_t i)
+{
+    for (;;) {
+        size_t l = 2 * i + 1;
+        size_t r = l + 1;
+        size_t min = i;
+
+        if (l < n && stage_head_ts(heap[l]) < stage_head_ts(heap[min])) {
+            min = l;
+        }
+        if (r < n && stage_head_ts(heap[r]) < stage_head_ts(heap[min])) {
+            min = r;
+        }
+        if (min == i) {
+            return;
+        }
+
+        size_t tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
     }
+}
+
+/**
+ * Get events from all shards in timestamp order
+ *
+ * Each shard is already ordered, so a k-way merge over the shard heads
+ * yields an ordered batch. Events staged but not emitted stay in the
+ * stage for the next call.
+ */
+static size_t merged_get_events(dsv4l2rt_compact_event_t *out, size_t max_count)
+{
+    size_t *heap = runtime.heap;
+    size_t n = 0;
+    size_t count = 0;
+    size_t i;
 
-    buf->count -= count;
+    if (runtime.shard_count == 1) {
+        return buffer_get_events(&runtime.shards[0], out, max_count);
+    }
 
-    pthread_mutex_unlock(&buf->lock);
+    pthread_mutex_lock(&runtime.drain_lock);
+
+    for (i = 0; i < runtime.shard_count; i++) {
+        shard_stage_t *st = &runtime.stages[i];
+
+        if (st->pos < st->len || stage_refill(i) > 0) {
+            heap[n++] = i;
+        }
+    }
+
+    for (i = n / 2; i-- > 0; ) {
+        heap_sift_down(heap, n, i);
+    }
+
+    while (count < max_count && n > 0) {
+        size_t shard = heap[0];
+        shard_stage_t *st = &runtime.stages[shard];
+
+        memcpy(&out[count++], &st->events[st->pos++], sizeof(*out));
+
+        if (st->pos == st->len && stage_refill(shard) == 0) {
+            heap[0] = heap[--n];
+        }
+        heap_sift_down(heap, n, 0);
+    }
+
+    pthread_mutex_unlock(&runtime.drain_lock);
 
     return count;
 }
 
+/**
+ * Events buffered for one shard, including staged ones
+ */
+static size_t shard_usage(size_t shard)
+{
+    size_t used = buffer_count(&runtime.shards[shard]);
+
+    if (runtime.shard_count > 1) {
+        const shard_stage_t *st = &runtime.stages[shard];
+        used += st->len - st->pos;
+    }
+
+    return used;
+}
+
+/**
+ * Hand one batch to the sinks
+ *
+ * events is expanded into (expanded = 0) or already holds the batch.
+ * With a hash-chained file sink the expanded events are hashed as they
+ * are produced, while still in cache, so chunk signing only has to
+ * finalize the digest.
+ */
+static void deliver_batch(const dsv4l2rt_compact_event_t *compact,
+                          dsv4l2_event_t *events, size_t count, int expanded)
+{
+    uint8_t digest[DSV4L2_SHA256_LEN];
+    dsv4l2_sha256_t hash;
+    int chained = runtime.tpm_enabled && runtime.file_log;
+
+    if (chained) {
+        dsv4l2_sha256_init(&hash);
+        if (expanded) {
+            dsv4l2_sha256_update(&hash, events, count * sizeof(*events));
+        } else {
+            expand_events(compact, count, events, &hash);
+            expanded = 1;
+        }
+        dsv4l2_sha256_final(&hash, digest);
+    }
+
+    emit_to_sinks(compact, events, count, expanded, chained ? digest : NULL);
+    __sync_fetch_and_add(&runtime.events_flushed, count);
+}
+
+/**
+ * Drain the buffer into the sinks
+ */
+static void buffer_drain(void)
+{
+    dsv4l2rt_compact_event_t compact[FLUSH_BATCH];
+    dsv4l2_event_t batch[FLUSH_BATCH];
+    size_t count;
+
+    while ((count = merged_get_events(compact, FLUSH_BATCH)) > 0) {
+        deliver_batch(compact, batch, count, 0);
+    }
+}
+
+/**
+ * Free all rings and merge state
+ */
+static void free_shards(void)
+{
+    size_t i;
+
+    for (i = 0; i < runtime.shard_count; i++) {
+        free(runtime.shards[i].slots);
+        if (runtime.stages) {
+            free(runtime.stages[i].events);
+        }
+    }
+
+    free(runtime.shards);
+    free(runtime.stages);
+    free(runtime.heap);
+    runtime.shards = NULL;
+    runtime.stages = NULL;
+    runtime.heap = NULL;
+    runtime.shard_count = 0;
+}
+
+/**
+ * Allocate the event rings
+ *
+ * @param shards Number of rings (1 = single shared ring)
+ * @param capacity Capacity of each ring
+ * @param watermark Per-ring flush watermark (0 = capacity/4)
+ */
+static int init_shards(size_t shards, size_t capacity, size_t watermark)
+{
+    size_t i;
+    int rc;
+
+    runtime.shards = calloc(shards, sizeof(event_buffer_t));
+    if (!runtime.shards) {
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < shards; i++) {
+        rc = init_event_buffer(&runtime.shards[i], capacity, watermark);
+        if (rc != 0) {
+            runtime.shard_count = i;
+            free_shards();
+            return rc;
+        }
+    }
+    runtime.shard_count = shards;
+
+    if (shards > 1) {
+        runtime.stages = calloc(shards, sizeof(shard_stage_t));
+        runtime.heap = calloc(shards, sizeof(size_t));
+        if (!runtime.stages || !runtime.heap) {
+            free_shards();
+            return -ENOMEM;
+        }
+
+        for (i = 0; i < shards; i++) {
+            runtime.stages[i].events = malloc(FLUSH_BATCH * sizeof(dsv4l2rt_compact_event_t));
+            if (!runtime.stages[i].events) {
+                free_shards();
+                return -ENOMEM;
+            }
+        }
+    }
+
+    pthread_mutex_init(&runtime.drain_lock, NULL);
+    return 0;
+}
+
+/**
+ * Resolve the configured shard count
+ */
+static size_t resolve_shard_count(size_t requested)
+{
+    if (requested == DSV4L2RT_SHARDS_PER_CPU) {
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        requested = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    if (requested == 0) {
+        return 1;
+    }
+
+    return requested > MAX_SHARDS ? MAX_SHARDS : requested;
+}
+
 /**
  * Initialize file sink
+ *
+ * config->enable_io_uring or DSV4L2_IO_URING=1 queues chunk records
+ * through the io_uring engine; without io_uring the sink stays on
+ * pwritev()/fsync().
  */
-static int init_file_sink(const char *path)
+static int init_file_sink(const dsv4l2rt_config_t *config)
 {
-    if (!path) {
+    const char *env = getenv("DSV4L2_IO_URING");
+    int rc;
+
+    runtime.file_chunk_sequence = 0;
+    if (!config->sink_config) {
         return 0;  /* No file sink */
     }
 
-    runtime.file_sink_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0600);
-    if (runtime.file_sink_fd < 0) {
-        return -errno;
+    rc = dsv4l2rt_log_writer_open(config->sink_config, &runtime.file_log);
+    if (rc != 0) {
+        return rc;
     }
+    runtime.file_chunk_sequence = dsv4l2rt_log_writer_next_chunk_id(runtime.file_log);
 
-    strncpy(runtime.file_sink_path, path, sizeof(runtime.file_sink_path) - 1);
+    if (config->enable_io_uring || (env && atoi(env) > 0)) {
+        dsv4l2rt_log_writer_enable_io(runtime.file_log);
+    }
     return 0;
 }
 
 /**
- * Write event to file sink (binary format)
+ * Close file sink (writes the chunk index)
  */
-static int file_sink_write(const dsv4l2_event_t *ev)
+static void close_file_sink(void)
 {
-    ssize_t written;
+    if (runtime.file_log) {
+        dsv4l2rt_log_writer_close(runtime.file_log);
+        runtime.file_log = NULL;
+    }
+}
 
-    if (runtime.file_sink_fd < 0) {
-        return 0;
+/**
+ * Monotonic time in ns
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Count an event in place
+ *
+ * @return 1 if counted, 0 if the counter table is full (buffer it instead)
+ */
+static int aggregate_event(const dsv4l2_event_t *ev)
+{
+    uint64_t key = ((uint64_t)ev->dev_id << 16) | ev->event_type;
+    size_t idx = (size_t)((ev->dev_id * 0x9E3779B1u) ^ ev->event_type);
+    size_t i;
+
+    for (i = 0; i < DSV4L2RT_AGGREGATE_SLOTS; i++, idx++) {
+        agg_counter_t *c = &runtime.agg[idx & (DSV4L2RT_AGGREGATE_SLOTS - 1)];
+        uint64_t cur = __atomic_load_n(&c->key, __ATOMIC_ACQUIRE);
+
+        if (cur == 0) {
+            uint64_t expected = 0;
+
+            if (__atomic_compare_exchange_n(&c->key, &expected, key, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                c->layer = ev->layer;
+                memcpy(c->role, ev->role, sizeof(c->role));
+                __atomic_store_n(&c->ready, 1, __ATOMIC_RELEASE);
+                cur = key;
+            } else {
+                cur = expected;
+            }
+        }
+
+        if (cur == key) {
+            uint64_t zero = 0;
+
+            __atomic_compare_exchange_n(&c->first_ts_ns, &zero, ev->ts_ns ? ev->ts_ns : 1,
+                                        0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+            __atomic_store_n(&c->last_ts_ns, ev->ts_ns, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&c->aux_sum, ev->aux, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&c->count, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
     }
 
-    written = write(runtime.file_sink_fd, ev, sizeof(*ev));
-    if (written != sizeof(*ev)) {
-        return -EIO;
+    return 0;
+}
+
+/**
+ * Deliver one COUNTER_SUMMARY event for every counter that moved
+ *
+ * Summaries carry more than a compact event holds, so they go straight
+ * to the sinks instead of through the ring. Runs before a drain.
+ */
+static void aggregate_summarize(void)
+{
+    dsv4l2rt_compact_event_t compact[FLUSH_BATCH];
+    dsv4l2_event_t batch[FLUSH_BATCH];
+    size_t i, n = 0;
+
+    if (!runtime.agg) {
+        return;
     }
 
+    pthread_mutex_lock(&runtime.agg_lock);
+
+    for (i = 0; i < DSV4L2RT_AGGREGATE_SLOTS; i++) {
+        agg_counter_t *c = &runtime.agg[i];
+        dsv4l2_event_t *ev = &batch[n];
+        uint64_t key, counts[4];
+
+        if (!__atomic_load_n(&c->ready, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        counts[0] = __atomic_exchange_n(&c->count, 0, __ATOMIC_RELAXED);
+        if (counts[0] == 0) {
+            continue;
+        }
+        counts[1] = __atomic_exchange_n(&c->aux_sum, 0, __ATOMIC_RELAXED);
+        counts[2] = __atomic_exchange_n(&c->first_ts_ns, 0, __ATOMIC_RELAXED);
+        counts[3] = 0;
+        key = c->key;
+
+        memset(ev, 0, sizeof(*ev));
+        ev->ts_ns = __atomic_load_n(&c->last_ts_ns, __ATOMIC_RELAXED);
+        ev->dev_id = (uint32_t)(key >> 16);
+        ev->event_type = DSV4L2_EVENT_COUNTER_SUMMARY;
+        ev->severity = DSV4L2_SEV_INFO;
+        ev->aux = (uint32_t)(key & 0xFFFF);
+        ev->layer = c->layer;
+        memcpy(ev->role, c->role, sizeof(ev->role));
+        memcpy(ev->mission, counts, sizeof(counts));
+
+        /* Compact form: aux = count (saturated), mission_id = counted type */
+        compact[n].ts_ns = ev->ts_ns;
+        compact[n].dev_id = ev->dev_id;
+        compact[n].event_type = ev->event_type;
+        compact[n].severity = (uint8_t)ev->severity;
+        compact[n].layer = (uint8_t)ev->layer;
+        compact[n].role_id = dsv4l2rt_strtab_intern(ev->role, sizeof(ev->role));
+        compact[n].aux = counts[0] > UINT32_MAX ? UINT32_MAX : (uint32_t)counts[0];
+        compact[n].mission_id = (uint16_t)(key & 0xFFFF);
+
+        if (runtime.shm) {
+            dsv4l2rt_shm_writer_publish(runtime.shm, ev);
+        }
+
+        if (++n == FLUSH_BATCH) {
+            deliver_batch(compact, batch, n, 1);
+            n = 0;
+        }
+    }
+
+    if (n > 0) {
+        deliver_batch(compact, batch, n, 1);
+    }
+
+    pthread_mutex_unlock(&runtime.agg_lock);
+}
+
+/**
+ * Set up counter aggregation (OPS profile with aggregate_below set)
+ */
+static int init_aggregation(const dsv4l2rt_config_t *config)
+{
+    runtime.agg = NULL;
+    runtime.agg_below = 0;
+    runtime.events_aggregated = 0;
+
+    if (runtime.profile != DSV4L2_PROFILE_OPS || !config ||
+        config->aggregate_below <= DSV4L2_SEV_DEBUG) {
+        return 0;  /* Every event is buffered */
+    }
+
+    runtime.agg = calloc(DSV4L2RT_AGGREGATE_SLOTS, sizeof(agg_counter_t));
+    if (!runtime.agg) {
+        return -ENOMEM;
+    }
+
+    runtime.agg_interval_ms = config->aggregate_interval_ms ?
+                              config->aggregate_interval_ms : AGG_INTERVAL_MS;
+    runtime.agg_last_ns = now_ns();
+    pthread_mutex_init(&runtime.agg_lock, NULL);
+    runtime.agg_below = (uint32_t)config->aggregate_below;
+
     return 0;
 }
 
 /**
- * Flush thread - periodically flushes events to sinks
+ * Free the counters (after the final summary)
  */
-static void *flush_thread_fn(void *arg)
+static void close_aggregation(void)
 {
-    dsv4l2_event_t batch[256];
-    size_t count;
+    if (runtime.agg) {
+        pthread_mutex_destroy(&runtime.agg_lock);
+        free(runtime.agg);
+        runtime.agg = NULL;
+    }
+    runtime.agg_below = 0;
+}
 
-    (void)arg;
+/**
+ * Decode a COUNTER_SUMMARY event
+ */
+int dsv4l2rt_summary_decode(const dsv4l2_event_t *ev, dsv4l2rt_summary_t *out)
+{
+    uint64_t counts[4];
+
+    if (!ev || !out || ev->event_type != DSV4L2_EVENT_COUNTER_SUMMARY) {
+        return -EINVAL;
+    }
+
+    memcpy(counts, ev->mission, sizeof(counts));
+    out->event_type = (uint16_t)ev->aux;
+    out->count = counts[0];
+    out->aux_sum = counts[1];
+    out->first_ts_ns = counts[2];
+    out->last_ts_ns = ev->ts_ns;
+
+    return 0;
+}
+
+/**
+ * Initialize the shared-memory ring
+ *
+ * config->shm_name wins over DSV4L2_SHM; neither means no ring.
+ */
+static int init_shm_ring(const dsv4l2rt_config_t *config, size_t capacity)
+{
+    const char *name = (config && config->shm_name) ? config->shm_name :
+                       getenv("DSV4L2_SHM");
+
+    if (!name || !name[0]) {
+        return 0;  /* No shared-memory ring */
+    }
+
+    return dsv4l2rt_shm_writer_open(name, capacity, &runtime.shm);
+}
 
-    while (runtime.flush_running) {
-        pthread_mutex_lock(&runtime.buffer.lock);
+/**
+ * Publish a stats snapshot to the shared-memory ring (flush thread)
+ */
+static void publish_shm_stats(void)
+{
+    dsv4l2rt_stats_t stats;
+
+    if (runtime.shm) {
+        dsv4l2rt_get_stats(&stats);
+        dsv4l2rt_shm_writer_stats(runtime.shm, &stats);
+    }
+}
 
-        /* Wait for events or 1 second timeout */
-        struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
-        ts.tv_sec += 1;
-        pthread_cond_timedwait(&runtime.buffer.cond, &runtime.buffer.lock, &ts);
+/**
+ * Close the shared-memory ring
+ */
+static void close_shm_ring(void)
+{
+    if (runtime.shm) {
+        dsv4l2rt_shm_writer_close(runtime.shm);
+        runtime.shm = NULL;
+    }
+}
 
-        pthread_mutex_unlock(&runtime.buffer.lock);
+/**
+ * Flush thread - drains the ring on watermark wakeups or periodically
+ */
+static void *flush_thread_fn(void *arg)
+{
+    (void)arg;
 
-        /* Get batch of events */
-        count = buffer_get_events(&runtime.buffer, batch, 256);
-        if (count > 0) {
-            /* Emit to all sinks */
-            emit_to_sinks(batch, count);
-            runtime.events_flushed += count;
+    while (__atomic_load_n(&runtime.flush_running, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&runtime.flush_lock);
+
+        if (!__atomic_load_n(&runtime.wake_pending, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&runtime.flush_running, __ATOMIC_ACQUIRE)) {
+            /* Wait for watermark or idle flush interval */
+            uint32_t interval_ms = (runtime.agg && runtime.agg_interval_ms < FLUSH_INTERVAL_MS) ?
+                                   runtime.agg_interval_ms : FLUSH_INTERVAL_MS;
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += interval_ms / 1000;
+            ts.tv_nsec += (interval_ms % 1000) * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&runtime.flush_cond, &runtime.flush_lock, &ts);
+        }
+
+        __atomic_store_n(&runtime.wake_pending, 0, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&runtime.flush_lock);
+
+        /* Counter summaries once per interval */
+        if (runtime.agg &&
+            now_ns() - runtime.agg_last_ns >= runtime.agg_interval_ms * 1000000ULL) {
+            runtime.agg_last_ns = now_ns();
+            aggregate_summarize();
         }
+
+        buffer_drain();
+        publish_shm_stats();
     }
 
     return NULL;
@@ -217,22 +992,61 @@ static void *flush_thread_fn(void *arg)
 
 /**
  * Emit events to all registered sinks
+ *
+ * events_digest is the SHA-256 of the batch when it was hashed during
+ * the drain (hash-chained file sink), NULL otherwise.
  */
-static int emit_to_sinks(const dsv4l2_event_t *events, size_t count)
+static int emit_to_sinks(const dsv4l2rt_compact_event_t *compact,
+                         dsv4l2_event_t *events, size_t count, int expanded,
+                         const uint8_t *events_digest)
 {
     event_sink_t *sink;
-    size_t i;
 
-    /* Write to file sink */
-    for (i = 0; i < count; i++) {
-        file_sink_write(&events[i]);
+    pthread_mutex_lock(&runtime.sink_lock);
+
+    /* Expand only if someone takes the full layout */
+    if (!expanded) {
+        int full = runtime.file_log != NULL;
+
+        for (sink = runtime.sinks; sink != NULL && !full; sink = sink->next) {
+            full = sink->callback != NULL;
+        }
+        if (full) {
+            expand_events(compact, count, events, NULL);
+        }
+    }
+
+    /* Write the batch to the file sink as one chunk record */
+    if (runtime.file_log) {
+        dsv4l2rt_chunk_header_t chunk;
+
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.timestamp_ns = events[0].ts_ns;
+        chunk.event_count = count;
+        if (!events_digest || dsv4l2_tpm_chain_digest(&chunk, events_digest) != 0) {
+            chunk.chunk_id = runtime.file_chunk_sequence++;
+        }
+        dsv4l2rt_log_writer_append(runtime.file_log, &chunk, events);
     }
 
     /* Call custom sinks */
-    pthread_mutex_lock(&runtime.sink_lock);
 
     for (sink = runtime.sinks; sink != NULL; sink = sink->next) {
-        sink->callback(events, count, sink->user_data);
+        if (sink->callback) {
+            sink->callback(events, count, sink->user_data);
+            continue;
+        }
+
+        /* Compact sink: announce strings interned since its last batch */
+        if (sink->strings) {
+            uint16_t known = dsv4l2rt_strtab_count();
+
+            for (; sink->strings_sent < known; sink->strings_sent++) {
+                sink->strings(sink->strings_sent, dsv4l2rt_string(sink->strings_sent),
+                              sink->user_data);
+            }
+        }
+        sink->compact(compact, count, sink->user_data);
     }
 
     pthread_mutex_unlock(&runtime.sink_lock);
@@ -240,6 +1054,62 @@ static int emit_to_sinks(const dsv4l2_event_t *events, size_t count)
     return 0;
 }
 
+/*
+ * Default filter per profile (OFF never reaches the mask)
+ *
+ * OPS keeps counters and transitions but not the DEBUG TEMPEST_QUERY
+ * emitted by every polled dsv4l2_get_tempest_state() call.
+ */
+static const struct {
+    uint32_t min_severity;
+    uint32_t event_mask;
+} profile_filters[] = {
+    [DSV4L2_PROFILE_OFF]      = { DSV4L2_SEV_CRITICAL, 0 },
+    [DSV4L2_PROFILE_OPS]      = { DSV4L2_SEV_DEBUG,
+                                  DSV4L2RT_EVENT_MASK_ALL &
+                                  ~DSV4L2RT_EVENT_BIT(DSV4L2_EVENT_TEMPEST_QUERY) },
+    [DSV4L2_PROFILE_EXERCISE] = { DSV4L2_SEV_DEBUG, DSV4L2RT_EVENT_MASK_ALL },
+    [DSV4L2_PROFILE_FORENSIC] = { DSV4L2_SEV_DEBUG, DSV4L2RT_EVENT_MASK_ALL },
+};
+
+/**
+ * Install the filter for a profile
+ *
+ * OFF drops everything at the call site. Other profiles start from their
+ * profile_filters entry; the config can raise the severity floor and
+ * replace the event mask.
+ */
+static void apply_profile_filter(dsv4l2_profile_t profile,
+                                 const dsv4l2rt_config_t *config)
+{
+    uint32_t min_severity, event_mask;
+
+    if (profile == DSV4L2_PROFILE_OFF) {
+        dsv4l2rt_filter.state = DSV4L2RT_FILTER_OFF;
+        return;
+    }
+
+    if ((unsigned)profile < sizeof(profile_filters) / sizeof(profile_filters[0])) {
+        min_severity = profile_filters[profile].min_severity;
+        event_mask = profile_filters[profile].event_mask;
+    } else {
+        min_severity = DSV4L2_SEV_DEBUG;
+        event_mask = DSV4L2RT_EVENT_MASK_ALL;
+    }
+
+    if (config && (uint32_t)config->min_severity > min_severity) {
+        min_severity = (uint32_t)config->min_severity;
+    }
+    if (config && config->event_mask) {
+        event_mask = config->event_mask;
+    }
+
+    dsv4l2rt_filter.min_severity = min_severity;
+    dsv4l2rt_filter.event_mask = event_mask;
+    __atomic_store_n(&dsv4l2rt_filter.state, DSV4L2RT_FILTER_ACTIVE,
+                     __ATOMIC_RELEASE);
+}
+
 /**
  * Initialize runtime
  */
@@ -274,116 +1144,166 @@ int dsv4l2rt_init(const dsv4l2rt_config_t *config)
         }
     }
 
-    /* Initialize event buffer */
-    rc = init_event_buffer(&runtime.buffer, EVENT_BUFFER_SIZE);
+    /* Initialize sink list */
+    runtime.sinks = NULL;
+    pthread_mutex_init(&runtime.sink_lock, NULL);
+
+    /* OFF records nothing: no rings, no flush thread */
+    if (runtime.profile == DSV4L2_PROFILE_OFF) {
+        runtime.initialized = 1;
+        apply_profile_filter(runtime.profile, config);
+        return 0;
+    }
+
+    /* Initialize event buffers */
+    rc = init_shards(resolve_shard_count(config ? config->shard_count : 0),
+                     ring_capacity(config ? config->ring_buffer_size : 0),
+                     config ? config->flush_watermark : 0);
     if (rc != 0) {
+        pthread_mutex_destroy(&runtime.sink_lock);
         return rc;
     }
 
-    /* Initialize sink list */
-    runtime.sinks = NULL;
-    pthread_mutex_init(&runtime.sink_lock, NULL);
+    runtime.wake_pending = 0;
+    pthread_mutex_init(&runtime.flush_lock, NULL);
+    pthread_cond_init(&runtime.flush_cond, NULL);
+
+    /* In exercise/forensic mode, also log to stderr (from the flush thread) */
+    if (runtime.profile >= DSV4L2_PROFILE_EXERCISE) {
+        dsv4l2rt_init_log_sink(STDERR_FILENO);
+    }
 
     /* Initialize file sink if configured */
     if (config && config->sink_type && strcmp(config->sink_type, "file") == 0) {
-        rc = init_file_sink(config->sink_config);
+        rc = init_file_sink(config);
         if (rc != 0) {
-            free(runtime.buffer.events);
+            free_shards();
             return rc;
         }
     }
 
-    /* Initialize TPM signing */
+    /* Initialize the shared-memory ring if requested */
+    rc = init_shm_ring(config, ring_capacity(config ? config->ring_buffer_size : 0));
+    if (rc != 0) {
+        free_shards();
+        close_file_sink();
+        return rc;
+    }
+
+    /* Initialize OPS counter aggregation if requested */
+    rc = init_aggregation(config);
+    if (rc != 0) {
+        free_shards();
+        close_file_sink();
+        close_shm_ring();
+        return rc;
+    }
+
+    /* Initialize TPM signing (hash chain + background root signing) */
     runtime.tpm_enabled = (config && config->enable_tpm_sign);
     runtime.chunk_sequence = 0;
+    if (runtime.tpm_enabled) {
+        /* A reopened log continues its chunk IDs and hash chain */
+        uint8_t prev[DSV4L2_SHA256_LEN];
+        int chained = dsv4l2rt_log_writer_last_chain(runtime.file_log, prev);
+
+        rc = dsv4l2_tpm_pipeline_resume(0, runtime.file_chunk_sequence,
+                                        chained ? prev : NULL);
+        if (rc != 0) {
+            free_shards();
+            close_file_sink();
+            close_shm_ring();
+            close_aggregation();
+            return rc;
+        }
+    }
 
     /* Start flush thread */
     runtime.flush_running = 1;
     rc = pthread_create(&runtime.flush_thread, NULL, flush_thread_fn, NULL);
     if (rc != 0) {
-        free(runtime.buffer.events);
-        if (runtime.file_sink_fd >= 0) {
-            close(runtime.file_sink_fd);
+        free_shards();
+        close_file_sink();
+        close_shm_ring();
+        close_aggregation();
+        if (runtime.tpm_enabled) {
+            dsv4l2_tpm_pipeline_stop();
         }
         return -rc;
     }
 
     runtime.initialized = 1;
+    apply_profile_filter(runtime.profile, config);
 
     return 0;
 }
 
+/**
+ * Auto-initialize on first emit
+ *
+ * Defaults to OPS unless DSV4L2_PROFILE selects a profile.
+ */
+static void auto_init(void)
+{
+    dsv4l2rt_config_t config = {
+        .profile = DSV4L2_PROFILE_OPS,
+    };
+
+    dsv4l2rt_init(getenv("DSV4L2_PROFILE") ? NULL : &config);
+}
+
 /**
  * Emit an event
  */
-void dsv4l2rt_emit(const dsv4l2_event_t *ev)
+void (dsv4l2rt_emit)(const dsv4l2_event_t *ev)
 {
     /* Auto-initialize if not initialized */
     if (!runtime.initialized) {
-        dsv4l2rt_config_t config = {
-            .profile = DSV4L2_PROFILE_OPS,
-        };
-        dsv4l2rt_init(&config);
+        auto_init();
+        if (!runtime.initialized) {
+            return;
+        }
     }
 
-    /* If profile is OFF, do nothing */
-    if (runtime.profile == DSV4L2_PROFILE_OFF) {
+    /* Filter (OFF profile, severity, event mask) */
+    if (!dsv4l2rt_event_enabled((dsv4l2_event_type_t)ev->event_type,
+                                (dsv4l2_severity_t)ev->severity)) {
         return;
     }
 
     /* Update statistics */
     __sync_fetch_and_add(&runtime.events_emitted, 1);
 
-    /* Add to buffer */
-    buffer_add_event(&runtime.buffer, ev);
-
-    /* In exercise/forensic mode, also print to stderr */
-    if (runtime.profile >= DSV4L2_PROFILE_EXERCISE) {
-        const char *event_name = "UNKNOWN";
-        const char *severity_name = "INFO";
-
-        /* Map event type to name */
-        switch (ev->event_type) {
-            case DSV4L2_EVENT_DEVICE_OPEN:          event_name = "DEVICE_OPEN"; break;
-            case DSV4L2_EVENT_DEVICE_CLOSE:         event_name = "DEVICE_CLOSE"; break;
-            case DSV4L2_EVENT_CAPTURE_START:        event_name = "CAPTURE_START"; break;
-            case DSV4L2_EVENT_CAPTURE_STOP:         event_name = "CAPTURE_STOP"; break;
-            case DSV4L2_EVENT_FRAME_ACQUIRED:       event_name = "FRAME_ACQUIRED"; break;
-            case DSV4L2_EVENT_FRAME_DROPPED:        event_name = "FRAME_DROPPED"; break;
-            case DSV4L2_EVENT_TEMPEST_TRANSITION:   event_name = "TEMPEST_TRANSITION"; break;
-            case DSV4L2_EVENT_TEMPEST_QUERY:        event_name = "TEMPEST_QUERY"; break;
-            case DSV4L2_EVENT_TEMPEST_LOCKDOWN:     event_name = "TEMPEST_LOCKDOWN"; break;
-            case DSV4L2_EVENT_FORMAT_CHANGE:        event_name = "FORMAT_CHANGE"; break;
-            case DSV4L2_EVENT_RESOLUTION_CHANGE:    event_name = "RESOLUTION_CHANGE"; break;
-            case DSV4L2_EVENT_ERROR:                event_name = "ERROR"; break;
-            case DSV4L2_EVENT_POLICY_VIOLATION:     event_name = "POLICY_VIOLATION"; break;
-            default:                                event_name = "UNKNOWN"; break;
-        }
+    /* OPS aggregation: low-severity events only bump a counter */
+    if (ev->severity < runtime.agg_below && aggregate_event(ev)) {
+        __atomic_fetch_add(&runtime.events_aggregated, 1, __ATOMIC_RELAXED);
+        return;
+    }
 
-        /* Map severity */
-        switch (ev->severity) {
-            case DSV4L2_SEV_DEBUG:    severity_name = "DEBUG"; break;
-            case DSV4L2_SEV_INFO:     severity_name = "INFO"; break;
-            case DSV4L2_SEV_MEDIUM:   severity_name = "MEDIUM"; break;
-            case DSV4L2_SEV_HIGH:     severity_name = "HIGH"; break;
-            case DSV4L2_SEV_CRITICAL: severity_name = "CRITICAL"; break;
-        }
+    /* Add to buffer */
+    buffer_add_event(select_shard(), ev);
 
-        fprintf(stderr, "[DSV4L2] %s [%s] dev=%08x aux=%u role=%s\n",
-                event_name, severity_name, ev->dev_id, ev->aux, ev->role);
+    /* Mirror to external monitors */
+    if (runtime.shm) {
+        dsv4l2rt_shm_writer_publish(runtime.shm, ev);
     }
 }
 
 /**
  * Emit a simple event (convenience wrapper)
  */
-void dsv4l2rt_emit_simple(uint32_t dev_id,
-                          dsv4l2_event_type_t type,
-                          dsv4l2_severity_t severity,
-                          uint32_t aux)
+void (dsv4l2rt_emit_simple)(uint32_t dev_id,
+                            dsv4l2_event_type_t type,
+                            dsv4l2_severity_t severity,
+                            uint32_t aux)
 {
     dsv4l2_event_t ev;
 
+    /* Reject before building the event */
+    if (!dsv4l2rt_event_enabled(type, severity)) {
+        return;
+    }
+
     memset(&ev, 0, sizeof(ev));
     ev.dev_id = dev_id;
     ev.event_type = type;
@@ -396,7 +1316,7 @@ void dsv4l2rt_emit_simple(uint32_t dev_id,
         ev.ts_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
     }
 
-    dsv4l2rt_emit(&ev);
+    (dsv4l2rt_emit)(&ev);
 }
 
 /**
@@ -404,22 +1324,22 @@ void dsv4l2rt_emit_simple(uint32_t dev_id,
  */
 void dsv4l2rt_flush(void)
 {
-    dsv4l2_event_t batch[256];
-    size_t count;
-
-    if (!runtime.initialized) {
+    if (!runtime.initialized || runtime.shard_count == 0) {
         return;
     }
 
-    /* Flush all buffered events */
-    while ((count = buffer_get_events(&runtime.buffer, batch, 256)) > 0) {
-        emit_to_sinks(batch, count);
-        runtime.events_flushed += count;
+    /* Summarize counters, then flush all buffered events */
+    aggregate_summarize();
+    buffer_drain();
+
+    /* Sign every sealed chunk batch */
+    if (runtime.tpm_enabled) {
+        dsv4l2_tpm_pipeline_flush();
     }
 
     /* Sync file sink */
-    if (runtime.file_sink_fd >= 0) {
-        fsync(runtime.file_sink_fd);
+    if (runtime.file_log) {
+        dsv4l2rt_log_writer_sync(runtime.file_log);
     }
 }
 
@@ -434,23 +1354,39 @@ void dsv4l2rt_shutdown(void)
         return;
     }
 
-    /* Stop flush thread */
-    runtime.flush_running = 0;
-    pthread_cond_signal(&runtime.buffer.cond);
-    pthread_join(runtime.flush_thread, NULL);
-
-    /* Final flush */
-    dsv4l2rt_flush();
-
-    /* Cleanup buffer */
-    pthread_mutex_destroy(&runtime.buffer.lock);
-    pthread_cond_destroy(&runtime.buffer.cond);
-    free(runtime.buffer.events);
+    /* Stop recording: emit falls back to auto-init */
+    dsv4l2rt_filter.state = DSV4L2RT_FILTER_UNINIT;
+
+    if (runtime.shard_count > 0) {
+        /* Stop flush thread */
+        __atomic_store_n(&runtime.flush_running, 0, __ATOMIC_RELEASE);
+        pthread_mutex_lock(&runtime.flush_lock);
+        pthread_cond_signal(&runtime.flush_cond);
+        pthread_mutex_unlock(&runtime.flush_lock);
+        pthread_join(runtime.flush_thread, NULL);
+
+        /* Final flush */
+        dsv4l2rt_flush();
+
+        /* Last stats snapshot, then readers see the ring closed */
+        publish_shm_stats();
+        close_shm_ring();
+        close_aggregation();
+
+        /* Cleanup buffer */
+        pthread_mutex_destroy(&runtime.flush_lock);
+        pthread_cond_destroy(&runtime.flush_cond);
+        pthread_mutex_destroy(&runtime.drain_lock);
+        free_shards();
+    }
 
     /* Cleanup sinks */
     pthread_mutex_lock(&runtime.sink_lock);
     for (sink = runtime.sinks; sink != NULL; sink = next) {
         next = sink->next;
+        if (sink->close) {
+            sink->close(sink->user_data);
+        }
         free(sink);
     }
     runtime.sinks = NULL;
@@ -458,15 +1394,18 @@ void dsv4l2rt_shutdown(void)
     pthread_mutex_destroy(&runtime.sink_lock);
 
     /* Close file sink */
-    if (runtime.file_sink_fd >= 0) {
-        close(runtime.file_sink_fd);
-        runtime.file_sink_fd = -1;
+    close_file_sink();
+
+    /* Stop signer (batches were signed by the final flush) */
+    if (runtime.tpm_enabled) {
+        dsv4l2_tpm_pipeline_stop();
     }
 
     /* Reset statistics */
     runtime.events_emitted = 0;
     runtime.events_dropped = 0;
     runtime.events_flushed = 0;
+    runtime.events_aggregated = 0;
 
     runtime.initialized = 0;
 }
@@ -484,23 +1423,83 @@ dsv4l2_profile_t dsv4l2rt_get_profile(void)
  */
 void dsv4l2rt_get_stats(dsv4l2rt_stats_t *stats)
 {
+    size_t i;
+
     if (!stats) {
         return;
     }
 
-    pthread_mutex_lock(&runtime.buffer.lock);
-    stats->events_emitted = runtime.events_emitted;
-    stats->events_dropped = runtime.events_dropped;
-    stats->events_flushed = runtime.events_flushed;
-    stats->buffer_usage = runtime.buffer.count;
-    stats->buffer_capacity = runtime.buffer.capacity;
-    pthread_mutex_unlock(&runtime.buffer.lock);
+    stats->events_emitted = __atomic_load_n(&runtime.events_emitted, __ATOMIC_RELAXED);
+    stats->events_dropped = __atomic_load_n(&runtime.events_dropped, __ATOMIC_RELAXED);
+    stats->events_flushed = __atomic_load_n(&runtime.events_flushed, __ATOMIC_RELAXED);
+    stats->events_aggregated = __atomic_load_n(&runtime.events_aggregated, __ATOMIC_RELAXED);
+    stats->buffer_usage = 0;
+    stats->buffer_capacity = 0;
+    stats->shard_count = runtime.shard_count;
+
+    if (!runtime.initialized || runtime.shard_count == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&runtime.drain_lock);
+    for (i = 0; i < runtime.shard_count; i++) {
+        stats->buffer_usage += shard_usage(i);
+        stats->buffer_capacity += runtime.shards[i].capacity;
+    }
+    pthread_mutex_unlock(&runtime.drain_lock);
+}
+
+/**
+ * Override the profile's default filter
+ */
+int dsv4l2rt_set_filter(dsv4l2_severity_t min_severity, uint32_t event_mask)
+{
+    if (!runtime.initialized || dsv4l2rt_filter.state != DSV4L2RT_FILTER_ACTIVE) {
+        return -EAGAIN;
+    }
+
+    dsv4l2rt_filter.min_severity = min_severity;
+    dsv4l2rt_filter.event_mask = event_mask;
+
+    return 0;
+}
+
+/**
+ * Get statistics for one event ring
+ */
+int dsv4l2rt_get_shard_stats(size_t shard, dsv4l2rt_shard_stats_t *stats)
+{
+    if (!stats) {
+        return -EINVAL;
+    }
+
+    if (!runtime.initialized || shard >= runtime.shard_count) {
+        return -ENOENT;
+    }
+
+    pthread_mutex_lock(&runtime.drain_lock);
+    stats->buffer_usage = shard_usage(shard);
+    stats->buffer_capacity = runtime.shards[shard].capacity;
+    stats->events_dropped = __atomic_load_n(&runtime.shards[shard].dropped,
+                                            __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&runtime.drain_lock);
+
+    return 0;
 }
 
 /**
  * Register custom sink
  */
 int dsv4l2rt_register_sink(dsv4l2rt_sink_fn sink, void *user_data)
+{
+    return dsv4l2rt_register_sink_ex(sink, NULL, user_data);
+}
+
+/**
+ * Register custom sink with a shutdown hook
+ */
+int dsv4l2rt_register_sink_ex(dsv4l2rt_sink_fn sink, dsv4l2rt_sink_close_fn close,
+                              void *user_data)
 {
     event_sink_t *new_sink;
 
@@ -513,7 +1512,41 @@ int dsv4l2rt_register_sink(dsv4l2rt_sink_fn sink, void *user_data)
         return -ENOMEM;
     }
 
+    memset(new_sink, 0, sizeof(*new_sink));
     new_sink->callback = sink;
+    new_sink->close = close;
+    new_sink->user_data = user_data;
+
+    pthread_mutex_lock(&runtime.sink_lock);
+    new_sink->next = runtime.sinks;
+    runtime.sinks = new_sink;
+    pthread_mutex_unlock(&runtime.sink_lock);
+
+    return 0;
+}
+
+/**
+ * Register a compact sink
+ */
+int dsv4l2rt_register_compact_sink(dsv4l2rt_compact_sink_fn sink,
+                                   dsv4l2rt_string_fn strings,
+                                   dsv4l2rt_sink_close_fn close,
+                                   void *user_data)
+{
+    event_sink_t *new_sink;
+
+    if (!sink) {
+        return -EINVAL;
+    }
+
+    new_sink = calloc(1, sizeof(event_sink_t));
+    if (!new_sink) {
+        return -ENOMEM;
+    }
+
+    new_sink->compact = sink;
+    new_sink->strings = strings;
+    new_sink->close = close;
     new_sink->user_data = user_data;
 
     pthread_mutex_lock(&runtime.sink_lock);
@@ -531,44 +1564,50 @@ int dsv4l2rt_get_signed_chunk(dsv4l2rt_chunk_header_t *header,
                                dsv4l2_event_t **events,
                                size_t *count)
 {
+    dsv4l2rt_compact_event_t compact[FLUSH_BATCH];
     dsv4l2_event_t *batch;
     size_t batch_count;
+    uint8_t digest[DSV4L2_SHA256_LEN];
+    dsv4l2_sha256_t hash;
 
     if (!header || !events || !count) {
         return -EINVAL;
     }
 
-    if (!runtime.initialized) {
+    if (!runtime.initialized || runtime.shard_count == 0) {
         return -EAGAIN;
     }
 
     /* Allocate batch buffer */
-    batch = malloc(256 * sizeof(dsv4l2_event_t));
+    batch = malloc(FLUSH_BATCH * sizeof(dsv4l2_event_t));
     if (!batch) {
         return -ENOMEM;
     }
 
     /* Get events from buffer */
-    batch_count = buffer_get_events(&runtime.buffer, batch, 256);
+    batch_count = merged_get_events(compact, FLUSH_BATCH);
     if (batch_count == 0) {
         free(batch);
         return -EAGAIN;
     }
 
+    dsv4l2_sha256_init(&hash);
+    expand_events(compact, batch_count, batch, runtime.tpm_enabled ? &hash : NULL);
+
     /* Fill header */
     memset(header, 0, sizeof(*header));
-    header->chunk_id = runtime.chunk_sequence++;
     header->timestamp_ns = batch[0].ts_ns;
     header->event_count = batch_count;
 
-    /* TPM signing - use hardware TPM2 if available */
+    /*
+     * TPM signing: chain the chunk and let the signer thread sign the
+     * batch root; the proof comes from dsv4l2_tpm_get_proof().
+     */
     if (runtime.tpm_enabled) {
-        int sign_rc = dsv4l2_tpm_sign_events(batch, batch_count, header->tpm_signature);
-        if (sign_rc != 0) {
-            /* If TPM signing fails, fall back to stub for testing */
-            fprintf(stderr, "Warning: TPM signing failed (%d), using stub signature\n", sign_rc);
-            memset(header->tpm_signature, 0x5A, sizeof(header->tpm_signature));
-        }
+        dsv4l2_sha256_final(&hash, digest);
+    }
+    if (!runtime.tpm_enabled || dsv4l2_tpm_chain_digest(header, digest) != 0) {
+        header->chunk_id = runtime.chunk_sequence++;
     }
 
     *events = batch;
@@ -26,6 +26,11 @@ static struct {
     .profile = DSV4L2_PROFILE_OFF,
 };
 
+/* Inline filter word: left UNINIT so every event reaches the stub */
+dsv4l2rt_filter_t dsv4l2rt_filter = {
+    .state = DSV4L2RT_FILTER_UNINIT,
+};
+
 /**
  * Initialize runtime (stub)
  */
@@ -51,7 +56,7 @@ int dsv4l2rt_init(const dsv4l2rt_config_t *config)
 /**
  * Emit an event (stub - just counts events, optionally prints)
  */
-void dsv4l2rt_emit(const dsv4l2_event_t *ev)
+void (dsv4l2rt_emit)(const dsv4l2_event_t *ev)
 {
     /* Auto-initialize if not initialized */
     if (!runtime.initialized) {
@@ -110,10 +115,10 @@ void dsv4l2rt_emit(const dsv4l2_event_t *ev)
 /**
  * Emit a simple event (convenience wrapper)
  */
-void dsv4l2rt_emit_simple(uint32_t dev_id,
-                          dsv4l2_event_type_t type,
-                          dsv4l2_severity_t severity,
-                          uint32_t aux)
+void (dsv4l2rt_emit_simple)(uint32_t dev_id,
+                            dsv4l2_event_type_t type,
+                            dsv4l2_severity_t severity,
+                            uint32_t aux)
 {
     dsv4l2_event_t ev;
 
@@ -129,7 +134,7 @@ void dsv4l2rt_emit_simple(uint32_t dev_id,
         ev.ts_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
     }
 
-    dsv4l2rt_emit(&ev);
+    (dsv4l2rt_emit)(&ev);
 }
 
 /**
@@ -189,6 +194,18 @@ int dsv4l2rt_register_sink(dsv4l2rt_sink_fn sink, void *user_data)
     return -1;  /* Not implemented in stub */
 }
 
+/**
+ * Register custom sink with a shutdown hook (stub - not implemented)
+ */
+int dsv4l2rt_register_sink_ex(dsv4l2rt_sink_fn sink, dsv4l2rt_sink_close_fn close,
+                              void *user_data)
+{
+    (void)sink;
+    (void)close;
+    (void)user_data;
+    return -1;  /* Not implemented in stub */
+}
+
 /**
  * Get signed event chunk (stub - not implemented)
  */
@@ -0,0 +1,831 @@
+/*
+ * DSV4L2 Runtime - Event Log Writer and Reader
+ *
+ * Writer: appends one chunk record per flushed batch with a single
+ * pwritev() and keeps the chunk index in memory until close, when it is
+ * written as a footer. With the io_uring engine enabled the record is
+ * staged in an arena buffer and queued instead, so the flush thread no
+ * longer blocks on the disk.
+ *
+ * Reader: mmaps the log, loads the footer index (or rebuilds it from the
+ * chunk records if the footer is missing) and binary-searches it to seek
+ * by timestamp. Events are returned as pointers into the mapping.
+ *
+ * Layout is documented in event_log.h.
+ */
+
+#include "dsv4l2rt.h"
+#include "event_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+struct dsv4l2rt_log_writer {
+    int                    fd;
+    uint64_t               offset;       /* End of the last chunk record */
+    uint64_t               next_chunk_id; /* Follows the last chunk in the log */
+    uint8_t                last_chain[32]; /* Last non-zero chain digest in the log */
+    int                    have_chain;
+    dsv4l2rt_log_index_t  *index;
+    size_t                 index_count;
+    size_t                 index_capacity;
+    int                    async;        /* Holds an io engine reference */
+    int                    io_error;     /* Unreported async error (atomic) */
+    int                    io_failed;    /* Some async write was lost (atomic) */
+};
+
+struct dsv4l2rt_log {
+    const uint8_t         *map;
+    size_t                 size;
+    dsv4l2rt_log_index_t  *index;
+    size_t                 index_count;
+    size_t                 chunk;        /* Current chunk */
+    size_t                 event;        /* Next event within the chunk */
+};
+
+/**
+ * Append an entry to a growable index
+ */
+static int index_push(dsv4l2rt_log_index_t **index, size_t *count,
+                      size_t *capacity, const dsv4l2rt_log_index_t *entry)
+{
+    if (*count == *capacity) {
+        size_t new_cap = *capacity ? *capacity * 2 : 64;
+        dsv4l2rt_log_index_t *grown = realloc(*index, new_cap * sizeof(**index));
+
+        if (!grown) {
+            return -ENOMEM;
+        }
+        *index = grown;
+        *capacity = new_cap;
+    }
+
+    (*index)[(*count)++] = *entry;
+    return 0;
+}
+
+/**
+ * Check the file header
+ */
+static int log_check_header(const uint8_t *map, size_t size)
+{
+    const dsv4l2rt_log_header_t *hdr = (const dsv4l2rt_log_header_t *)map;
+
+    if (size < sizeof(*hdr) ||
+        memcmp(hdr->magic, DSV4L2RT_LOG_MAGIC, sizeof(hdr->magic)) != 0) {
+        return -EINVAL;
+    }
+
+    if (hdr->version != DSV4L2RT_LOG_VERSION ||
+        hdr->header_size != sizeof(dsv4l2rt_log_header_t) ||
+        hdr->event_size != sizeof(dsv4l2_event_t) ||
+        hdr->record_size != sizeof(dsv4l2rt_log_record_t)) {
+        return -EPROTO;
+    }
+
+    return 0;
+}
+
+/**
+ * Try to load the footer index
+ *
+ * @return 0 if a consistent footer was found, -ENOENT otherwise
+ */
+static int log_load_footer(const uint8_t *map, size_t size,
+                           dsv4l2rt_log_index_t **index, size_t *count,
+                           uint64_t *data_end)
+{
+    const dsv4l2rt_log_footer_t *footer;
+    const dsv4l2rt_log_index_t *entries;
+    size_t i;
+
+    if (size < sizeof(dsv4l2rt_log_header_t) + sizeof(*footer)) {
+        return -ENOENT;
+    }
+
+    footer = (const dsv4l2rt_log_footer_t *)(map + size - sizeof(*footer));
+    if (memcmp(footer->magic, DSV4L2RT_LOG_FOOTER_MAGIC, sizeof(footer->magic)) != 0 ||
+        footer->index_offset != footer->data_end ||
+        footer->index_offset < sizeof(dsv4l2rt_log_header_t) ||
+        footer->index_count > size / sizeof(dsv4l2rt_log_index_t) ||
+        footer->index_offset + footer->index_count * sizeof(*entries) +
+            sizeof(*footer) != size) {
+        return -ENOENT;
+    }
+
+    entries = (const dsv4l2rt_log_index_t *)(map + footer->index_offset);
+    for (i = 0; i < footer->index_count; i++) {
+        if (entries[i].offset + sizeof(dsv4l2rt_log_record_t) +
+            entries[i].event_count * sizeof(dsv4l2_event_t) > footer->data_end) {
+            return -ENOENT;
+        }
+    }
+
+    *index = malloc((footer->index_count ? footer->index_count : 1) * sizeof(**index));
+    if (!*index) {
+        return -ENOMEM;
+    }
+
+    memcpy(*index, entries, footer->index_count * sizeof(**index));
+    *count = footer->index_count;
+    *data_end = footer->data_end;
+    return 0;
+}
+
+/**
+ * Rebuild the index by walking chunk records
+ *
+ * Stops at the first truncated or corrupt record, so a log cut short by
+ * a crash yields every complete chunk.
+ */
+static int log_scan_records(const uint8_t *map, size_t size,
+                            dsv4l2rt_log_index_t **index, size_t *count,
+                            uint64_t *data_end)
+{
+    size_t capacity = 0;
+    uint64_t off = sizeof(dsv4l2rt_log_header_t);
+    int rc;
+
+    *index = NULL;
+    *count = 0;
+
+    while (off + sizeof(dsv4l2rt_log_record_t) <= size) {
+        const dsv4l2rt_log_record_t *rec = (const dsv4l2rt_log_record_t *)(map + off);
+        dsv4l2rt_log_index_t entry;
+        uint64_t end;
+
+        if (rec->magic != DSV4L2RT_LOG_CHUNK_MAGIC ||
+            rec->chunk.event_count > (size - off) / sizeof(dsv4l2_event_t)) {
+            break;
+        }
+
+        end = off + sizeof(*rec) + rec->chunk.event_count * sizeof(dsv4l2_event_t);
+        if (end > size) {
+            break;
+        }
+
+        entry.first_ts_ns = rec->chunk.timestamp_ns;
+        entry.last_ts_ns = rec->last_ts_ns;
+        entry.offset = off;
+        entry.event_count = rec->chunk.event_count;
+
+        rc = index_push(index, count, &capacity, &entry);
+        if (rc != 0) {
+            free(*index);
+            *index = NULL;
+            return rc;
+        }
+
+        off = end;
+    }
+
+    *data_end = off;
+    return 0;
+}
+
+/**
+ * Validate a mapped log and produce its chunk index
+ */
+static int log_build_index(const uint8_t *map, size_t size,
+                           dsv4l2rt_log_index_t **index, size_t *count,
+                           uint64_t *data_end)
+{
+    int rc;
+
+    rc = log_check_header(map, size);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = log_load_footer(map, size, index, count, data_end);
+    if (rc != -ENOENT) {
+        return rc;
+    }
+
+    return log_scan_records(map, size, index, count, data_end);
+}
+
+/**
+ * Write a full buffer at an offset
+ */
+static int pwritev_all(int fd, struct iovec *iov, int iovcnt, uint64_t offset)
+{
+    while (iovcnt > 0) {
+        ssize_t n = pwritev(fd, iov, iovcnt, (off_t)offset);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+
+        offset += (uint64_t)n;
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+
+    return 0;
+}
+
+/* ========================================================================
+ * Writer
+ * ======================================================================== */
+
+/* Rotation suffixes tried for a file that is not a current log */
+#define LOG_ROTATE_MAX  1000
+
+/**
+ * Move a file that cannot be appended to out of the way
+ *
+ * The file is renamed to "<path>.legacy" (or "<path>.legacy.N" if that
+ * is taken) without replacing an earlier rotation.
+ */
+static int log_rotate(const char *path)
+{
+    char name[4096];
+    int i, n;
+
+    for (i = 0; i < LOG_ROTATE_MAX; i++) {
+        n = i ? snprintf(name, sizeof(name), "%s.legacy.%d", path, i) :
+                snprintf(name, sizeof(name), "%s.legacy", path);
+        if (n < 0 || (size_t)n >= sizeof(name)) {
+            return -ENAMETOOLONG;
+        }
+
+        if (link(path, name) == 0) {
+            return unlink(path) == 0 ? 0 : -errno;
+        }
+        if (errno != EEXIST) {
+            return -errno;
+        }
+    }
+
+    return -EEXIST;
+}
+
+/**
+ * Find the chain digest of the last hash-chained chunk (unsigned chunks
+ * carry an all-zero digest)
+ */
+static void log_find_chain(const uint8_t *map, const dsv4l2rt_log_index_t *index,
+                           size_t count, uint8_t digest[32], int *found)
+{
+    static const uint8_t zero[32];
+
+    while (count-- > 0) {
+        const dsv4l2rt_log_record_t *rec =
+            (const dsv4l2rt_log_record_t *)(map + index[count].offset);
+
+        if (memcmp(rec->chunk.chain_digest, zero, sizeof(zero)) != 0) {
+            memcpy(digest, rec->chunk.chain_digest, sizeof(zero));
+            *found = 1;
+            return;
+        }
+    }
+}
+
+int dsv4l2rt_log_writer_open(const char *path, dsv4l2rt_log_writer_t **out)
+{
+    dsv4l2rt_log_writer_t *w;
+    struct stat st;
+    int rotated = 0;
+    int rc;
+
+    if (!path || !out) {
+        return -EINVAL;
+    }
+
+    w = calloc(1, sizeof(*w));
+    if (!w) {
+        return -ENOMEM;
+    }
+
+reopen:
+    w->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (w->fd < 0) {
+        rc = -errno;
+        free(w);
+        return rc;
+    }
+
+    if (fstat(w->fd, &st) < 0) {
+        rc = -errno;
+        goto fail;
+    }
+
+    if (st.st_size == 0) {
+        /* New log: write header */
+        dsv4l2rt_log_header_t hdr;
+        struct timespec ts;
+        struct iovec iov;
+
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, DSV4L2RT_LOG_MAGIC, sizeof(hdr.magic));
+        hdr.version = DSV4L2RT_LOG_VERSION;
+        hdr.header_size = sizeof(hdr);
+        hdr.event_size = sizeof(dsv4l2_event_t);
+        hdr.record_size = sizeof(dsv4l2rt_log_record_t);
+        if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+            hdr.created_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        }
+
+        iov.iov_base = &hdr;
+        iov.iov_len = sizeof(hdr);
+        rc = pwritev_all(w->fd, &iov, 1, 0);
+        if (rc != 0) {
+            goto fail;
+        }
+        w->offset = sizeof(hdr);
+    } else {
+        /* Existing log: reload index, drop the old footer */
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, w->fd, 0);
+
+        if (map == MAP_FAILED) {
+            rc = -errno;
+            goto fail;
+        }
+
+        rc = log_build_index(map, (size_t)st.st_size, &w->index,
+                             &w->index_count, &w->offset);
+        if (rc == 0 && w->index_count > 0) {
+            const dsv4l2rt_log_record_t *last = (const dsv4l2rt_log_record_t *)
+                ((const uint8_t *)map + w->index[w->index_count - 1].offset);
+
+            w->next_chunk_id = last->chunk.chunk_id + 1;
+            log_find_chain(map, w->index, w->index_count, w->last_chain, &w->have_chain);
+        }
+        munmap(map, (size_t)st.st_size);
+
+        /* Raw event dump or other log version: start a fresh log */
+        if ((rc == -EINVAL || rc == -EPROTO) && !rotated) {
+            close(w->fd);
+            rc = log_rotate(path);
+            if (rc != 0) {
+                free(w);
+                return rc;
+            }
+            rotated = 1;
+            goto reopen;
+        }
+        if (rc != 0) {
+            goto fail;
+        }
+        w->index_capacity = w->index_count;
+
+        if (ftruncate(w->fd, (off_t)w->offset) < 0) {
+            rc = -errno;
+            goto fail;
+        }
+    }
+
+    *out = w;
+    return 0;
+
+fail:
+    close(w->fd);
+    free(w->index);
+    free(w);
+    return rc;
+}
+
+uint64_t dsv4l2rt_log_writer_next_chunk_id(const dsv4l2rt_log_writer_t *w)
+{
+    return w ? w->next_chunk_id : 0;
+}
+
+int dsv4l2rt_log_writer_last_chain(const dsv4l2rt_log_writer_t *w, uint8_t digest[32])
+{
+    if (!w || !w->have_chain) {
+        return 0;
+    }
+
+    memcpy(digest, w->last_chain, sizeof(w->last_chain));
+    return 1;
+}
+
+int dsv4l2rt_log_writer_enable_io(dsv4l2rt_log_writer_t *w)
+{
+    int rc;
+
+    if (!w) {
+        return -EINVAL;
+    }
+    if (w->async) {
+        return 0;
+    }
+
+    rc = dsv4l2rt_io_start(0);
+    if (rc == 0) {
+        w->async = 1;
+    }
+    return rc;
+}
+
+/**
+ * Async write completion (io submission thread)
+ */
+static void log_io_done(void *user_data, int result)
+{
+    dsv4l2rt_log_writer_t *w = user_data;
+
+    if (result < 0) {
+        int expected = 0;
+
+        __atomic_compare_exchange_n(&w->io_error, &expected, result, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->io_failed, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Stage a chunk record in the arena and queue it
+ *
+ * @return 0 if queued, -ENOBUFS if the caller should write synchronously
+ */
+static int log_append_async(dsv4l2rt_log_writer_t *w, const dsv4l2rt_log_record_t *rec,
+                            const dsv4l2_event_t *events, size_t count)
+{
+    size_t len = sizeof(*rec) + count * sizeof(dsv4l2_event_t);
+    uint8_t *buf = dsv4l2rt_io_buffer_alloc(len);
+
+    if (!buf) {
+        /* Arena full of in-flight records: let them land, then retry */
+        dsv4l2rt_io_drain();
+        buf = dsv4l2rt_io_buffer_alloc(len);
+        if (!buf) {
+            return -ENOBUFS;
+        }
+    }
+
+    memcpy(buf, rec, sizeof(*rec));
+    memcpy(buf + sizeof(*rec), events, count * sizeof(dsv4l2_event_t));
+
+    if (dsv4l2rt_io_write(w->fd, buf, len, w->offset, DSV4L2RT_IO_RELEASE,
+                          log_io_done, w) != 0) {
+        dsv4l2rt_io_buffer_free(buf);
+        return -ENOBUFS;
+    }
+
+    return 0;
+}
+
+int dsv4l2rt_log_writer_append(dsv4l2rt_log_writer_t *w,
+                               const dsv4l2rt_chunk_header_t *chunk,
+                               const dsv4l2_event_t *events)
+{
+    dsv4l2rt_log_record_t rec;
+    dsv4l2rt_log_index_t entry;
+    struct iovec iov[2];
+    size_t count;
+    int rc = -ENOBUFS;
+
+    if (!w || !chunk || !events || chunk->event_count == 0) {
+        return -EINVAL;
+    }
+
+    count = chunk->event_count;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = DSV4L2RT_LOG_CHUNK_MAGIC;
+    rec.chunk = *chunk;
+    rec.last_ts_ns = events[count - 1].ts_ns;
+
+    iov[0].iov_base = &rec;
+    iov[0].iov_len = sizeof(rec);
+    iov[1].iov_base = (void *)events;
+    iov[1].iov_len = count * sizeof(dsv4l2_event_t);
+
+    if (w->async) {
+        rc = log_append_async(w, &rec, events, count);
+    }
+    if (rc == -ENOBUFS) {
+        rc = pwritev_all(w->fd, iov, 2, w->offset);
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    entry.first_ts_ns = rec.chunk.timestamp_ns;
+    entry.last_ts_ns = rec.last_ts_ns;
+    entry.offset = w->offset;
+    entry.event_count = count;
+
+    w->offset += sizeof(rec) + count * sizeof(dsv4l2_event_t);
+
+    /* Index is rebuilt from the records on reopen if this fails */
+    rc = index_push(&w->index, &w->index_count, &w->index_capacity, &entry);
+
+    /* Report an earlier queued write that failed */
+    if (w->async && rc == 0) {
+        rc = __atomic_exchange_n(&w->io_error, 0, __ATOMIC_RELAXED);
+    }
+    return rc;
+}
+
+int dsv4l2rt_log_writer_sync(dsv4l2rt_log_writer_t *w)
+{
+    int rc;
+
+    if (!w) {
+        return -EINVAL;
+    }
+
+    if (w->async) {
+        /* Ordered behind every queued record */
+        rc = dsv4l2rt_io_sync(w->fd);
+        if (rc != -ENODEV) {
+            int err = __atomic_exchange_n(&w->io_error, 0, __ATOMIC_RELAXED);
+
+            return err ? err : rc;
+        }
+    }
+
+    return fsync(w->fd) < 0 ? -errno : 0;
+}
+
+/**
+ * Queue the footer with a linked fsync and wait for both
+ *
+ * @return 0 or negative errno, -ENOBUFS if no arena buffer was free
+ */
+static int log_close_async(dsv4l2rt_log_writer_t *w, const struct iovec *iov)
+{
+    size_t len = iov[0].iov_len + iov[1].iov_len;
+    uint8_t *buf = dsv4l2rt_io_buffer_alloc(len);
+    int rc;
+
+    if (!buf) {
+        return -ENOBUFS;
+    }
+
+    memcpy(buf, iov[0].iov_base, iov[0].iov_len);
+    memcpy(buf + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+
+    rc = dsv4l2rt_io_write(w->fd, buf, len, w->offset,
+                           DSV4L2RT_IO_FSYNC | DSV4L2RT_IO_RELEASE, log_io_done, w);
+    if (rc != 0) {
+        dsv4l2rt_io_buffer_free(buf);
+        return -ENOBUFS;
+    }
+
+    dsv4l2rt_io_drain();
+    return __atomic_load_n(&w->io_error, __ATOMIC_RELAXED);
+}
+
+int dsv4l2rt_log_writer_close(dsv4l2rt_log_writer_t *w)
+{
+    dsv4l2rt_log_footer_t footer;
+    struct iovec iov[2];
+    int rc = -ENOBUFS;
+
+    if (!w) {
+        return -EINVAL;
+    }
+
+    memset(&footer, 0, sizeof(footer));
+    memcpy(footer.magic, DSV4L2RT_LOG_FOOTER_MAGIC, sizeof(footer.magic));
+    footer.index_offset = w->offset;
+    footer.index_count = w->index_count;
+    footer.data_end = w->offset;
+
+    iov[0].iov_base = w->index;
+    iov[0].iov_len = w->index_count * sizeof(dsv4l2rt_log_index_t);
+    iov[1].iov_base = &footer;
+    iov[1].iov_len = sizeof(footer);
+
+    if (w->async) {
+        dsv4l2rt_io_drain();
+
+        /*
+         * A lost record would leave a hole the footer vouches for; without
+         * a footer the reader rescans and stops at the last good record.
+         */
+        if (__atomic_load_n(&w->io_failed, __ATOMIC_ACQUIRE)) {
+            rc = __atomic_load_n(&w->io_error, __ATOMIC_RELAXED);
+            rc = rc ? rc : -EIO;
+        } else {
+            rc = log_close_async(w, iov);
+        }
+        dsv4l2rt_io_stop();
+    }
+
+    if (rc == -ENOBUFS) {
+        rc = pwritev_all(w->fd, iov, 2, w->offset);
+        if (rc == 0 && fsync(w->fd) < 0) {
+            rc = -errno;
+        }
+    }
+
+    close(w->fd);
+    free(w->index);
+    free(w);
+    return rc;
+}
+
+/* ========================================================================
+ * Reader
+ * ======================================================================== */
+
+/**
+ * Open an event log for reading
+ */
+int dsv4l2rt_log_open(const char *path, dsv4l2rt_log_t **out)
+{
+    dsv4l2rt_log_t *log;
+    struct stat st;
+    uint64_t data_end;
+    void *map;
+    int fd, rc;
+
+    if (!path || !out) {
+        return -EINVAL;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    if (fstat(fd, &st) < 0) {
+        rc = -errno;
+        close(fd);
+        return rc;
+    }
+
+    if ((size_t)st.st_size < sizeof(dsv4l2rt_log_header_t)) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    rc = (map == MAP_FAILED) ? -errno : 0;
+    close(fd);
+    if (rc != 0) {
+        return rc;
+    }
+
+    log = calloc(1, sizeof(*log));
+    if (!log) {
+        munmap(map, (size_t)st.st_size);
+        return -ENOMEM;
+    }
+
+    log->map = map;
+    log->size = (size_t)st.st_size;
+
+    rc = log_build_index(log->map, log->size, &log->index,
+                         &log->index_count, &data_end);
+    if (rc != 0) {
+        munmap(map, log->size);
+        free(log);
+        return rc;
+    }
+
+    *out = log;
+    return 0;
+}
+
+/**
+ * Events of a chunk
+ */
+static const dsv4l2_event_t *log_chunk_events(const dsv4l2rt_log_t *log, size_t chunk)
+{
+    return (const dsv4l2_event_t *)(log->map + log->index[chunk].offset +
+                                    sizeof(dsv4l2rt_log_record_t));
+}
+
+/**
+ * Position the reader at the first event with ts_ns >= ts_ns
+ */
+int dsv4l2rt_log_seek(dsv4l2rt_log_t *log, uint64_t ts_ns)
+{
+    const dsv4l2_event_t *events;
+    size_t lo = 0, hi;
+
+    if (!log) {
+        return -EINVAL;
+    }
+
+    /* First chunk whose last event is not before ts_ns */
+    hi = log->index_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (log->index[mid].last_ts_ns < ts_ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    log->chunk = lo;
+    log->event = 0;
+
+    if (lo == log->index_count) {
+        return -ENODATA;
+    }
+
+    /* First event within the chunk */
+    events = log_chunk_events(log, lo);
+    hi = log->index[lo].event_count;
+    lo = 0;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (events[mid].ts_ns < ts_ns) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    log->event = lo;
+    return 0;
+}
+
+/**
+ * Read the next event
+ */
+int dsv4l2rt_log_next(dsv4l2rt_log_t *log, const dsv4l2_event_t **ev)
+{
+    if (!log || !ev) {
+        return -EINVAL;
+    }
+
+    while (log->chunk < log->index_count) {
+        if (log->event < log->index[log->chunk].event_count) {
+            *ev = &log_chunk_events(log, log->chunk)[log->event++];
+            return 0;
+        }
+        log->chunk++;
+        log->event = 0;
+    }
+
+    return -ENODATA;
+}
+
+/**
+ * Read the next whole chunk
+ */
+int dsv4l2rt_log_next_chunk(dsv4l2rt_log_t *log,
+                            const dsv4l2rt_chunk_header_t **header,
+                            const dsv4l2_event_t **events,
+                            size_t *count)
+{
+    const dsv4l2rt_log_record_t *rec;
+
+    if (!log || !header || !events || !count) {
+        return -EINVAL;
+    }
+
+    if (log->chunk >= log->index_count) {
+        return -ENODATA;
+    }
+
+    rec = (const dsv4l2rt_log_record_t *)(log->map + log->index[log->chunk].offset);
+    *header = &rec->chunk;
+    *events = log_chunk_events(log, log->chunk);
+    *count = log->index[log->chunk].event_count;
+
+    log->chunk++;
+    log->event = 0;
+    return 0;
+}
+
+/**
+ * Number of chunks in an open log
+ */
+size_t dsv4l2rt_log_chunk_count(const dsv4l2rt_log_t *log)
+{
+    return log ? log->index_count : 0;
+}
+
+/**
+ * Close an event log
+ */
+void dsv4l2rt_log_close(dsv4l2rt_log_t *log)
+{
+    if (!log) {
+        return;
+    }
+
+    munmap((void *)log->map, log->size);
+    free(log->index);
+    free(log);
+}
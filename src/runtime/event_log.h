@@ -0,0 +1,136 @@
+/*
+ * DSV4L2 Runtime - On-disk Event Log Format (internal)
+ *
+ * File layout (all integers little-endian, native struct layout):
+ *
+ *   +-------------------------+
+ *   | dsv4l2rt_log_header_t   |  64 bytes, written once
+ *   +-------------------------+
+ *   | chunk record 0          |  dsv4l2rt_log_record_t + events[]
+ *   | chunk record 1          |
+ *   | ...                     |
+ *   +-------------------------+
+ *   | dsv4l2rt_log_index_t[]  |  one entry per chunk, written on close
+ *   | dsv4l2rt_log_footer_t   |  fixed size, last bytes of the file
+ *   +-------------------------+
+ *
+ * Each flushed batch becomes one chunk record, written with a single
+ * pwritev(). A log without a footer (crash, kill -9) is still readable:
+ * the reader rebuilds the index by walking the chunk records.
+ */
+
+#ifndef DSV4L2RT_EVENT_LOG_H
+#define DSV4L2RT_EVENT_LOG_H
+
+#include "dsv4l2rt.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DSV4L2RT_LOG_MAGIC        "DSV4LOG"     /* 8 bytes incl. NUL */
+#define DSV4L2RT_LOG_FOOTER_MAGIC "DSV4IDX"     /* 8 bytes incl. NUL */
+#define DSV4L2RT_LOG_CHUNK_MAGIC  0x4B4E4843u   /* "CHNK" */
+#define DSV4L2RT_LOG_VERSION      1
+
+/* File header */
+typedef struct {
+    char     magic[8];         /* DSV4L2RT_LOG_MAGIC */
+    uint16_t version;          /* DSV4L2RT_LOG_VERSION */
+    uint16_t header_size;      /* sizeof(dsv4l2rt_log_header_t) */
+    uint32_t event_size;       /* sizeof(dsv4l2_event_t) */
+    uint32_t record_size;      /* sizeof(dsv4l2rt_log_record_t) */
+    uint32_t reserved0;
+    uint64_t created_ns;       /* CLOCK_REALTIME at creation */
+    uint8_t  reserved[32];
+} dsv4l2rt_log_header_t;
+
+/* Chunk record header, followed by chunk.event_count events */
+typedef struct {
+    uint32_t                magic;        /* DSV4L2RT_LOG_CHUNK_MAGIC */
+    uint32_t                reserved;
+    dsv4l2rt_chunk_header_t chunk;        /* chunk_id, first ts, count, chain digest */
+    uint64_t                last_ts_ns;   /* Timestamp of the last event */
+} dsv4l2rt_log_record_t;
+
+/* Footer index entry */
+typedef struct {
+    uint64_t first_ts_ns;
+    uint64_t last_ts_ns;
+    uint64_t offset;           /* File offset of the chunk record */
+    uint64_t event_count;
+} dsv4l2rt_log_index_t;
+
+/* Footer trailer */
+typedef struct {
+    char     magic[8];         /* DSV4L2RT_LOG_FOOTER_MAGIC */
+    uint64_t index_offset;     /* File offset of the first index entry */
+    uint64_t index_count;      /* Number of index entries */
+    uint64_t data_end;         /* End of the last chunk record */
+} dsv4l2rt_log_footer_t;
+
+/* Log writer (flush thread side) */
+typedef struct dsv4l2rt_log_writer dsv4l2rt_log_writer_t;
+
+/**
+ * Open a log for appending.
+ *
+ * A new file gets a header. An existing log is reopened at the end of its
+ * last complete chunk; a previous footer is dropped and rewritten on
+ * close. A file that is not a log of this version (e.g. a raw event dump
+ * from an older file sink) is renamed to "<path>.legacy" and a new log
+ * is started in its place.
+ *
+ * @param path Log file path
+ * @param out Output writer
+ * @return 0 on success, negative errno otherwise
+ */
+int dsv4l2rt_log_writer_open(const char *path, dsv4l2rt_log_writer_t **out);
+
+/**
+ * Chunk ID following the last chunk already in the log (0 for a new log),
+ * so a reopened log continues its chunk sequence.
+ */
+uint64_t dsv4l2rt_log_writer_next_chunk_id(const dsv4l2rt_log_writer_t *w);
+
+/**
+ * Chain digest of the last hash-chained chunk already in the log, so a
+ * reopened signed log continues its hash chain.
+ *
+ * @return 1 if the log holds a chained chunk, 0 otherwise (digest untouched)
+ */
+int dsv4l2rt_log_writer_last_chain(const dsv4l2rt_log_writer_t *w, uint8_t digest[32]);
+
+/**
+ * Append one batch as a chunk record (single pwritev()).
+ *
+ * @param w Writer
+ * @param chunk Chunk header (id, first timestamp, count, chain digest)
+ * @param events chunk->event_count events, in timestamp order
+ * @return 0 on success, negative errno on error
+ */
+int dsv4l2rt_log_writer_append(dsv4l2rt_log_writer_t *w,
+                               const dsv4l2rt_chunk_header_t *chunk,
+                               const dsv4l2_event_t *events);
+
+/**
+ * Queue later appends through the io_uring engine (dsv4l2rt_io_start()).
+ * Appends fall back to pwritev() whenever the arena is exhausted; a
+ * queued write that fails is returned by the next append or sync, and
+ * the log is then closed without a footer.
+ *
+ * @return 0 on success, negative errno if io_uring is unavailable (the
+ *         writer stays synchronous)
+ */
+int dsv4l2rt_log_writer_enable_io(dsv4l2rt_log_writer_t *w);
+
+/**
+ * fsync() the log (after every queued append in async mode).
+ */
+int dsv4l2rt_log_writer_sync(dsv4l2rt_log_writer_t *w);
+
+/**
+ * Write the footer index and close the log.
+ */
+int dsv4l2rt_log_writer_close(dsv4l2rt_log_writer_t *w);
+
+#endif /* DSV4L2RT_EVENT_LOG_H */
@@ -0,0 +1,811 @@
+/*
+ * DSV4L2 Runtime - io_uring File I/O Backend
+ *
+ * One process-wide submission thread owns the ring. Producers (the file
+ * sink's flush thread, frame recorders) append requests to a locked queue
+ * and only poke an eventfd when the thread is asleep; the thread keeps a
+ * POLL_ADD on that eventfd in flight so io_uring_enter() is its single
+ * wait point for both new work and completions.
+ *
+ * Writes whose buffer lies in the staging arena are issued as
+ * WRITE_FIXED against the arena registered once at start. Requests may
+ * carry a linked FSYNC. dsv4l2rt_io_sync() queues a barrier FSYNC: it
+ * is held back until every earlier request has completed (IOSQE_IO_DRAIN
+ * would also wait for the eventfd poll, which never completes by itself).
+ *
+ * The ring is driven with the raw syscalls (no liburing dependency).
+ */
+
+#define _GNU_SOURCE
+#include "dsv4l2rt.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#define IO_RING_ENTRIES  64
+#define IO_PAGE          4096u
+#define IO_WAKE_TAG      0          /* user_data of the eventfd poll */
+#define IO_FSYNC_TAG     1u         /* Low bit: linked fsync half of a request */
+
+typedef enum {
+    IO_REQ_WRITE = 0,
+    IO_REQ_FSYNC = 1,
+} io_req_op_t;
+
+typedef struct io_req {
+    struct io_req      *next;
+    struct io_req      *prev;       /* In-flight list only */
+    io_req_op_t         op;
+    int                 fd;
+    const void         *buf;
+    uint32_t            len;
+    uint64_t            offset;
+    unsigned            flags;      /* DSV4L2RT_IO_* */
+    dsv4l2rt_io_done_fn done;
+    void               *user_data;
+    int                 result;     /* First error, else bytes written / 0 */
+    int                 parts;      /* CQEs still expected */
+} io_req_t;
+
+/* Blocking dsv4l2rt_io_sync() waiter */
+typedef struct {
+    int done;
+    int result;
+} io_sync_wait_t;
+
+static struct {
+    pthread_mutex_t  lock;          /* Queue, counters, arena map */
+    pthread_cond_t   idle;          /* Completions (drain and sync waiters) */
+    int              refs;          /* dsv4l2rt_io_start() callers */
+    int              running;
+    int              stopping;
+    int              failed;        /* Fatal ring error (negative errno) */
+
+    /* Request queue (producers -> submission thread) */
+    io_req_t        *queue_head;
+    io_req_t        *queue_tail;
+    io_req_t        *inflight;      /* Submitted, not yet completed */
+    size_t           pending;       /* Queued + in flight */
+    int              waiting;       /* Thread is (about to be) in io_uring_enter */
+    int              wake_pending;  /* eventfd written, poll not yet reaped */
+
+    /* Ring */
+    int              ring_fd;
+    int              wakefd;
+    pthread_t        thread;
+    void            *sq_map;
+    size_t           sq_map_len;
+    void            *cq_map;
+    size_t           cq_map_len;
+    struct io_uring_sqe *sqes;
+    size_t           sqes_len;
+    unsigned        *sq_head;
+    unsigned        *sq_tail;
+    unsigned        *sq_array;
+    unsigned         sq_mask;
+    unsigned         sq_entries;
+    unsigned        *cq_head;
+    unsigned        *cq_tail;
+    struct io_uring_cqe *cqes;
+    unsigned         cq_mask;
+    unsigned         cq_entries;
+
+    /* Staging arena (page granular, first fit) */
+    uint8_t         *arena;
+    size_t           arena_pages;
+    uint32_t        *arena_runs;    /* Pages allocated at a run's first page, 0 = free */
+    int              registered;    /* Arena is a fixed buffer (index 0) */
+} eng = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .ring_fd = -1,
+    .wakefd = -1,
+};
+
+/* ========================================================================
+ * Ring setup
+ * ======================================================================== */
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                        NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void *arg,
+                                 unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * Unmap the rings and close the ring fd
+ */
+static void ring_close(void)
+{
+    if (eng.sqes) {
+        munmap(eng.sqes, eng.sqes_len);
+    }
+    if (eng.cq_map && eng.cq_map != eng.sq_map) {
+        munmap(eng.cq_map, eng.cq_map_len);
+    }
+    if (eng.sq_map) {
+        munmap(eng.sq_map, eng.sq_map_len);
+    }
+    if (eng.ring_fd >= 0) {
+        close(eng.ring_fd);
+    }
+
+    eng.sqes = NULL;
+    eng.sq_map = NULL;
+    eng.cq_map = NULL;
+    eng.ring_fd = -1;
+}
+
+/**
+ * Create the ring and map its SQ/CQ
+ */
+static int ring_open(void)
+{
+    struct io_uring_params p;
+    uint8_t *sq, *cq;
+    int rc;
+
+    memset(&p, 0, sizeof(p));
+    eng.ring_fd = sys_io_uring_setup(IO_RING_ENTRIES, &p);
+    if (eng.ring_fd < 0) {
+        return -errno;
+    }
+
+    eng.sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    eng.cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (eng.cq_map_len > eng.sq_map_len) {
+            eng.sq_map_len = eng.cq_map_len;
+        }
+        eng.cq_map_len = eng.sq_map_len;
+    }
+
+    eng.sq_map = mmap(NULL, eng.sq_map_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, eng.ring_fd, IORING_OFF_SQ_RING);
+    if (eng.sq_map == MAP_FAILED) {
+        eng.sq_map = NULL;
+        goto fail;
+    }
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        eng.cq_map = eng.sq_map;
+    } else {
+        eng.cq_map = mmap(NULL, eng.cq_map_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, eng.ring_fd, IORING_OFF_CQ_RING);
+        if (eng.cq_map == MAP_FAILED) {
+            eng.cq_map = NULL;
+            goto fail;
+        }
+    }
+
+    eng.sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    eng.sqes = mmap(NULL, eng.sqes_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, eng.ring_fd, IORING_OFF_SQES);
+    if (eng.sqes == MAP_FAILED) {
+        eng.sqes = NULL;
+        goto fail;
+    }
+
+    sq = eng.sq_map;
+    cq = eng.cq_map;
+    eng.sq_head = (unsigned *)(sq + p.sq_off.head);
+    eng.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    eng.sq_array = (unsigned *)(sq + p.sq_off.array);
+    eng.sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+    eng.sq_entries = p.sq_entries;
+    eng.cq_head = (unsigned *)(cq + p.cq_off.head);
+    eng.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    eng.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    eng.cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+    eng.cq_entries = p.cq_entries;
+    return 0;
+
+fail:
+    rc = -errno;
+    ring_close();
+    return rc;
+}
+
+/**
+ * Map the staging arena and register it as fixed buffer 0
+ *
+ * Registration pins the pages against RLIMIT_MEMLOCK; if that is refused
+ * the arena still works, its writes just go out as plain WRITEs.
+ */
+static int arena_open(size_t size)
+{
+    struct iovec iov;
+
+    size = (size + IO_PAGE - 1) & ~(size_t)(IO_PAGE - 1);
+    eng.arena = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (eng.arena == MAP_FAILED) {
+        eng.arena = NULL;
+        return -errno;
+    }
+
+    eng.arena_pages = size / IO_PAGE;
+    eng.arena_runs = calloc(eng.arena_pages, sizeof(*eng.arena_runs));
+    if (!eng.arena_runs) {
+        munmap(eng.arena, size);
+        eng.arena = NULL;
+        return -ENOMEM;
+    }
+
+    iov.iov_base = eng.arena;
+    iov.iov_len = size;
+    eng.registered = sys_io_uring_register(eng.ring_fd, IORING_REGISTER_BUFFERS,
+                                           &iov, 1) == 0;
+    return 0;
+}
+
+static void arena_close(void)
+{
+    if (eng.arena) {
+        munmap(eng.arena, eng.arena_pages * IO_PAGE);
+    }
+    free(eng.arena_runs);
+    eng.arena = NULL;
+    eng.arena_runs = NULL;
+    eng.arena_pages = 0;
+    eng.registered = 0;
+}
+
+static int in_arena(const void *buf)
+{
+    return eng.arena && (const uint8_t *)buf >= eng.arena &&
+           (const uint8_t *)buf < eng.arena + eng.arena_pages * IO_PAGE;
+}
+
+/* ========================================================================
+ * Submission thread
+ * ======================================================================== */
+
+/**
+ * Next free SQE (submission thread only; caller checked for space)
+ */
+static struct io_uring_sqe *sqe_get(void)
+{
+    unsigned tail = *eng.sq_tail;
+    unsigned idx = tail & eng.sq_mask;
+    struct io_uring_sqe *sqe = &eng.sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    eng.sq_array[idx] = idx;
+    __atomic_store_n(eng.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+static unsigned sq_space(void)
+{
+    return eng.sq_entries - (*eng.sq_tail - __atomic_load_n(eng.sq_head, __ATOMIC_ACQUIRE));
+}
+
+static void prep_wake_poll(void)
+{
+    struct io_uring_sqe *sqe = sqe_get();
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = eng.wakefd;
+    sqe->poll_events = POLLIN;
+    sqe->user_data = IO_WAKE_TAG;
+}
+
+/**
+ * Turn a request into one SQE, or two when an fsync is linked
+ */
+static void prep_request(io_req_t *req)
+{
+    struct io_uring_sqe *sqe = sqe_get();
+
+    if (req->op == IO_REQ_FSYNC) {
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = req->fd;
+        sqe->user_data = (uintptr_t)req;
+        req->parts = 1;
+        return;
+    }
+
+    sqe->opcode = IORING_OP_WRITE;
+    if (eng.registered && in_arena(req->buf)) {
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = 0;
+    }
+    sqe->fd = req->fd;
+    sqe->addr = (uintptr_t)req->buf;
+    sqe->len = req->len;
+    sqe->off = req->offset;
+    sqe->user_data = (uintptr_t)req;
+    req->parts = 1;
+
+    if (req->flags & DSV4L2RT_IO_FSYNC) {
+        /* A failed or short write cancels the fsync */
+        sqe->flags = IOSQE_IO_LINK;
+        sqe = sqe_get();
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = req->fd;
+        sqe->user_data = (uintptr_t)req | IO_FSYNC_TAG;
+        req->parts = 2;
+    }
+}
+
+/**
+ * Run a finished request's callback and retire it
+ */
+static void finish_request(io_req_t *req)
+{
+    if (req->done) {
+        req->done(req->user_data, req->result);
+    }
+    if (req->flags & DSV4L2RT_IO_RELEASE) {
+        dsv4l2rt_io_buffer_free((void *)req->buf);
+    }
+
+    pthread_mutex_lock(&eng.lock);
+    eng.pending--;
+    pthread_cond_broadcast(&eng.idle);
+    pthread_mutex_unlock(&eng.lock);
+
+    free(req);
+}
+
+static void inflight_remove(io_req_t *req)
+{
+    if (req->prev) {
+        req->prev->next = req->next;
+    } else {
+        eng.inflight = req->next;
+    }
+    if (req->next) {
+        req->next->prev = req->prev;
+    }
+}
+
+/**
+ * Fold one CQE into its request
+ *
+ * @return Request if that was its last CQE, NULL otherwise
+ */
+static io_req_t *reap_one(const struct io_uring_cqe *cqe)
+{
+    io_req_t *req = (io_req_t *)(uintptr_t)(cqe->user_data & ~(uint64_t)IO_FSYNC_TAG);
+    int res = cqe->res;
+
+    if (cqe->user_data & IO_FSYNC_TAG) {
+        if (res < 0 && req->result >= 0) {
+            req->result = res;
+        }
+    } else if (res < 0) {
+        req->result = res;
+    } else if (req->op == IO_REQ_WRITE && (uint32_t)res < req->len) {
+        req->result = -EIO;              /* Short write (e.g. out of space) */
+    } else {
+        req->result = res;
+    }
+
+    return --req->parts == 0 ? req : NULL;
+}
+
+/**
+ * Fail every queued and in-flight request after a fatal ring error
+ */
+static void fail_all(int err)
+{
+    io_req_t *list, *req;
+
+    pthread_mutex_lock(&eng.lock);
+    eng.failed = err;
+    list = eng.queue_head;
+    eng.queue_head = eng.queue_tail = NULL;
+    while ((req = eng.inflight) != NULL) {
+        eng.inflight = req->next;
+        req->next = list;
+        list = req;
+    }
+    pthread_cond_broadcast(&eng.idle);
+    pthread_mutex_unlock(&eng.lock);
+
+    while ((req = list) != NULL) {
+        list = req->next;
+        req->result = err;
+        finish_request(req);
+    }
+}
+
+static void *io_thread_fn(void *arg)
+{
+    unsigned outstanding = 0;       /* CQEs the kernel still owes us */
+    int poll_armed = 0;
+
+    (void)arg;
+
+    for (;;) {
+        io_req_t *done = NULL, *req;
+        unsigned head, tail, submit;
+        int rc;
+
+        /* Move queued requests into the SQ while the CQ has room for them */
+        pthread_mutex_lock(&eng.lock);
+        if (!poll_armed && sq_space() > 0) {
+            prep_wake_poll();
+            poll_armed = 1;
+            outstanding++;
+        }
+        while ((req = eng.queue_head) != NULL && sq_space() >= 2 &&
+               outstanding + 2 <= eng.cq_entries) {
+            if (req->op == IO_REQ_FSYNC && eng.inflight) {
+                break;          /* Barrier: earlier writes must land first */
+            }
+            eng.queue_head = req->next;
+            if (!eng.queue_head) {
+                eng.queue_tail = NULL;
+            }
+            prep_request(req);
+            outstanding += req->parts;
+
+            req->prev = NULL;
+            req->next = eng.inflight;
+            if (eng.inflight) {
+                eng.inflight->prev = req;
+            }
+            eng.inflight = req;
+        }
+        if (eng.stopping && eng.pending == 0) {
+            pthread_mutex_unlock(&eng.lock);
+            break;
+        }
+        eng.waiting = (eng.queue_head == NULL);
+        pthread_mutex_unlock(&eng.lock);
+
+        submit = *eng.sq_tail - __atomic_load_n(eng.sq_head, __ATOMIC_ACQUIRE);
+        rc = sys_io_uring_enter(eng.ring_fd, submit, 1, IORING_ENTER_GETEVENTS);
+        if (rc < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            fail_all(-errno);
+            break;
+        }
+
+        /* Reap; finished requests leave the in-flight list before their
+         * next pointer is reused for the done list */
+        head = *eng.cq_head;
+        tail = __atomic_load_n(eng.cq_tail, __ATOMIC_ACQUIRE);
+        pthread_mutex_lock(&eng.lock);
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe = &eng.cqes[head & eng.cq_mask];
+
+            outstanding--;
+            if (cqe->user_data == IO_WAKE_TAG) {
+                uint64_t v;
+
+                if (read(eng.wakefd, &v, sizeof(v)) < 0) {
+                    /* Nothing to consume: spurious wakeup */
+                }
+                poll_armed = 0;
+                eng.wake_pending = 0;
+                continue;
+            }
+
+            req = reap_one(cqe);
+            if (req) {
+                inflight_remove(req);
+                req->next = done;
+                done = req;
+            }
+        }
+        pthread_mutex_unlock(&eng.lock);
+        __atomic_store_n(eng.cq_head, head, __ATOMIC_RELEASE);
+
+        /* Callbacks run without the lock so they may queue more I/O */
+        while ((req = done) != NULL) {
+            done = req->next;
+            finish_request(req);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Queue a request and wake the submission thread if it sleeps
+ */
+static int enqueue(io_req_t *req)
+{
+    int wake = 0;
+
+    pthread_mutex_lock(&eng.lock);
+    if (!eng.running || eng.stopping || eng.failed) {
+        int rc = eng.failed ? eng.failed : -ENODEV;
+
+        pthread_mutex_unlock(&eng.lock);
+        return rc;
+    }
+
+    req->next = NULL;
+    if (eng.queue_tail) {
+        eng.queue_tail->next = req;
+    } else {
+        eng.queue_head = req;
+    }
+    eng.queue_tail = req;
+    eng.pending++;
+
+    if (eng.waiting && !eng.wake_pending) {
+        eng.wake_pending = 1;
+        wake = 1;
+    }
+    pthread_mutex_unlock(&eng.lock);
+
+    if (wake) {
+        uint64_t one = 1;
+
+        if (write(eng.wakefd, &one, sizeof(one)) < 0) {
+            /* Counter saturated: a wakeup is already pending */
+        }
+    }
+
+    return 0;
+}
+
+/* ========================================================================
+ * Public API
+ * ======================================================================== */
+
+int dsv4l2rt_io_start(size_t arena_size)
+{
+    int rc;
+
+    pthread_mutex_lock(&eng.lock);
+    if (eng.running) {
+        eng.refs++;
+        pthread_mutex_unlock(&eng.lock);
+        return 0;
+    }
+
+    if (getenv("DSV4L2_NO_IO_URING")) {
+        pthread_mutex_unlock(&eng.lock);
+        return -ENOSYS;
+    }
+
+    rc = ring_open();
+    if (rc != 0) {
+        pthread_mutex_unlock(&eng.lock);
+        return rc;
+    }
+
+    rc = arena_open(arena_size ? arena_size : DSV4L2RT_IO_ARENA_DEFAULT);
+    if (rc != 0) {
+        ring_close();
+        pthread_mutex_unlock(&eng.lock);
+        return rc;
+    }
+
+    eng.wakefd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eng.wakefd < 0) {
+        rc = -errno;
+        arena_close();
+        ring_close();
+        pthread_mutex_unlock(&eng.lock);
+        return rc;
+    }
+
+    eng.stopping = 0;
+    eng.failed = 0;
+    eng.waiting = 0;
+    eng.wake_pending = 0;
+    eng.pending = 0;
+
+    rc = pthread_create(&eng.thread, NULL, io_thread_fn, NULL);
+    if (rc != 0) {
+        close(eng.wakefd);
+        eng.wakefd = -1;
+        arena_close();
+        ring_close();
+        pthread_mutex_unlock(&eng.lock);
+        return -rc;
+    }
+
+    eng.running = 1;
+    eng.refs = 1;
+    pthread_mutex_unlock(&eng.lock);
+    return 0;
+}
+
+void dsv4l2rt_io_stop(void)
+{
+    int wake;
+
+    pthread_mutex_lock(&eng.lock);
+    if (!eng.running || --eng.refs > 0) {
+        pthread_mutex_unlock(&eng.lock);
+        return;
+    }
+
+    /* The thread exits once everything queued has completed */
+    eng.stopping = 1;
+    wake = !eng.wake_pending;
+    eng.wake_pending = 1;
+    pthread_mutex_unlock(&eng.lock);
+
+    if (wake) {
+        uint64_t one = 1;
+
+        if (write(eng.wakefd, &one, sizeof(one)) < 0) {
+            /* Counter saturated: a wakeup is already pending */
+        }
+    }
+    pthread_join(eng.thread, NULL);
+
+    pthread_mutex_lock(&eng.lock);
+    close(eng.wakefd);
+    eng.wakefd = -1;
+    ring_close();
+    arena_close();
+    eng.running = 0;
+    eng.stopping = 0;
+    pthread_mutex_unlock(&eng.lock);
+}
+
+void *dsv4l2rt_io_buffer_alloc(size_t size)
+{
+    size_t pages, i, run = 0;
+    void *buf = NULL;
+
+    if (size == 0) {
+        return NULL;
+    }
+    pages = (size + IO_PAGE - 1) / IO_PAGE;
+
+    pthread_mutex_lock(&eng.lock);
+    if (!eng.running || pages > eng.arena_pages) {
+        pthread_mutex_unlock(&eng.lock);
+        return NULL;
+    }
+
+    /* First fit: skip over allocated runs */
+    for (i = 0; i < eng.arena_pages && run < pages; ) {
+        if (eng.arena_runs[i]) {
+            i += eng.arena_runs[i];
+            run = 0;
+            continue;
+        }
+        run++;
+        i++;
+    }
+
+    if (run == pages) {
+        size_t first = i - pages;
+
+        eng.arena_runs[first] = (uint32_t)pages;
+        buf = eng.arena + first * IO_PAGE;
+    }
+    pthread_mutex_unlock(&eng.lock);
+
+    return buf;
+}
+
+void dsv4l2rt_io_buffer_free(void *buf)
+{
+    size_t page;
+
+    if (!buf) {
+        return;
+    }
+
+    pthread_mutex_lock(&eng.lock);
+    if (in_arena(buf)) {
+        page = (size_t)((uint8_t *)buf - eng.arena) / IO_PAGE;
+        eng.arena_runs[page] = 0;
+    }
+    pthread_mutex_unlock(&eng.lock);
+}
+
+int dsv4l2rt_io_write(int fd, const void *buf, size_t len, uint64_t offset,
+                      unsigned flags, dsv4l2rt_io_done_fn done, void *user_data)
+{
+    io_req_t *req;
+    int rc;
+
+    if (fd < 0 || !buf || len == 0 || len > INT_MAX) {
+        return -EINVAL;
+    }
+
+    req = calloc(1, sizeof(*req));
+    if (!req) {
+        return -ENOMEM;
+    }
+
+    req->op = IO_REQ_WRITE;
+    req->fd = fd;
+    req->buf = buf;
+    req->len = (uint32_t)len;
+    req->offset = offset;
+    req->flags = flags;
+    req->done = done;
+    req->user_data = user_data;
+
+    rc = enqueue(req);
+    if (rc != 0) {
+        free(req);
+    }
+    return rc;
+}
+
+static void sync_done(void *user_data, int result)
+{
+    io_sync_wait_t *wait = user_data;
+
+    pthread_mutex_lock(&eng.lock);
+    wait->result = result;
+    wait->done = 1;
+    pthread_mutex_unlock(&eng.lock);
+}
+
+int dsv4l2rt_io_sync(int fd)
+{
+    io_sync_wait_t wait = { 0, 0 };
+    io_req_t *req;
+    int rc;
+
+    if (fd < 0) {
+        return -EINVAL;
+    }
+
+    req = calloc(1, sizeof(*req));
+    if (!req) {
+        return -ENOMEM;
+    }
+
+    req->op = IO_REQ_FSYNC;
+    req->fd = fd;
+    req->done = sync_done;
+    req->user_data = &wait;
+
+    rc = enqueue(req);
+    if (rc != 0) {
+        free(req);
+        return rc;
+    }
+
+    pthread_mutex_lock(&eng.lock);
+    while (!wait.done) {
+        pthread_cond_wait(&eng.idle, &eng.lock);
+    }
+    pthread_mutex_unlock(&eng.lock);
+
+    return wait.result;
+}
+
+int dsv4l2rt_io_drain(void)
+{
+    int rc;
+
+    pthread_mutex_lock(&eng.lock);
+    while (eng.running && eng.pending > 0) {
+        pthread_cond_wait(&eng.idle, &eng.lock);
+    }
+    rc = eng.failed;
+    pthread_mutex_unlock(&eng.lock);
+
+    return rc;
+}
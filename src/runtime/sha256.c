@@ -0,0 +1,347 @@
+/*
+ * DSV4L2 Runtime - SHA-256 (FIPS 180-4)
+ *
+ * The block function is picked once at first use: SHA-NI on x86-64,
+ * the ARMv8 crypto extension on AArch64, portable C otherwise.
+ */
+
+#include "sha256.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_HAVE_SHANI 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define SHA256_HAVE_ARMV8 1
+#endif
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const uint8_t *p, size_t blocks);
+
+/**
+ * Compress whole 64-byte blocks into the state (portable)
+ */
+static void sha256_blocks_generic(uint32_t state[8], const uint8_t *p, size_t blocks)
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    int i;
+
+    while (blocks--) {
+        for (i = 0; i < 16; i++) {
+            w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 |
+                   (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+        }
+        for (i = 16; i < 64; i++) {
+            uint32_t s0 = ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+        for (i = 0; i < 64; i++) {
+            t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        p += 64;
+    }
+}
+
+#ifdef SHA256_HAVE_SHANI
+/**
+ * Compress blocks with the x86 SHA extensions
+ *
+ * State is kept as ABEF/CDGH as the sha256rnds2 instruction expects.
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(uint32_t state[8], const uint8_t *p, size_t blocks)
+{
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i state0, state1, msg, tmp, abef_save, cdgh_save;
+    __m128i w[4];
+    int i;
+
+    tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+    state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);              /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1B);        /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);        /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);     /* CDGH */
+
+    while (blocks--) {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        for (i = 0; i < 4; i++) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16 * i)), bswap);
+        }
+
+        for (i = 0; i < 16; i++) {
+            msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+
+            if (i < 12) {
+                /* W[i+4] from W[i..i+3] */
+                tmp = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+                w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+        p += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);           /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xB1);        /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);     /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);        /* HGFE */
+
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+static int cpu_has_shani(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+        !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1)) {
+        return 0;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return 0;
+    }
+    return (ebx & bit_SHA) != 0;
+}
+#endif /* SHA256_HAVE_SHANI */
+
+#ifdef SHA256_HAVE_ARMV8
+/**
+ * Compress blocks with the ARMv8 SHA-256 instructions
+ */
+__attribute__((target("arch=armv8-a+crypto")))
+static void sha256_blocks_armv8(uint32_t state[8], const uint8_t *p, size_t blocks)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+    uint32x4_t abcd_save, efgh_save, wk, tmp;
+    uint32x4_t w[4];
+    int i;
+
+    while (blocks--) {
+        abcd_save = state0;
+        efgh_save = state1;
+
+        for (i = 0; i < 4; i++) {
+            w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16 * i)));
+        }
+
+        for (i = 0; i < 16; i++) {
+            wk = vaddq_u32(w[i & 3], vld1q_u32(&K[4 * i]));
+            tmp = state0;
+            state0 = vsha256hq_u32(state0, state1, wk);
+            state1 = vsha256h2q_u32(state1, tmp, wk);
+
+            if (i < 12) {
+                /* W[i+4] from W[i..i+3] */
+                w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]),
+                                           w[(i + 2) & 3], w[(i + 3) & 3]);
+            }
+        }
+
+        state0 = vaddq_u32(state0, abcd_save);
+        state1 = vaddq_u32(state1, efgh_save);
+        p += 64;
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif /* SHA256_HAVE_ARMV8 */
+
+/**
+ * Pick the fastest block function for this CPU (once)
+ */
+static sha256_blocks_fn sha256_select(void)
+{
+#ifdef SHA256_HAVE_SHANI
+    if (cpu_has_shani()) {
+        return sha256_blocks_shani;
+    }
+#endif
+#ifdef SHA256_HAVE_ARMV8
+    if (getauxval(AT_HWCAP) & HWCAP_SHA2) {
+        return sha256_blocks_armv8;
+    }
+#endif
+    return sha256_blocks_generic;
+}
+
+/* Selected block function, NULL until first use */
+static sha256_blocks_fn sha256_impl;
+
+/**
+ * Compress blocks with the selected implementation
+ */
+static void sha256_blocks(uint32_t state[8], const uint8_t *p, size_t blocks)
+{
+    sha256_blocks_fn fn = __atomic_load_n(&sha256_impl, __ATOMIC_RELAXED);
+
+    if (!fn) {
+        fn = sha256_select();
+        __atomic_store_n(&sha256_impl, fn, __ATOMIC_RELAXED);
+    }
+
+    fn(state, p, blocks);
+}
+
+/**
+ * Name of a block function
+ */
+static const char *sha256_impl_name(sha256_blocks_fn fn)
+{
+#ifdef SHA256_HAVE_SHANI
+    if (fn == sha256_blocks_shani) {
+        return "sha-ni";
+    }
+#endif
+#ifdef SHA256_HAVE_ARMV8
+    if (fn == sha256_blocks_armv8) {
+        return "armv8-ce";
+    }
+#endif
+    (void)fn;
+    return "generic";
+}
+
+const char *dsv4l2_sha256_impl(void)
+{
+    sha256_blocks_fn fn = __atomic_load_n(&sha256_impl, __ATOMIC_RELAXED);
+
+    return sha256_impl_name(fn ? fn : sha256_select());
+}
+
+int dsv4l2_sha256_set_impl(const char *name)
+{
+    sha256_blocks_fn fn = sha256_select();
+
+    if (name && strcmp(name, "generic") == 0) {
+        fn = sha256_blocks_generic;
+    } else if (name && strcmp(name, sha256_impl_name(fn)) != 0) {
+        return -ENOTSUP;  /* Not this CPU's accelerated kernel */
+    }
+
+    __atomic_store_n(&sha256_impl, fn, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void dsv4l2_sha256_init(dsv4l2_sha256_t *ctx)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    memcpy(ctx->state, iv, sizeof(iv));
+    ctx->length = 0;
+    ctx->fill = 0;
+}
+
+void dsv4l2_sha256_update(dsv4l2_sha256_t *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    ctx->length += len;
+
+    if (ctx->fill) {
+        size_t n = 64 - ctx->fill;
+
+        if (n > len) {
+            n = len;
+        }
+        memcpy(ctx->block + ctx->fill, p, n);
+        ctx->fill += n;
+        p += n;
+        len -= n;
+
+        if (ctx->fill < 64) {
+            return;
+        }
+        sha256_blocks(ctx->state, ctx->block, 1);
+        ctx->fill = 0;
+    }
+
+    if (len >= 64) {
+        sha256_blocks(ctx->state, p, len / 64);
+        p += len & ~(size_t)63;
+        len &= 63;
+    }
+
+    if (len) {
+        memcpy(ctx->block, p, len);
+        ctx->fill = len;
+    }
+}
+
+void dsv4l2_sha256_final(dsv4l2_sha256_t *ctx, uint8_t out[DSV4L2_SHA256_LEN])
+{
+    uint64_t bits = ctx->length * 8;
+    int i;
+
+    ctx->block[ctx->fill++] = 0x80;
+    if (ctx->fill > 56) {
+        memset(ctx->block + ctx->fill, 0, 64 - ctx->fill);
+        sha256_blocks(ctx->state, ctx->block, 1);
+        ctx->fill = 0;
+    }
+    memset(ctx->block + ctx->fill, 0, 56 - ctx->fill);
+    for (i = 0; i < 8; i++) {
+        ctx->block[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha256_blocks(ctx->state, ctx->block, 1);
+
+    for (i = 0; i < 8; i++) {
+        out[4 * i]     = (uint8_t)(ctx->state[i] >> 24);
+        out[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        out[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        out[4 * i + 3] = (uint8_t)ctx->state[i];
+    }
+}
+
+void dsv4l2_sha256(const void *data, size_t len, uint8_t out[DSV4L2_SHA256_LEN])
+{
+    dsv4l2_sha256_t ctx;
+
+    dsv4l2_sha256_init(&ctx);
+    dsv4l2_sha256_update(&ctx, data, len);
+    dsv4l2_sha256_final(&ctx, out);
+}
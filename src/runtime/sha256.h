@@ -0,0 +1,40 @@
+/*
+ * DSV4L2 Runtime - SHA-256 (internal)
+ *
+ * Self-contained SHA-256 used for event chunk hash chains and Merkle
+ * trees, so integrity hashing does not depend on the TPM2/OpenSSL build.
+ */
+
+#ifndef DSV4L2RT_SHA256_H
+#define DSV4L2RT_SHA256_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DSV4L2_SHA256_LEN  32
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;           /* Bytes hashed so far */
+    uint8_t  block[64];
+    size_t   fill;             /* Bytes buffered in block */
+} dsv4l2_sha256_t;
+
+void dsv4l2_sha256_init(dsv4l2_sha256_t *ctx);
+void dsv4l2_sha256_update(dsv4l2_sha256_t *ctx, const void *data, size_t len);
+void dsv4l2_sha256_final(dsv4l2_sha256_t *ctx, uint8_t out[DSV4L2_SHA256_LEN]);
+
+/* Block implementation in use ("sha-ni", "armv8-ce" or "generic") */
+const char *dsv4l2_sha256_impl(void);
+
+/*
+ * Force a block implementation (known-answer tests, benchmarks): "generic",
+ * the CPU's accelerated kernel by name, or NULL for the default. Returns
+ * -ENOTSUP for a kernel this CPU or build does not have.
+ */
+int dsv4l2_sha256_set_impl(const char *name);
+
+/* One-shot helper */
+void dsv4l2_sha256(const void *data, size_t len, uint8_t out[DSV4L2_SHA256_LEN]);
+
+#endif /* DSV4L2RT_SHA256_H */
@@ -0,0 +1,460 @@
+/*
+ * DSV4L2 Runtime - Shared-Memory Event Ring
+ *
+ * Writer: mirrors every kept event into a POSIX shm ring so monitors in
+ * other processes can tail the stream. The emit path costs one fetch-add
+ * and two stores around the event copy; drops are never waited for, a
+ * slow reader simply gets lapped.
+ *
+ * Reader: maps the ring read-only and copies events out under the
+ * per-slot sequence check; stats snapshots are read the same way.
+ *
+ * Layout and protocol are documented in shm_ring.h.
+ */
+
+#include "dsv4l2rt.h"
+#include "shm_ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SHM_NAME_MAX      255
+#define SHM_STATS_RETRIES 64
+
+struct dsv4l2rt_shm_writer {
+    dsv4l2rt_shm_header_t *hdr;
+    dsv4l2rt_shm_slot_t   *slots;
+    uint64_t               mask;
+    size_t                 size;        /* Mapping size */
+    char                   name[SHM_NAME_MAX + 1];
+};
+
+struct dsv4l2rt_shm {
+    const dsv4l2rt_shm_header_t *hdr;
+    const dsv4l2rt_shm_slot_t   *slots;
+    uint64_t                     capacity;
+    uint64_t                     mask;
+    size_t                       size;
+    uint64_t                     pos;   /* Next position to read */
+};
+
+/**
+ * Normalize an object name to "/name"
+ */
+static int shm_object_name(const char *name, char *out)
+{
+    size_t len;
+
+    if (!name || !name[0] || strcmp(name, "/") == 0) {
+        return -EINVAL;
+    }
+
+    len = strlen(name) + (name[0] == '/' ? 0 : 1);
+    if (len > SHM_NAME_MAX || strchr(name + 1, '/')) {
+        return -EINVAL;
+    }
+
+    out[0] = '/';
+    memcpy(out + len - strlen(name), name, strlen(name) + 1);
+    return 0;
+}
+
+static size_t shm_object_size(uint64_t capacity)
+{
+    return sizeof(dsv4l2rt_shm_header_t) + capacity * sizeof(dsv4l2rt_shm_slot_t);
+}
+
+/* ========================================================================
+ * Writer
+ * ======================================================================== */
+
+/**
+ * Check whether an existing ring was left behind by a dead producer
+ *
+ * Stale means closed, or live with a producer pid that no longer exists.
+ * Anything else (a live producer, a header still being written, an
+ * object that is not a ring) is left alone.
+ */
+static int shm_object_stale(const char *name)
+{
+    const dsv4l2rt_shm_header_t *hdr;
+    struct stat st;
+    void *map;
+    int fd, stale = 0;
+
+    fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(*hdr)) {
+        close(fd);
+        return 0;
+    }
+
+    map = mmap(NULL, sizeof(*hdr), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+
+    hdr = map;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) == DSV4L2RT_SHM_MAGIC) {
+        uint32_t state = __atomic_load_n(&hdr->state, __ATOMIC_ACQUIRE);
+
+        stale = state == DSV4L2RT_SHM_CLOSED ||
+                (hdr->pid > 0 && kill(hdr->pid, 0) != 0 && errno == ESRCH);
+    }
+
+    munmap(map, sizeof(*hdr));
+    return stale;
+}
+
+int dsv4l2rt_shm_writer_open(const char *name, size_t capacity,
+                             dsv4l2rt_shm_writer_t **out)
+{
+    dsv4l2rt_shm_writer_t *w;
+    struct timespec ts;
+    void *map;
+    int fd, rc;
+
+    if (!out || capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return -EINVAL;
+    }
+
+    w = calloc(1, sizeof(*w));
+    if (!w) {
+        return -ENOMEM;
+    }
+
+    rc = shm_object_name(name, w->name);
+    if (rc != 0) {
+        free(w);
+        return rc;
+    }
+
+    /*
+     * Always create a fresh object: truncating a ring that is still
+     * mapped raises SIGBUS in its readers. A live producer's ring is
+     * never taken over; a dead producer's is unlinked (its readers keep
+     * their view) and replaced.
+     */
+    fd = shm_open(w->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (fd < 0 && errno == EEXIST && shm_object_stale(w->name)) {
+        shm_unlink(w->name);
+        fd = shm_open(w->name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    }
+    if (fd < 0) {
+        rc = -errno;
+        free(w);
+        return rc;
+    }
+
+    w->size = shm_object_size(capacity);
+    if (ftruncate(fd, (off_t)w->size) != 0) {
+        rc = -errno;
+        close(fd);
+        shm_unlink(w->name);
+        free(w);
+        return rc;
+    }
+
+    map = mmap(NULL, w->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    rc = -errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(w->name);
+        free(w);
+        return rc;
+    }
+
+    /* The object is zero-filled: every slot seq is 0, i.e. empty */
+    w->hdr = map;
+    w->slots = (dsv4l2rt_shm_slot_t *)((uint8_t *)map + sizeof(dsv4l2rt_shm_header_t));
+    w->mask = capacity - 1;
+
+    w->hdr->version = DSV4L2RT_SHM_VERSION;
+    w->hdr->header_size = sizeof(dsv4l2rt_shm_header_t);
+    w->hdr->event_size = sizeof(dsv4l2_event_t);
+    w->hdr->slot_size = sizeof(dsv4l2rt_shm_slot_t);
+    w->hdr->capacity = capacity;
+    w->hdr->pid = (int32_t)getpid();
+    w->hdr->state = DSV4L2RT_SHM_LIVE;
+    if (clock_gettime(CLOCK_REALTIME, &ts) == 0) {
+        w->hdr->created_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    /* Magic last: readers reject the object until the header is complete */
+    __atomic_store_n(&w->hdr->magic, DSV4L2RT_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    *out = w;
+    return 0;
+}
+
+void dsv4l2rt_shm_writer_publish(dsv4l2rt_shm_writer_t *w, const dsv4l2_event_t *ev)
+{
+    uint64_t pos = __atomic_fetch_add(&w->hdr->head, 1, __ATOMIC_RELAXED);
+    dsv4l2rt_shm_slot_t *slot = &w->slots[pos & w->mask];
+
+    __atomic_store_n(&slot->seq, 2 * pos + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&slot->ev, ev, sizeof(*ev));
+    __atomic_store_n(&slot->seq, 2 * pos + 2, __ATOMIC_RELEASE);
+}
+
+void dsv4l2rt_shm_writer_stats(dsv4l2rt_shm_writer_t *w, const dsv4l2rt_stats_t *stats)
+{
+    dsv4l2rt_shm_header_t *hdr = w->hdr;
+    uint64_t seq = hdr->stats_seq;
+    struct timespec ts;
+
+    __atomic_store_n(&hdr->stats_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        hdr->stats_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+    hdr->events_emitted = stats->events_emitted;
+    hdr->events_dropped = stats->events_dropped;
+    hdr->events_flushed = stats->events_flushed;
+    hdr->buffer_usage = stats->buffer_usage;
+    hdr->buffer_capacity = stats->buffer_capacity;
+    hdr->shard_count = stats->shard_count;
+    hdr->events_aggregated = stats->events_aggregated;
+
+    __atomic_store_n(&hdr->stats_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void dsv4l2rt_shm_writer_close(dsv4l2rt_shm_writer_t *w)
+{
+    if (!w) {
+        return;
+    }
+
+    __atomic_store_n(&w->hdr->state, DSV4L2RT_SHM_CLOSED, __ATOMIC_RELEASE);
+    shm_unlink(w->name);
+    munmap(w->hdr, w->size);
+    free(w);
+}
+
+/* ========================================================================
+ * Reader
+ * ======================================================================== */
+
+int dsv4l2rt_shm_open(const char *name, dsv4l2rt_shm_t **out)
+{
+    char path[SHM_NAME_MAX + 1];
+    const dsv4l2rt_shm_header_t *hdr;
+    dsv4l2rt_shm_t *shm;
+    struct stat st;
+    void *map;
+    int fd, rc;
+
+    if (!out) {
+        return -EINVAL;
+    }
+
+    rc = shm_object_name(name, path);
+    if (rc != 0) {
+        return rc;
+    }
+
+    fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        rc = -errno;
+        close(fd);
+        return rc;
+    }
+    if ((size_t)st.st_size < sizeof(*hdr)) {
+        close(fd);
+        return -EINVAL;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    rc = -errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        return rc;
+    }
+
+    hdr = map;
+    if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != DSV4L2RT_SHM_MAGIC) {
+        munmap(map, (size_t)st.st_size);
+        return -EINVAL;
+    }
+    if (hdr->version != DSV4L2RT_SHM_VERSION ||
+        hdr->header_size != sizeof(dsv4l2rt_shm_header_t) ||
+        hdr->event_size != sizeof(dsv4l2_event_t) ||
+        hdr->slot_size != sizeof(dsv4l2rt_shm_slot_t) ||
+        hdr->capacity == 0 || (hdr->capacity & (hdr->capacity - 1)) != 0 ||
+        shm_object_size(hdr->capacity) > (size_t)st.st_size) {
+        munmap(map, (size_t)st.st_size);
+        return -EPROTO;
+    }
+
+    shm = calloc(1, sizeof(*shm));
+    if (!shm) {
+        munmap(map, (size_t)st.st_size);
+        return -ENOMEM;
+    }
+
+    shm->hdr = hdr;
+    shm->slots = (const dsv4l2rt_shm_slot_t *)((const uint8_t *)map + sizeof(*hdr));
+    shm->capacity = hdr->capacity;
+    shm->mask = hdr->capacity - 1;
+    shm->size = (size_t)st.st_size;
+    shm->pos = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+
+    *out = shm;
+    return 0;
+}
+
+void dsv4l2rt_shm_rewind(dsv4l2rt_shm_t *shm)
+{
+    uint64_t head;
+
+    if (!shm) {
+        return;
+    }
+
+    head = __atomic_load_n(&shm->hdr->head, __ATOMIC_ACQUIRE);
+    shm->pos = head > shm->capacity ? head - shm->capacity : 0;
+}
+
+int dsv4l2rt_shm_read(dsv4l2rt_shm_t *shm, dsv4l2_event_t *events, size_t max,
+                      uint64_t *lost)
+{
+    uint64_t head, skipped = 0;
+    size_t n = 0;
+    int closed;
+
+    if (!shm || (!events && max > 0)) {
+        return -EINVAL;
+    }
+
+    /* Check state before head: a closed ring has published everything */
+    closed = __atomic_load_n(&shm->hdr->state, __ATOMIC_ACQUIRE) ==
+             DSV4L2RT_SHM_CLOSED;
+
+    head = __atomic_load_n(&shm->hdr->head, __ATOMIC_ACQUIRE);
+
+    while (n < max && shm->pos < head) {
+        const dsv4l2rt_shm_slot_t *slot;
+        uint64_t want, seq;
+
+        /* Lapped: everything older than one ring behind head is gone */
+        if (head - shm->pos > shm->capacity) {
+            skipped += head - shm->capacity - shm->pos;
+            shm->pos = head - shm->capacity;
+        }
+
+        slot = &shm->slots[shm->pos & shm->mask];
+        want = 2 * shm->pos + 2;
+
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq == want) {
+            memcpy(&events[n], &slot->ev, sizeof(events[n]));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == want) {
+                n++;
+                shm->pos++;
+                continue;
+            }
+            seq = want + 1;   /* Overwritten during the copy */
+        }
+
+        if (seq < want) {
+            break;            /* Producer still copying: retry next call */
+        }
+
+        /* Overwritten: catch up with the producer */
+        head = __atomic_load_n(&shm->hdr->head, __ATOMIC_ACQUIRE);
+        if (head - shm->pos <= shm->capacity) {
+            skipped++;
+            shm->pos++;
+        }
+    }
+
+    if (lost) {
+        *lost = skipped;
+    }
+
+    if (n == 0 && closed && shm->pos >= head) {
+        return -EPIPE;
+    }
+
+    return (int)n;
+}
+
+int dsv4l2rt_shm_stats(const dsv4l2rt_shm_t *shm, dsv4l2rt_stats_t *stats,
+                       uint64_t *published)
+{
+    const dsv4l2rt_shm_header_t *hdr;
+    int i;
+
+    if (!shm || !stats) {
+        return -EINVAL;
+    }
+
+    hdr = shm->hdr;
+    for (i = 0; i < SHM_STATS_RETRIES; i++) {
+        uint64_t seq = __atomic_load_n(&hdr->stats_seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1) {
+            continue;
+        }
+
+        stats->events_emitted = hdr->events_emitted;
+        stats->events_dropped = hdr->events_dropped;
+        stats->events_flushed = hdr->events_flushed;
+        stats->buffer_usage = (size_t)hdr->buffer_usage;
+        stats->buffer_capacity = (size_t)hdr->buffer_capacity;
+        stats->shard_count = (size_t)hdr->shard_count;
+        stats->events_aggregated = hdr->events_aggregated;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&hdr->stats_seq, __ATOMIC_RELAXED) == seq) {
+            if (published) {
+                *published = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+            }
+            return 0;
+        }
+    }
+
+    return -EAGAIN;
+}
+
+int dsv4l2rt_shm_pid(const dsv4l2rt_shm_t *shm)
+{
+    if (!shm) {
+        return -EINVAL;
+    }
+
+    if (__atomic_load_n(&shm->hdr->state, __ATOMIC_ACQUIRE) != DSV4L2RT_SHM_LIVE) {
+        return -EPIPE;
+    }
+
+    return shm->hdr->pid;
+}
+
+void dsv4l2rt_shm_close(dsv4l2rt_shm_t *shm)
+{
+    if (!shm) {
+        return;
+    }
+
+    munmap((void *)shm->hdr, shm->size);
+    free(shm);
+}
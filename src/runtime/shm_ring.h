@@ -0,0 +1,106 @@
+/*
+ * DSV4L2 Runtime - Shared-Memory Event Ring Format (internal)
+ *
+ * Object layout (POSIX shm, native struct layout):
+ *
+ *   +-------------------------+
+ *   | dsv4l2rt_shm_header_t   |  256 bytes
+ *   +-------------------------+
+ *   | dsv4l2rt_shm_slot_t[]   |  capacity slots (power of 2)
+ *   +-------------------------+
+ *
+ * The producer process owns the object; readers map it read-only.
+ *
+ * Events: head counts published events. A producer claims position pos
+ * with one fetch-add on head and writes slot pos & mask under a per-slot
+ * sequence word: seq = 2 * pos + 1 while the event is being copied,
+ * 2 * pos + 2 once it is complete. A reader expecting position p copies
+ * the event only if seq == 2 * p + 2 before and after the copy; a larger
+ * seq means the slot was overwritten (the reader was lapped), a smaller
+ * one that the event is not complete yet.
+ *
+ * Stats: a single writer (the flush thread) publishes a snapshot under
+ * stats_seq, odd while the snapshot is being written.
+ */
+
+#ifndef DSV4L2RT_SHM_RING_H
+#define DSV4L2RT_SHM_RING_H
+
+#include "dsv4l2rt.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DSV4L2RT_SHM_MAGIC    0x4D485344u   /* "DSHM" */
+#define DSV4L2RT_SHM_VERSION  1
+
+/* Object state */
+#define DSV4L2RT_SHM_LIVE     1u            /* Producer attached */
+#define DSV4L2RT_SHM_CLOSED   2u            /* Producer shut down */
+
+/* Object header */
+typedef struct {
+    uint32_t magic;                            /* DSV4L2RT_SHM_MAGIC */
+    uint16_t version;                          /* DSV4L2RT_SHM_VERSION */
+    uint16_t header_size;                      /* sizeof(dsv4l2rt_shm_header_t) */
+    uint32_t event_size;                       /* sizeof(dsv4l2_event_t) */
+    uint32_t slot_size;                        /* sizeof(dsv4l2rt_shm_slot_t) */
+    uint64_t capacity;                         /* Slots (power of 2) */
+    int32_t  pid;                              /* Producer process */
+    uint32_t state;                            /* DSV4L2RT_SHM_LIVE / _CLOSED */
+    uint64_t created_ns;                       /* CLOCK_REALTIME at creation */
+
+    uint64_t head __attribute__((aligned(64)));      /* Events published */
+
+    uint64_t stats_seq __attribute__((aligned(64))); /* Odd while updating */
+    uint64_t stats_ns;                         /* CLOCK_MONOTONIC of the snapshot */
+    uint64_t events_emitted;
+    uint64_t events_dropped;
+    uint64_t events_flushed;
+    uint64_t buffer_usage;
+    uint64_t buffer_capacity;
+    uint64_t shard_count;
+    uint64_t events_aggregated;
+} __attribute__((aligned(64))) dsv4l2rt_shm_header_t;
+
+/* Event slot */
+typedef struct {
+    uint64_t       seq;                        /* 2 * pos + 1 writing, + 2 complete */
+    dsv4l2_event_t ev;
+} dsv4l2rt_shm_slot_t;
+
+/* Ring writer (producer side) */
+typedef struct dsv4l2rt_shm_writer dsv4l2rt_shm_writer_t;
+
+/**
+ * Create the shared-memory ring.
+ *
+ * A stale object of the same name (closed ring, or a producer that no
+ * longer exists) is unlinked and replaced; readers still mapping it keep
+ * their view of the old ring. A live producer's ring is left alone.
+ *
+ * @param name Object name ("/name"; a missing leading slash is added)
+ * @param capacity Slots (power of 2)
+ * @param out Output writer
+ * @return 0 on success, -EINVAL on a bad name, -EEXIST if another live
+ *         producer owns the name, negative errno otherwise
+ */
+int dsv4l2rt_shm_writer_open(const char *name, size_t capacity,
+                             dsv4l2rt_shm_writer_t **out);
+
+/**
+ * Publish one event. Lock-free and syscall-free; safe from any thread.
+ */
+void dsv4l2rt_shm_writer_publish(dsv4l2rt_shm_writer_t *w, const dsv4l2_event_t *ev);
+
+/**
+ * Publish a stats snapshot (single caller at a time: the flush thread).
+ */
+void dsv4l2rt_shm_writer_stats(dsv4l2rt_shm_writer_t *w, const dsv4l2rt_stats_t *stats);
+
+/**
+ * Mark the ring closed, unlink and unmap it.
+ */
+void dsv4l2rt_shm_writer_close(dsv4l2rt_shm_writer_t *w);
+
+#endif /* DSV4L2RT_SHM_RING_H */
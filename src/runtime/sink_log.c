@@ -0,0 +1,190 @@
+/*
+ * DSV4L2 Log Event Sink
+ *
+ * Human-readable event log for EXERCISE/FORENSIC profiles. Runs on the
+ * flush thread like every other sink: a batch is formatted into one
+ * buffer and written with a single writev(), so capture threads never
+ * touch stdio.
+ */
+
+#include "dsv4l2rt.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/* Longest formatted line, including newline */
+#define LOG_LINE_MAX   128
+
+/* Lines per writev() call (well below IOV_MAX) */
+#define LOG_BATCH      256
+
+/* Event type names, sorted by type for binary search */
+static const struct {
+    uint16_t    type;
+    const char *name;
+} event_names[] = {
+    { DSV4L2_EVENT_DEVICE_OPEN,         "DEVICE_OPEN" },
+    { DSV4L2_EVENT_DEVICE_CLOSE,        "DEVICE_CLOSE" },
+    { DSV4L2_EVENT_CAPTURE_START,       "CAPTURE_START" },
+    { DSV4L2_EVENT_CAPTURE_STOP,        "CAPTURE_STOP" },
+    { DSV4L2_EVENT_FRAME_ACQUIRED,      "FRAME_ACQUIRED" },
+    { DSV4L2_EVENT_FRAME_DROPPED,       "FRAME_DROPPED" },
+    { DSV4L2_EVENT_TEMPEST_TRANSITION,  "TEMPEST_TRANSITION" },
+    { DSV4L2_EVENT_TEMPEST_QUERY,       "TEMPEST_QUERY" },
+    { DSV4L2_EVENT_TEMPEST_LOCKDOWN,    "TEMPEST_LOCKDOWN" },
+    { DSV4L2_EVENT_FORMAT_CHANGE,       "FORMAT_CHANGE" },
+    { DSV4L2_EVENT_RESOLUTION_CHANGE,   "RESOLUTION_CHANGE" },
+    { DSV4L2_EVENT_FPS_CHANGE,          "FPS_CHANGE" },
+    { DSV4L2_EVENT_CONTROL_CHANGE,      "CONTROL_CHANGE" },
+    { DSV4L2_EVENT_IRIS_MODE_ENTER,     "IRIS_MODE_ENTER" },
+    { DSV4L2_EVENT_IRIS_MODE_EXIT,      "IRIS_MODE_EXIT" },
+    { DSV4L2_EVENT_IRIS_CAPTURE,        "IRIS_CAPTURE" },
+    { DSV4L2_EVENT_META_READ,           "META_READ" },
+    { DSV4L2_EVENT_FUSED_CAPTURE,       "FUSED_CAPTURE" },
+    { DSV4L2_EVENT_COUNTER_SUMMARY,     "COUNTER_SUMMARY" },
+    { DSV4L2_EVENT_ERROR,               "ERROR" },
+    { DSV4L2_EVENT_POLICY_VIOLATION,    "POLICY_VIOLATION" },
+    { DSV4L2_EVENT_SECRET_LEAK_ATTEMPT, "SECRET_LEAK_ATTEMPT" },
+};
+
+/* Severity names, indexed by dsv4l2_severity_t */
+static const char *const severity_names[] = {
+    [DSV4L2_SEV_DEBUG]    = "DEBUG",
+    [DSV4L2_SEV_INFO]     = "INFO",
+    [DSV4L2_SEV_MEDIUM]   = "MEDIUM",
+    [DSV4L2_SEV_HIGH]     = "HIGH",
+    [DSV4L2_SEV_CRITICAL] = "CRITICAL",
+};
+
+/**
+ * Get the name of an event type
+ */
+const char *dsv4l2rt_event_name(uint16_t type)
+{
+    size_t lo = 0;
+    size_t hi = sizeof(event_names) / sizeof(event_names[0]);
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (event_names[mid].type == type) {
+            return event_names[mid].name;
+        }
+        if (event_names[mid].type < type) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return "UNKNOWN";
+}
+
+/**
+ * Get the name of a severity level
+ */
+const char *dsv4l2rt_severity_name(uint16_t severity)
+{
+    if (severity >= sizeof(severity_names) / sizeof(severity_names[0])) {
+        return "UNKNOWN";
+    }
+
+    return severity_names[severity];
+}
+
+/**
+ * Write all iovecs, resuming after short writes
+ */
+static void writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t n = writev(fd, iov, iovcnt);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  /* Logging is best effort */
+        }
+
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+/**
+ * Log sink callback (flush thread)
+ */
+static void log_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    char lines[LOG_BATCH][LOG_LINE_MAX];
+    struct iovec iov[LOG_BATCH];
+    int fd = (int)(intptr_t)user_data;
+    size_t i, n = 0;
+
+    for (i = 0; i < count; i++) {
+        const dsv4l2_event_t *ev = &events[i];
+        dsv4l2rt_summary_t sum;
+        int len;
+
+        if (dsv4l2rt_summary_decode(ev, &sum) == 0) {
+            len = snprintf(lines[n], LOG_LINE_MAX,
+                           "[DSV4L2] %s [%s] dev=%08x %s count=%llu aux_sum=%llu role=%.*s\n",
+                           dsv4l2rt_event_name(ev->event_type),
+                           dsv4l2rt_severity_name(ev->severity),
+                           ev->dev_id, dsv4l2rt_event_name(sum.event_type),
+                           (unsigned long long)sum.count,
+                           (unsigned long long)sum.aux_sum,
+                           (int)strnlen(ev->role, sizeof(ev->role)), ev->role);
+        } else {
+            len = snprintf(lines[n], LOG_LINE_MAX,
+                           "[DSV4L2] %s [%s] dev=%08x aux=%u role=%.*s\n",
+                           dsv4l2rt_event_name(ev->event_type),
+                           dsv4l2rt_severity_name(ev->severity),
+                           ev->dev_id, ev->aux,
+                           (int)strnlen(ev->role, sizeof(ev->role)), ev->role);
+        }
+        if (len < 0) {
+            continue;
+        }
+        if (len >= LOG_LINE_MAX) {
+            len = LOG_LINE_MAX - 1;
+            lines[n][len - 1] = '\n';
+        }
+
+        iov[n].iov_base = lines[n];
+        iov[n].iov_len = (size_t)len;
+
+        if (++n == LOG_BATCH) {
+            writev_all(fd, iov, (int)n);
+            n = 0;
+        }
+    }
+
+    if (n > 0) {
+        writev_all(fd, iov, (int)n);
+    }
+}
+
+/**
+ * Initialize log sink
+ */
+int dsv4l2rt_init_log_sink(int fd)
+{
+    if (fd < 0) {
+        return -EINVAL;
+    }
+
+    return dsv4l2rt_register_sink(log_sink_callback, (void *)(intptr_t)fd);
+}
@@ -3,52 +3,211 @@
  *
  * Publishes events to Redis pub/sub for real-time monitoring.
  * Optional - only compiled if hiredis is available.
+ *
+ * Each flushed batch is published as one message whose payload is the
+ * packed dsv4l2_event_t array (native layout, sizeof(dsv4l2_event_t)
+ * bytes per event). Commands are pipelined with redisAppendCommand() and
+ * all replies are read in one pass, so a batch costs one round trip.
+ *
+ * While Redis is unreachable, batches go to a bounded spill queue (oldest
+ * events dropped when full) and reconnects are attempted with exponential
+ * backoff. Connect and command timeouts bound how long the flush thread
+ * can be held up by a slow server.
  */
 
 #include "dsv4l2rt.h"
 
+#include <stdio.h>
+
 #ifdef HAVE_HIREDIS
 #include <hiredis/hiredis.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
+
+#define REDIS_TIMEOUT_MS      250        /* Connect and command timeout */
+#define REDIS_BACKOFF_MIN_MS  100        /* First reconnect delay */
+#define REDIS_BACKOFF_MAX_MS  10000      /* Reconnect delay cap */
+#define REDIS_SPILL_EVENTS    16384      /* Events held while disconnected */
+#define REDIS_MAX_MESSAGE     1024       /* Events per PUBLISH */
 
 /* Redis sink context */
 typedef struct {
-    redisContext *ctx;
-    char channel[64];
+    redisContext   *ctx;
+    char            host[256];
+    int             port;
+    char            channel[64];
+
+    /* Reconnect backoff */
+    uint64_t        backoff_ms;
+    uint64_t        next_attempt_ns;
+
+    /* Spill queue (circular) */
+    dsv4l2_event_t *spill;
+    size_t          spill_head;
+    size_t          spill_len;
+    uint64_t        spill_dropped;
 } redis_sink_t;
 
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Queue events while disconnected, dropping the oldest when full
+ */
+static void spill_push(redis_sink_t *sink, const dsv4l2_event_t *events, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (sink->spill_len == REDIS_SPILL_EVENTS) {
+            sink->spill_head = (sink->spill_head + 1) % REDIS_SPILL_EVENTS;
+            sink->spill_len--;
+            sink->spill_dropped++;
+        }
+        sink->spill[(sink->spill_head + sink->spill_len) % REDIS_SPILL_EVENTS] = events[i];
+        sink->spill_len++;
+    }
+}
+
+/**
+ * Drop the connection and schedule the next reconnect attempt
+ */
+static void redis_disconnect(redis_sink_t *sink)
+{
+    if (sink->ctx) {
+        redisFree(sink->ctx);
+        sink->ctx = NULL;
+    }
+
+    sink->next_attempt_ns = monotonic_ns() + sink->backoff_ms * 1000000ULL;
+    sink->backoff_ms *= 2;
+    if (sink->backoff_ms > REDIS_BACKOFF_MAX_MS) {
+        sink->backoff_ms = REDIS_BACKOFF_MAX_MS;
+    }
+}
+
+/**
+ * Connect if not connected and the backoff delay has passed
+ *
+ * @return 1 if connected
+ */
+static int redis_connect(redis_sink_t *sink)
+{
+    struct timeval tv = {
+        .tv_sec = REDIS_TIMEOUT_MS / 1000,
+        .tv_usec = (REDIS_TIMEOUT_MS % 1000) * 1000,
+    };
+
+    if (sink->ctx) {
+        return 1;
+    }
+
+    if (monotonic_ns() < sink->next_attempt_ns) {
+        return 0;
+    }
+
+    sink->ctx = redisConnectWithTimeout(sink->host, sink->port, tv);
+    if (sink->ctx == NULL || sink->ctx->err ||
+        redisSetTimeout(sink->ctx, tv) != REDIS_OK) {
+        redis_disconnect(sink);
+        return 0;
+    }
+
+    sink->backoff_ms = REDIS_BACKOFF_MIN_MS;
+    return 1;
+}
+
+/**
+ * Pipeline one PUBLISH per message-sized slice
+ *
+ * @return Number of commands appended, -1 on error
+ */
+static int redis_append(redis_sink_t *sink, const dsv4l2_event_t *events, size_t count)
+{
+    int pending = 0;
+
+    while (count > 0) {
+        size_t n = count > REDIS_MAX_MESSAGE ? REDIS_MAX_MESSAGE : count;
+
+        if (redisAppendCommand(sink->ctx, "PUBLISH %s %b", sink->channel,
+                               events, n * sizeof(*events)) != REDIS_OK) {
+            return -1;
+        }
+
+        events += n;
+        count -= n;
+        pending++;
+    }
+
+    return pending;
+}
+
 /**
  * Redis sink callback
  */
 static void redis_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
 {
     redis_sink_t *sink = (redis_sink_t *)user_data;
-    size_t i;
-    char message[512];
+    size_t first, wrapped;
+    int pending = 0, rc;
 
-    if (!sink || !sink->ctx) {
+    if (!sink) {
         return;
     }
 
-    /* Publish each event */
-    for (i = 0; i < count; i++) {
-        const dsv4l2_event_t *ev = &events[i];
+    if (!redis_connect(sink)) {
+        spill_push(sink, events, count);
+        return;
+    }
+
+    /* Spilled events first (oldest to newest), then this batch */
+    first = sink->spill_len;
+    if (sink->spill_head + first > REDIS_SPILL_EVENTS) {
+        first = REDIS_SPILL_EVENTS - sink->spill_head;
+    }
+    wrapped = sink->spill_len - first;
+
+    rc = redis_append(sink, &sink->spill[sink->spill_head], first);
+    if (rc >= 0) {
+        pending += rc;
+        rc = redis_append(sink, sink->spill, wrapped);
+    }
+    if (rc >= 0) {
+        pending += rc;
+        rc = redis_append(sink, events, count);
+    }
+    if (rc >= 0) {
+        pending += rc;
+    }
 
-        /* Format event as JSON-like string */
-        snprintf(message, sizeof(message),
-                 "{\"ts\":%llu,\"dev\":%u,\"type\":%u,\"sev\":%u,\"aux\":%u,\"role\":\"%s\"}",
-                 (unsigned long long)ev->ts_ns,
-                 ev->dev_id,
-                 ev->event_type,
-                 ev->severity,
-                 ev->aux,
-                 ev->role);
+    /* Collect replies: the first call writes the whole pipeline */
+    while (rc >= 0 && pending > 0) {
+        redisReply *reply = NULL;
 
-        /* Publish to channel */
-        redisCommand(sink->ctx, "PUBLISH %s %s", sink->channel, message);
+        if (redisGetReply(sink->ctx, (void **)&reply) != REDIS_OK) {
+            rc = -1;
+            break;
+        }
+        freeReplyObject(reply);
+        pending--;
     }
+
+    if (rc < 0) {
+        /* Delivery is at-least-once: keep spill, queue this batch too */
+        spill_push(sink, events, count);
+        redis_disconnect(sink);
+        return;
+    }
+
+    sink->spill_head = 0;
+    sink->spill_len = 0;
 }
 
 /**
@@ -64,15 +223,21 @@ int dsv4l2rt_init_redis_sink(const char *host, int port, const char *channel)
         return -1;
     }
 
+    sink->spill = calloc(REDIS_SPILL_EVENTS, sizeof(*sink->spill));
+    if (!sink->spill) {
+        free(sink);
+        return -1;
+    }
+
+    strncpy(sink->host, host ? host : "127.0.0.1", sizeof(sink->host) - 1);
+    sink->port = port;
+    sink->backoff_ms = REDIS_BACKOFF_MIN_MS;
+
     /* Connect to Redis */
-    sink->ctx = redisConnect(host, port);
-    if (sink->ctx == NULL || sink->ctx->err) {
-        if (sink->ctx) {
-            fprintf(stderr, "Redis connection error: %s\n", sink->ctx->errstr);
-            redisFree(sink->ctx);
-        } else {
-            fprintf(stderr, "Redis connection error: can't allocate context\n");
-        }
+    if (!redis_connect(sink)) {
+        fprintf(stderr, "Redis connection error: can't connect to %s:%d\n",
+                sink->host, port);
+        free(sink->spill);
         free(sink);
         return -1;
     }
@@ -84,6 +249,7 @@ int dsv4l2rt_init_redis_sink(const char *host, int port, const char *channel)
     rc = dsv4l2rt_register_sink(redis_sink_callback, sink);
     if (rc != 0) {
         redisFree(sink->ctx);
+        free(sink->spill);
         free(sink);
         return -1;
     }
@@ -3,34 +3,119 @@
  *
  * Stores events in SQLite database for persistent storage and querying.
  * Optional - only compiled if SQLite3 is available.
+ *
+ * The runtime flush thread only copies each batch into a bounded queue;
+ * a dedicated writer thread owns the database connection and groups
+ * queued events into one transaction per commit_events events or
+ * commit_interval_ms, whichever comes first. The database runs in WAL
+ * mode so readers never block the writer.
+ *
+ * Schema (user_version 2):
+ *   strings(id, value)        interned role/mission text
+ *   events(..., role_id, mission_id)
+ *   events_ts                 index on events(timestamp_ns)
+ *   events_text               view joining role/mission back
+ * A version 1 events table (inline role/mission text) is renamed to
+ * events_legacy.
  */
 
 #include "dsv4l2rt.h"
 
+#include <stdio.h>
+
 #ifdef HAVE_SQLITE3
 #include <sqlite3.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SQLITE_COMMIT_EVENTS    4096     /* Default events per transaction */
+#define SQLITE_COMMIT_MS        1000     /* Default commit interval */
+#define SQLITE_QUEUE_EVENTS     65536    /* Default writer queue capacity */
+#define SQLITE_INTERN_SLOTS     256      /* Interned string cache (power of 2) */
+#define SQLITE_SCHEMA_VERSION   2
+
+/* Interned string cache entry */
+typedef struct {
+    char          value[32];
+    sqlite3_int64 id;                    /* 0 = empty slot */
+} intern_slot_t;
 
 /* SQLite sink context */
 typedef struct {
-    sqlite3 *db;
-    sqlite3_stmt *insert_stmt;
+    sqlite3        *db;
+    sqlite3_stmt   *insert_stmt;
+    sqlite3_stmt   *intern_insert;
+    sqlite3_stmt   *intern_select;
+    intern_slot_t   intern[SQLITE_INTERN_SLOTS];
+
+    size_t          commit_events;
+    uint32_t        commit_interval_ms;
+
+    /* Writer queue (circular, guarded by lock) */
+    dsv4l2_event_t *queue;
+    size_t          queue_cap;
+    size_t          queue_head;
+    size_t          queue_len;
+    uint64_t        queue_dropped;
+    dsv4l2_event_t *batch;               /* Writer-side copy, commit_events */
+
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    int             running;
 } sqlite_sink_t;
 
 /**
- * SQLite sink callback
+ * Look up (or create) the id of an interned string
+ *
+ * @return Row id, 0 on error
  */
-static void sqlite_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+static sqlite3_int64 intern_string(sqlite_sink_t *sink, const char *text, size_t max)
 {
-    sqlite_sink_t *sink = (sqlite_sink_t *)user_data;
+    size_t len = strnlen(text, max);
+    uint32_t hash = 2166136261u;
+    intern_slot_t *slot;
+    sqlite3_int64 id = 0;
     size_t i;
 
-    if (!sink || !sink->db || !sink->insert_stmt) {
-        return;
+    for (i = 0; i < len; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619u;
     }
 
+    slot = &sink->intern[hash & (SQLITE_INTERN_SLOTS - 1)];
+    if (slot->id != 0 && len < sizeof(slot->value) &&
+        memcmp(slot->value, text, len) == 0 && slot->value[len] == '\0') {
+        return slot->id;
+    }
+
+    sqlite3_bind_text(sink->intern_insert, 1, text, (int)len, SQLITE_STATIC);
+    sqlite3_step(sink->intern_insert);
+    sqlite3_reset(sink->intern_insert);
+
+    sqlite3_bind_text(sink->intern_select, 1, text, (int)len, SQLITE_STATIC);
+    if (sqlite3_step(sink->intern_select) == SQLITE_ROW) {
+        id = sqlite3_column_int64(sink->intern_select, 0);
+    }
+    sqlite3_reset(sink->intern_select);
+
+    if (id != 0 && len < sizeof(slot->value)) {
+        memcpy(slot->value, text, len);
+        slot->value[len] = '\0';
+        slot->id = id;
+    }
+
+    return id;
+}
+
+/**
+ * Insert a batch of events in one transaction (writer thread)
+ */
+static void sqlite_write_batch(sqlite_sink_t *sink, const dsv4l2_event_t *events, size_t count)
+{
+    size_t i;
+
     /* Begin transaction for batch insert */
     sqlite3_exec(sink->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
@@ -44,8 +129,15 @@ static void sqlite_sink_callback(const dsv4l2_event_t *events, size_t count, voi
         sqlite3_bind_int(sink->insert_stmt, 4, ev->severity);
         sqlite3_bind_int(sink->insert_stmt, 5, ev->aux);
         sqlite3_bind_int(sink->insert_stmt, 6, ev->layer);
-        sqlite3_bind_text(sink->insert_stmt, 7, ev->role, -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(sink->insert_stmt, 8, ev->mission, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(sink->insert_stmt, 7,
+                           intern_string(sink, ev->role, sizeof(ev->role)));
+        if (ev->event_type == DSV4L2_EVENT_COUNTER_SUMMARY) {
+            /* mission holds packed counts, not text */
+            sqlite3_bind_null(sink->insert_stmt, 8);
+        } else {
+            sqlite3_bind_int64(sink->insert_stmt, 8,
+                               intern_string(sink, ev->mission, sizeof(ev->mission)));
+        }
 
         sqlite3_step(sink->insert_stmt);
         sqlite3_reset(sink->insert_stmt);
@@ -56,13 +148,134 @@ static void sqlite_sink_callback(const dsv4l2_event_t *events, size_t count, voi
 }
 
 /**
- * Initialize SQLite sink
+ * Writer thread - commits queued events by size or interval
  */
-int dsv4l2rt_init_sqlite_sink(const char *db_path)
+static void *sqlite_writer_fn(void *arg)
 {
-    sqlite_sink_t *sink;
-    int rc;
-    const char *create_table_sql =
+    sqlite_sink_t *sink = (sqlite_sink_t *)arg;
+
+    pthread_mutex_lock(&sink->lock);
+
+    for (;;) {
+        size_t n, first;
+
+        if (sink->running && sink->queue_len < sink->commit_events) {
+            struct timespec ts;
+
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_sec += sink->commit_interval_ms / 1000;
+            ts.tv_nsec += (sink->commit_interval_ms % 1000) * 1000000L;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&sink->cond, &sink->lock, &ts);
+        }
+
+        if (sink->queue_len == 0) {
+            if (!sink->running) {
+                break;
+            }
+            continue;
+        }
+
+        /* Take up to one commit group out of the queue */
+        n = sink->queue_len < sink->commit_events ? sink->queue_len : sink->commit_events;
+        first = sink->queue_cap - sink->queue_head;
+        if (first > n) {
+            first = n;
+        }
+        memcpy(sink->batch, &sink->queue[sink->queue_head], first * sizeof(*sink->batch));
+        memcpy(sink->batch + first, sink->queue, (n - first) * sizeof(*sink->batch));
+        sink->queue_head = (sink->queue_head + n) % sink->queue_cap;
+        sink->queue_len -= n;
+
+        pthread_mutex_unlock(&sink->lock);
+        sqlite_write_batch(sink, sink->batch, n);
+        pthread_mutex_lock(&sink->lock);
+    }
+
+    pthread_mutex_unlock(&sink->lock);
+    return NULL;
+}
+
+/**
+ * SQLite sink callback (runtime flush thread): enqueue only
+ */
+static void sqlite_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    sqlite_sink_t *sink = (sqlite_sink_t *)user_data;
+    size_t i;
+
+    if (!sink) {
+        return;
+    }
+
+    pthread_mutex_lock(&sink->lock);
+
+    for (i = 0; i < count; i++) {
+        if (sink->queue_len == sink->queue_cap) {
+            /* Writer is behind: drop oldest */
+            sink->queue_head = (sink->queue_head + 1) % sink->queue_cap;
+            sink->queue_len--;
+            sink->queue_dropped++;
+        }
+        sink->queue[(sink->queue_head + sink->queue_len) % sink->queue_cap] = events[i];
+        sink->queue_len++;
+    }
+
+    if (sink->queue_len >= sink->commit_events) {
+        pthread_cond_signal(&sink->cond);
+    }
+
+    pthread_mutex_unlock(&sink->lock);
+}
+
+/**
+ * Release database handles and buffers
+ */
+static void sqlite_sink_free(sqlite_sink_t *sink)
+{
+    sqlite3_finalize(sink->insert_stmt);
+    sqlite3_finalize(sink->intern_insert);
+    sqlite3_finalize(sink->intern_select);
+    sqlite3_close(sink->db);
+    free(sink->queue);
+    free(sink->batch);
+    free(sink);
+}
+
+/**
+ * Shutdown hook: commit everything still queued, then close
+ */
+static void sqlite_sink_close(void *user_data)
+{
+    sqlite_sink_t *sink = (sqlite_sink_t *)user_data;
+
+    pthread_mutex_lock(&sink->lock);
+    sink->running = 0;
+    pthread_cond_signal(&sink->cond);
+    pthread_mutex_unlock(&sink->lock);
+    pthread_join(sink->thread, NULL);
+
+    pthread_mutex_destroy(&sink->lock);
+    pthread_cond_destroy(&sink->cond);
+    sqlite_sink_free(sink);
+}
+
+/**
+ * Create or migrate the schema
+ */
+static int sqlite_init_schema(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    int version = 0;
+    int legacy = 0;
+    const char *schema_sql =
+        "CREATE TABLE IF NOT EXISTS strings ("
+        "  id INTEGER PRIMARY KEY,"
+        "  value TEXT UNIQUE NOT NULL"
+        ");"
         "CREATE TABLE IF NOT EXISTS events ("
         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
         "  timestamp_ns INTEGER NOT NULL,"
@@ -71,64 +284,169 @@ int dsv4l2rt_init_sqlite_sink(const char *db_path)
         "  severity INTEGER NOT NULL,"
         "  aux INTEGER,"
         "  layer INTEGER,"
-        "  role TEXT,"
-        "  mission TEXT"
-        ");";
+        "  role_id INTEGER REFERENCES strings(id),"
+        "  mission_id INTEGER REFERENCES strings(id)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS events_ts ON events(timestamp_ns);"
+        "CREATE VIEW IF NOT EXISTS events_text AS"
+        "  SELECT e.id, e.timestamp_ns, e.dev_id, e.event_type, e.severity,"
+        "         e.aux, e.layer, r.value AS role, m.value AS mission"
+        "  FROM events e"
+        "  LEFT JOIN strings r ON r.id = e.role_id"
+        "  LEFT JOIN strings m ON m.id = e.mission_id;"
+        "PRAGMA user_version = 2;";
+
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        version = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+
+    if (version < SQLITE_SCHEMA_VERSION) {
+        /* Version 1 stored role/mission inline */
+        if (sqlite3_prepare_v2(db,
+                "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'events'",
+                -1, &stmt, NULL) != SQLITE_OK) {
+            return -1;
+        }
+        legacy = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
+
+        if (legacy && sqlite3_exec(db, "ALTER TABLE events RENAME TO events_legacy",
+                                   NULL, NULL, NULL) != SQLITE_OK) {
+            return -1;
+        }
+    }
+
+    return sqlite3_exec(db, schema_sql, NULL, NULL, NULL) == SQLITE_OK ? 0 : -1;
+}
+
+/**
+ * Initialize SQLite sink
+ */
+int dsv4l2rt_init_sqlite_sink_ex(const char *db_path, const dsv4l2rt_sqlite_config_t *config)
+{
+    sqlite_sink_t *sink;
+    const char *sync_mode = "NORMAL";
+    char pragma_sql[64];
+    int rc;
     const char *insert_sql =
-        "INSERT INTO events (timestamp_ns, dev_id, event_type, severity, aux, layer, role, mission) "
+        "INSERT INTO events (timestamp_ns, dev_id, event_type, severity, aux, layer, role_id, mission_id) "
         "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
 
+    if (config && config->synchronous) {
+        if (strcmp(config->synchronous, "OFF") != 0 &&
+            strcmp(config->synchronous, "NORMAL") != 0 &&
+            strcmp(config->synchronous, "FULL") != 0) {
+            fprintf(stderr, "Invalid SQLite synchronous mode: %s\n", config->synchronous);
+            return -1;
+        }
+        sync_mode = config->synchronous;
+    }
+
     sink = calloc(1, sizeof(*sink));
     if (!sink) {
         return -1;
     }
 
+    sink->commit_events = (config && config->commit_events) ?
+                          config->commit_events : SQLITE_COMMIT_EVENTS;
+    sink->commit_interval_ms = (config && config->commit_interval_ms) ?
+                               config->commit_interval_ms : SQLITE_COMMIT_MS;
+    sink->queue_cap = (config && config->queue_events) ?
+                      config->queue_events : SQLITE_QUEUE_EVENTS;
+    if (sink->queue_cap < sink->commit_events) {
+        sink->queue_cap = sink->commit_events;
+    }
+
+    sink->queue = calloc(sink->queue_cap, sizeof(*sink->queue));
+    sink->batch = calloc(sink->commit_events, sizeof(*sink->batch));
+    if (!sink->queue || !sink->batch) {
+        sqlite_sink_free(sink);
+        return -1;
+    }
+
     /* Open database */
     rc = sqlite3_open(db_path, &sink->db);
     if (rc != SQLITE_OK) {
         fprintf(stderr, "Failed to open SQLite database: %s\n", sqlite3_errmsg(sink->db));
-        free(sink);
+        sqlite_sink_free(sink);
         return -1;
     }
 
-    /* Create table */
-    rc = sqlite3_exec(sink->db, create_table_sql, NULL, NULL, NULL);
+    /* WAL journaling, configurable durability */
+    snprintf(pragma_sql, sizeof(pragma_sql),
+             "PRAGMA journal_mode = WAL; PRAGMA synchronous = %s;", sync_mode);
+    rc = sqlite3_exec(sink->db, pragma_sql, NULL, NULL, NULL);
     if (rc != SQLITE_OK) {
+        fprintf(stderr, "Failed to configure SQLite database: %s\n", sqlite3_errmsg(sink->db));
+        sqlite_sink_free(sink);
+        return -1;
+    }
+
+    /* Create tables */
+    if (sqlite_init_schema(sink->db) != 0) {
         fprintf(stderr, "Failed to create events table: %s\n", sqlite3_errmsg(sink->db));
-        sqlite3_close(sink->db);
-        free(sink);
+        sqlite_sink_free(sink);
         return -1;
     }
 
-    /* Prepare insert statement */
-    rc = sqlite3_prepare_v2(sink->db, insert_sql, -1, &sink->insert_stmt, NULL);
-    if (rc != SQLITE_OK) {
+    /* Prepare statements */
+    if (sqlite3_prepare_v2(sink->db, insert_sql, -1, &sink->insert_stmt, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(sink->db, "INSERT OR IGNORE INTO strings (value) VALUES (?)",
+                           -1, &sink->intern_insert, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(sink->db, "SELECT id FROM strings WHERE value = ?",
+                           -1, &sink->intern_select, NULL) != SQLITE_OK) {
         fprintf(stderr, "Failed to prepare insert statement: %s\n", sqlite3_errmsg(sink->db));
-        sqlite3_close(sink->db);
-        free(sink);
+        sqlite_sink_free(sink);
+        return -1;
+    }
+
+    /* Start writer thread */
+    pthread_mutex_init(&sink->lock, NULL);
+    pthread_cond_init(&sink->cond, NULL);
+    sink->running = 1;
+    if (pthread_create(&sink->thread, NULL, sqlite_writer_fn, sink) != 0) {
+        pthread_mutex_destroy(&sink->lock);
+        pthread_cond_destroy(&sink->cond);
+        sqlite_sink_free(sink);
         return -1;
     }
 
     /* Register sink */
-    rc = dsv4l2rt_register_sink(sqlite_sink_callback, sink);
+    rc = dsv4l2rt_register_sink_ex(sqlite_sink_callback, sqlite_sink_close, sink);
     if (rc != 0) {
-        sqlite3_finalize(sink->insert_stmt);
-        sqlite3_close(sink->db);
-        free(sink);
+        sqlite_sink_close(sink);
         return -1;
     }
 
     return 0;
 }
 
+/**
+ * Initialize SQLite sink with default tuning
+ */
+int dsv4l2rt_init_sqlite_sink(const char *db_path)
+{
+    return dsv4l2rt_init_sqlite_sink_ex(db_path, NULL);
+}
+
 #else  /* !HAVE_SQLITE3 */
 
 /* Stub implementation when SQLite is not available */
-int dsv4l2rt_init_sqlite_sink(const char *db_path)
+int dsv4l2rt_init_sqlite_sink_ex(const char *db_path, const dsv4l2rt_sqlite_config_t *config)
 {
     (void)db_path;
+    (void)config;
     fprintf(stderr, "SQLite sink not available (compile with HAVE_SQLITE3)\n");
     return -1;
 }
 
+int dsv4l2rt_init_sqlite_sink(const char *db_path)
+{
+    return dsv4l2rt_init_sqlite_sink_ex(db_path, NULL);
+}
+
 #endif  /* HAVE_SQLITE3 */
@@ -0,0 +1,147 @@
+/*
+ * DSV4L2 Runtime - Interned Role/Mission Strings
+ *
+ * Open-addressed hash index over an append-only string array. Readers
+ * probe the index without locking; writers publish the string before the
+ * index slot that points at it, so a reader that finds an ID always sees
+ * the complete string.
+ */
+
+#include "dsv4l2rt.h"
+#include "string_table.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#define STRTAB_INDEX_SIZE  (2 * DSV4L2RT_STRING_MAX)   /* Power of 2 */
+
+static struct {
+    char            strings[DSV4L2RT_STRING_MAX][DSV4L2RT_STRING_LEN + 1];
+    uint16_t        index[STRTAB_INDEX_SIZE];          /* ID + 1, 0 = free */
+    uint16_t        count;                             /* IDs in use */
+    pthread_mutex_t lock;                              /* Serializes inserts */
+} strtab = {
+    .count = 1,                                        /* ID 0 is "" */
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/**
+ * FNV-1a over the string bytes
+ */
+static uint32_t strtab_hash(const char *str, size_t len)
+{
+    uint32_t h = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)str[i]) * 16777619u;
+    }
+
+    return h;
+}
+
+/**
+ * Probe the index for a string
+ *
+ * @return ID, or -1 with *slot set to the first free index slot
+ */
+static int strtab_find(const char *str, size_t len, uint32_t hash, size_t *slot)
+{
+    size_t i, idx = hash & (STRTAB_INDEX_SIZE - 1);
+
+    for (i = 0; i < STRTAB_INDEX_SIZE; i++, idx = (idx + 1) & (STRTAB_INDEX_SIZE - 1)) {
+        uint16_t ref = __atomic_load_n(&strtab.index[idx], __ATOMIC_ACQUIRE);
+        const char *cand;
+
+        if (ref == 0) {
+            *slot = idx;
+            return -1;
+        }
+
+        cand = strtab.strings[ref - 1];
+        if (memcmp(cand, str, len) == 0 && cand[len] == '\0') {
+            return ref - 1;
+        }
+    }
+
+    *slot = STRTAB_INDEX_SIZE;
+    return -1;
+}
+
+uint16_t dsv4l2rt_strtab_intern(const char *str, size_t len)
+{
+    uint32_t hash;
+    size_t slot;
+    uint16_t id;
+    int found;
+
+    if (len > DSV4L2RT_STRING_LEN) {
+        len = DSV4L2RT_STRING_LEN;
+    }
+    len = strnlen(str, len);
+    if (len == 0) {
+        return DSV4L2RT_STRING_EMPTY;
+    }
+
+    hash = strtab_hash(str, len);
+    found = strtab_find(str, len, hash, &slot);
+    if (found >= 0) {
+        return (uint16_t)found;
+    }
+
+    pthread_mutex_lock(&strtab.lock);
+
+    /* Another thread may have inserted it meanwhile */
+    found = strtab_find(str, len, hash, &slot);
+    if (found >= 0 || strtab.count == DSV4L2RT_STRING_MAX ||
+        slot == STRTAB_INDEX_SIZE) {
+        pthread_mutex_unlock(&strtab.lock);
+        return found >= 0 ? (uint16_t)found : DSV4L2RT_STRING_OVERFLOW;
+    }
+
+    id = strtab.count;
+    memcpy(strtab.strings[id], str, len);
+    strtab.strings[id][len] = '\0';
+    __atomic_store_n(&strtab.count, (uint16_t)(id + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&strtab.index[slot], (uint16_t)(id + 1), __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&strtab.lock);
+
+    return id;
+}
+
+uint16_t dsv4l2rt_strtab_count(void)
+{
+    return __atomic_load_n(&strtab.count, __ATOMIC_ACQUIRE);
+}
+
+const char *dsv4l2rt_string(uint16_t id)
+{
+    if (id >= dsv4l2rt_strtab_count()) {
+        return "";
+    }
+
+    return strtab.strings[id];
+}
+
+void dsv4l2rt_event_expand(const dsv4l2rt_compact_event_t *in, dsv4l2_event_t *out)
+{
+    out->ts_ns = in->ts_ns;
+    out->dev_id = in->dev_id;
+    out->event_type = in->event_type;
+    out->severity = in->severity;
+    out->aux = in->aux;
+    out->layer = in->layer;
+
+    /* strncpy semantics: the fields are fixed-size, zero-padded */
+    memset(out->role, 0, sizeof(out->role));
+    memset(out->mission, 0, sizeof(out->mission));
+    if (in->role_id != DSV4L2RT_STRING_EMPTY) {
+        const char *role = dsv4l2rt_string(in->role_id);
+        memcpy(out->role, role, strnlen(role, sizeof(out->role)));
+    }
+    if (in->mission_id != DSV4L2RT_STRING_EMPTY) {
+        const char *mission = dsv4l2rt_string(in->mission_id);
+        memcpy(out->mission, mission, strnlen(mission, sizeof(out->mission)));
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * DSV4L2 Runtime - Interned Role/Mission Strings (internal)
+ *
+ * Process-wide, append-only table behind dsv4l2rt_compact_event_t.
+ * Lookups are lock-free; a new string takes the table mutex once. IDs
+ * are assigned in order and never reused, so "strings below count" is
+ * all a consumer needs to know to stay in sync.
+ */
+
+#ifndef DSV4L2RT_STRING_TABLE_H
+#define DSV4L2RT_STRING_TABLE_H
+
+#include "dsv4l2rt.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Intern a fixed-size, possibly unterminated string field.
+ *
+ * @param str Field (e.g. ev->role)
+ * @param len Field size (at most DSV4L2RT_STRING_LEN bytes are kept)
+ * @return String ID, DSV4L2RT_STRING_EMPTY for "", or
+ *         DSV4L2RT_STRING_OVERFLOW once the table is full
+ */
+uint16_t dsv4l2rt_strtab_intern(const char *str, size_t len);
+
+/**
+ * Number of IDs handed out so far (including DSV4L2RT_STRING_EMPTY).
+ */
+uint16_t dsv4l2rt_strtab_count(void);
+
+#endif /* DSV4L2RT_STRING_TABLE_H */
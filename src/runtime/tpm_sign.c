@@ -4,22 +4,69 @@
  * Provides TPM2-based cryptographic signing for event chunks
  * to ensure forensic integrity and non-repudiation.
  *
+ * The signing pipeline hash-chains chunks and signs one Merkle root per
+ * batch from a background thread; see dsv4l2rt.h.
+ *
  * Requires: tpm2-tss library (libtss2-esys, libtss2-rc, libtss2-mu)
  */
 
 #include "dsv4l2rt.h"
+#include "sha256.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #ifdef HAVE_TPM2
 #include <tss2/tss2_esys.h>
 #include <tss2/tss2_rc.h>
 #include <tss2/tss2_mu.h>
-#include <openssl/sha.h>
 #endif
 
+/* Signed batches kept for proof lookup */
+#define PIPELINE_HISTORY  64
+
+/* Merkle batch lifecycle */
+enum {
+    BATCH_FREE   = 0,
+    BATCH_OPEN   = 1,   /* Receiving chunks */
+    BATCH_SEALED = 2,   /* Waiting for the signer */
+    BATCH_SIGNED = 3,   /* Root signed, proofs available */
+};
+
+typedef struct {
+    int      state;
+    uint64_t batch_id;
+    uint64_t first_chunk_id;
+    uint32_t leaf_count;
+    int      stub;                                  /* Root not TPM-signed */
+    uint8_t  prev_digest[DSV4L2_SHA256_LEN];        /* Chain digest before first leaf */
+    uint8_t  digests[DSV4L2_TPM_BATCH_MAX][DSV4L2_SHA256_LEN];
+    uint8_t  root[DSV4L2_SHA256_LEN];
+    uint8_t  signature[256];
+} merkle_batch_t;
+
+/* Signing pipeline state */
+static struct {
+    int              running;
+    size_t           batch_chunks;
+    merkle_batch_t  *batches;                       /* PIPELINE_HISTORY slots */
+    uint64_t         next_chunk_id;
+    uint64_t         open_batch;                    /* Batch receiving chunks */
+    uint64_t         sign_next;                     /* Next batch to sign */
+    uint8_t          chain[DSV4L2_SHA256_LEN];      /* Last chain digest */
+    int              warned;
+    pthread_t        thread;
+    pthread_mutex_t  lock;
+    pthread_cond_t   work;                          /* Batch sealed / stopping */
+    pthread_cond_t   done;                          /* Batch signed */
+} pipeline = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
 /* TPM2 context (persistent across signing operations) */
 static struct {
 #ifdef HAVE_TPM2
@@ -88,22 +135,26 @@ void dsv4l2_tpm_cleanup(void)
 #endif
 }
 
+#ifdef HAVE_TPM2
 /**
- * Sign event chunk with TPM2.
- *
- * @param events Array of events to sign
- * @param count Number of events
- * @param signature Output buffer for signature (must be 256 bytes)
- * @return 0 on success, negative errno on failure
+ * Hash an event array (legacy per-chunk signatures)
  */
-int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count, uint8_t signature[256])
+static void hash_events(const dsv4l2_event_t *events, size_t count,
+                        uint8_t digest[DSV4L2_SHA256_LEN])
+{
+    dsv4l2_sha256(events, count * sizeof(dsv4l2_event_t), digest);
+}
+#endif
+
+/**
+ * Sign a SHA-256 digest with the TPM2 key
+ */
+static int tpm_sign_digest(const uint8_t hash[DSV4L2_SHA256_LEN], uint8_t signature[256])
 {
 #ifdef HAVE_TPM2
     TSS2_RC rc;
-    TPM2B_DIGEST digest = { .size = SHA256_DIGEST_LENGTH };
+    TPM2B_DIGEST digest = { .size = DSV4L2_SHA256_LEN };
     TPMT_SIGNATURE *sig_out = NULL;
-    SHA256_CTX sha_ctx;
-    size_t i;
 
     if (!tpm_ctx.initialized) {
         /* Auto-initialize with default key */
@@ -112,16 +163,7 @@ int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count, uint8_t s
         }
     }
 
-    if (!events || count == 0 || !signature) {
-        return -EINVAL;
-    }
-
-    /* Compute SHA-256 hash of event data */
-    SHA256_Init(&sha_ctx);
-    for (i = 0; i < count; i++) {
-        SHA256_Update(&sha_ctx, &events[i], sizeof(dsv4l2_event_t));
-    }
-    SHA256_Final(digest.buffer, &sha_ctx);
+    memcpy(digest.buffer, hash, DSV4L2_SHA256_LEN);
 
     /* Sign the hash with TPM2 */
     TPMT_TK_HASHCHECK validation = {
@@ -129,8 +171,6 @@ int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count, uint8_t s
         .hierarchy = TPM2_RH_NULL
     };
 
-    TPM2B_DATA qualifier = { .size = 0 };
-
     TPMT_SIG_SCHEME scheme = {
         .scheme = TPM2_ALG_RSASSA,
         .details.rsassa.hashAlg = TPM2_ALG_SHA256
@@ -164,29 +204,20 @@ int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count, uint8_t s
     Esys_Free(sig_out);
     return 0;
 #else
-    (void)events;
-    (void)count;
+    (void)hash;
     (void)signature;
     return -ENOSYS;
 #endif
 }
 
 /**
- * Verify TPM2 signature (for forensic validation).
- *
- * @param events Array of events that were signed
- * @param count Number of events
- * @param signature Signature to verify
- * @return 0 if valid, -EBADMSG if invalid, other negative errno on error
+ * Verify a TPM2 signature over a SHA-256 digest
  */
-int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
-                                 const uint8_t signature[256])
+static int tpm_verify_digest(const uint8_t hash[DSV4L2_SHA256_LEN], const uint8_t signature[256])
 {
 #ifdef HAVE_TPM2
     TSS2_RC rc;
-    TPM2B_DIGEST digest = { .size = SHA256_DIGEST_LENGTH };
-    SHA256_CTX sha_ctx;
-    size_t i;
+    TPM2B_DIGEST digest = { .size = DSV4L2_SHA256_LEN };
 
     if (!tpm_ctx.initialized) {
         if (dsv4l2_tpm_init(0x81010001) != 0) {
@@ -194,16 +225,7 @@ int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
         }
     }
 
-    if (!events || count == 0 || !signature) {
-        return -EINVAL;
-    }
-
-    /* Compute SHA-256 hash of event data */
-    SHA256_Init(&sha_ctx);
-    for (i = 0; i < count; i++) {
-        SHA256_Update(&sha_ctx, &events[i], sizeof(dsv4l2_event_t));
-    }
-    SHA256_Final(digest.buffer, &sha_ctx);
+    memcpy(digest.buffer, hash, DSV4L2_SHA256_LEN);
 
     /* Prepare signature structure */
     TPMT_SIGNATURE tpm_sig = {
@@ -237,6 +259,33 @@ int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
 
     Esys_Free(validation);
     return 0; /* Signature valid */
+#else
+    (void)hash;
+    (void)signature;
+    return -ENOSYS;
+#endif
+}
+
+/**
+ * Sign event chunk with TPM2.
+ *
+ * @param events Array of events to sign
+ * @param count Number of events
+ * @param signature Output buffer for signature (must be 256 bytes)
+ * @return 0 on success, negative errno on failure
+ */
+int dsv4l2_tpm_sign_events(const dsv4l2_event_t *events, size_t count, uint8_t signature[256])
+{
+#ifdef HAVE_TPM2
+    uint8_t digest[DSV4L2_SHA256_LEN];
+
+    if (!events || count == 0 || !signature) {
+        return -EINVAL;
+    }
+
+    /* Compute SHA-256 hash of event data */
+    hash_events(events, count, digest);
+    return tpm_sign_digest(digest, signature);
 #else
     (void)events;
     (void)count;
@@ -244,3 +293,479 @@ int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
     return -ENOSYS;
 #endif
 }
+
+/**
+ * Verify TPM2 signature (for forensic validation).
+ *
+ * @param events Array of events that were signed
+ * @param count Number of events
+ * @param signature Signature to verify
+ * @return 0 if valid, -EBADMSG if invalid, other negative errno on error
+ */
+int dsv4l2_tpm_verify_signature(const dsv4l2_event_t *events, size_t count,
+                                 const uint8_t signature[256])
+{
+#ifdef HAVE_TPM2
+    uint8_t digest[DSV4L2_SHA256_LEN];
+
+    if (!events || count == 0 || !signature) {
+        return -EINVAL;
+    }
+
+    /* Compute SHA-256 hash of event data */
+    hash_events(events, count, digest);
+    return tpm_verify_digest(digest, signature);
+#else
+    (void)events;
+    (void)count;
+    (void)signature;
+    return -ENOSYS;
+#endif
+}
+
+/* ========================================================================
+ * Hash Chain and Merkle Batches
+ * ======================================================================== */
+
+/**
+ * Append a little-endian u64 to a hash
+ */
+static void sha256_update_u64(dsv4l2_sha256_t *ctx, uint64_t v)
+{
+    uint8_t b[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        b[i] = (uint8_t)(v >> (8 * i));
+    }
+    dsv4l2_sha256_update(ctx, b, sizeof(b));
+}
+
+/**
+ * Chain step: SHA-256(prev || chunk_id || timestamp_ns || event_count || events_digest)
+ */
+static void chain_digest(const uint8_t prev_digest[DSV4L2_SHA256_LEN],
+                         const dsv4l2rt_chunk_header_t *header,
+                         const uint8_t events_digest[DSV4L2_SHA256_LEN],
+                         uint8_t digest[DSV4L2_SHA256_LEN])
+{
+    dsv4l2_sha256_t ctx;
+
+    dsv4l2_sha256_init(&ctx);
+    dsv4l2_sha256_update(&ctx, prev_digest, DSV4L2_SHA256_LEN);
+    sha256_update_u64(&ctx, header->chunk_id);
+    sha256_update_u64(&ctx, header->timestamp_ns);
+    sha256_update_u64(&ctx, header->event_count);
+    dsv4l2_sha256_update(&ctx, events_digest, DSV4L2_SHA256_LEN);
+    dsv4l2_sha256_final(&ctx, digest);
+}
+
+/**
+ * Chain digest of a chunk from its events
+ */
+void dsv4l2_tpm_chunk_digest(const uint8_t prev_digest[32],
+                             const dsv4l2rt_chunk_header_t *header,
+                             const dsv4l2_event_t *events,
+                             uint8_t digest[32])
+{
+    uint8_t events_digest[DSV4L2_SHA256_LEN];
+
+    dsv4l2_sha256(events, header->event_count * sizeof(dsv4l2_event_t), events_digest);
+    chain_digest(prev_digest, header, events_digest, digest);
+}
+
+/**
+ * Merkle leaf and node hashes (domain-separated)
+ */
+static void merkle_leaf(const uint8_t digest[DSV4L2_SHA256_LEN], uint8_t out[DSV4L2_SHA256_LEN])
+{
+    dsv4l2_sha256_t ctx;
+    uint8_t tag = 0x00;
+
+    dsv4l2_sha256_init(&ctx);
+    dsv4l2_sha256_update(&ctx, &tag, 1);
+    dsv4l2_sha256_update(&ctx, digest, DSV4L2_SHA256_LEN);
+    dsv4l2_sha256_final(&ctx, out);
+}
+
+static void merkle_node(const uint8_t left[DSV4L2_SHA256_LEN],
+                        const uint8_t right[DSV4L2_SHA256_LEN],
+                        uint8_t out[DSV4L2_SHA256_LEN])
+{
+    dsv4l2_sha256_t ctx;
+    uint8_t tag = 0x01;
+
+    dsv4l2_sha256_init(&ctx);
+    dsv4l2_sha256_update(&ctx, &tag, 1);
+    dsv4l2_sha256_update(&ctx, left, DSV4L2_SHA256_LEN);
+    dsv4l2_sha256_update(&ctx, right, DSV4L2_SHA256_LEN);
+    dsv4l2_sha256_final(&ctx, out);
+}
+
+/**
+ * Compute a batch root, optionally collecting the path of one leaf
+ *
+ * An odd node at the end of a level is promoted unchanged.
+ */
+static void merkle_build(const merkle_batch_t *batch, uint32_t index,
+                         uint8_t root[DSV4L2_SHA256_LEN],
+                         uint8_t siblings[][DSV4L2_SHA256_LEN], uint32_t *depth)
+{
+    uint8_t level[DSV4L2_TPM_BATCH_MAX][DSV4L2_SHA256_LEN];
+    uint32_t n = batch->leaf_count;
+    uint32_t i, k = 0;
+
+    for (i = 0; i < n; i++) {
+        merkle_leaf(batch->digests[i], level[i]);
+    }
+
+    while (n > 1) {
+        if (siblings) {
+            if (index & 1) {
+                memcpy(siblings[k++], level[index - 1], DSV4L2_SHA256_LEN);
+            } else if (index + 1 < n) {
+                memcpy(siblings[k++], level[index + 1], DSV4L2_SHA256_LEN);
+            }
+        }
+
+        for (i = 0; i + 1 < n; i += 2) {
+            merkle_node(level[i], level[i + 1], level[i / 2]);
+        }
+        if (n & 1) {
+            memcpy(level[n / 2], level[n - 1], DSV4L2_SHA256_LEN);
+        }
+
+        index /= 2;
+        n = (n + 1) / 2;
+    }
+
+    memcpy(root, level[0], DSV4L2_SHA256_LEN);
+    if (depth) {
+        *depth = k;
+    }
+}
+
+/**
+ * Seal the open batch (lock held)
+ */
+static void pipeline_seal(void)
+{
+    merkle_batch_t *batch = &pipeline.batches[pipeline.open_batch % PIPELINE_HISTORY];
+
+    if (batch->state != BATCH_OPEN || batch->batch_id != pipeline.open_batch) {
+        return;  /* Nothing buffered */
+    }
+
+    batch->state = BATCH_SEALED;
+    pipeline.open_batch++;
+    pthread_cond_signal(&pipeline.work);
+}
+
+/**
+ * Signer thread - signs sealed batch roots in order
+ */
+static void *pipeline_signer_fn(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&pipeline.lock);
+
+    for (;;) {
+        merkle_batch_t *batch = &pipeline.batches[pipeline.sign_next % PIPELINE_HISTORY];
+        int rc;
+
+        if (batch->state != BATCH_SEALED || batch->batch_id != pipeline.sign_next) {
+            if (!pipeline.running) {
+                break;
+            }
+            pthread_cond_wait(&pipeline.work, &pipeline.lock);
+            continue;
+        }
+
+        /* Sealed batches are not modified by producers */
+        pthread_mutex_unlock(&pipeline.lock);
+
+        merkle_build(batch, 0, batch->root, NULL, NULL);
+        rc = tpm_sign_digest(batch->root, batch->signature);
+        if (rc != 0) {
+            if (!pipeline.warned) {
+                fprintf(stderr, "Warning: TPM signing failed (%d), using stub signature\n", rc);
+                pipeline.warned = 1;
+            }
+            memset(batch->signature, 0x5A, sizeof(batch->signature));
+        }
+
+        pthread_mutex_lock(&pipeline.lock);
+        batch->stub = (rc != 0);
+        batch->state = BATCH_SIGNED;
+        pipeline.sign_next++;
+        pthread_cond_broadcast(&pipeline.done);
+    }
+
+    pthread_mutex_unlock(&pipeline.lock);
+    return NULL;
+}
+
+/**
+ * Start the signing pipeline
+ */
+int dsv4l2_tpm_pipeline_start(size_t batch_chunks)
+{
+    return dsv4l2_tpm_pipeline_resume(batch_chunks, 0, NULL);
+}
+
+/**
+ * Start the signing pipeline at a given point of an existing chain
+ */
+int dsv4l2_tpm_pipeline_resume(size_t batch_chunks, uint64_t first_chunk_id,
+                               const uint8_t prev_digest[32])
+{
+    int rc;
+
+    if (batch_chunks > DSV4L2_TPM_BATCH_MAX) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&pipeline.lock);
+
+    if (pipeline.running) {
+        pthread_mutex_unlock(&pipeline.lock);
+        return 0;
+    }
+
+    free(pipeline.batches);
+    pipeline.batches = calloc(PIPELINE_HISTORY, sizeof(*pipeline.batches));
+    if (!pipeline.batches) {
+        pthread_mutex_unlock(&pipeline.lock);
+        return -ENOMEM;
+    }
+
+    pipeline.batch_chunks = batch_chunks ? batch_chunks : DSV4L2_TPM_BATCH_CHUNKS;
+    pipeline.next_chunk_id = first_chunk_id;
+    pipeline.open_batch = 0;
+    pipeline.sign_next = 0;
+    pipeline.warned = 0;
+    if (prev_digest) {
+        memcpy(pipeline.chain, prev_digest, sizeof(pipeline.chain));
+    } else {
+        memset(pipeline.chain, 0, sizeof(pipeline.chain));
+    }
+
+    pipeline.running = 1;
+    rc = pthread_create(&pipeline.thread, NULL, pipeline_signer_fn, NULL);
+    if (rc != 0) {
+        pipeline.running = 0;
+        free(pipeline.batches);
+        pipeline.batches = NULL;
+    }
+
+    pthread_mutex_unlock(&pipeline.lock);
+    return -rc;
+}
+
+/**
+ * Seal the partial batch and wait for the signer to catch up
+ */
+void dsv4l2_tpm_pipeline_flush(void)
+{
+    pthread_mutex_lock(&pipeline.lock);
+
+    if (pipeline.running) {
+        pipeline_seal();
+        while (pipeline.sign_next < pipeline.open_batch) {
+            pthread_cond_wait(&pipeline.done, &pipeline.lock);
+        }
+    }
+
+    pthread_mutex_unlock(&pipeline.lock);
+}
+
+/**
+ * Flush and stop the signer thread
+ */
+void dsv4l2_tpm_pipeline_stop(void)
+{
+    dsv4l2_tpm_pipeline_flush();
+
+    pthread_mutex_lock(&pipeline.lock);
+    if (!pipeline.running) {
+        pthread_mutex_unlock(&pipeline.lock);
+        return;
+    }
+    pipeline.running = 0;
+    pthread_cond_signal(&pipeline.work);
+    pthread_mutex_unlock(&pipeline.lock);
+
+    pthread_join(pipeline.thread, NULL);
+}
+
+/**
+ * Append a chunk to the hash chain
+ */
+int dsv4l2_tpm_chain_chunk(dsv4l2rt_chunk_header_t *header,
+                           const dsv4l2_event_t *events)
+{
+    uint8_t events_digest[DSV4L2_SHA256_LEN];
+
+    if (!header || (!events && header->event_count > 0)) {
+        return -EINVAL;
+    }
+
+    /* Hash outside the pipeline lock */
+    dsv4l2_sha256(events, header->event_count * sizeof(dsv4l2_event_t), events_digest);
+    return dsv4l2_tpm_chain_digest(header, events_digest);
+}
+
+/**
+ * Append a chunk to the hash chain from a precomputed events digest
+ */
+int dsv4l2_tpm_chain_digest(dsv4l2rt_chunk_header_t *header,
+                            const uint8_t events_digest[32])
+{
+    merkle_batch_t *batch;
+
+    if (!header || !events_digest) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&pipeline.lock);
+
+    if (!pipeline.running) {
+        pthread_mutex_unlock(&pipeline.lock);
+        return -EAGAIN;
+    }
+
+    batch = &pipeline.batches[pipeline.open_batch % PIPELINE_HISTORY];
+    if (batch->state != BATCH_OPEN || batch->batch_id != pipeline.open_batch) {
+        /* Signer a full history behind: wait for the slot */
+        while (batch->state == BATCH_SEALED) {
+            pthread_cond_wait(&pipeline.done, &pipeline.lock);
+        }
+
+        batch->state = BATCH_OPEN;
+        batch->batch_id = pipeline.open_batch;
+        batch->first_chunk_id = pipeline.next_chunk_id;
+        batch->leaf_count = 0;
+        memcpy(batch->prev_digest, pipeline.chain, DSV4L2_SHA256_LEN);
+    }
+
+    header->chunk_id = pipeline.next_chunk_id++;
+    chain_digest(pipeline.chain, header, events_digest, header->chain_digest);
+    memcpy(pipeline.chain, header->chain_digest, DSV4L2_SHA256_LEN);
+    memcpy(batch->digests[batch->leaf_count++], header->chain_digest, DSV4L2_SHA256_LEN);
+
+    if (batch->leaf_count == pipeline.batch_chunks) {
+        pipeline_seal();
+    }
+
+    pthread_mutex_unlock(&pipeline.lock);
+    return 0;
+}
+
+/**
+ * Get the inclusion proof of a chunk
+ */
+int dsv4l2_tpm_get_proof(uint64_t chunk_id, dsv4l2_tpm_proof_t *proof)
+{
+    int rc = -ENOENT;
+    size_t i;
+
+    if (!proof) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&pipeline.lock);
+
+    for (i = 0; pipeline.batches && i < PIPELINE_HISTORY; i++) {
+        merkle_batch_t *batch = &pipeline.batches[i];
+        uint32_t index;
+
+        if (batch->state == BATCH_FREE || chunk_id < batch->first_chunk_id ||
+            chunk_id >= batch->first_chunk_id + batch->leaf_count) {
+            continue;
+        }
+
+        if (batch->state != BATCH_SIGNED) {
+            rc = -EAGAIN;
+            break;
+        }
+
+        index = (uint32_t)(chunk_id - batch->first_chunk_id);
+
+        memset(proof, 0, sizeof(*proof));
+        proof->batch_id = batch->batch_id;
+        proof->chunk_id = chunk_id;
+        proof->leaf_index = index;
+        proof->leaf_count = batch->leaf_count;
+        proof->stub_signature = batch->stub;
+        memcpy(proof->prev_digest,
+               index ? batch->digests[index - 1] : batch->prev_digest,
+               DSV4L2_SHA256_LEN);
+        merkle_build(batch, index, proof->root, proof->siblings, &proof->depth);
+        memcpy(proof->root_signature, batch->signature, sizeof(proof->root_signature));
+        rc = 0;
+        break;
+    }
+
+    pthread_mutex_unlock(&pipeline.lock);
+    return rc;
+}
+
+/**
+ * Verify a single chunk against its inclusion proof
+ */
+int dsv4l2_tpm_verify_chunk(const dsv4l2rt_chunk_header_t *header,
+                            const dsv4l2_event_t *events,
+                            const dsv4l2_tpm_proof_t *proof)
+{
+    uint8_t digest[DSV4L2_SHA256_LEN];
+    uint8_t hash[DSV4L2_SHA256_LEN];
+    uint32_t index, n, k = 0;
+
+    if (!header || !proof || (!events && header->event_count > 0)) {
+        return -EINVAL;
+    }
+
+    if (header->chunk_id != proof->chunk_id ||
+        proof->leaf_count == 0 || proof->leaf_count > DSV4L2_TPM_BATCH_MAX ||
+        proof->leaf_index >= proof->leaf_count ||
+        proof->depth > DSV4L2_TPM_PROOF_DEPTH) {
+        return -EBADMSG;
+    }
+
+    /* Recompute the chain digest from the events */
+    dsv4l2_tpm_chunk_digest(proof->prev_digest, header, events, digest);
+    if (memcmp(digest, header->chain_digest, DSV4L2_SHA256_LEN) != 0) {
+        return -EBADMSG;
+    }
+
+    /* Walk the path to the root */
+    merkle_leaf(digest, hash);
+    index = proof->leaf_index;
+    n = proof->leaf_count;
+    while (n > 1) {
+        if (index & 1) {
+            if (k >= proof->depth) {
+                return -EBADMSG;
+            }
+            merkle_node(proof->siblings[k++], hash, hash);
+        } else if (index + 1 < n) {
+            if (k >= proof->depth) {
+                return -EBADMSG;
+            }
+            merkle_node(hash, proof->siblings[k++], hash);
+        }
+        index /= 2;
+        n = (n + 1) / 2;
+    }
+
+    if (k != proof->depth || memcmp(hash, proof->root, DSV4L2_SHA256_LEN) != 0) {
+        return -EBADMSG;
+    }
+
+    if (proof->stub_signature) {
+        return -ENOSYS;
+    }
+
+    return tpm_verify_digest(proof->root, proof->root_signature);
+}
@@ -0,0 +1,506 @@
+/*
+ * DSV4L2 Device Streams
+ *
+ * Push-style capture for one device:
+ * - A dedicated dequeue thread (optionally SCHED_FIFO and pinned) pulls
+ *   frames with dsv4l2_frame_acquire(), so each frame is TEMPEST-gated
+ * - Frames are spread round-robin over per-worker queues; an idle worker
+ *   steals from the others before sleeping
+ * - Workers run the callback and release the lease, returning the
+ *   buffer to the driver
+ *
+ * Queue depth counters for each stage show where frames pile up: in
+ * the driver, in worker queues, or inside callbacks.
+ */
+
+#define _GNU_SOURCE
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
+#include "dsv4l2_stream.h"
+#include "dsv4l2rt.h"
+#include "device_internal.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_POLL_MS     100   /* Dequeue wait between stop checks */
+#define STREAM_BACKOFF_MS  10    /* Wait when all buffers are leased or policy blocks */
+
+/* Per-worker frame queue (ring, protected by lock) */
+typedef struct {
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    dsv4l2_frame_t *frames;
+    size_t          head;
+    size_t          len;
+    unsigned        index;
+    struct dsv4l2_stream *stream;
+} stream_worker_t;
+
+struct dsv4l2_stream {
+    dsv4l2_device_t    *dev;
+    dsv4l2_stream_cb    callback;
+    void               *user_data;
+
+    pthread_t           dequeue_thread;
+    stream_worker_t    *workers;
+    unsigned            worker_count;
+    size_t              queue_depth;
+    unsigned            next_worker;    /* Round-robin cursor (dequeue thread only) */
+
+    /* Sleep/wake for workers and the dequeue thread */
+    pthread_mutex_t     lock;
+    pthread_cond_t      work;           /* Frames queued or draining */
+    pthread_cond_t      space;          /* A lease was released or stopping */
+    int                 stopping;       /* Dequeue thread should exit (atomic) */
+    int                 draining;       /* Workers exit once queues are empty */
+    int                 error;          /* Error that ended the dequeue thread */
+
+    /* Counters (atomic) */
+    uint64_t            frames_dequeued;
+    uint64_t            frames_processed;
+    uint64_t            frames_dropped;
+    uint64_t            frames_stolen;
+    uint32_t            depth_queued;
+    uint32_t            depth_processing;
+    uint32_t            max_depth_queued;
+};
+
+/**
+ * Fill stream options with defaults
+ */
+void dsv4l2_stream_opts_init(dsv4l2_stream_opts_t *opts)
+{
+    if (!opts) {
+        return;
+    }
+
+    memset(opts, 0, sizeof(*opts));
+    opts->workers = 1;
+    opts->dequeue_cpu = -1;
+    opts->worker_cpu_first = -1;
+}
+
+/**
+ * Push a frame onto a worker queue
+ *
+ * @return 1 if queued, 0 if the queue is full
+ */
+static int worker_push(stream_worker_t *w, size_t capacity, const dsv4l2_frame_t *frame)
+{
+    int queued = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->len < capacity) {
+        w->frames[(w->head + w->len) % capacity] = *frame;
+        w->len++;
+        queued = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return queued;
+}
+
+/**
+ * Take a frame from a worker queue
+ *
+ * The owner pops the oldest frame; thieves take the newest, which keeps
+ * the owner and thief on opposite ends of the ring.
+ */
+static int worker_take(stream_worker_t *w, size_t capacity, dsv4l2_frame_t *frame,
+                       int steal)
+{
+    int taken = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->len > 0) {
+        if (steal) {
+            *frame = w->frames[(w->head + w->len - 1) % capacity];
+        } else {
+            *frame = w->frames[w->head];
+            w->head = (w->head + 1) % capacity;
+        }
+        w->len--;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return taken;
+}
+
+/**
+ * Get the next frame for a worker: own queue first, then steal
+ */
+static int worker_next(stream_worker_t *w, dsv4l2_frame_t *frame)
+{
+    dsv4l2_stream_t *s = w->stream;
+    unsigned i;
+
+    if (worker_take(w, s->queue_depth, frame, 0)) {
+        return 1;
+    }
+
+    for (i = 1; i < s->worker_count; i++) {
+        stream_worker_t *victim = &s->workers[(w->index + i) % s->worker_count];
+
+        if (worker_take(victim, s->queue_depth, frame, 1)) {
+            __atomic_add_fetch(&s->frames_stolen, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Worker: run callbacks and hand buffers back to the driver
+ */
+static void *worker_main(void *arg)
+{
+    stream_worker_t *w = arg;
+    dsv4l2_stream_t *s = w->stream;
+    dsv4l2_frame_t frame;
+
+    for (;;) {
+        if (worker_next(w, &frame)) {
+            __atomic_sub_fetch(&s->depth_queued, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s->depth_processing, 1, __ATOMIC_RELAXED);
+
+            s->callback(s->dev, &frame, s->user_data);
+            dsv4l2_frame_release(s->dev, &frame);
+
+            __atomic_sub_fetch(&s->depth_processing, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s->frames_processed, 1, __ATOMIC_RELAXED);
+
+            /* A buffer is back with the driver */
+            pthread_mutex_lock(&s->lock);
+            pthread_cond_signal(&s->space);
+            pthread_mutex_unlock(&s->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&s->lock);
+        while (__atomic_load_n(&s->depth_queued, __ATOMIC_RELAXED) == 0 && !s->draining) {
+            pthread_cond_wait(&s->work, &s->lock);
+        }
+        if (__atomic_load_n(&s->depth_queued, __ATOMIC_RELAXED) == 0 && s->draining) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    return NULL;
+}
+
+/**
+ * Hand a dequeued frame to the pool, or requeue it if every queue is full
+ */
+static void dispatch_frame(dsv4l2_stream_t *s, dsv4l2_frame_t *frame)
+{
+    uint32_t depth, max;
+    unsigned i;
+
+    /* Count before publishing so a worker never sees a negative depth */
+    depth = __atomic_add_fetch(&s->depth_queued, 1, __ATOMIC_RELAXED);
+
+    for (i = 0; i < s->worker_count; i++) {
+        stream_worker_t *w = &s->workers[(s->next_worker + i) % s->worker_count];
+
+        if (worker_push(w, s->queue_depth, frame)) {
+            s->next_worker = (w->index + 1) % s->worker_count;
+
+            max = __atomic_load_n(&s->max_depth_queued, __ATOMIC_RELAXED);
+            while (depth > max &&
+                   !__atomic_compare_exchange_n(&s->max_depth_queued, &max, depth, 0,
+                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                /* Retry with the updated max */
+            }
+
+            pthread_mutex_lock(&s->lock);
+            pthread_cond_signal(&s->work);
+            pthread_mutex_unlock(&s->lock);
+            return;
+        }
+    }
+
+    __atomic_sub_fetch(&s->depth_queued, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s->frames_dropped, 1, __ATOMIC_RELAXED);
+    dsv4l2_frame_release(s->dev, frame);
+}
+
+/**
+ * Sleep until a lease is released, the stream stops, or the backoff ends
+ */
+static void wait_for_space(dsv4l2_stream_t *s)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += STREAM_BACKOFF_MS * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (!__atomic_load_n(&s->stopping, __ATOMIC_ACQUIRE)) {
+        pthread_cond_timedwait(&s->space, &s->lock, &deadline);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+/**
+ * Dequeue thread: pull frames from the driver and feed the pool
+ */
+static void *dequeue_main(void *arg)
+{
+    dsv4l2_stream_t *s = arg;
+    dsv4l2_frame_t frame;
+    int rc;
+
+    while (!__atomic_load_n(&s->stopping, __ATOMIC_ACQUIRE)) {
+        rc = dsv4l2_frame_acquire(s->dev, &frame, STREAM_POLL_MS);
+
+        if (rc == 0) {
+            __atomic_add_fetch(&s->frames_dequeued, 1, __ATOMIC_RELAXED);
+            dispatch_frame(s, &frame);
+        } else if (rc == -ETIMEDOUT || rc == -EAGAIN) {
+            continue;
+        } else if (rc == -ENOBUFS || rc == -EPERM) {
+            /* Every buffer is with the workers, or TEMPEST blocks capture */
+            wait_for_space(s);
+        } else {
+            s->error = rc;
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Pin a thread attribute to one CPU
+ */
+static void attr_set_cpu(pthread_attr_t *attr, int cpu)
+{
+    cpu_set_t set;
+
+    if (cpu < 0) {
+        return;
+    }
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+/**
+ * Stop the workers and free the stream (dequeue thread already joined)
+ */
+static void stream_destroy(dsv4l2_stream_t *s, unsigned started)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&s->lock);
+    s->draining = 1;
+    pthread_cond_broadcast(&s->work);
+    pthread_mutex_unlock(&s->lock);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(s->workers[i].thread, NULL);
+    }
+
+    for (i = 0; s->workers && i < s->worker_count; i++) {
+        pthread_mutex_destroy(&s->workers[i].lock);
+        free(s->workers[i].frames);
+    }
+    free(s->workers);
+
+    pthread_cond_destroy(&s->space);
+    pthread_cond_destroy(&s->work);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+/**
+ * Start a push-style stream
+ */
+DSMIL_REQUIRES_TEMPEST_CHECK
+int dsv4l2_stream_start(dsv4l2_device_t *dev, dsv4l2_stream_cb callback,
+                        void *user_data, const dsv4l2_stream_opts_t *opts,
+                        dsv4l2_stream_t **out)
+{
+    dsv4l2_device_internal_t *internal;
+    dsv4l2_stream_opts_t defaults;
+    dsv4l2_stream_t *s;
+    pthread_attr_t attr;
+    unsigned i, started = 0;
+    int rc;
+
+    if (!dev || !callback || !out) {
+        return -EINVAL;
+    }
+
+    if (!opts) {
+        dsv4l2_stream_opts_init(&defaults);
+        opts = &defaults;
+    }
+
+    internal = dsv4l2_get_internal(dev);
+    if (internal->buffer_count == 0) {
+        return -EINVAL;
+    }
+
+    /* CRITICAL: TEMPEST state check (REQUIRED by DSLLVM) */
+    dsv4l2_tempest_state_t state = dsv4l2_get_tempest_state(dev);
+    if (dsv4l2_policy_capture_check(internal, state, "stream_start") != 0) {
+        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_POLICY_VIOLATION,
+                             DSV4L2_SEV_CRITICAL, state);
+        return -EPERM;
+    }
+
+    if (!internal->streaming) {
+        rc = dsv4l2_start_streaming(dev);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    s = calloc(1, sizeof(*s));
+    if (!s) {
+        return -ENOMEM;
+    }
+
+    s->dev = dev;
+    s->callback = callback;
+    s->user_data = user_data;
+    s->worker_count = opts->workers ? opts->workers : 1;
+    s->queue_depth = opts->queue_depth ? opts->queue_depth : internal->buffer_count;
+    if (!opts->queue_depth && internal->adapt_max > s->queue_depth) {
+        s->queue_depth = internal->adapt_max;  /* Room for an adaptive set at full depth */
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work, NULL);
+    pthread_cond_init(&s->space, NULL);
+
+    s->workers = calloc(s->worker_count, sizeof(*s->workers));
+    if (!s->workers) {
+        stream_destroy(s, 0);
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < s->worker_count; i++) {
+        stream_worker_t *w = &s->workers[i];
+
+        pthread_mutex_init(&w->lock, NULL);
+        w->index = i;
+        w->stream = s;
+        w->frames = calloc(s->queue_depth, sizeof(*w->frames));
+        if (!w->frames) {
+            stream_destroy(s, 0);
+            return -ENOMEM;
+        }
+    }
+
+    /* Workers */
+    for (i = 0; i < s->worker_count; i++) {
+        pthread_attr_init(&attr);
+        if (opts->worker_cpu_first >= 0) {
+            attr_set_cpu(&attr, opts->worker_cpu_first + (int)i);
+        }
+        rc = pthread_create(&s->workers[i].thread, &attr, worker_main, &s->workers[i]);
+        pthread_attr_destroy(&attr);
+        if (rc != 0) {
+            stream_destroy(s, started);
+            return -rc;
+        }
+        started++;
+    }
+
+    /* Dequeue thread */
+    pthread_attr_init(&attr);
+    attr_set_cpu(&attr, opts->dequeue_cpu);
+    if (opts->rt_priority > 0) {
+        struct sched_param param;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = opts->rt_priority;
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+    rc = pthread_create(&s->dequeue_thread, &attr, dequeue_main, s);
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        stream_destroy(s, started);
+        return -rc;
+    }
+
+    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_CAPTURE_START,
+                         DSV4L2_SEV_INFO, s->worker_count);
+
+    *out = s;
+    return 0;
+}
+
+/**
+ * Stop a stream
+ */
+int dsv4l2_stream_stop(dsv4l2_stream_t *stream)
+{
+    dsv4l2_device_internal_t *internal;
+    int rc;
+
+    if (!stream) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(stream->dev);
+
+    pthread_mutex_lock(&stream->lock);
+    __atomic_store_n(&stream->stopping, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&stream->space);
+    pthread_mutex_unlock(&stream->lock);
+
+    pthread_join(stream->dequeue_thread, NULL);
+
+    rc = stream->error;
+    stream_destroy(stream, stream->worker_count);
+
+    dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_CAPTURE_STOP,
+                         DSV4L2_SEV_INFO, 0);
+
+    return rc;
+}
+
+/**
+ * Snapshot stream counters
+ */
+int dsv4l2_stream_get_stats(dsv4l2_stream_t *stream, dsv4l2_stream_stats_t *out)
+{
+    dsv4l2_device_internal_t *internal;
+
+    if (!stream || !out) {
+        return -EINVAL;
+    }
+
+    internal = dsv4l2_get_internal(stream->dev);
+
+    out->frames_dequeued = __atomic_load_n(&stream->frames_dequeued, __ATOMIC_RELAXED);
+    out->frames_processed = __atomic_load_n(&stream->frames_processed, __ATOMIC_RELAXED);
+    out->frames_dropped = __atomic_load_n(&stream->frames_dropped, __ATOMIC_RELAXED);
+    out->frames_stolen = __atomic_load_n(&stream->frames_stolen, __ATOMIC_RELAXED);
+    out->depth_driver = dsv4l2_buffer_available(internal);
+    out->depth_queued = __atomic_load_n(&stream->depth_queued, __ATOMIC_RELAXED);
+    out->depth_processing = __atomic_load_n(&stream->depth_processing, __ATOMIC_RELAXED);
+    out->max_depth_queued = __atomic_load_n(&stream->max_depth_queued, __ATOMIC_RELAXED);
+
+    return 0;
+}
@@ -12,27 +12,148 @@
 #include "dsv4l2_annotations.h"
 #include "dsv4l2_policy.h"
 #include "dsv4l2rt.h"
+#include "device_internal.h"
 
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <string.h>
 
-/* Forward declaration of internal device structure */
-typedef struct dsv4l2_device_internal dsv4l2_device_internal_t;
-extern dsv4l2_device_internal_t *dsv4l2_get_internal(dsv4l2_device_t *dev);
-
-/* Internal accessor for TEMPEST state */
-struct dsv4l2_device_internal {
-    dsv4l2_device_t public;
-    struct v4l2_capability cap;
-    dsv4l2_tempest_state_t tempest;
-    int tempest_ctrl_id;
-    char *profile_path;
-    char *classification;
-    int streaming;
-    uint32_t dev_id;
-};
+/**
+ * Map a TEMPEST control value to a state
+ */
+static dsv4l2_tempest_state_t tempest_from_value(int32_t value)
+{
+    switch (value) {
+        case 0: return DSV4L2_TEMPEST_DISABLED;
+        case 1: return DSV4L2_TEMPEST_LOW;
+        case 2: return DSV4L2_TEMPEST_HIGH;
+        case 3: return DSV4L2_TEMPEST_LOCKDOWN;
+        default: return DSV4L2_TEMPEST_DISABLED;
+    }
+}
+
+/**
+ * Read the TEMPEST control into the cached state
+ *
+ * @return 0 on success, negative errno on error (cache unchanged)
+ */
+static int tempest_read_ctrl(dsv4l2_device_internal_t *dev)
+{
+    struct v4l2_control ctrl;
+
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.id = dev->tempest_ctrl_id;
+
+    if (ioctl(dev->public.fd, VIDIOC_G_CTRL, &ctrl) < 0) {
+        return -errno;
+    }
+
+    __atomic_store_n(&dev->tempest, tempest_from_value(ctrl.value), __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Emit TEMPEST transition telemetry (CRITICAL severity)
+ */
+static void tempest_emit_transition(dsv4l2_device_internal_t *dev,
+                                    dsv4l2_tempest_state_t old_state,
+                                    dsv4l2_tempest_state_t new_state)
+{
+    dsv4l2_event_t ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.dev_id = dev->dev_id;
+    ev.event_type = DSV4L2_EVENT_TEMPEST_TRANSITION;
+    ev.severity = DSV4L2_SEV_CRITICAL;
+    ev.aux = (old_state << 16) | new_state;  /* Pack old and new state */
+    ev.layer = dev->public.layer;
+    if (dev->public.role) {
+        strncpy(ev.role, dev->public.role, sizeof(ev.role) - 1);
+    }
+
+    dsv4l2rt_emit(&ev);
+
+    /* If entering LOCKDOWN, emit additional event */
+    if (new_state == DSV4L2_TEMPEST_LOCKDOWN) {
+        dsv4l2rt_emit_simple(dev->dev_id, DSV4L2_EVENT_TEMPEST_LOCKDOWN,
+                             DSV4L2_SEV_CRITICAL, 0);
+    }
+}
+
+/**
+ * Subscribe to TEMPEST control changes and prime the cache
+ *
+ * Subscribing before the initial read means a change racing with open
+ * is still delivered as an event.
+ */
+void dsv4l2_tempest_subscribe(dsv4l2_device_internal_t *dev)
+{
+    struct v4l2_event_subscription sub;
+
+    dev->tempest_subscribed = 0;
+
+    if (dev->tempest_ctrl_id == 0) {
+        return;
+    }
+
+    memset(&sub, 0, sizeof(sub));
+    sub.type = V4L2_EVENT_CTRL;
+    sub.id = dev->tempest_ctrl_id;
+
+    if (ioctl(dev->public.fd, VIDIOC_SUBSCRIBE_EVENT, &sub) < 0) {
+        /* No control events: fall back to VIDIOC_G_CTRL per query */
+        return;
+    }
+
+    if (tempest_read_ctrl(dev) < 0) {
+        /* Control not readable: nothing to cache */
+        ioctl(dev->public.fd, VIDIOC_UNSUBSCRIBE_EVENT, &sub);
+        return;
+    }
+
+    dev->tempest_subscribed = 1;
+}
+
+/**
+ * Apply pending TEMPEST control-change events to the cache
+ *
+ * Changes made through another file handle (or by the driver) are
+ * logged as transitions, like dsv4l2_set_tempest_state().
+ *
+ * @return Number of events applied, negative errno on error
+ */
+int dsv4l2_tempest_dequeue_events(dsv4l2_device_internal_t *dev)
+{
+    struct v4l2_event ev;
+    dsv4l2_tempest_state_t old_state, new_state;
+    int applied = 0;
+
+    if (!dev->tempest_subscribed) {
+        return 0;
+    }
+
+    for (;;) {
+        memset(&ev, 0, sizeof(ev));
+        if (ioctl(dev->public.fd, VIDIOC_DQEVENT, &ev) < 0) {
+            /* ENOENT: queue empty */
+            return errno == ENOENT ? applied : -errno;
+        }
+
+        if (ev.type != V4L2_EVENT_CTRL || ev.id != (uint32_t)dev->tempest_ctrl_id ||
+            !(ev.u.ctrl.changes & V4L2_EVENT_CTRL_CH_VALUE)) {
+            continue;
+        }
+
+        new_state = tempest_from_value(ev.u.ctrl.value);
+        old_state = __atomic_exchange_n(&dev->tempest, new_state, __ATOMIC_ACQ_REL);
+        applied++;
+
+        if (old_state != new_state) {
+            tempest_emit_transition(dev, old_state, new_state);
+        }
+    }
+}
 
 /**
  * Get current TEMPEST state of a device
@@ -42,12 +163,17 @@ struct dsv4l2_device_internal {
  *
  * This function is annotated with DSMIL_TEMPEST_QUERY so DSLLVM knows
  * it queries TEMPEST state. Every capture function MUST call this.
+ *
+ * When the device delivers control events the cached state is returned
+ * with one atomic load. While streaming, pending events are applied by
+ * the frame wait in capture.c (POLLPRI), which re-checks policy before
+ * dequeuing, so a LOCKDOWN transition is always observed before the next
+ * frame. When idle, pending events are applied here.
  */
 DSMIL_TEMPEST_QUERY
 dsv4l2_tempest_state_t dsv4l2_get_tempest_state(dsv4l2_device_t *dev)
 {
     dsv4l2_device_internal_t *internal;
-    struct v4l2_control ctrl;
 
     if (!dev) {
         return DSV4L2_TEMPEST_DISABLED;
@@ -60,23 +186,16 @@ dsv4l2_tempest_state_t dsv4l2_get_tempest_state(dsv4l2_device_t *dev)
         return DSV4L2_TEMPEST_DISABLED;
     }
 
-    /* Query v4l2 control */
-    memset(&ctrl, 0, sizeof(ctrl));
-    ctrl.id = internal->tempest_ctrl_id;
-
-    if (ioctl(dev->fd, VIDIOC_G_CTRL, &ctrl) < 0) {
-        /* If control read fails, return cached state */
-        return internal->tempest;
+    /* Event-driven cache */
+    if (internal->tempest_subscribed) {
+        if (!internal->streaming) {
+            dsv4l2_tempest_dequeue_events(internal);
+        }
+        return __atomic_load_n(&internal->tempest, __ATOMIC_ACQUIRE);
     }
 
-    /* Update cached state */
-    switch (ctrl.value) {
-        case 0: internal->tempest = DSV4L2_TEMPEST_DISABLED; break;
-        case 1: internal->tempest = DSV4L2_TEMPEST_LOW; break;
-        case 2: internal->tempest = DSV4L2_TEMPEST_HIGH; break;
-        case 3: internal->tempest = DSV4L2_TEMPEST_LOCKDOWN; break;
-        default: internal->tempest = DSV4L2_TEMPEST_DISABLED; break;
-    }
+    /* Query v4l2 control (if the read fails, the cached state is returned) */
+    tempest_read_ctrl(internal);
 
     /* Emit query event (low priority) */
     dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_TEMPEST_QUERY,
@@ -103,7 +222,6 @@ int dsv4l2_set_tempest_state(dsv4l2_device_t *dev,
     dsv4l2_device_internal_t *internal;
     struct v4l2_control ctrl;
     dsv4l2_tempest_state_t old_state;
-    dsv4l2_event_t ev;
 
     if (!dev) {
         return -EINVAL;
@@ -116,15 +234,16 @@ int dsv4l2_set_tempest_state(dsv4l2_device_t *dev,
         return -ENOTSUP;
     }
 
-    /* Get current state */
-    old_state = dsv4l2_get_tempest_state(dev);
-
     /* Validate new state */
     if (new_state < DSV4L2_TEMPEST_DISABLED ||
         new_state > DSV4L2_TEMPEST_LOCKDOWN) {
         return -EINVAL;
     }
 
+    /* Get current state (applies any pending change events first) */
+    dsv4l2_tempest_dequeue_events(internal);
+    old_state = dsv4l2_get_tempest_state(dev);
+
     /* Set v4l2 control */
     memset(&ctrl, 0, sizeof(ctrl));
     ctrl.id = internal->tempest_ctrl_id;
@@ -134,25 +253,10 @@ int dsv4l2_set_tempest_state(dsv4l2_device_t *dev,
         return -errno;
     }
 
-    /* Update cached state */
-    internal->tempest = new_state;
+    /* Update cached state (our own change is not echoed as an event) */
+    __atomic_store_n(&internal->tempest, new_state, __ATOMIC_RELEASE);
 
-    /* Emit TEMPEST transition event (CRITICAL severity) */
-    memset(&ev, 0, sizeof(ev));
-    ev.dev_id = internal->dev_id;
-    ev.event_type = DSV4L2_EVENT_TEMPEST_TRANSITION;
-    ev.severity = DSV4L2_SEV_CRITICAL;
-    ev.aux = (old_state << 16) | new_state;  /* Pack old and new state */
-    ev.layer = dev->layer;
-    strncpy(ev.role, dev->role, sizeof(ev.role) - 1);
-
-    dsv4l2rt_emit(&ev);
-
-    /* If entering LOCKDOWN, emit additional event */
-    if (new_state == DSV4L2_TEMPEST_LOCKDOWN) {
-        dsv4l2rt_emit_simple(internal->dev_id, DSV4L2_EVENT_TEMPEST_LOCKDOWN,
-                             DSV4L2_SEV_CRITICAL, 0);
-    }
+    tempest_emit_transition(internal, old_state, new_state);
 
     return 0;
 }
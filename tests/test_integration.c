@@ -143,7 +143,7 @@ static void test_runtime_integration(void)
 
     /* Check statistics */
     dsv4l2rt_get_stats(&stats);
-    TEST_ASSERT(stats.events_emitted == 3, "Three events emitted");
+    TEST_ASSERT(stats.events_emitted == 2, "Two events emitted (OPS drops TEMPEST_QUERY)");
     TEST_ASSERT(stats.buffer_capacity == 4096, "Buffer capacity correct");
 
     /* Flush and shutdown */
@@ -281,6 +281,30 @@ static void test_error_handling(void)
     /* Test profile not found */
     const dsv4l2_device_profile_t *profile = dsv4l2_find_profile_by_role("nonexistent");
     TEST_ASSERT(profile == NULL, "Handle missing profile gracefully");
+
+    /* Frame lease API argument validation */
+    dsv4l2_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    rc = dsv4l2_frame_acquire(NULL, &frame, 0);
+    TEST_ASSERT(rc == -EINVAL, "frame_acquire rejects NULL device");
+
+    rc = dsv4l2_frame_release(NULL, &frame);
+    TEST_ASSERT(rc == -EINVAL, "frame_release rejects NULL device");
+
+    /* Drop statistics and adaptive depth argument validation */
+    dsv4l2_capture_stats_t stats;
+    rc = dsv4l2_get_capture_stats(NULL, &stats);
+    TEST_ASSERT(rc == -EINVAL, "get_capture_stats rejects NULL device");
+
+    rc = dsv4l2_get_metadata_stats(NULL, &stats);
+    TEST_ASSERT(rc == -EINVAL, "get_metadata_stats rejects NULL stream");
+
+    rc = dsv4l2_set_adaptive_depth(NULL, 4, 8);
+    TEST_ASSERT(rc == -EINVAL, "set_adaptive_depth rejects NULL device");
+
+    dsv4l2_metadata_t meta;
+    rc = dsv4l2_fused_capture_aligned(NULL, NULL, 0, 0, &frame, &meta, NULL, 0);
+    TEST_ASSERT(rc == -EINVAL, "fused_capture_aligned rejects NULL device");
 }
 
 /**
@@ -337,6 +361,258 @@ static void test_layer_policies(void)
     }
 }
 
+/* Reference BT.601 pixel, same fixed-point rules as the library */
+static void ref_yuv_pixel(int y, int u, int v, uint8_t *out)
+{
+    int yy = (y - 16) * 75 + 32;
+    int c[3], i;
+
+    c[0] = yy + 102 * (v - 128);
+    c[1] = yy - (25 * (u - 128) + 52 * (v - 128));
+    c[2] = yy + 129 * (u - 128);
+
+    for (i = 0; i < 3; i++) {
+        int x = c[i] > 32767 ? 32767 : c[i];
+
+        x = x < 0 ? 0 : x >> 6;
+        out[i] = (uint8_t)(x > 255 ? 255 : x);
+    }
+}
+
+/**
+ * Test 11: Pixel Format Conversion
+ */
+static void test_format_conversion(void)
+{
+    /* Width leaves a tail after every SIMD step; odd height for NV12 */
+    enum { W = 70, H = 5, STRIDE = W * 2 + 12 };
+    static uint8_t yuyv[STRIDE * H], uyvy[W * 2 * H];
+    static uint8_t ref_rgb[W * 3 * H], rgb[W * 3 * H], rgb_mt[W * 3 * H];
+    static uint8_t nv12[W * H + W * ((H + 1) / 2)];
+    dsv4l2_image_t src, src2, dst;
+    uint32_t x, y;
+    int rc, ok;
+
+    printf("\n=== Test 11: Pixel Format Conversion ===\n");
+    printf("  kernel: %s\n", dsv4l2_convert_impl());
+
+    for (y = 0; y < H; y++) {
+        for (x = 0; x < W * 2; x++) {
+            yuyv[y * STRIDE + x] = (uint8_t)((x * 37 + y * 101) * 2654435761u >> 24);
+        }
+        for (x = 0; x < W; x += 2) {
+            const uint8_t *m = &yuyv[y * STRIDE + x * 2];
+            uint8_t *n = &uyvy[(y * W + x) * 2];
+
+            n[0] = m[1];
+            n[1] = m[0];
+            n[2] = m[3];
+            n[3] = m[2];
+            ref_yuv_pixel(m[0], m[1], m[3], &ref_rgb[(y * W + x) * 3]);
+            ref_yuv_pixel(m[2], m[1], m[3], &ref_rgb[(y * W + x + 1) * 3]);
+        }
+    }
+
+    TEST_ASSERT(dsv4l2_image_size(V4L2_PIX_FMT_NV12, W, H) == sizeof(nv12),
+                "NV12 image size includes chroma plane");
+    TEST_ASSERT(dsv4l2_convert_supported(V4L2_PIX_FMT_YUYV, V4L2_PIX_FMT_RGB24) &&
+                !dsv4l2_convert_supported(V4L2_PIX_FMT_RGB24, V4L2_PIX_FMT_YUYV),
+                "Supported conversion pairs reported");
+
+    /* Strided YUYV source */
+    rc = dsv4l2_image_init(&src, V4L2_PIX_FMT_YUYV, W, H, yuyv, sizeof(yuyv));
+    src.stride[0] = STRIDE;
+    TEST_ASSERT(rc == 0, "Describe YUYV source");
+
+    dsv4l2_image_init(&dst, V4L2_PIX_FMT_RGB24, W, H, rgb, sizeof(rgb));
+    rc = dsv4l2_convert_image(&src, &dst, 1);
+    TEST_ASSERT(rc == 0 && memcmp(rgb, ref_rgb, sizeof(rgb)) == 0,
+                "YUYV to RGB24 matches reference");
+
+    dsv4l2_image_init(&dst, V4L2_PIX_FMT_RGB24, W, H, rgb_mt, sizeof(rgb_mt));
+    rc = dsv4l2_convert_image(&src, &dst, 3);
+    TEST_ASSERT(rc == 0 && memcmp(rgb_mt, rgb, sizeof(rgb)) == 0,
+                "Row-parallel conversion matches single thread");
+
+    dsv4l2_image_init(&src2, V4L2_PIX_FMT_UYVY, W, H, uyvy, sizeof(uyvy));
+    memset(rgb_mt, 0, sizeof(rgb_mt));
+    dsv4l2_convert_image(&src2, &dst, 1);
+    TEST_ASSERT(memcmp(rgb_mt, ref_rgb, sizeof(rgb)) == 0, "UYVY to RGB24 matches reference");
+
+    dsv4l2_image_init(&dst, V4L2_PIX_FMT_BGR24, W, H, rgb_mt, sizeof(rgb_mt));
+    dsv4l2_convert_image(&src, &dst, 1);
+    ok = 1;
+    for (x = 0; x < W * H; x++) {
+        if (rgb_mt[x * 3] != ref_rgb[x * 3 + 2] || rgb_mt[x * 3 + 2] != ref_rgb[x * 3]) {
+            ok = 0;
+        }
+    }
+    TEST_ASSERT(ok, "BGR24 swaps red and blue");
+
+    dsv4l2_image_init(&dst, V4L2_PIX_FMT_NV12, W, H, nv12, sizeof(nv12));
+    rc = dsv4l2_convert_image(&src, &dst, 2);
+    ok = (rc == 0);
+    for (y = 0; y < H && ok; y++) {
+        const uint8_t *a = &yuyv[y * STRIDE];
+        const uint8_t *b = &yuyv[(y + 1 < H ? y + 1 : y) * STRIDE];
+
+        for (x = 0; x < W; x++) {
+            if (nv12[y * W + x] != a[x * 2]) {
+                ok = 0;
+            }
+            if ((y & 1) == 0 &&
+                nv12[W * H + (y / 2) * W + x] != (uint8_t)((a[x * 2 + 1] + b[x * 2 + 1] + 1) >> 1)) {
+                ok = 0;
+            }
+        }
+    }
+    TEST_ASSERT(ok, "YUYV to NV12 luma and averaged chroma");
+
+    /* Destination in a shared mapping, as for a dmabuf */
+    {
+        FILE *f = tmpfile();
+        uint8_t grey[W * H];
+
+        if (!f || ftruncate(fileno(f), W * H) != 0) {
+            TEST_SKIP("Shared mapping destination (no tmpfile)");
+        } else {
+            rc = dsv4l2_convert_to_dmabuf(&src, fileno(f), V4L2_PIX_FMT_GREY, 0);
+            ok = (rc == 0 && pread(fileno(f), grey, sizeof(grey), 0) == (ssize_t)sizeof(grey));
+            for (x = 0; x < W * H && ok; x++) {
+                if (grey[x] != yuyv[(x / W) * STRIDE + (x % W) * 2]) {
+                    ok = 0;
+                }
+            }
+            TEST_ASSERT(ok, "Convert into mapped fd destination");
+
+            rc = dsv4l2_convert_to_dmabuf(&src, fileno(f), V4L2_PIX_FMT_RGB24, 0);
+            TEST_ASSERT(rc == -ENOBUFS, "Undersized destination fd rejected");
+        }
+        if (f) {
+            fclose(f);
+        }
+    }
+
+    /* Argument validation */
+    dsv4l2_image_init(&dst, V4L2_PIX_FMT_RGB24, W - 1, H, rgb, sizeof(rgb));
+    src2.width = W - 1;
+    TEST_ASSERT(dsv4l2_convert_image(&src2, &dst, 1) == -EINVAL, "Odd width rejected");
+    src2.width = W;
+    dst.width = W;
+    dst.fourcc = V4L2_PIX_FMT_YUYV;
+    dst.stride[0] = 0;
+    TEST_ASSERT(dsv4l2_convert_image(&dst, &src2, 1) == -ENOTSUP,
+                "Unsupported pair rejected");
+    TEST_ASSERT(dsv4l2_image_init(&dst, V4L2_PIX_FMT_RGB24, W, H, rgb, 10) == -ENOBUFS,
+                "Short destination buffer rejected");
+}
+
+/**
+ * Test 12: Latency Histograms
+ */
+static void test_latency_histograms(void)
+{
+    static dsv4l2_histogram_t h, other, snap;
+    uint64_t p50, p99, p999, v;
+    int ok = 1;
+
+    printf("\n=== Test 12: Latency Histograms ===\n");
+
+    memset(&h, 0, sizeof(h));
+    TEST_ASSERT(dsv4l2_histogram_percentile(&h, 50.0) == 0, "Empty histogram reads 0");
+
+    /* Exact below 16 ns */
+    for (v = 0; v < 16; v++) {
+        dsv4l2_histogram_record(&h, v);
+        ok &= dsv4l2_histogram_percentile(&h, 100.0) == v;
+    }
+    TEST_ASSERT(ok, "Small values are exact");
+
+    /* 1..100000 us: percentiles within the 1/16 bucket width */
+    memset(&h, 0, sizeof(h));
+    for (v = 1; v <= 100000; v++) {
+        dsv4l2_histogram_record(&h, v * 1000);
+    }
+    p50 = dsv4l2_histogram_percentile(&h, 50.0);
+    p99 = dsv4l2_histogram_percentile(&h, 99.0);
+    p999 = dsv4l2_histogram_percentile(&h, 99.9);
+    printf("  p50=%llu p99=%llu p999=%llu ns\n", (unsigned long long)p50,
+           (unsigned long long)p99, (unsigned long long)p999);
+    TEST_ASSERT(h.count == 100000 && h.max_ns == 100000000ULL, "Count and max tracked");
+    TEST_ASSERT(p50 >= 50000000ULL && p50 <= 50000000ULL + 50000000ULL / 16,
+                "p50 within bucket error");
+    TEST_ASSERT(p99 >= 99000000ULL && p99 <= 99000000ULL + 99000000ULL / 16,
+                "p99 within bucket error");
+    TEST_ASSERT(p999 >= 99900000ULL && p999 <= h.max_ns, "p999 capped at max");
+    TEST_ASSERT(dsv4l2_histogram_percentile(&h, 100.0) == h.max_ns, "p100 is max");
+
+    /* Out-of-range values land in the last bucket */
+    memset(&other, 0, sizeof(other));
+    dsv4l2_histogram_record(&other, UINT64_MAX);
+    TEST_ASSERT(other.buckets[DSV4L2_HIST_BUCKETS - 1] == 1, "Huge value clamped");
+
+    dsv4l2_histogram_merge(&h, &other);
+    TEST_ASSERT(h.count == 100001 && h.max_ns == UINT64_MAX, "Merge adds counts and max");
+
+    TEST_ASSERT(dsv4l2_get_histogram(NULL, DSV4L2_HIST_LATENCY, &snap) == -EINVAL,
+                "get_histogram rejects NULL device");
+    TEST_ASSERT(dsv4l2_get_metadata_histogram(NULL, DSV4L2_HIST_INTERVAL, &snap) == -EINVAL,
+                "get_metadata_histogram rejects NULL stream");
+}
+
+/**
+ * Test 13: Device Probe Cache
+ */
+static void test_device_probe(void)
+{
+    dsv4l2_device_info_t *nodes = NULL, *again = NULL;
+    dsv4l2_device_t **devices = NULL;
+    size_t count = 0, again_count = 0, dev_count = 0, capture = 0, i;
+    int rc, ok = 1;
+
+    printf("\n=== Test 13: Device Probe Cache ===\n");
+
+    TEST_ASSERT(dsv4l2_probe_devices(NULL, &count) == -EINVAL, "probe_devices rejects NULL output");
+
+    rc = dsv4l2_probe_devices(&nodes, &count);
+    TEST_ASSERT(rc == 0, "Probe succeeds");
+    if (rc != 0) {
+        return;
+    }
+    printf("  %zu node(s)\n", count);
+
+    for (i = 0; i < count; i++) {
+        ok &= strncmp(nodes[i].path, "/dev/video", 10) == 0 && nodes[i].role[0] != '\0';
+        if (i > 0) {
+            ok &= atoi(nodes[i - 1].path + 10) < atoi(nodes[i].path + 10);
+        }
+        capture += (nodes[i].capabilities & V4L2_CAP_VIDEO_CAPTURE) != 0;
+    }
+    TEST_ASSERT(ok, "Entries are video nodes sorted by number");
+
+    /* Cached (or rescanned without netlink): same view either way */
+    rc = dsv4l2_probe_devices(&again, &again_count);
+    TEST_ASSERT(rc == 0 && again_count == count &&
+                (count == 0 || memcmp(again, nodes, count * sizeof(*nodes)) == 0),
+                "Second probe matches the first");
+    free(again);
+
+    dsv4l2_probe_invalidate();
+    rc = dsv4l2_list_devices(&devices, &dev_count);
+    TEST_ASSERT(rc == 0 && dev_count <= capture, "list_devices opens capture nodes only");
+    for (i = 0; i < dev_count; i++) {
+        dsv4l2_close(devices[i]);
+    }
+    free(devices);
+    free(nodes);
+
+    dsv4l2_probe_shutdown();
+    rc = dsv4l2_probe_devices(&nodes, &count);
+    TEST_ASSERT(rc == 0, "Probe restarts after shutdown");
+    free(nodes);
+    dsv4l2_probe_shutdown();
+}
+
 /**
  * Print test summary
  */
@@ -384,6 +660,9 @@ int main(void)
     test_error_handling();
     test_concurrent_events();
     test_layer_policies();
+    test_format_conversion();
+    test_latency_histograms();
+    test_device_probe();
 
     /* Print summary */
     print_summary();
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 
 /* Test result tracking */
 static int tests_passed = 0;
@@ -129,6 +130,186 @@ static void test_klv_parsing(void)
     /* Cleanup */
     free(items);
     free(buffer.data);
+
+    /* Truncated value and trailing fragments (one-shot contract) */
+    {
+        uint8_t data[64];
+        dsv4l2_klv_buffer_t b = { .data = data };
+
+        memcpy(data, DSV4L2_KLV_SENSOR_LATITUDE.bytes, 16);
+        data[16] = 0x04;
+        memset(data + 17, 0xAB, 4);
+        memcpy(data + 21, DSV4L2_KLV_UAS_DATALINK_LS.bytes, 16);
+
+        /* Second item claims 16 value bytes but only 4 follow */
+        data[37] = 0x10;
+        memset(data + 38, 0xCD, 4);
+        b.length = 42;
+        items = NULL;
+        TEST_ASSERT(dsv4l2_parse_klv(&b, &items, &count) == -EINVAL,
+                    "Truncated value returns -EINVAL");
+
+        /* Long-form length cut short */
+        data[37] = 0x82;
+        b.length = 39;
+        TEST_ASSERT(dsv4l2_parse_klv(&b, &items, &count) == -EINVAL,
+                    "Truncated long-form length returns -EINVAL");
+
+        /* Complete item plus a 16-byte fragment (key, no length) */
+        b.length = 37;
+        items = NULL;
+        rc = dsv4l2_parse_klv(&b, &items, &count);
+        TEST_ASSERT(rc == 0 && count == 1, "16-byte trailing fragment ignored");
+        free(items);
+
+        /* Complete item plus a partial key */
+        b.length = 30;
+        items = NULL;
+        rc = dsv4l2_parse_klv(&b, &items, &count);
+        TEST_ASSERT(rc == 0 && count == 1 && items[0].length == 4,
+                    "Partial trailing key ignored");
+        free(items);
+    }
+}
+
+/**
+ * Test the resumable KLV parser on fragmented input
+ */
+static void test_klv_streaming(void)
+{
+    dsv4l2_klv_buffer_t buffer;
+    dsv4l2_klv_parser_t parser;
+    dsv4l2_klv_item_t items[4];
+    uint8_t arena[64];
+    uint8_t long_item[16 + 2 + 200];
+    size_t i, consumed;
+    int rc;
+
+    printf("\n=== Testing Resumable KLV Parser ===\n");
+
+    rc = create_test_klv_buffer(&buffer);
+    TEST_ASSERT(rc == 0, "Create test KLV buffer");
+    if (rc != 0) {
+        return;
+    }
+
+    /* One byte at a time: every key, length and value is split */
+    dsv4l2_klv_parser_init(&parser, items, 4, arena, sizeof(arena));
+    rc = 0;
+    for (i = 0; i < buffer.length && rc >= 0; i++) {
+        rc = dsv4l2_klv_parser_feed(&parser, &buffer.data[i], 1);
+    }
+    TEST_ASSERT(rc == 1, "Byte-wise feed consumes every byte");
+    TEST_ASSERT(dsv4l2_klv_parser_finish(&parser) == 0, "Stream ends on an item boundary");
+    TEST_ASSERT(parser.count == 2, "Byte-wise feed yields 2 items");
+    TEST_ASSERT(items[0].length == 8 && items[0].value[7] == 0x08,
+                "Split value assembled in the arena");
+    TEST_ASSERT(items[1].length == 4 && items[1].value[3] == 0xDD,
+                "Second split value intact");
+    TEST_ASSERT(memcmp(items[1].key.bytes, DSV4L2_KLV_SENSOR_LATITUDE.bytes, 16) == 0,
+                "Split key reassembled");
+
+    /* Whole chunk, one-item array: stops at the boundary and resumes */
+    dsv4l2_klv_parser_init(&parser, items, 1, NULL, 0);
+    rc = dsv4l2_klv_parser_feed(&parser, buffer.data, buffer.length);
+    TEST_ASSERT(rc == 25 && parser.count == 1, "Full item array stops after one item");
+    TEST_ASSERT(items[0].value == &buffer.data[17], "Unsplit value referenced in place");
+
+    consumed = (size_t)rc;
+    dsv4l2_klv_parser_clear(&parser);
+    rc = dsv4l2_klv_parser_feed(&parser, buffer.data + consumed, buffer.length - consumed);
+    TEST_ASSERT(rc == 21 && parser.count == 1 && items[0].length == 4,
+                "Resume after clear");
+
+    /* Truncated input */
+    dsv4l2_klv_parser_init(&parser, items, 4, arena, sizeof(arena));
+    rc = dsv4l2_klv_parser_feed(&parser, buffer.data, 20);
+    TEST_ASSERT(rc == 20 && dsv4l2_klv_parser_finish(&parser) == -EINVAL,
+                "Stream cut inside a value is reported");
+
+    /* Long-form length, split value larger than the arena */
+    memcpy(long_item, DSV4L2_KLV_UAS_DATALINK_LS.bytes, 16);
+    long_item[16] = 0x81;
+    long_item[17] = 200;
+    memset(&long_item[18], 0x5A, 200);
+
+    dsv4l2_klv_parser_init(&parser, items, 4, NULL, 0);
+    rc = dsv4l2_klv_parser_feed(&parser, long_item, sizeof(long_item));
+    TEST_ASSERT(rc == (int)sizeof(long_item) && parser.count == 1 &&
+                items[0].length == 200, "Long-form length parsed");
+
+    dsv4l2_klv_parser_init(&parser, items, 4, arena, sizeof(arena));
+    rc = dsv4l2_klv_parser_feed(&parser, long_item, 40);
+    TEST_ASSERT(rc == -ENOBUFS, "Split value larger than arena rejected");
+    TEST_ASSERT(dsv4l2_klv_parser_feed(&parser, long_item + 40, 10) == -ENOBUFS,
+                "Parser error is sticky");
+
+    free(buffer.data);
+}
+
+/**
+ * Test indexed key lookup and the MISB 0601 local-set decoder
+ */
+static void test_klv_index_misb(void)
+{
+    /* MISB ST 0601 example values (tags 2, 5, 6, 7, 13, 15, plus unknown 65) */
+    static const uint8_t ls_value[] = {
+        0x02, 0x08, 0x00, 0x04, 0x59, 0xF4, 0xA6, 0xAA, 0x4A, 0xA8,
+        0x05, 0x02, 0x71, 0xC2,
+        0x06, 0x02, 0xFD, 0x3D,
+        0x07, 0x02, 0x08, 0xB8,
+        0x0D, 0x04, 0x55, 0x95, 0xB6, 0x6D,
+        0x0F, 0x02, 0xC2, 0x21,
+        0x41, 0x01, 0x0D,
+    };
+    static const uint8_t lon_value[] = { 0x5B, 0x53, 0x60, 0xC4 };
+    dsv4l2_klv_item_t items[3];
+    dsv4l2_klv_index_t idx;
+    dsv4l2_telemetry_t tel;
+    int rc;
+
+    printf("\n=== Testing KLV Index & MISB 0601 Decoder ===\n");
+
+    TEST_ASSERT(dsv4l2_klv_key_id(&DSV4L2_KLV_UAS_DATALINK_LS) == DSV4L2_KLV_KEY_UAS_DATALINK_LS &&
+                dsv4l2_klv_key_id(&DSV4L2_KLV_SENSOR_LATITUDE) == DSV4L2_KLV_KEY_SENSOR_LATITUDE &&
+                dsv4l2_klv_key_id(&DSV4L2_KLV_SENSOR_LONGITUDE) == DSV4L2_KLV_KEY_SENSOR_LONGITUDE &&
+                dsv4l2_klv_key_id(&DSV4L2_KLV_SENSOR_ALTITUDE) == DSV4L2_KLV_KEY_SENSOR_ALTITUDE,
+                "Every known key hashes to its own id");
+
+    memset(items, 0, sizeof(items));
+    items[0].key = DSV4L2_KLV_UAS_DATALINK_LS;
+    items[0].length = sizeof(ls_value);
+    items[0].value = ls_value;
+    items[1].key = DSV4L2_KLV_UAS_DATALINK_LS;
+    items[1].key.bytes[15] = 0x7F;  /* Same hash slot, different key */
+    items[2].key = DSV4L2_KLV_SENSOR_LONGITUDE;
+    items[2].length = sizeof(lon_value);
+    items[2].value = lon_value;
+
+    TEST_ASSERT(dsv4l2_klv_key_id(&items[1].key) == -1, "Unknown key rejected");
+
+    rc = dsv4l2_klv_index_build(&idx, items, 3);
+    TEST_ASSERT(rc == 0, "Build KLV index");
+    TEST_ASSERT(idx.items[DSV4L2_KLV_KEY_UAS_DATALINK_LS] == &items[0], "Index finds UAS LS");
+    TEST_ASSERT(idx.items[DSV4L2_KLV_KEY_SENSOR_LONGITUDE] == &items[2], "Index finds longitude");
+    TEST_ASSERT(idx.items[DSV4L2_KLV_KEY_SENSOR_LATITUDE] == NULL, "Absent key is NULL");
+    TEST_ASSERT(idx.unknown == 1, "Unknown keys counted");
+
+    memset(&tel, 0, sizeof(tel));
+    rc = dsv4l2_klv_decode_telemetry(&idx, &tel);
+    TEST_ASSERT(rc == 7, "Decode 7 telemetry fields");
+    TEST_ASSERT(tel.timestamp_ns == 0x000459F4A6AA4AA8ULL * 1000ULL, "Precision time stamp");
+    TEST_ASSERT(fabs(tel.latitude - 60.1768229669783) < 1e-9, "Sensor latitude");
+    TEST_ASSERT(fabs(tel.longitude - 128.426759042045) < 1e-9, "Standalone sensor longitude");
+    TEST_ASSERT(fabsf(tel.heading - 159.9744f) < 1e-3f, "Platform heading");
+    TEST_ASSERT(fabsf(tel.pitch - (-0.4315251f)) < 1e-4f, "Platform pitch");
+    TEST_ASSERT(fabsf(tel.roll - 3.405814f) < 1e-4f, "Platform roll");
+    TEST_ASSERT(fabsf(tel.altitude - 14190.72f) < 0.01f, "Sensor true altitude");
+
+    rc = dsv4l2_decode_misb0601(ls_value, sizeof(ls_value) - 1, &tel);
+    TEST_ASSERT(rc == -EINVAL, "Truncated local set rejected");
+
+    TEST_ASSERT(dsv4l2_klv_index_build(NULL, items, 3) == -EINVAL, "Index rejects NULL");
 }
 
 /**
@@ -180,6 +361,218 @@ static void test_ir_radiometric(void)
     }
 }
 
+/**
+ * Test IR decode into caller buffers (SIMD kernels and threading)
+ */
+static void test_ir_decode_into(void)
+{
+    enum { W = 37, H = 19, N = W * H };
+    static uint16_t raw[N], ref[N], out1[N], out3[N];
+    float calibration[2] = { 0.01f, 273.15f };
+    dsv4l2_ir_stats_t stats;
+    uint16_t mn = 0xFFFF, mx = 0;
+    double sum = 0.0;
+    int rc, exact = 1, same = 1;
+    size_t i;
+
+    printf("\n=== Testing IR Decode Into Caller Buffer ===\n");
+
+    /* Odd size so every kernel runs its scalar tail */
+    for (i = 0; i < N; i++) {
+        float t;
+
+        raw[i] = (uint16_t)((i * 2654435761u) >> 16);
+        t = calibration[0] * raw[i] + calibration[1];
+
+        if (t > 500.0f) t = 500.0f;  /* Encoder clamps to 0..500 K */
+        ref[i] = (uint16_t)(t * 100.0f);
+        if (ref[i] < mn) mn = ref[i];
+        if (ref[i] > mx) mx = ref[i];
+        sum += ref[i];
+    }
+
+    TEST_ASSERT(dsv4l2_ir_decode_impl() != NULL, "IR decode kernel selected");
+    printf("  kernel: %s\n", dsv4l2_ir_decode_impl());
+
+    rc = dsv4l2_decode_ir_into(raw, W, H, calibration, out1, 1, &stats);
+    TEST_ASSERT(rc == 0, "Decode into buffer (1 thread)");
+    for (i = 0; i < N; i++) {
+        if (abs((int)out1[i] - (int)ref[i]) > 1) {
+            exact = 0;
+        }
+    }
+    TEST_ASSERT(exact, "Kernel matches scalar reference");
+    TEST_ASSERT(abs((int)stats.min - (int)mn) <= 1 &&
+                abs((int)stats.max - (int)mx) <= 1, "Min/max stats");
+    TEST_ASSERT(fabs(stats.mean - sum / N) < 1.0, "Mean stat");
+
+    rc = dsv4l2_decode_ir_into(raw, W, H, calibration, out3, 3, NULL);
+    TEST_ASSERT(rc == 0, "Decode into buffer (3 threads)");
+    for (i = 0; i < N; i++) {
+        if (out3[i] != out1[i]) {
+            same = 0;
+        }
+    }
+    TEST_ASSERT(same, "Threaded decode matches single thread");
+
+    TEST_ASSERT(dsv4l2_decode_ir_into(NULL, W, H, calibration, out1, 1, NULL) == -EINVAL,
+                "NULL raw rejected");
+    TEST_ASSERT(dsv4l2_decode_ir_into(raw, W, H, calibration, NULL, 1, NULL) == -EINVAL,
+                "NULL output rejected");
+}
+
+/**
+ * Test IR decode stats on full-size maps (sum accumulator overflow)
+ */
+static void test_ir_decode_stats_large(void)
+{
+    enum { W = 1280, H = 1024, N = W * H };
+    static uint16_t raw[N], out[N];
+    float calibration[2] = { 0.01f, 0.0f };
+    dsv4l2_ir_stats_t stats;
+    uint16_t mn = 0xFFFF, mx = 0;
+    double sum = 0.0;
+    int rc;
+    size_t i;
+
+    printf("\n=== Testing IR Decode Stats (%dx%d) ===\n", W, H);
+
+    /* Uniform 300 K map: every pixel decodes to 30000 */
+    for (i = 0; i < N; i++) {
+        raw[i] = 30000;
+    }
+
+    rc = dsv4l2_decode_ir_into(raw, W, H, calibration, out, 1, &stats);
+    TEST_ASSERT(rc == 0, "Decode full-size map");
+    TEST_ASSERT(stats.min == 30000 && stats.max == 30000, "Uniform map min/max");
+    TEST_ASSERT(fabs(stats.mean - 30000.0) < 1.0, "Uniform map mean (no sum overflow)");
+
+    rc = dsv4l2_decode_ir_into(raw, 640, 512, calibration, out, 1, &stats);
+    TEST_ASSERT(rc == 0 && fabs(stats.mean - 30000.0) < 1.0, "640x512 uniform map mean");
+
+    /* Varied map against the scalar reference */
+    for (i = 0; i < N; i++) {
+        float t;
+        uint16_t v;
+
+        raw[i] = (uint16_t)(20000 + ((i * 2654435761u) >> 16) % 30000);
+        t = calibration[0] * raw[i] + calibration[1];
+        v = (uint16_t)(t * 100.0f);
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+        sum += v;
+    }
+
+    rc = dsv4l2_decode_ir_into(raw, W, H, calibration, out, 1, &stats);
+    TEST_ASSERT(rc == 0, "Decode varied full-size map");
+    TEST_ASSERT(abs((int)stats.min - (int)mn) <= 1 &&
+                abs((int)stats.max - (int)mx) <= 1, "Varied map min/max match scalar");
+    TEST_ASSERT(fabs(stats.mean - sum / N) < 1.0, "Varied map mean matches scalar");
+
+    rc = dsv4l2_decode_ir_into(raw, W, H, calibration, out, 4, &stats);
+    TEST_ASSERT(rc == 0 && fabs(stats.mean - sum / N) < 1.0, "Threaded mean matches scalar");
+}
+
+/**
+ * Test the timestamp-sorted metadata history ring
+ */
+static void test_metadata_history(void)
+{
+    static const uint64_t ms = 1000000ULL;
+    dsv4l2_meta_history_t *hist = NULL;
+    dsv4l2_metadata_t m, out;
+    uint8_t klv[24], copy[32];
+    int rc, i;
+
+    printf("\n=== Testing Metadata History ===\n");
+
+    rc = dsv4l2_meta_history_create(4, sizeof(klv), &hist);
+    TEST_ASSERT(rc == 0 && hist != NULL, "Create history ring");
+    if (rc != 0) {
+        return;
+    }
+
+    /* Telemetry at 100 ms and 200 ms, then a late 150 ms sample */
+    memset(&m, 0, sizeof(m));
+    m.format = DSV4L2_META_FORMAT_TELEMETRY;
+    m.timestamp_ns = 100 * ms;
+    m.data.telemetry.latitude = 10.0;
+    m.data.telemetry.heading = 350.0f;
+    dsv4l2_meta_history_push(hist, &m, NULL, 0);
+    m.timestamp_ns = 200 * ms;
+    m.data.telemetry.latitude = 20.0;
+    m.data.telemetry.heading = 10.0f;
+    dsv4l2_meta_history_push(hist, &m, NULL, 0);
+    m.timestamp_ns = 150 * ms;
+    m.data.telemetry.latitude = 15.0;
+    rc = dsv4l2_meta_history_push(hist, &m, NULL, 0);
+    TEST_ASSERT(rc == 0 && dsv4l2_meta_history_count(hist) == 3, "Out-of-order push");
+
+    rc = dsv4l2_meta_history_find(hist, 160 * ms, 20 * ms, 0, &out, NULL, 0);
+    TEST_ASSERT(rc == 0 && out.timestamp_ns == 150 * ms, "Nearest entry found");
+
+    rc = dsv4l2_meta_history_find(hist, 175 * ms, 30 * ms, DSV4L2_META_FIND_INTERPOLATE,
+                                  &out, NULL, 0);
+    TEST_ASSERT(rc == 0 && out.timestamp_ns == 175 * ms &&
+                fabs(out.data.telemetry.latitude - 17.5) < 1e-9,
+                "Telemetry interpolated between neighbours");
+    TEST_ASSERT(fabsf(out.data.telemetry.heading - 10.0f) < 1e-3f,
+                "Interpolation endpoint heading");
+
+    rc = dsv4l2_meta_history_find(hist, 115 * ms, 30 * ms, DSV4L2_META_FIND_INTERPOLATE,
+                                  &out, NULL, 0);
+    TEST_ASSERT(rc == 0 && fabsf(out.data.telemetry.heading - 356.0f) < 1e-3f,
+                "Heading interpolation wraps through north");
+
+    rc = dsv4l2_meta_history_find(hist, 300 * ms, 50 * ms, 0, &out, NULL, 0);
+    TEST_ASSERT(rc == -ENOENT, "Nothing within tolerance");
+
+    /* Fill past depth: the oldest goes, anything older still is refused */
+    m.timestamp_ns = 250 * ms;
+    dsv4l2_meta_history_push(hist, &m, NULL, 0);
+    m.timestamp_ns = 300 * ms;
+    dsv4l2_meta_history_push(hist, &m, NULL, 0);
+    TEST_ASSERT(dsv4l2_meta_history_count(hist) == 4, "Ring capped at depth");
+    TEST_ASSERT(dsv4l2_meta_history_find(hist, 100 * ms, 1, 0, &out, NULL, 0) == -ENOENT,
+                "Oldest entry dropped");
+    m.timestamp_ns = 50 * ms;
+    TEST_ASSERT(dsv4l2_meta_history_push(hist, &m, NULL, 0) == -ESTALE,
+                "Entry older than a full ring refused");
+
+    /* KLV entries keep their own payload copy */
+    for (i = 0; i < (int)sizeof(klv); i++) {
+        klv[i] = (uint8_t)i;
+    }
+    memset(&m, 0, sizeof(m));
+    m.format = DSV4L2_META_FORMAT_KLV;
+    m.timestamp_ns = 400 * ms;
+    m.data.klv.data = klv;
+    m.data.klv.length = sizeof(klv);
+    rc = dsv4l2_meta_history_push(hist, &m, klv, sizeof(klv));
+    TEST_ASSERT(rc == 0, "Push KLV entry");
+    memset(klv, 0xEE, sizeof(klv));
+
+    rc = dsv4l2_meta_history_find(hist, 400 * ms, 0, 0, &out, copy, sizeof(copy));
+    TEST_ASSERT(rc == 0 && out.data.klv.data == copy && copy[5] == 5 &&
+                out.data.klv.length == sizeof(klv), "KLV payload copied out");
+
+    rc = dsv4l2_meta_history_find(hist, 400 * ms, 0, 0, &out, NULL, 0);
+    TEST_ASSERT(rc == 0 && out.data.klv.data == NULL && out.data.klv.length == sizeof(klv),
+                "NULL payload clears the pointer");
+    rc = dsv4l2_meta_history_find(hist, 400 * ms, 0, 0, &out, copy, 4);
+    TEST_ASSERT(rc == -EMSGSIZE, "Short payload buffer rejected");
+
+    m.data.klv.data = copy;
+    TEST_ASSERT(dsv4l2_meta_history_push(hist, &m, copy, sizeof(copy)) == -EMSGSIZE,
+                "Oversized payload rejected");
+
+    TEST_ASSERT(dsv4l2_metadata_set_history(NULL, 8) == -EINVAL,
+                "set_history rejects NULL stream");
+    TEST_ASSERT(dsv4l2_metadata_get_history(NULL) == NULL, "No history without a stream");
+
+    dsv4l2_meta_history_destroy(hist);
+}
+
 /**
  * Test timestamp synchronization
  */
@@ -253,6 +646,116 @@ static void test_metadata_formats(void)
     TEST_ASSERT(metadata.sequence == 42, "Set sequence");
 }
 
+/* Little-endian writers for building wire-format buffers */
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static void put_f32(uint8_t *p, float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put_le32(p, v);
+}
+
+static void put_f64(uint8_t *p, double d)
+{
+    uint64_t v;
+    memcpy(&v, &d, sizeof(v));
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+/**
+ * Test in-place decoders for the fixed-format metadata types
+ */
+static void test_inplace_decoders(void)
+{
+    static uint16_t storage[64];  /* 2-byte aligned backing for IR buffers */
+    uint8_t *ir = (uint8_t *)storage;
+    uint8_t tel[DSV4L2_META_TELEMETRY_SIZE];
+    uint8_t tim[DSV4L2_META_TIMING_SIZE];
+    dsv4l2_ir_radiometric_t ir_out;
+    dsv4l2_telemetry_t tel_out;
+    dsv4l2_timing_t tim_out;
+    dsv4l2_metadata_t meta;
+    uint8_t arena[64];
+    int rc;
+
+    printf("\n=== Testing In-place Metadata Decoders ===\n");
+
+    /* IR_TEMP: 2x2 map after the header */
+    memset(storage, 0, sizeof(storage));
+    ir[0] = 2; ir[1] = 0;
+    ir[2] = 2; ir[3] = 0;
+    put_f32(ir + 4, 0.98f);
+    put_f32(ir + 8, 295.0f);
+    put_f32(ir + 12, 0.04f);
+    put_f32(ir + 16, -10.0f);
+    storage[DSV4L2_META_IR_HEADER_SIZE / 2] = 30000;
+
+    rc = dsv4l2_decode_ir_temp(ir, DSV4L2_META_IR_HEADER_SIZE + 8, &ir_out);
+    TEST_ASSERT(rc == 0, "Decode IR_TEMP buffer");
+    TEST_ASSERT(ir_out.width == 2 && ir_out.height == 2, "IR map dimensions");
+    TEST_ASSERT(ir_out.emissivity > 0.979f && ir_out.emissivity < 0.981f,
+                "IR emissivity");
+    TEST_ASSERT((uint8_t *)ir_out.temp_map == ir + DSV4L2_META_IR_HEADER_SIZE,
+                "IR map points into the buffer");
+    TEST_ASSERT(ir_out.temp_map[0] == 30000, "IR map value read in place");
+
+    rc = dsv4l2_decode_ir_temp(ir, DSV4L2_META_IR_HEADER_SIZE + 6, &ir_out);
+    TEST_ASSERT(rc == -EINVAL, "Reject truncated IR map");
+
+    /* TELEMETRY */
+    put_f64(tel, 51.5);
+    put_f64(tel + 8, -0.125);
+    put_f32(tel + 16, 120.0f);
+    put_f32(tel + 20, 90.0f);
+    put_f32(tel + 24, 1.0f);
+    put_f32(tel + 28, -2.0f);
+    put_f32(tel + 32, 3.0f);
+    put_f32(tel + 36, 4.0f);
+    put_f32(tel + 40, 5.0f);
+
+    rc = dsv4l2_decode_telemetry(tel, sizeof(tel), &tel_out);
+    TEST_ASSERT(rc == 0, "Decode TELEMETRY buffer");
+    TEST_ASSERT(tel_out.latitude == 51.5 && tel_out.longitude == -0.125,
+                "Telemetry position");
+    TEST_ASSERT(tel_out.heading == 90.0f && tel_out.roll == -2.0f,
+                "Telemetry attitude");
+    TEST_ASSERT(tel_out.velocity[2] == 5.0f, "Telemetry velocity");
+    TEST_ASSERT(dsv4l2_decode_telemetry(tel, sizeof(tel) - 1, &tel_out) == -EINVAL,
+                "Reject short telemetry");
+
+    /* TIMING */
+    put_le32(tim, 0x89ABCDEF);
+    put_le32(tim + 4, 0x01234567);
+    put_le32(tim + 8, 42);
+    put_le32(tim + 12, 0);
+    put_le32(tim + 16, 7);
+    put_le32(tim + 20, 0x3);
+
+    rc = dsv4l2_decode_timing(tim, sizeof(tim), &tim_out);
+    TEST_ASSERT(rc == 0, "Decode TIMING buffer");
+    TEST_ASSERT(tim_out.sensor_ts_ns == 0x0123456789ABCDEFULL, "Timing sensor timestamp");
+    TEST_ASSERT(tim_out.sync_token == 42 && tim_out.frame_sequence == 7 &&
+                tim_out.flags == 0x3, "Timing token, sequence and flags");
+    TEST_ASSERT(dsv4l2_decode_timing(tim, 8, &tim_out) == -EINVAL,
+                "Reject short timing");
+
+    /* Capture entry points validate arguments */
+    TEST_ASSERT(dsv4l2_metadata_acquire(NULL, &meta) == -EINVAL,
+                "metadata_acquire rejects NULL stream");
+    TEST_ASSERT(dsv4l2_metadata_release(NULL, &meta) == -EINVAL,
+                "metadata_release rejects NULL stream");
+    TEST_ASSERT(dsv4l2_capture_metadata_into(NULL, &meta, arena, sizeof(arena)) == -EINVAL,
+                "capture_metadata_into rejects NULL stream");
+}
+
 /**
  * Main test runner
  */
@@ -263,9 +766,15 @@ int main(void)
 
     /* Run test suites */
     test_klv_parsing();
+    test_klv_streaming();
+    test_klv_index_misb();
     test_ir_radiometric();
+    test_ir_decode_into();
+    test_ir_decode_stats_large();
     test_timestamp_sync();
+    test_metadata_history();
     test_metadata_formats();
+    test_inplace_decoders();
 
     /* Print summary */
     printf("\n=============================\n");
@@ -9,6 +9,7 @@
 #include "dsv4l2_profiles.h"
 #include "dsv4l2_dsmil.h"
 #include "dsv4l2rt.h"
+#include "../src/device_internal.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -143,9 +144,130 @@ static void test_capture_authorization(void)
     dsv4l2_set_threatcon(THREATCON_EMERGENCY);
     printf("  [INFO] THREATCON EMERGENCY -> LOCKDOWN would block all capture\n");
 
+    /* Fleet-wide fan-out with no devices open */
+    {
+        dsv4l2_threatcon_result_t results[4];
+        size_t count = 99;
+
+        TEST_ASSERT(dsv4l2_apply_threatcon_all(results, 4, &count) == 0,
+                    "Fan-out with no open devices succeeds");
+        TEST_ASSERT(count == 0, "Registry is empty");
+        TEST_ASSERT(dsv4l2_apply_threatcon_all(NULL, 0, NULL) == 0,
+                    "Fan-out without result buffer");
+    }
+
     dsv4l2_set_threatcon(THREATCON_NORMAL);
 }
 
+/**
+ * Test the cached per-device capture decision on a mock device
+ */
+static void test_capture_decision(void)
+{
+    static dsv4l2_device_internal_t mock;
+    uint32_t generation;
+
+    printf("\n=== Testing Cached Capture Decision ===\n");
+
+    /* No TEMPEST control: the state reads as DISABLED without an ioctl */
+    memset(&mock, 0, sizeof(mock));
+    mock.public.fd = -1;
+    mock.public.role = "generic_webcam";
+    mock.public.layer = 3;
+    dsv4l2_policy_decide(&mock);
+
+    TEST_ASSERT(DSV4L2_POLICY_GENERATION(mock.policy) != 0, "Decision computed at open");
+    TEST_ASSERT(dsv4l2_check_capture_allowed(&mock.public, "test") == 0,
+                "L3 device may capture");
+
+    mock.public.layer = 7;
+    TEST_ASSERT(dsv4l2_check_capture_allowed(&mock.public, "test") == -EPERM,
+                "Layer reassignment recomputes the decision");
+    TEST_ASSERT(DSV4L2_POLICY_LAYER(mock.policy) == 7 &&
+                DSV4L2_POLICY_MIN_TEMPEST(mock.policy) == DSV4L2_TEMPEST_HIGH,
+                "L7 decision requires TEMPEST HIGH");
+
+    mock.public.layer = 3;
+    TEST_ASSERT(dsv4l2_check_capture_allowed(&mock.public, "test") == 0,
+                "L3 decision restored");
+
+    generation = DSV4L2_POLICY_GENERATION(mock.policy);
+    dsv4l2_set_threatcon(THREATCON_ALPHA);
+    TEST_ASSERT(dsv4l2_policy_capture_check(&mock, DSV4L2_TEMPEST_DISABLED, "test") == 0,
+                "Capture-path check allows DISABLED");
+    TEST_ASSERT(DSV4L2_POLICY_GENERATION(mock.policy) != generation,
+                "THREATCON change invalidates the decision");
+    TEST_ASSERT(dsv4l2_policy_capture_check(&mock, DSV4L2_TEMPEST_LOCKDOWN, "test") == -EPERM,
+                "Capture-path check blocks LOCKDOWN");
+
+    /* EMERGENCY blocks capture even without a TEMPEST control */
+    dsv4l2_set_threatcon(THREATCON_EMERGENCY);
+    TEST_ASSERT(dsv4l2_check_capture_allowed(&mock.public, "test") == -EPERM,
+                "THREATCON EMERGENCY denies capture");
+    TEST_ASSERT(dsv4l2_policy_capture_check(&mock, DSV4L2_TEMPEST_DISABLED, "test") == -EPERM,
+                "THREATCON EMERGENCY denies the capture path");
+    dsv4l2_set_threatcon(THREATCON_NORMAL);
+    TEST_ASSERT(dsv4l2_policy_capture_check(&mock, DSV4L2_TEMPEST_DISABLED, "test") == 0,
+                "Capture resumes after EMERGENCY is lifted");
+
+    /* UNCLASSIFIED user, TOP_SECRET role */
+    mock.public.role = "tempest_cam";
+    dsv4l2_policy_decide(&mock);
+    TEST_ASSERT(dsv4l2_policy_capture_check(&mock, DSV4L2_TEMPEST_DISABLED, "test") == -EPERM,
+                "Insufficient clearance denies capture");
+}
+
+/**
+ * Test THREATCON fan-out across several registered mock devices
+ */
+static void test_threatcon_fanout(void)
+{
+    static dsv4l2_device_internal_t mocks[3];
+    dsv4l2_threatcon_result_t results[4];
+    size_t count = 0;
+    size_t i, j;
+    int found = 1;
+    int rc;
+
+    printf("\n=== Testing THREATCON Fan-out ===\n");
+
+    /* No TEMPEST control: reported as -ENOTSUP without an ioctl */
+    memset(mocks, 0, sizeof(mocks));
+    for (i = 0; i < 3; i++) {
+        mocks[i].public.fd = -1;
+        mocks[i].public.role = "generic_webcam";
+        mocks[i].public.layer = 3;
+        dsv4l2_registry_add(&mocks[i]);
+    }
+
+    memset(results, 0, sizeof(results));
+    rc = dsv4l2_apply_threatcon_all(results, 4, &count);
+    TEST_ASSERT(rc == 0 && count == 3, "Fan-out reaches all three devices");
+    for (i = 0; i < 3; i++) {
+        int match = 0;
+
+        for (j = 0; j < 3; j++) {
+            match |= results[j].dev == &mocks[i].public;
+        }
+        found &= match && results[i].result == -ENOTSUP;
+    }
+    TEST_ASSERT(found, "Each device reported once; no TEMPEST control is not a failure");
+
+    rc = dsv4l2_apply_threatcon_all(results, 1, &count);
+    TEST_ASSERT(rc == 0 && count == 3, "Result capacity does not limit the fan-out");
+
+    /* A device whose TEMPEST control cannot be set fails the fan-out */
+    mocks[1].tempest_ctrl_id = 0x009a0901;
+    rc = dsv4l2_apply_threatcon_all(NULL, 0, &count);
+    TEST_ASSERT(rc == -EBADF && count == 3, "Failed transition is returned");
+
+    for (i = 0; i < 3; i++) {
+        dsv4l2_registry_remove(&mocks[i]);
+    }
+    rc = dsv4l2_apply_threatcon_all(NULL, 0, &count);
+    TEST_ASSERT(rc == 0 && count == 0, "Removed devices leave the registry");
+}
+
 /**
  * Test profile loading with security metadata
  */
@@ -197,6 +319,8 @@ int main(void)
     test_clearance_checking();
     test_layer_policies();
     test_capture_authorization();
+    test_capture_decision();
+    test_threatcon_fanout();
     test_profile_security();
 
     /* Print summary */
@@ -6,7 +6,52 @@
 
 #include "dsv4l2_profiles.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg) do { \
+    if (cond) { \
+        printf("  [PASS] %s\n", msg); \
+    } else { \
+        printf("  [FAIL] %s\n", msg); \
+        failures++; \
+    } \
+} while (0)
+
+static void write_profile(const char *dir, const char *name, const char *id,
+                          const char *role)
+{
+    char path[512], tmp[520];
+    FILE *fp;
+
+    /* Write-then-rename, the way deployment tools replace profiles */
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    snprintf(tmp, sizeof(tmp), "%s/.tmp", dir);
+    fp = fopen(tmp, "w");
+    if (fp) {
+        fprintf(fp, "id: \"%s\"\nrole: \"%s\"\nclassification: \"SECRET\"\n", id, role);
+        fclose(fp);
+        rename(tmp, path);
+    }
+}
+
+/* Wait (up to 3 s) for the watcher to publish a new snapshot */
+static int wait_generation(unsigned int after)
+{
+    int i;
+
+    for (i = 0; i < 300; i++) {
+        if (dsv4l2_profiles_generation() != after) {
+            return 1;
+        }
+        usleep(10000);
+    }
+    return 0;
+}
 
 int main(void)
 {
@@ -68,6 +113,84 @@ int main(void)
     }
     printf("\n");
 
+    /* Test 5: Configured directory and binary cache */
+    printf("Test 5: Profile store directory and cache\n");
+    {
+        char dir[] = "/tmp/dsv4l2_profiles_XXXXXX";
+        char cache[600], path[600];
+        const dsv4l2_device_profile_t *old_profile;
+        unsigned int gen;
+        FILE *fp;
+
+        if (!mkdtemp(dir)) {
+            printf("  [FAIL] mkdtemp\n");
+            return 1;
+        }
+        snprintf(cache, sizeof(cache), "%s/profiles.cache", dir);
+
+        write_profile(dir, "a.yaml", "1234:0001", "store_cam");
+        write_profile(dir, "b.yaml", "1234:0002", "store_ir");
+
+        CHECK(dsv4l2_profiles_configure(dir, cache) == 2, "Configured directory loaded");
+        CHECK(access(cache, R_OK) == 0, "Binary cache written");
+        profile = dsv4l2_find_profile("1234:0002");
+        CHECK(profile && strcmp(profile->role, "store_ir") == 0, "Lookup by id");
+        profile = dsv4l2_find_profile_by_role("store_cam");
+        CHECK(profile && strcmp(profile->id, "1234:0001") == 0, "Lookup by role");
+        CHECK(dsv4l2_find_profile("046d:0825") == NULL, "Previous directory replaced");
+
+        CHECK(dsv4l2_profiles_reload() == 2, "Reload from cache");
+        profile = dsv4l2_find_profile("1234:0001");
+        CHECK(profile && strcmp(profile->classification, "SECRET") == 0 &&
+              strcmp(profile->filename, "a.yaml") == 0, "Cached profile intact");
+
+        /* A damaged cache is ignored and rewritten */
+        fp = fopen(cache, "w");
+        if (fp) {
+            fputs("garbage", fp);
+            fclose(fp);
+        }
+        CHECK(dsv4l2_profiles_reload() == 2, "Truncated cache ignored");
+
+        /* Test 6: Hot reload */
+        printf("\nTest 6: Hot reload\n");
+        old_profile = dsv4l2_find_profile("1234:0001");
+        CHECK(dsv4l2_profiles_watch() == 0, "Watcher started");
+        CHECK(dsv4l2_profiles_configure(".", NULL) == -EBUSY, "Reconfigure refused while watching");
+
+        gen = dsv4l2_profiles_generation();
+        write_profile(dir, "c.yaml", "1234:0003", "store_new");
+        CHECK(wait_generation(gen), "Snapshot swapped after a new file");
+        CHECK(dsv4l2_find_profile_by_role("store_new") != NULL, "New profile visible");
+        CHECK(old_profile && strcmp(old_profile->id, "1234:0001") == 0,
+              "Old snapshot still readable");
+
+        gen = dsv4l2_profiles_generation();
+        snprintf(path, sizeof(path), "%s/a.yaml", dir);
+        unlink(path);
+        CHECK(wait_generation(gen), "Snapshot swapped after a removal");
+        CHECK(dsv4l2_find_profile("1234:0001") == NULL, "Removed profile gone");
+        CHECK(dsv4l2_get_profile_count() == 2, "Count follows the directory");
+
+        dsv4l2_profiles_shutdown();
+        CHECK(dsv4l2_get_profile_count() == count, "Defaults back after shutdown");
+
+        unlink(cache);
+        snprintf(path, sizeof(path), "%s/b.yaml", dir);
+        unlink(path);
+        snprintf(path, sizeof(path), "%s/c.yaml", dir);
+        unlink(path);
+        rmdir(dir);
+    }
+    printf("\n");
+
+    dsv4l2_profiles_shutdown();
+
+    if (failures > 0) {
+        printf("%d profile test(s) FAILED\n", failures);
+        return 1;
+    }
+
     printf("All profile tests completed!\n");
 
     return 0;
@@ -5,12 +5,29 @@
  */
 
 #include "dsv4l2rt.h"
+#include "../src/runtime/shm_ring.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#ifdef HAVE_SQLITE3
+#include <sqlite3.h>
+#include <time.h>
+#endif
+
+#ifdef HAVE_HIREDIS
+#include <pthread.h>
+#include <signal.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
 
 /* Test result tracking */
 static int tests_passed = 0;
@@ -192,8 +209,8 @@ static void test_file_sink(void)
 {
     dsv4l2rt_config_t config;
     const char *test_file = "/tmp/dsv4l2_test_events.bin";
-    FILE *f;
-    dsv4l2_event_t ev_read;
+    dsv4l2rt_log_t *log = NULL;
+    const dsv4l2_event_t *ev_read;
     int i, count;
 
     printf("\n=== Testing File Sink ===\n");
@@ -222,20 +239,21 @@ static void test_file_sink(void)
     dsv4l2rt_shutdown();
 
     /* Read back events from file */
-    f = fopen(test_file, "rb");
-    TEST_ASSERT(f != NULL, "Open event file for reading");
+    rc = dsv4l2rt_log_open(test_file, &log);
+    TEST_ASSERT(rc == 0, "Open event log for reading");
 
-    if (f) {
+    if (rc == 0) {
         count = 0;
-        while (fread(&ev_read, sizeof(ev_read), 1, f) == 1) {
+        while (dsv4l2rt_log_next(log, &ev_read) == 0) {
             count++;
             if (count == 1) {
-                TEST_ASSERT(ev_read.dev_id == 0, "First event dev_id = 0");
-                TEST_ASSERT(ev_read.event_type == DSV4L2_EVENT_FRAME_ACQUIRED,
+                TEST_ASSERT(ev_read->dev_id == 0, "First event dev_id = 0");
+                TEST_ASSERT(ev_read->event_type == DSV4L2_EVENT_FRAME_ACQUIRED,
                            "First event type = FRAME_ACQUIRED");
             }
         }
-        fclose(f);
+        TEST_ASSERT(dsv4l2rt_log_chunk_count(log) >= 1, "Log has chunk index");
+        dsv4l2rt_log_close(log);
 
         TEST_ASSERT(count == 10, "Read 10 events from file");
     }
@@ -244,6 +262,147 @@ static void test_file_sink(void)
     unlink(test_file);
 }
 
+/**
+ * Test event log seek, append-on-reopen and footer recovery
+ */
+static void test_event_log(void)
+{
+    dsv4l2rt_config_t config;
+    const char *test_file = "/tmp/dsv4l2_test_log.bin";
+    dsv4l2rt_log_t *log = NULL;
+    const dsv4l2rt_chunk_header_t *hdr;
+    const dsv4l2_event_t *ev, *events;
+    dsv4l2_event_t raw;
+    char legacy[64];
+    uint64_t ts[15];
+    size_t n, total;
+    uint64_t chunks;
+    struct stat st;
+    int i, count, ordered, fd, rc;
+
+    printf("\n=== Testing Event Log ===\n");
+
+    unlink(test_file);
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.sink_type = "file";
+    config.sink_config = test_file;
+
+    /* Two sessions appending to the same log */
+    rc = dsv4l2rt_init(&config);
+    for (i = 0; i < 10; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, i);
+    }
+    dsv4l2rt_shutdown();
+
+    rc |= dsv4l2rt_init(&config);
+    for (i = 10; i < 15; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, i);
+    }
+    dsv4l2rt_shutdown();
+    TEST_ASSERT(rc == 0, "Reopen log for a second session");
+
+    rc = dsv4l2rt_log_open(test_file, &log);
+    TEST_ASSERT(rc == 0, "Open appended log");
+    if (rc != 0) {
+        unlink(test_file);
+        return;
+    }
+
+    count = 0;
+    ordered = 1;
+    while (count < 15 && dsv4l2rt_log_next(log, &ev) == 0) {
+        ts[count] = ev->ts_ns;
+        if (ev->dev_id != (uint32_t)count) {
+            ordered = 0;
+        }
+        count++;
+    }
+    TEST_ASSERT(count == 15, "Read 15 events across both sessions");
+    TEST_ASSERT(ordered, "Events read back in emit order");
+    TEST_ASSERT(dsv4l2rt_log_chunk_count(log) >= 2, "One chunk per flushed batch");
+
+    /* Seek to the 12th event */
+    rc = dsv4l2rt_log_seek(log, ts[11]);
+    TEST_ASSERT(rc == 0 && dsv4l2rt_log_next(log, &ev) == 0 && ev->dev_id == 11,
+                "Seek by timestamp lands on matching event");
+    TEST_ASSERT(dsv4l2rt_log_seek(log, ts[14] + 1) == -ENODATA,
+                "Seek past end returns -ENODATA");
+
+    /* Chunk iteration covers every event */
+    dsv4l2rt_log_seek(log, 0);
+    total = 0;
+    chunks = 0;
+    ordered = 1;
+    while (dsv4l2rt_log_next_chunk(log, &hdr, &events, &n) == 0) {
+        if (hdr->event_count != n || events[0].ts_ns != hdr->timestamp_ns) {
+            break;
+        }
+        if (hdr->chunk_id != chunks) {
+            ordered = 0;
+        }
+        total += n;
+        chunks++;
+    }
+    TEST_ASSERT(total == 15, "Chunk iteration covers every event");
+    TEST_ASSERT(ordered, "Reopened log continues the chunk sequence");
+    dsv4l2rt_log_close(log);
+
+    /* Drop the footer: reader must rebuild the index from records */
+    rc = stat(test_file, &st);
+    if (rc == 0) {
+        rc = truncate(test_file, st.st_size - 32);
+    }
+    TEST_ASSERT(rc == 0, "Truncate log footer");
+
+    rc = dsv4l2rt_log_open(test_file, &log);
+    TEST_ASSERT(rc == 0, "Open log without footer");
+    if (rc == 0) {
+        count = 0;
+        while (dsv4l2rt_log_next(log, &ev) == 0) {
+            count++;
+        }
+        TEST_ASSERT(count == 15, "Recovered 15 events without footer");
+        dsv4l2rt_log_close(log);
+    }
+
+    TEST_ASSERT(dsv4l2rt_log_open("/dev/null", &log) != 0,
+                "Reject a file that is not an event log");
+
+    unlink(test_file);
+
+    /* Raw event dump left by an older file sink */
+    snprintf(legacy, sizeof(legacy), "%s.legacy", test_file);
+    unlink(legacy);
+    memset(&raw, 0, sizeof(raw));
+    raw.event_type = DSV4L2_EVENT_FRAME_ACQUIRED;
+    fd = open(test_file, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    rc = (fd >= 0 && write(fd, &raw, sizeof(raw)) == (ssize_t)sizeof(raw)) ? 0 : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+    TEST_ASSERT(rc == 0, "Write raw event file");
+
+    rc = dsv4l2rt_init(&config);
+    TEST_ASSERT(rc == 0, "File sink starts over a raw event file");
+    dsv4l2rt_emit_simple(7, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, 0);
+    dsv4l2rt_shutdown();
+
+    TEST_ASSERT(stat(legacy, &st) == 0 && st.st_size == (off_t)sizeof(raw),
+                "Raw event file kept as .legacy");
+    rc = dsv4l2rt_log_open(test_file, &log);
+    TEST_ASSERT(rc == 0, "Fresh log written in its place");
+    if (rc == 0) {
+        TEST_ASSERT(dsv4l2rt_log_next(log, &ev) == 0 && ev->dev_id == 7,
+                    "Fresh log holds the new session");
+        dsv4l2rt_log_close(log);
+    }
+
+    unlink(legacy);
+    unlink(test_file);
+}
+
 /**
  * Test TPM signed chunks
  */
@@ -251,6 +410,7 @@ static void test_tpm_signing(void)
 {
     dsv4l2rt_config_t config;
     dsv4l2rt_chunk_header_t header;
+    dsv4l2_tpm_proof_t proof;
     dsv4l2_event_t *events = NULL;
     size_t count;
     int rc;
@@ -282,15 +442,26 @@ static void test_tpm_signing(void)
         TEST_ASSERT(header.timestamp_ns > 0, "Chunk has timestamp");
         TEST_ASSERT(count > 0, "Chunk contains events");
 
-        /* Verify signature exists (stub signature is 0x5A) */
-        int has_signature = 0;
-        for (i = 0; i < 256; i++) {
-            if (header.tpm_signature[i] == 0x5A) {
-                has_signature = 1;
+        /* Verify chunk is chained and covered by a signed root */
+        int has_digest = 0;
+        for (i = 0; i < 32; i++) {
+            if (header.chain_digest[i] != 0) {
+                has_digest = 1;
                 break;
             }
         }
-        TEST_ASSERT(has_signature, "Chunk has TPM signature (stub)");
+        TEST_ASSERT(has_digest, "Chunk has chain digest");
+
+        dsv4l2rt_flush();
+        rc = dsv4l2_tpm_get_proof(header.chunk_id, &proof);
+        TEST_ASSERT(rc == 0, "Chunk has inclusion proof");
+        if (rc == 0) {
+            /* Stub root signature (0x5A) when no TPM is available */
+            rc = dsv4l2_tpm_verify_chunk(&header, events, &proof);
+            TEST_ASSERT(rc == 0 || (rc == -ENOSYS && proof.stub_signature &&
+                                    proof.root_signature[0] == 0x5A),
+                        "Chunk verifies against signed root");
+        }
 
         free(events);
 
@@ -303,6 +474,76 @@ static void test_tpm_signing(void)
     dsv4l2rt_shutdown();
 }
 
+/**
+ * Test that a reopened signed log continues its chunk IDs and hash chain
+ */
+static void test_signed_log_reopen(void)
+{
+    dsv4l2rt_config_t config;
+    const char *test_file = "/tmp/dsv4l2_test_signed.bin";
+    dsv4l2rt_log_t *log = NULL;
+    const dsv4l2rt_chunk_header_t *hdr;
+    const dsv4l2_event_t *events;
+    dsv4l2_tpm_proof_t proof;
+    uint8_t prev[32], digest[32];
+    uint64_t chunks = 0, last_id = 0;
+    size_t n, total = 0;
+    int ids_ok = 1, chain_ok = 1;
+    int session, i, rc = 0;
+
+    printf("\n=== Testing Signed Log Reopen ===\n");
+
+    unlink(test_file);
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_FORENSIC;
+    config.enable_tpm_sign = 1;
+    config.sink_type = "file";
+    config.sink_config = test_file;
+
+    for (session = 0; session < 2; session++) {
+        rc |= dsv4l2rt_init(&config);
+        for (i = 0; i < 5; i++) {
+            dsv4l2rt_emit_simple(session * 5 + i, DSV4L2_EVENT_FRAME_ACQUIRED,
+                                 DSV4L2_SEV_INFO, i);
+            dsv4l2rt_flush();
+        }
+        dsv4l2rt_shutdown();
+    }
+    TEST_ASSERT(rc == 0, "Two signed sessions on one log");
+
+    rc = dsv4l2rt_log_open(test_file, &log);
+    TEST_ASSERT(rc == 0, "Open signed log");
+    if (rc != 0) {
+        unlink(test_file);
+        return;
+    }
+
+    /* Walk the whole chain from the zero digest */
+    memset(prev, 0, sizeof(prev));
+    while (dsv4l2rt_log_next_chunk(log, &hdr, &events, &n) == 0) {
+        ids_ok &= hdr->chunk_id == chunks;
+        dsv4l2_tpm_chunk_digest(prev, hdr, events, digest);
+        chain_ok &= memcmp(digest, hdr->chain_digest, sizeof(digest)) == 0;
+        memcpy(prev, hdr->chain_digest, sizeof(prev));
+        last_id = hdr->chunk_id;
+        total += n;
+        chunks++;
+    }
+    dsv4l2rt_log_close(log);
+
+    TEST_ASSERT(total == 10 && chunks >= 2, "Log holds both sessions");
+    TEST_ASSERT(ids_ok, "Chunk IDs continue across the reopen");
+    TEST_ASSERT(chain_ok, "Hash chain continues across the reopen");
+
+    /* The second session's proofs carry the resumed IDs */
+    rc = dsv4l2_tpm_get_proof(last_id, &proof);
+    TEST_ASSERT(rc == 0 && proof.chunk_id == last_id,
+                "Proof of the last chunk uses its continued ID");
+
+    unlink(test_file);
+}
+
 /**
  * Test statistics
  */
@@ -339,6 +580,1019 @@ static void test_statistics(void)
     dsv4l2rt_shutdown();
 }
 
+/**
+ * Test configurable ring size and drop accounting
+ */
+static void test_ring_config(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t stats;
+    int i;
+
+    printf("\n=== Testing Ring Configuration ===\n");
+
+    /* Non power-of-two sizes are rounded up */
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.ring_buffer_size = 100;
+
+    dsv4l2rt_init(&config);
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.buffer_capacity == 128, "ring_buffer_size 100 -> capacity 128");
+    dsv4l2rt_shutdown();
+
+    /* Small ring: every event is either flushed or dropped, never lost */
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.ring_buffer_size = 16;
+    config.flush_watermark = 16;
+
+    dsv4l2rt_init(&config);
+    for (i = 0; i < 1000; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, i);
+    }
+    dsv4l2rt_flush();
+
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.buffer_capacity == 16, "ring_buffer_size 16 honoured");
+    TEST_ASSERT(stats.events_dropped > 0, "Full ring drops oldest events");
+    TEST_ASSERT(stats.events_flushed + stats.events_dropped == 1000,
+                "Flushed + dropped accounts for every event");
+
+    dsv4l2rt_shutdown();
+}
+
+/**
+ * Test sharded rings and ordered merge
+ */
+static uint64_t sharded_last_ts = 0;
+static int sharded_out_of_order = 0;
+static size_t sharded_received = 0;
+static void sharded_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    size_t i;
+
+    (void)user_data;
+    for (i = 0; i < count; i++) {
+        if (events[i].ts_ns < sharded_last_ts) {
+            sharded_out_of_order = 1;
+        }
+        sharded_last_ts = events[i].ts_ns;
+    }
+    sharded_received += count;
+}
+
+static void test_sharded_rings(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t stats;
+    dsv4l2rt_shard_stats_t shard;
+    int rc, i;
+
+    printf("\n=== Testing Sharded Rings ===\n");
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.ring_buffer_size = 256;
+    config.shard_count = 4;
+
+    dsv4l2rt_init(&config);
+
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.shard_count == 4, "Four shards configured");
+    TEST_ASSERT(stats.buffer_capacity == 4 * 256, "Capacity summed over shards");
+
+    rc = dsv4l2rt_get_shard_stats(3, &shard);
+    TEST_ASSERT(rc == 0 && shard.buffer_capacity == 256, "Per-shard stats available");
+
+    rc = dsv4l2rt_get_shard_stats(4, &shard);
+    TEST_ASSERT(rc == -ENOENT, "Out-of-range shard rejected");
+
+    sharded_last_ts = 0;
+    sharded_out_of_order = 0;
+    sharded_received = 0;
+    dsv4l2rt_register_sink(sharded_sink_callback, NULL);
+
+    for (i = 0; i < 200; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, i);
+    }
+    dsv4l2rt_flush();
+
+    TEST_ASSERT(sharded_received == 200, "Merged flush delivers every event");
+    TEST_ASSERT(!sharded_out_of_order, "Merged batches are timestamp ordered");
+
+    dsv4l2rt_shutdown();
+}
+
+/**
+ * Test human-readable log sink
+ */
+static void test_log_sink(void)
+{
+    dsv4l2rt_config_t config;
+    char out[1024];
+    int fds[2];
+    ssize_t n;
+    int rc;
+
+    printf("\n=== Testing Log Sink ===\n");
+
+    TEST_ASSERT(strcmp(dsv4l2rt_event_name(DSV4L2_EVENT_FPS_CHANGE), "FPS_CHANGE") == 0,
+                "Event name table covers FPS_CHANGE");
+    TEST_ASSERT(strcmp(dsv4l2rt_event_name(DSV4L2_EVENT_SECRET_LEAK_ATTEMPT),
+                       "SECRET_LEAK_ATTEMPT") == 0,
+                "Event name table covers SECRET_LEAK_ATTEMPT");
+    TEST_ASSERT(strcmp(dsv4l2rt_event_name(0x7777), "UNKNOWN") == 0,
+                "Unknown event type maps to UNKNOWN");
+    TEST_ASSERT(strcmp(dsv4l2rt_severity_name(DSV4L2_SEV_CRITICAL), "CRITICAL") == 0,
+                "Severity name lookup");
+
+    if (pipe(fds) != 0) {
+        TEST_ASSERT(0, "Create pipe for log sink");
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    dsv4l2rt_init(&config);
+
+    rc = dsv4l2rt_init_log_sink(fds[1]);
+    TEST_ASSERT(rc == 0, "Register log sink");
+
+    dsv4l2rt_emit_simple(0x10, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, 7);
+    dsv4l2rt_emit_simple(0x11, DSV4L2_EVENT_META_READ, DSV4L2_SEV_INFO, 8);
+    dsv4l2rt_flush();
+    dsv4l2rt_shutdown();
+
+    close(fds[1]);
+    n = read(fds[0], out, sizeof(out) - 1);
+    close(fds[0]);
+    out[n > 0 ? n : 0] = '\0';
+
+    TEST_ASSERT(strstr(out, "[DSV4L2] IRIS_CAPTURE [HIGH] dev=00000010 aux=7") != NULL,
+                "Log sink formats IRIS_CAPTURE");
+    TEST_ASSERT(strstr(out, "[DSV4L2] META_READ [INFO] dev=00000011 aux=8") != NULL,
+                "Log sink formats META_READ");
+}
+
+#ifdef HAVE_SQLITE3
+/* First column of a single-row query, -1 on error */
+static long long sqlite_query_int(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    long long value = -1;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        return -1;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        value = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * Test the WAL-mode SQLite sink and its writer thread
+ */
+static void test_sqlite_sink(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_sqlite_config_t sq;
+    dsv4l2_event_t ev;
+    sqlite3 *db = NULL;
+    sqlite3_stmt *stmt;
+    char path[64], wal[80], shm[80];
+    const char *role = NULL;
+    long long rows = -1;
+    int i, rc;
+
+    printf("\n=== Testing SQLite Sink ===\n");
+
+    snprintf(path, sizeof(path), "/tmp/dsv4l2rt-sqlite-%d.db", (int)getpid());
+    snprintf(wal, sizeof(wal), "%s-wal", path);
+    snprintf(shm, sizeof(shm), "%s-shm", path);
+    unlink(path);
+
+    /* Version 1 database: inline role text, no user_version */
+    rc = sqlite3_open(path, &db);
+    rc |= sqlite3_exec(db, "CREATE TABLE events (id INTEGER PRIMARY KEY, role TEXT);"
+                           "INSERT INTO events (role) VALUES ('camera');", NULL, NULL, NULL);
+    sqlite3_close(db);
+    TEST_ASSERT(rc == SQLITE_OK, "Create version 1 database");
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    dsv4l2rt_init(&config);
+
+    memset(&sq, 0, sizeof(sq));
+    sq.synchronous = "SOMETIMES";
+    TEST_ASSERT(dsv4l2rt_init_sqlite_sink_ex(path, &sq) == -1,
+                "Unknown synchronous mode is rejected");
+
+    sq.synchronous = "FULL";
+    sq.commit_events = 4;
+    sq.commit_interval_ms = 50;
+    rc = dsv4l2rt_init_sqlite_sink_ex(path, &sq);
+    TEST_ASSERT(rc == 0, "Register SQLite sink");
+
+    memset(&ev, 0, sizeof(ev));
+    ev.event_type = DSV4L2_EVENT_IRIS_CAPTURE;
+    ev.severity = DSV4L2_SEV_HIGH;
+    ev.layer = 3;
+    strcpy(ev.mission, "alpha");
+    for (i = 0; i < 10; i++) {
+        ev.dev_id = i;
+        ev.aux = i;
+        strcpy(ev.role, i & 1 ? "iris" : "camera");
+        (dsv4l2rt_emit)(&ev);
+    }
+    dsv4l2rt_flush();
+
+    /* The writer thread commits on its own, before shutdown */
+    rc = sqlite3_open(path, &db);
+    for (i = 0; rc == SQLITE_OK && i < 200 && rows != 10; i++) {
+        struct timespec delay = { 0, 10 * 1000000L };
+
+        nanosleep(&delay, NULL);
+        rows = sqlite_query_int(db, "SELECT count(*) FROM events");
+    }
+    TEST_ASSERT(rows == 10, "Writer thread commits queued events");
+
+    TEST_ASSERT(sqlite_query_int(db, "SELECT count(*) FROM strings") == 3,
+                "role/mission interned once each");
+    TEST_ASSERT(sqlite_query_int(db, "SELECT count(*) FROM events_legacy") == 1 &&
+                sqlite_query_int(db, "PRAGMA user_version") == 2,
+                "Version 1 table kept as events_legacy");
+    TEST_ASSERT(sqlite_query_int(db, "SELECT count(*) FROM sqlite_master "
+                                     "WHERE type = 'index' AND name = 'events_ts'") == 1,
+                "Timestamp index exists");
+
+    if (sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, NULL) == SQLITE_OK) {
+        rc = sqlite3_step(stmt) == SQLITE_ROW &&
+             strcmp((const char *)sqlite3_column_text(stmt, 0), "wal") == 0;
+        sqlite3_finalize(stmt);
+        TEST_ASSERT(rc, "Database runs in WAL mode");
+    }
+
+    if (sqlite3_prepare_v2(db, "SELECT role, mission, aux FROM events_text WHERE dev_id = 3",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        rc = sqlite3_step(stmt) == SQLITE_ROW;
+        role = rc ? (const char *)sqlite3_column_text(stmt, 0) : NULL;
+        rc = rc && role && strcmp(role, "iris") == 0 &&
+             strcmp((const char *)sqlite3_column_text(stmt, 1), "alpha") == 0 &&
+             sqlite3_column_int(stmt, 2) == 3;
+        sqlite3_finalize(stmt);
+        TEST_ASSERT(rc, "events_text joins role/mission back");
+    }
+
+    /* Shutdown drains what is still queued */
+    ev.dev_id = 10;
+    (dsv4l2rt_emit)(&ev);
+    dsv4l2rt_shutdown();
+    TEST_ASSERT(sqlite_query_int(db, "SELECT count(*) FROM events") == 11,
+                "Shutdown commits the final flush");
+
+    sqlite3_close(db);
+    unlink(path);
+    unlink(wal);
+    unlink(shm);
+}
+#endif
+
+#ifdef HAVE_HIREDIS
+/*
+ * Minimal RESP server for the Redis sink: answers every command with an
+ * integer reply and records PUBLISH payloads. With drop_next set it reads
+ * the next command and closes the connection without replying.
+ */
+static struct {
+    int             listen_fd;
+    int             conn_fd;
+    int             port;
+    int             drop_next;
+    char            channel[64];
+    size_t          messages;
+    size_t          count;
+    dsv4l2_event_t  events[64];
+    pthread_t       thread;
+} redis_srv = { .listen_fd = -1, .conn_fd = -1 };
+
+/* Read one RESP bulk string into buf (truncated to len), -1 on EOF */
+static long redis_srv_bulk(FILE *in, void *buf, size_t len)
+{
+    char line[32];
+    long n;
+    char *data;
+
+    if (!fgets(line, sizeof(line), in) || line[0] != '$') {
+        return -1;
+    }
+    n = strtol(line + 1, NULL, 10);
+    data = malloc(n + 2);
+    if (!data || fread(data, 1, n + 2, in) != (size_t)n + 2) {
+        free(data);
+        return -1;
+    }
+    memcpy(buf, data, (size_t)n < len ? (size_t)n : len);
+    free(data);
+    return n;
+}
+
+static void *redis_srv_fn(void *arg)
+{
+    (void)arg;
+
+    for (;;) {
+        char line[32], cmd[16];
+        FILE *in;
+        int fd = accept(redis_srv.listen_fd, NULL, NULL);
+
+        if (fd < 0) {
+            return NULL;
+        }
+        redis_srv.conn_fd = fd;
+        in = fdopen(fd, "r");
+
+        /* PUBLISH channel payload */
+        while (fgets(line, sizeof(line), in) && line[0] == '*') {
+            char payload[sizeof(redis_srv.events)];
+            long n;
+
+            memset(cmd, 0, sizeof(cmd));
+            if (redis_srv_bulk(in, cmd, sizeof(cmd) - 1) < 0 ||
+                redis_srv_bulk(in, redis_srv.channel, sizeof(redis_srv.channel) - 1) < 0 ||
+                (n = redis_srv_bulk(in, payload, sizeof(payload))) < 0) {
+                break;
+            }
+            if (redis_srv.drop_next) {
+                redis_srv.drop_next = 0;
+                break;
+            }
+            if (strcmp(cmd, "PUBLISH") == 0 &&
+                redis_srv.count + n / sizeof(dsv4l2_event_t) <= 64) {
+                memcpy(&redis_srv.events[redis_srv.count], payload, n);
+                redis_srv.count += n / sizeof(dsv4l2_event_t);
+                redis_srv.messages++;
+            }
+            if (write(fd, ":0\r\n", 4) != 4) {
+                break;
+            }
+        }
+
+        redis_srv.conn_fd = -1;
+        fclose(in);
+    }
+}
+
+static int redis_srv_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    redis_srv.listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (redis_srv.listen_fd < 0 ||
+        bind(redis_srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(redis_srv.listen_fd, (struct sockaddr *)&addr, &len) < 0) {
+        return -1;
+    }
+    redis_srv.port = ntohs(addr.sin_port);
+    return 0;
+}
+
+static void redis_srv_stop(void)
+{
+    shutdown(redis_srv.listen_fd, SHUT_RDWR);
+    if (redis_srv.conn_fd >= 0) {
+        shutdown(redis_srv.conn_fd, SHUT_RDWR);
+    }
+    pthread_join(redis_srv.thread, NULL);
+    close(redis_srv.listen_fd);
+    redis_srv.listen_fd = -1;
+}
+
+/**
+ * Test the pipelined Redis sink against a local RESP server
+ */
+static void test_redis_sink(void)
+{
+    dsv4l2rt_config_t config;
+    int ordered = 1;
+    size_t i;
+    int rc;
+
+    printf("\n=== Testing Redis Sink ===\n");
+
+    /* A failed send must not kill the test process */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (redis_srv_start() != 0) {
+        TEST_ASSERT(0, "Bind loopback RESP server");
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    dsv4l2rt_init(&config);
+
+    /* Bound but not listening: connection refused */
+    rc = dsv4l2rt_init_redis_sink("127.0.0.1", redis_srv.port, NULL);
+    TEST_ASSERT(rc == -1, "Unreachable server fails registration");
+
+    listen(redis_srv.listen_fd, 4);
+    pthread_create(&redis_srv.thread, NULL, redis_srv_fn, NULL);
+
+    rc = dsv4l2rt_init_redis_sink("127.0.0.1", redis_srv.port, "dsv4l2:test");
+    TEST_ASSERT(rc == 0, "Register Redis sink");
+
+    for (i = 0; i < 5; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, i);
+    }
+    dsv4l2rt_flush();
+    TEST_ASSERT(redis_srv.messages == 1 && redis_srv.count == 5,
+                "Batch is published as one message");
+    TEST_ASSERT(strcmp(redis_srv.channel, "dsv4l2:test") == 0,
+                "Published on the configured channel");
+
+    /* Connection lost mid-batch: the batch is spilled, not dropped */
+    redis_srv.drop_next = 1;
+    for (i = 5; i < 8; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, i);
+    }
+    dsv4l2rt_flush();
+
+    /* Inside the reconnect backoff: spilled without a connect attempt */
+    dsv4l2rt_emit_simple(8, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, 8);
+    dsv4l2rt_emit_simple(9, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, 9);
+    dsv4l2rt_flush();
+    TEST_ASSERT(redis_srv.count == 5, "Nothing published while disconnected");
+
+    /* After the backoff the spill goes out ahead of the new batch */
+    usleep(200 * 1000);
+    dsv4l2rt_emit_simple(10, DSV4L2_EVENT_IRIS_CAPTURE, DSV4L2_SEV_HIGH, 10);
+    dsv4l2rt_flush();
+    for (i = 0; i < redis_srv.count; i++) {
+        ordered &= redis_srv.events[i].dev_id == i &&
+                   redis_srv.events[i].event_type == DSV4L2_EVENT_IRIS_CAPTURE;
+    }
+    TEST_ASSERT(redis_srv.count == 11 && ordered,
+                "Reconnect delivers spilled events in order");
+
+    dsv4l2rt_shutdown();
+    redis_srv_stop();
+}
+#endif
+
+/**
+ * Test inline event filter
+ */
+static void test_event_filter(void)
+{
+    static const dsv4l2_event_type_t types[] = {
+        DSV4L2_EVENT_DEVICE_OPEN, DSV4L2_EVENT_DEVICE_CLOSE,
+        DSV4L2_EVENT_CAPTURE_START, DSV4L2_EVENT_CAPTURE_STOP,
+        DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_EVENT_FRAME_DROPPED,
+        DSV4L2_EVENT_TEMPEST_TRANSITION, DSV4L2_EVENT_TEMPEST_QUERY,
+        DSV4L2_EVENT_TEMPEST_LOCKDOWN, DSV4L2_EVENT_FORMAT_CHANGE,
+        DSV4L2_EVENT_RESOLUTION_CHANGE, DSV4L2_EVENT_FPS_CHANGE,
+        DSV4L2_EVENT_CONTROL_CHANGE, DSV4L2_EVENT_IRIS_MODE_ENTER,
+        DSV4L2_EVENT_IRIS_MODE_EXIT, DSV4L2_EVENT_IRIS_CAPTURE,
+        DSV4L2_EVENT_META_READ, DSV4L2_EVENT_FUSED_CAPTURE,
+        DSV4L2_EVENT_ERROR, DSV4L2_EVENT_POLICY_VIOLATION,
+        DSV4L2_EVENT_SECRET_LEAK_ATTEMPT,
+    };
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t stats;
+    uint32_t seen = 0;
+    int unique = 1;
+    size_t i;
+
+    printf("\n=== Testing Event Filter ===\n");
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (seen & DSV4L2RT_EVENT_BIT(types[i])) {
+            unique = 0;
+        }
+        seen |= DSV4L2RT_EVENT_BIT(types[i]);
+    }
+    TEST_ASSERT(unique, "Every event type has its own mask bit");
+
+    /* OFF profile: nothing recorded, no rings */
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OFF;
+    dsv4l2rt_init(&config);
+
+    TEST_ASSERT(!dsv4l2rt_event_enabled(DSV4L2_EVENT_ERROR, DSV4L2_SEV_CRITICAL),
+                "OFF profile rejects inline");
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_ERROR, DSV4L2_SEV_CRITICAL, 0);
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.events_emitted == 0, "OFF profile emits nothing");
+    TEST_ASSERT(stats.buffer_capacity == 0, "OFF profile allocates no ring");
+    dsv4l2rt_shutdown();
+
+    /* Profile defaults: OPS drops per-frame TEMPEST queries, EXERCISE keeps them */
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    dsv4l2rt_init(&config);
+    TEST_ASSERT(!dsv4l2rt_event_enabled(DSV4L2_EVENT_TEMPEST_QUERY, DSV4L2_SEV_DEBUG),
+                "OPS default drops TEMPEST_QUERY");
+    TEST_ASSERT(dsv4l2rt_event_enabled(DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG) &&
+                dsv4l2rt_event_enabled(DSV4L2_EVENT_TEMPEST_TRANSITION, DSV4L2_SEV_DEBUG),
+                "OPS default keeps frames and transitions");
+    dsv4l2rt_shutdown();
+
+    config.profile = DSV4L2_PROFILE_EXERCISE;
+    dsv4l2rt_init(&config);
+    TEST_ASSERT(dsv4l2rt_event_enabled(DSV4L2_EVENT_TEMPEST_QUERY, DSV4L2_SEV_DEBUG),
+                "EXERCISE default keeps TEMPEST_QUERY");
+    dsv4l2rt_shutdown();
+
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.event_mask = DSV4L2RT_EVENT_MASK_ALL;
+    dsv4l2rt_init(&config);
+    TEST_ASSERT(dsv4l2rt_event_enabled(DSV4L2_EVENT_TEMPEST_QUERY, DSV4L2_SEV_DEBUG),
+                "Config event mask replaces the OPS default");
+    dsv4l2rt_shutdown();
+
+    /* Severity floor and event mask from config */
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.min_severity = DSV4L2_SEV_MEDIUM;
+    config.event_mask = DSV4L2RT_EVENT_MASK_ALL &
+                        ~DSV4L2RT_EVENT_BIT(DSV4L2_EVENT_TEMPEST_QUERY);
+    dsv4l2rt_init(&config);
+
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, 0);
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_TEMPEST_QUERY, DSV4L2_SEV_HIGH, 0);
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_DROPPED, DSV4L2_SEV_MEDIUM, 0);
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_TEMPEST_QUERY, DSV4L2_SEV_CRITICAL, 0);
+
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.events_emitted == 2, "Filter keeps MEDIUM+ unmasked and CRITICAL");
+
+    /* Runtime override */
+    TEST_ASSERT(dsv4l2rt_set_filter(DSV4L2_SEV_DEBUG, DSV4L2RT_EVENT_MASK_ALL) == 0,
+                "Override filter at runtime");
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, 0);
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.events_emitted == 3, "Overridden filter keeps DEBUG");
+
+    dsv4l2rt_shutdown();
+}
+
+/**
+ * Test the shared-memory ring seen by an external reader
+ */
+static void test_shm_ring(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t stats;
+    dsv4l2rt_shm_t *shm = NULL;
+    dsv4l2rt_shm_writer_t *writer = NULL;
+    dsv4l2_event_t events[64];
+    uint64_t lost = 0, published = 0;
+    char name[64];
+    pid_t child;
+    int ordered = 1;
+    int i, n, rc, status = 0;
+
+    printf("\n=== Testing Shared-Memory Ring ===\n");
+
+    snprintf(name, sizeof(name), "/dsv4l2rt-test-%d", (int)getpid());
+    TEST_ASSERT(dsv4l2rt_shm_open(name, &shm) == -ENOENT,
+                "Attach before the producer exists fails");
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.ring_buffer_size = 16;
+    config.shm_name = name;
+
+    rc = dsv4l2rt_init(&config);
+    TEST_ASSERT(rc == 0, "Initialize runtime with shared-memory ring");
+
+    rc = dsv4l2rt_shm_open(name, &shm);
+    TEST_ASSERT(rc == 0, "Attach reader");
+    if (rc != 0) {
+        dsv4l2rt_shutdown();
+        return;
+    }
+    TEST_ASSERT(dsv4l2rt_shm_pid(shm) == (int)getpid(), "Ring reports producer pid");
+    TEST_ASSERT(dsv4l2rt_shm_read(shm, events, 64, &lost) == 0, "New reader starts empty");
+
+    for (i = 0; i < 10; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, i);
+    }
+    n = dsv4l2rt_shm_read(shm, events, 64, &lost);
+    TEST_ASSERT(n == 10 && lost == 0, "Reader sees 10 events");
+    for (i = 0; i < n; i++) {
+        ordered &= (events[i].dev_id == (uint32_t)i);
+    }
+    TEST_ASSERT(ordered, "Events read in publish order");
+
+    /* Two full laps while the reader is away */
+    for (i = 10; i < 42; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_DEBUG, i);
+    }
+    n = dsv4l2rt_shm_read(shm, events, 64, &lost);
+    TEST_ASSERT(n == 16 && lost == 16, "Lapped reader skips overwritten events");
+    TEST_ASSERT(n == 16 && events[0].dev_id == 26 && events[15].dev_id == 41,
+                "Lapped reader resumes at the oldest live event");
+
+    dsv4l2rt_shm_rewind(shm);
+    TEST_ASSERT(dsv4l2rt_shm_read(shm, events, 4, NULL) == 4 && events[0].dev_id == 26,
+                "Rewind replays the ring");
+
+    TEST_ASSERT(dsv4l2rt_shm_writer_open(name, 16, &writer) == -EEXIST,
+                "Second producer cannot take over a live ring");
+    TEST_ASSERT(dsv4l2rt_shm_pid(shm) == (int)getpid(), "Live ring keeps its producer");
+
+    dsv4l2rt_shutdown();
+
+    TEST_ASSERT(dsv4l2rt_shm_read(shm, events, 64, NULL) == 12,
+                "Events stay readable after producer exit");
+    TEST_ASSERT(dsv4l2rt_shm_read(shm, events, 64, NULL) == -EPIPE,
+                "Drained ring of an exited producer reports EPIPE");
+    rc = dsv4l2rt_shm_stats(shm, &stats, &published);
+    TEST_ASSERT(rc == 0 && stats.events_emitted == 42 && published == 42,
+                "Final stats snapshot published");
+    TEST_ASSERT(dsv4l2rt_shm_pid(shm) == -EPIPE, "Closed ring has no producer");
+    dsv4l2rt_shm_close(shm);
+
+    TEST_ASSERT(dsv4l2rt_shm_open(name, &shm) == -ENOENT, "Ring unlinked at shutdown");
+
+    /* Producer that exits without closing its ring */
+    child = fork();
+    if (child == 0) {
+        _exit(dsv4l2rt_shm_writer_open(name, 16, &writer) == 0 ? 0 : 1);
+    }
+    TEST_ASSERT(child > 0 && waitpid(child, &status, 0) == child &&
+                WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                "Crashed producer leaves its ring behind");
+
+    rc = dsv4l2rt_shm_writer_open(name, 16, &writer);
+    TEST_ASSERT(rc == 0, "Ring of a dead producer is reclaimed");
+    if (rc == 0) {
+        dsv4l2rt_shm_writer_close(writer);
+    }
+    TEST_ASSERT(dsv4l2rt_shm_open(name, &shm) == -ENOENT, "Reclaimed ring unlinked on close");
+}
+
+/* Sink collecting events for the aggregation test */
+static dsv4l2_event_t agg_events[64];
+static size_t agg_event_count = 0;
+
+static void agg_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    size_t i;
+
+    (void)user_data;
+    for (i = 0; i < count && agg_event_count < 64; i++) {
+        agg_events[agg_event_count++] = events[i];
+    }
+}
+
+/**
+ * Test OPS counter aggregation and summary events
+ */
+static void test_counter_aggregation(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t stats;
+    dsv4l2rt_summary_t sum;
+    uint64_t dev1 = 0, dev2 = 0, dev1_bytes = 0, dev2_bytes = 0;
+    size_t i, errors = 0, summaries = 0;
+
+    printf("\n=== Testing Counter Aggregation ===\n");
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.aggregate_below = DSV4L2_SEV_MEDIUM;
+    config.aggregate_interval_ms = 60000;
+
+    dsv4l2rt_init(&config);
+    agg_event_count = 0;
+    dsv4l2rt_register_sink(agg_sink_callback, NULL);
+
+    for (i = 0; i < 100; i++) {
+        dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, 1000);
+    }
+    for (i = 0; i < 50; i++) {
+        dsv4l2rt_emit_simple(2, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, 10);
+    }
+    for (i = 0; i < 3; i++) {
+        dsv4l2rt_emit_simple(1, DSV4L2_EVENT_ERROR, DSV4L2_SEV_HIGH, (uint32_t)i);
+    }
+
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.events_emitted == 153 && stats.events_aggregated == 150,
+                "Low-severity events counted in place");
+
+    dsv4l2rt_flush();
+    for (i = 0; i < agg_event_count; i++) {
+        if (agg_events[i].event_type == DSV4L2_EVENT_ERROR) {
+            errors++;
+        } else if (dsv4l2rt_summary_decode(&agg_events[i], &sum) == 0) {
+            summaries++;
+            if (agg_events[i].dev_id == 1 && sum.event_type == DSV4L2_EVENT_FRAME_ACQUIRED) {
+                dev1 = sum.count;
+                dev1_bytes = sum.aux_sum;
+            } else if (agg_events[i].dev_id == 2) {
+                dev2 = sum.count;
+                dev2_bytes = sum.aux_sum;
+            }
+            TEST_ASSERT(sum.first_ts_ns <= sum.last_ts_ns && sum.last_ts_ns > 0,
+                        "Summary spans the counted window");
+        }
+    }
+    TEST_ASSERT(errors == 3, "Discrete events delivered unchanged");
+    TEST_ASSERT(summaries == 2, "One summary per (device, type)");
+    TEST_ASSERT(dev1 == 100 && dev1_bytes == 100000, "Device 1 count and byte sum");
+    TEST_ASSERT(dev2 == 50 && dev2_bytes == 500, "Device 2 count and byte sum");
+
+    /* Counters restart after each summary; idle counters stay quiet */
+    agg_event_count = 0;
+    for (i = 0; i < 5; i++) {
+        dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, 1);
+    }
+    dsv4l2rt_flush();
+    TEST_ASSERT(agg_event_count == 1 &&
+                dsv4l2rt_summary_decode(&agg_events[0], &sum) == 0 && sum.count == 5,
+                "Next window only reports new events");
+    TEST_ASSERT(dsv4l2rt_summary_decode(&agg_events[0], &sum) == 0 &&
+                dsv4l2rt_summary_decode(&(dsv4l2_event_t){ .event_type = DSV4L2_EVENT_ERROR },
+                                        &sum) == -EINVAL,
+                "Decode rejects non-summary events");
+
+    dsv4l2rt_shutdown();
+
+    /* Other profiles buffer every event */
+    config.profile = DSV4L2_PROFILE_EXERCISE;
+    dsv4l2rt_init(&config);
+    dsv4l2rt_emit_simple(1, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, 1);
+    dsv4l2rt_get_stats(&stats);
+    TEST_ASSERT(stats.events_emitted == 1 && stats.events_aggregated == 0,
+                "Aggregation is OPS-only");
+    dsv4l2rt_shutdown();
+}
+
+/* Compact sink state */
+static char compact_strings[8][DSV4L2RT_STRING_LEN + 1];
+static size_t compact_string_calls = 0;
+static size_t compact_events_received = 0;
+static int compact_ok = 1;
+
+static void compact_string_callback(uint16_t id, const char *str, void *user_data)
+{
+    (void)user_data;
+    compact_string_calls++;
+    if (id < 8) {
+        snprintf(compact_strings[id], sizeof(compact_strings[id]), "%s", str);
+    }
+}
+
+static void compact_sink_callback(const dsv4l2rt_compact_event_t *events, size_t count,
+                                  void *user_data)
+{
+    size_t i;
+
+    (void)user_data;
+    for (i = 0; i < count; i++) {
+        const char *role = events[i].role_id < 8 ? compact_strings[events[i].role_id] : "?";
+        const char *want = (events[i].dev_id & 1) ? "iris_scanner" : "camera";
+
+        compact_ok &= (strcmp(role, want) == 0);
+        compact_events_received++;
+    }
+}
+
+/* Expanded sink checking role/mission survive the compact ring */
+static size_t expanded_events_received = 0;
+static int expanded_ok = 1;
+
+static void expanded_sink_callback(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    size_t i;
+
+    (void)user_data;
+    for (i = 0; i < count; i++) {
+        const char *want = (events[i].dev_id & 1) ? "iris_scanner" : "camera";
+
+        expanded_ok &= (strncmp(events[i].role, want, sizeof(events[i].role)) == 0 &&
+                        strncmp(events[i].mission, "overwatch", sizeof(events[i].mission)) == 0 &&
+                        events[i].aux == events[i].dev_id * 3 && events[i].layer == 3);
+        expanded_events_received++;
+    }
+}
+
+/**
+ * Test the compact event layout, string interning and both sink kinds
+ */
+static void test_compact_events(void)
+{
+    dsv4l2rt_config_t config;
+    dsv4l2rt_compact_event_t ce;
+    dsv4l2_event_t ev, out;
+    size_t strings_after_first;
+    int i;
+
+    printf("\n=== Testing Compact Events ===\n");
+
+    TEST_ASSERT(sizeof(dsv4l2rt_compact_event_t) == 24, "Compact event is 24 bytes");
+    TEST_ASSERT(sizeof(dsv4l2_event_t) == 72, "Full event is 72 bytes");
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.shard_count = DSV4L2RT_SHARDS_PER_CPU;
+    dsv4l2rt_init(&config);
+
+    compact_string_calls = 0;
+    dsv4l2rt_register_compact_sink(compact_sink_callback, compact_string_callback, NULL, NULL);
+    dsv4l2rt_register_sink(expanded_sink_callback, NULL);
+
+    memset(&ev, 0, sizeof(ev));
+    ev.event_type = DSV4L2_EVENT_FRAME_ACQUIRED;
+    ev.severity = DSV4L2_SEV_INFO;
+    ev.layer = 3;
+    strncpy(ev.mission, "overwatch", sizeof(ev.mission));
+    for (i = 0; i < 100; i++) {
+        ev.ts_ns = 1000 + i;
+        ev.dev_id = i;
+        ev.aux = i * 3;
+        memset(ev.role, 0, sizeof(ev.role));
+        strncpy(ev.role, (i & 1) ? "iris_scanner" : "camera", sizeof(ev.role));
+        dsv4l2rt_emit(&ev);
+    }
+    dsv4l2rt_flush();
+    strings_after_first = compact_string_calls;
+
+    TEST_ASSERT(compact_events_received == 100 && compact_ok,
+                "Compact sink resolves interned roles");
+    TEST_ASSERT(expanded_events_received == 100 && expanded_ok,
+                "Expanded sink sees role, mission, aux and layer intact");
+    TEST_ASSERT(strings_after_first >= 4, "Strings announced before first batch");
+
+    /* Runs of the same role: five cameras, then five iris scanners */
+    for (i = 0; i < 10; i++) {
+        ev.dev_id = i < 5 ? 2 * i : 2 * i + 1;
+        ev.aux = ev.dev_id * 3;
+        memset(ev.role, 0, sizeof(ev.role));
+        strncpy(ev.role, (ev.dev_id & 1) ? "iris_scanner" : "camera", sizeof(ev.role));
+        dsv4l2rt_emit(&ev);
+    }
+    dsv4l2rt_flush();
+    TEST_ASSERT(compact_string_calls == strings_after_first,
+                "Known strings are not announced again");
+    TEST_ASSERT(compact_events_received == 110 && compact_ok &&
+                expanded_events_received == 110 && expanded_ok,
+                "Repeated roles keep their interned IDs");
+
+    dsv4l2rt_shutdown();
+
+    /* Expansion helper round trip; full-length fields are not terminated */
+    memset(&ce, 0, sizeof(ce));
+    ce.role_id = DSV4L2RT_STRING_OVERFLOW;
+    dsv4l2rt_event_expand(&ce, &out);
+    TEST_ASSERT(out.role[0] == '\0' && strcmp(dsv4l2rt_string(DSV4L2RT_STRING_OVERFLOW), "") == 0,
+                "Unknown string IDs expand to empty");
+}
+
+/**
+ * Test the io_uring I/O engine and the file sink on top of it
+ */
+static int io_done_calls = 0;
+static int io_done_error = 0;
+static void io_done_callback(void *user_data, int result)
+{
+    (void)user_data;
+    __atomic_add_fetch(&io_done_calls, 1, __ATOMIC_RELAXED);
+    if (result < 0) {
+        __atomic_store_n(&io_done_error, result, __ATOMIC_RELAXED);
+    }
+}
+
+static void test_async_io(void)
+{
+    dsv4l2rt_config_t config;
+    const char *data_file = "/tmp/dsv4l2_test_io.bin";
+    const char *log_file = "/tmp/dsv4l2_test_io_events.bin";
+    dsv4l2rt_log_t *log = NULL;
+    const dsv4l2_event_t *ev;
+    uint8_t *bufs[4], check[4096];
+    int fd, i, rc, count, ok;
+
+    printf("\n=== Testing Async File I/O ===\n");
+
+    /* Explicit opt-out always falls back */
+    setenv("DSV4L2_NO_IO_URING", "1", 1);
+    TEST_ASSERT(dsv4l2rt_io_start(0) < 0, "DSV4L2_NO_IO_URING disables the engine");
+    unsetenv("DSV4L2_NO_IO_URING");
+    TEST_ASSERT(dsv4l2rt_io_write(1, "x", 1, 0, 0, NULL, NULL) == -ENODEV,
+                "Write without a running engine is refused");
+    TEST_ASSERT(dsv4l2rt_io_buffer_alloc(4096) == NULL, "No arena without an engine");
+
+    rc = dsv4l2rt_io_start(64 * 1024);
+    if (rc != 0) {
+        printf("  [SKIP] io_uring unavailable (%s)\n", strerror(-rc));
+        return;
+    }
+    TEST_ASSERT(rc == 0, "Start io_uring engine");
+
+    unlink(data_file);
+    fd = open(data_file, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    TEST_ASSERT(fd >= 0, "Create data file");
+
+    /* Four page writes from the arena, the last with a linked fsync */
+    ok = 1;
+    for (i = 0; i < 4; i++) {
+        bufs[i] = dsv4l2rt_io_buffer_alloc(4096);
+        ok = ok && bufs[i] != NULL && ((uintptr_t)bufs[i] & 4095) == 0;
+    }
+    TEST_ASSERT(ok, "Arena hands out page-aligned buffers");
+    TEST_ASSERT(dsv4l2rt_io_buffer_alloc(1024 * 1024) == NULL,
+                "Oversized request does not fit the arena");
+
+    ok = 1;
+    for (i = 0; i < 4 && bufs[i]; i++) {
+        memset(bufs[i], 'a' + i, 4096);
+        ok = ok && dsv4l2rt_io_write(fd, bufs[i], 4096, (uint64_t)i * 4096,
+                                     (i == 3 ? DSV4L2RT_IO_FSYNC : 0) | DSV4L2RT_IO_RELEASE,
+                                     io_done_callback, NULL) == 0;
+    }
+    TEST_ASSERT(ok, "Queue arena writes");
+    TEST_ASSERT(dsv4l2rt_io_drain() == 0, "Drain completes");
+    TEST_ASSERT(io_done_calls == 4 && io_done_error == 0, "Every write completed once");
+
+    ok = 1;
+    for (i = 0; i < 4; i++) {
+        ok = ok && pread(fd, check, sizeof(check), (off_t)i * 4096) == (ssize_t)sizeof(check) &&
+             check[0] == 'a' + i && check[4095] == 'a' + i;
+    }
+    TEST_ASSERT(ok, "Written data reads back");
+
+    /* Released buffers are reusable: the whole arena is free again */
+    bufs[0] = dsv4l2rt_io_buffer_alloc(64 * 1024);
+    TEST_ASSERT(bufs[0] != NULL, "Released buffers return to the arena");
+    dsv4l2rt_io_buffer_free(bufs[0]);
+
+    /* Heap buffer (plain write) and a blocking sync */
+    rc = dsv4l2rt_io_write(fd, "tail", 4, 4 * 4096, 0, io_done_callback, NULL);
+    TEST_ASSERT(rc == 0, "Queue a non-arena write");
+    TEST_ASSERT(dsv4l2rt_io_sync(fd) == 0, "Sync after queued write");
+    dsv4l2rt_io_drain();
+    TEST_ASSERT(pread(fd, check, 4, 4 * 4096) == 4 && memcmp(check, "tail", 4) == 0,
+                "Non-arena write landed before the sync returned");
+
+    /* Errors reach the callback */
+    io_done_error = 0;
+    rc = dsv4l2rt_io_write(-1, "x", 1, 0, 0, io_done_callback, NULL);
+    TEST_ASSERT(rc == -EINVAL, "Invalid fd rejected up front");
+    close(fd);
+    fd = open(data_file, O_RDONLY);
+    dsv4l2rt_io_write(fd, "x", 1, 0, 0, io_done_callback, NULL);
+    dsv4l2rt_io_drain();
+    TEST_ASSERT(io_done_error == -EBADF, "Write to a read-only fd fails in the callback");
+    close(fd);
+    unlink(data_file);
+
+    /* File sink through the engine (holds its own reference) */
+    unlink(log_file);
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    config.sink_type = "file";
+    config.sink_config = log_file;
+    config.enable_io_uring = 1;
+
+    rc = dsv4l2rt_init(&config);
+    TEST_ASSERT(rc == 0, "Initialize runtime with io_uring file sink");
+    for (i = 0; i < 100; i++) {
+        dsv4l2rt_emit_simple(i, DSV4L2_EVENT_FRAME_ACQUIRED, DSV4L2_SEV_INFO, i);
+        if (i % 25 == 24) {
+            dsv4l2rt_flush();
+        }
+    }
+    dsv4l2rt_shutdown();
+    dsv4l2rt_io_stop();
+
+    rc = dsv4l2rt_log_open(log_file, &log);
+    TEST_ASSERT(rc == 0, "Open io_uring-written log");
+    if (rc == 0) {
+        count = 0;
+        ok = 1;
+        while (dsv4l2rt_log_next(log, &ev) == 0) {
+            ok = ok && ev->aux == (uint32_t)count;
+            count++;
+        }
+        TEST_ASSERT(count == 100 && ok, "All 100 events read back in order");
+        TEST_ASSERT(dsv4l2rt_log_chunk_count(log) >= 4, "One chunk per flush");
+        dsv4l2rt_log_close(log);
+    }
+    unlink(log_file);
+}
+
 /**
  * Main test runner
  */
@@ -353,8 +1607,24 @@ int main(void)
     test_buffer_overflow();
     test_custom_sink();
     test_file_sink();
+    test_event_log();
     test_tpm_signing();
+    test_signed_log_reopen();
     test_statistics();
+    test_ring_config();
+    test_sharded_rings();
+    test_log_sink();
+#ifdef HAVE_SQLITE3
+    test_sqlite_sink();
+#endif
+#ifdef HAVE_HIREDIS
+    test_redis_sink();
+#endif
+    test_event_filter();
+    test_shm_ring();
+    test_counter_aggregation();
+    test_compact_events();
+    test_async_io();
 
     /* Print summary */
     printf("\n============================\n");
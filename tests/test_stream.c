@@ -0,0 +1,978 @@
+/*
+ * DSV4L2 Streaming Tests
+ *
+ * Test the capture reactor, frame leases and device stream APIs without
+ * hardware
+ */
+
+#define _GNU_SOURCE
+
+#include "dsv4l2_annotations.h"
+#include "dsv4l2_policy.h"
+#include "dsv4l2_core.h"
+#include "dsv4l2_stream.h"
+#include "dsv4l2_dsmil.h"
+#include "dsv4l2rt.h"
+#include "../src/device_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Test result tracking */
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST_ASSERT(cond, msg) do { \
+    if (cond) { \
+        printf("  [PASS] %s\n", msg); \
+        tests_passed++; \
+    } else { \
+        printf("  [FAIL] %s\n", msg); \
+        tests_failed++; \
+    } \
+} while (0)
+
+/* ========================================================================
+ * Mock vb2 queue
+ * ======================================================================== */
+
+/*
+ * ioctl() is interposed for the mock fd only. The fd is a memfd, so the
+ * library's mmap() of buffer offsets works and poll() reports it ready.
+ * VIDIOC_DQBUF hands out queued buffers in order and stamps each with
+ * the next driver sequence number; skip makes the driver drop frames.
+ */
+#define MOCK_BUF_SIZE  4096
+#define MOCK_BUF_MAX   8
+
+static struct {
+    int      fd;
+    uint32_t count;                     /* Buffers allocated */
+    uint32_t memory;                    /* V4L2_MEMORY_* of the set */
+    uint32_t queue[MOCK_BUF_MAX];       /* Queued indices (FIFO) */
+    uint32_t head, tail;
+    uint32_t sequence;                  /* Next driver sequence */
+    uint32_t skip;                      /* Sequence numbers dropped before the next DQBUF */
+    int      dq_errno;                  /* DQBUF fails with this after dq_ok more buffers */
+    uint32_t dq_ok;
+    struct v4l2_buffer last_qbuf;       /* Most recent VIDIOC_QBUF argument */
+    uint32_t width, height;             /* Current format, set by VIDIOC_S_FMT */
+} mockq = { .fd = -1 };
+
+static int mock_ioctl(unsigned long request, void *arg)
+{
+    switch (request) {
+    case VIDIOC_REQBUFS: {
+        struct v4l2_requestbuffers *req = arg;
+
+        if (req->count > MOCK_BUF_MAX) {
+            req->count = MOCK_BUF_MAX;
+        }
+        mockq.count = req->count;
+        mockq.memory = req->memory;
+        mockq.head = mockq.tail = 0;
+        return 0;
+    }
+    case VIDIOC_QUERYBUF: {
+        struct v4l2_buffer *buf = arg;
+
+        if (buf->index >= mockq.count) {
+            break;
+        }
+        buf->length = MOCK_BUF_SIZE;
+        buf->m.offset = buf->index * MOCK_BUF_SIZE;
+        return 0;
+    }
+    case VIDIOC_QBUF: {
+        struct v4l2_buffer *buf = arg;
+
+        if (buf->index >= mockq.count || buf->memory != mockq.memory ||
+            mockq.tail - mockq.head >= MOCK_BUF_MAX) {
+            break;
+        }
+        mockq.last_qbuf = *buf;
+        mockq.queue[mockq.tail++ % MOCK_BUF_MAX] = buf->index;
+        return 0;
+    }
+    case VIDIOC_DQBUF: {
+        struct v4l2_buffer *buf = arg;
+        struct timespec now;
+
+        if (mockq.dq_errno && mockq.dq_ok-- == 0) {
+            mockq.dq_ok = 0;
+            errno = mockq.dq_errno;
+            return -1;
+        }
+        if (mockq.head == mockq.tail) {
+            errno = EAGAIN;
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        mockq.sequence += mockq.skip;
+        mockq.skip = 0;
+        buf->index = mockq.queue[mockq.head++ % MOCK_BUF_MAX];
+        buf->sequence = mockq.sequence++;
+        buf->bytesused = MOCK_BUF_SIZE;
+        buf->flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+        buf->timestamp.tv_sec = now.tv_sec;
+        buf->timestamp.tv_usec = now.tv_nsec / 1000;
+        return 0;
+    }
+    case VIDIOC_STREAMON:
+        return 0;
+    case VIDIOC_STREAMOFF:
+        mockq.head = mockq.tail = 0;
+        return 0;
+    case VIDIOC_G_FMT: {
+        struct v4l2_format *fmt = arg;
+
+        fmt->fmt.pix.width = mockq.width;
+        fmt->fmt.pix.height = mockq.height;
+        return 0;
+    }
+    case VIDIOC_S_FMT: {
+        const struct v4l2_format *fmt = arg;
+
+        mockq.width = fmt->fmt.pix.width;
+        mockq.height = fmt->fmt.pix.height;
+        return 0;
+    }
+    case VIDIOC_CREATE_BUFS: {
+        struct v4l2_create_buffers *create = arg;
+
+        create->index = mockq.count;
+        create->count = mockq.count < MOCK_BUF_MAX ? 1 : 0;
+        mockq.count += create->count;
+        return 0;
+    }
+    case VIDIOC_EXPBUF: {
+        struct v4l2_exportbuffer *exp = arg;
+
+        /* Stand-in dmabuf: another reference to the backing memfd */
+        if (exp->index >= mockq.count) {
+            break;
+        }
+        exp->fd = fcntl(mockq.fd, F_DUPFD_CLOEXEC, 0);
+        return exp->fd < 0 ? -1 : 0;
+    }
+    default:
+        errno = ENOTTY;
+        return -1;
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (mockq.fd >= 0 && fd == mockq.fd) {
+        return mock_ioctl(request, arg);
+    }
+
+    return (int)syscall(SYS_ioctl, fd, request, arg);
+}
+
+/**
+ * Create the mock queue and a device handle on it
+ */
+static int mock_open(dsv4l2_device_internal_t *mock)
+{
+    memset(&mockq, 0, sizeof(mockq));
+    mockq.fd = memfd_create("dsv4l2-mockq", MFD_CLOEXEC);
+    if (mockq.fd < 0) {
+        return -errno;
+    }
+    if (ftruncate(mockq.fd, MOCK_BUF_MAX * MOCK_BUF_SIZE) < 0) {
+        close(mockq.fd);
+        mockq.fd = -1;
+        return -errno;
+    }
+
+    memset(mock, 0, sizeof(*mock));
+    mock->public.fd = mockq.fd;
+    mock->public.role = "camera";
+    mock->public.layer = 3;
+    mock->implicit_lease = -1;
+    return 0;
+}
+
+static void mock_close(dsv4l2_device_internal_t *mock)
+{
+    dsv4l2_stop_streaming(&mock->public);
+    dsv4l2_release_buffers(&mock->public);
+    close(mockq.fd);
+    mockq.fd = -1;
+}
+
+/* Buffers currently queued with the mock driver */
+static uint32_t mock_queued(void)
+{
+    return mockq.tail - mockq.head;
+}
+
+/**
+ * Request, map and queue MMAP buffers on the mock device, then stream
+ */
+static int mock_stream_mmap(dsv4l2_device_internal_t *mock, uint32_t count,
+                            uint32_t adapt_min, uint32_t adapt_max)
+{
+    uint32_t i;
+    int rc;
+
+    rc = dsv4l2_request_buffers(&mock->public, count);
+    if (rc == 0) {
+        rc = dsv4l2_mmap_buffers(&mock->public);
+    }
+    if (rc == 0 && adapt_max > 0) {
+        rc = dsv4l2_set_adaptive_depth(&mock->public, adapt_min, adapt_max);
+    }
+    for (i = 0; rc == 0 && i < count; i++) {
+        rc = dsv4l2_queue_buffer(&mock->public, i);
+    }
+    if (rc == 0) {
+        rc = dsv4l2_start_streaming(&mock->public);
+    }
+
+    return rc;
+}
+
+static void on_frame(dsv4l2_device_t *dev, dsv4l2_frame_t *frame, void *user_data)
+{
+    (void)user_data;
+    dsv4l2_frame_release(dev, frame);
+}
+
+static void *stop_later(void *arg)
+{
+    usleep(20000);
+    dsv4l2_reactor_stop(arg);
+    return NULL;
+}
+
+/**
+ * Test reactor lifecycle
+ */
+static void test_reactor(void)
+{
+    dsv4l2_reactor_t *reactor = NULL;
+    dsv4l2_device_t fake;
+    pthread_t thread;
+    int rc;
+
+    printf("\n=== Testing Capture Reactor ===\n");
+
+    TEST_ASSERT(dsv4l2_reactor_create(NULL) == -EINVAL, "Create rejects NULL");
+
+    rc = dsv4l2_reactor_create(&reactor);
+    TEST_ASSERT(rc == 0 && reactor != NULL, "Create reactor");
+    if (rc != 0) {
+        return;
+    }
+
+    TEST_ASSERT(dsv4l2_reactor_poll(reactor, 0) == 0, "Empty poll delivers nothing");
+    TEST_ASSERT(dsv4l2_reactor_poll(reactor, 10) == 0, "Empty poll times out");
+
+    memset(&fake, 0, sizeof(fake));
+    fake.fd = -1;
+    TEST_ASSERT(dsv4l2_reactor_add_device(reactor, NULL, on_frame, NULL) == -EINVAL,
+                "Add device rejects NULL device");
+    TEST_ASSERT(dsv4l2_reactor_add_device(reactor, &fake, NULL, NULL) == -EINVAL,
+                "Add device rejects NULL callback");
+    TEST_ASSERT(dsv4l2_reactor_remove_device(reactor, &fake) == -ENOENT,
+                "Remove unknown device");
+
+    /* Stop from another thread while blocked, pinned to CPU 0 */
+    pthread_create(&thread, NULL, stop_later, reactor);
+    rc = dsv4l2_reactor_run(reactor, 0);
+    pthread_join(thread, NULL);
+    TEST_ASSERT(rc == 0, "Run returns after stop");
+
+    /* Stop is consumed: the reactor can run again */
+    TEST_ASSERT(dsv4l2_reactor_poll(reactor, 0) == 0, "Poll after run is clean");
+
+    dsv4l2_reactor_stop(reactor);
+    TEST_ASSERT(dsv4l2_reactor_poll(reactor, -1) == -ECANCELED, "Poll sees stop");
+    TEST_ASSERT(dsv4l2_reactor_run(reactor, -1) == 0, "Run consumes pending stop");
+
+    dsv4l2_reactor_destroy(reactor);
+}
+
+/**
+ * Test dispatch of a device whose buffers are all leased while capture is blocked
+ *
+ * The mock fd is an eventfd that stays readable, like a vb2 queue left
+ * without buffers, and VIDIOC_DQBUF on it fails.
+ */
+static void test_reactor_leased(void)
+{
+    static dsv4l2_device_internal_t mock;
+    static dsv4l2_buffer_t buffers[2];
+    dsv4l2_reactor_t *reactor = NULL;
+    dsv4l2rt_config_t config;
+    dsv4l2rt_stats_t before, after;
+    int efd, i, rc;
+
+    printf("\n=== Testing Reactor Dispatch With All Buffers Leased ===\n");
+
+    efd = eventfd(1, EFD_CLOEXEC);
+    TEST_ASSERT(efd >= 0, "Create mock stream fd");
+    if (efd < 0) {
+        return;
+    }
+
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_OPS;
+    dsv4l2rt_init(&config);
+
+    memset(&mock, 0, sizeof(mock));
+    memset(buffers, 0, sizeof(buffers));
+    mock.public.fd = efd;
+    mock.public.role = "camera";
+    mock.public.layer = 3;
+    mock.streaming = 1;
+    mock.buffers = buffers;
+    mock.buffer_count = 2;
+    mock.implicit_lease = -1;
+    for (i = 0; i < 2; i++) {
+        buffers[i].state = DSV4L2_BUF_LEASED;
+        buffers[i].dmabuf_fd = -1;
+    }
+    mock.leased_count = 2;
+
+    rc = dsv4l2_reactor_create(&reactor);
+    TEST_ASSERT(rc == 0, "Create reactor");
+    if (rc != 0) {
+        dsv4l2rt_shutdown();
+        close(efd);
+        return;
+    }
+    rc = dsv4l2_reactor_add_device(reactor, &mock.public, on_frame, NULL);
+    TEST_ASSERT(rc == 0, "Register mock device");
+
+    dsv4l2_set_threatcon(THREATCON_EMERGENCY);
+    dsv4l2rt_get_stats(&before);
+
+    for (i = 0; i < 10; i++) {
+        rc |= dsv4l2_reactor_poll(reactor, 0);
+    }
+    dsv4l2rt_get_stats(&after);
+    TEST_ASSERT(rc == 0, "Blocked polls deliver nothing");
+    TEST_ASSERT(after.events_emitted == before.events_emitted,
+                "Fully leased device is parked, not dispatched on every wait");
+
+    /* Releasing a lease rearms it: the ready fd is dispatched (and blocked) again */
+    buffers[0].state = DSV4L2_BUF_IDLE;
+    mock.leased_count = 1;
+    rc = dsv4l2_reactor_poll(reactor, 0);
+    dsv4l2rt_get_stats(&after);
+    TEST_ASSERT(rc == 0 && after.events_emitted == before.events_emitted + 1,
+                "Lease release rearms the device");
+
+    dsv4l2_set_threatcon(THREATCON_NORMAL);
+    TEST_ASSERT(dsv4l2_reactor_remove_device(reactor, &mock.public) == 0,
+                "Unregister mock device");
+    dsv4l2_reactor_destroy(reactor);
+    dsv4l2rt_shutdown();
+    close(efd);
+}
+
+/**
+ * Test frame leases on the mock queue: hold, release, double release,
+ * stale descriptors and queue exhaustion
+ */
+static void test_frame_lease(void)
+{
+    static dsv4l2_device_internal_t mock;
+    dsv4l2_frame_t frames[3], extra, stale;
+    int ok = 1;
+    int i, rc;
+
+    printf("\n=== Testing Frame Leases ===\n");
+
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    rc = dsv4l2_request_buffers(&mock.public, 3);
+    TEST_ASSERT(rc == 0 && mock.buffer_count == 3, "Request three MMAP buffers");
+    TEST_ASSERT(dsv4l2_mmap_buffers(&mock.public) == 0, "Map the buffers");
+    TEST_ASSERT(dsv4l2_frame_acquire(&mock.public, &extra, 0) == -EAGAIN,
+                "No frame ready before any buffer is queued");
+
+    for (i = 0; i < 3; i++) {
+        rc |= dsv4l2_queue_buffer(&mock.public, i);
+    }
+    TEST_ASSERT(rc == 0 && mock_queued() == 3, "Queue every buffer");
+    TEST_ASSERT(dsv4l2_start_streaming(&mock.public) == 0, "Start streaming");
+
+    /* Hold all three at once */
+    for (i = 0; i < 3; i++) {
+        rc = dsv4l2_frame_acquire(&mock.public, &frames[i], 0);
+        ok &= rc == 0 && frames[i].index == (uint32_t)i &&
+              frames[i].sequence == (uint32_t)i &&
+              frames[i].data == mock.buffers[i].start &&
+              frames[i].len == MOCK_BUF_SIZE && frames[i].timestamp_ns > 0;
+    }
+    TEST_ASSERT(ok, "Acquire three leases in place (no copy)");
+    TEST_ASSERT(mock.leased_count == 3 && mock_queued() == 0,
+                "Held buffers stay out of the driver queue");
+    TEST_ASSERT(dsv4l2_frame_acquire(&mock.public, &extra, 0) == -ENOBUFS,
+                "Exhausted queue reports -ENOBUFS");
+
+    /* Release one: it goes back to the driver exactly once */
+    stale = frames[0];
+    rc = dsv4l2_frame_release(&mock.public, &frames[0]);
+    TEST_ASSERT(rc == 0 && frames[0].data == NULL && mock.leased_count == 2 &&
+                mock_queued() == 1, "Release requeues the buffer");
+    TEST_ASSERT(dsv4l2_frame_release(&mock.public, &stale) == -EINVAL && mock_queued() == 1,
+                "Double release is rejected");
+
+    /* The buffer comes round again with a new sequence number */
+    rc = dsv4l2_frame_acquire(&mock.public, &extra, 0);
+    TEST_ASSERT(rc == 0 && extra.index == stale.index && extra.sequence == 3,
+                "Released buffer is leased again");
+    TEST_ASSERT(dsv4l2_frame_release(&mock.public, &stale) == -EINVAL &&
+                mock.leased_count == 3,
+                "Stale descriptor cannot release the new lease");
+
+    stale = frames[1];
+    stale.index = 7;
+    TEST_ASSERT(dsv4l2_frame_release(&mock.public, &stale) == -EINVAL,
+                "Out-of-range index is rejected");
+
+    rc = dsv4l2_frame_release(&mock.public, &extra);
+    rc |= dsv4l2_frame_release(&mock.public, &frames[1]);
+    rc |= dsv4l2_frame_release(&mock.public, &frames[2]);
+    TEST_ASSERT(rc == 0 && mock.leased_count == 0 && mock_queued() == 3,
+                "Every lease returned");
+
+    /* STREAMOFF voids outstanding leases */
+    rc = dsv4l2_frame_acquire(&mock.public, &extra, 0);
+    dsv4l2_stop_streaming(&mock.public);
+    TEST_ASSERT(rc == 0 && mock.leased_count == 0 &&
+                dsv4l2_frame_release(&mock.public, &extra) == -EINVAL,
+                "Leases are void after STREAMOFF");
+
+    mock_close(&mock);
+}
+
+/**
+ * Test the implicit dsv4l2_capture_frame() lease against explicit leases
+ * of the same buffer
+ */
+static void test_capture_lease(void)
+{
+    static dsv4l2_device_internal_t mock;
+    dsv4l2_frame_t captured, held;
+    int rc;
+
+    printf("\n=== Testing Capture Frame Leases ===\n");
+
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    /* Two buffers: each capture hands the previous frame back */
+    rc = mock_stream_mmap(&mock, 2, 0, 0);
+    rc |= dsv4l2_capture_frame(&mock.public, &captured);
+    rc |= dsv4l2_capture_frame(&mock.public, &held);
+    TEST_ASSERT(rc == 0 && captured.sequence == 0 && held.sequence == 1 &&
+                mock.leased_count == 1 && mock_queued() == 1,
+                "Next capture requeues the previous frame");
+    mock_close(&mock);
+
+    /* One buffer: release the captured frame, then lease it explicitly */
+    rc = mock_open(&mock);
+    rc |= mock_stream_mmap(&mock, 1, 0, 0);
+    rc |= dsv4l2_capture_frame(&mock.public, &captured);
+    rc |= dsv4l2_frame_release(&mock.public, &captured);
+    TEST_ASSERT(rc == 0 && mock.implicit_lease == -1,
+                "Releasing the captured frame ends the implicit lease");
+
+    rc = dsv4l2_frame_acquire(&mock.public, &held, 0);
+    TEST_ASSERT(rc == 0 && held.index == captured.index, "Same buffer leased explicitly");
+
+    /* The next capture must not requeue the explicit lease */
+    rc = dsv4l2_capture_frame(&mock.public, &captured);
+    TEST_ASSERT(rc != 0 && mock.leased_count == 1 && mock_queued() == 0,
+                "Capture leaves the explicit lease alone");
+    TEST_ASSERT(dsv4l2_frame_release(&mock.public, &held) == 0,
+                "Explicit lease is still releasable");
+
+    mock_close(&mock);
+}
+
+/**
+ * Layer resolution limit, read from the device format at decision time
+ */
+static void test_resolution_limit(void)
+{
+    static dsv4l2_device_internal_t mock;
+    struct v4l2_format fmt;
+    int rc;
+
+    printf("\n=== Testing Layer Resolution Limit ===\n");
+
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    /* L3 allows up to 1280x720 */
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    fmt.fmt.pix.width = 1280;
+    fmt.fmt.pix.height = 720;
+    rc = dsv4l2_set_format(&mock.public, &fmt);
+    TEST_ASSERT(rc == 0 && dsv4l2_check_capture_allowed(&mock.public, "test") == 0,
+                "720p capture allowed at L3");
+
+    fmt.fmt.pix.width = 1920;
+    fmt.fmt.pix.height = 1080;
+    rc = dsv4l2_set_format(&mock.public, &fmt);
+    TEST_ASSERT(rc == 0 && dsv4l2_check_capture_allowed(&mock.public, "test") == -EPERM,
+                "1080p exceeds the L3 limit");
+
+    /* The format is re-read when the decision is recomputed (L4 also needs TEMPEST LOW) */
+    mock.public.layer = 4;
+    dsv4l2_check_capture_allowed(&mock.public, "test");
+    TEST_ASSERT(DSV4L2_POLICY_LAYER(mock.policy) == 4 && DSV4L2_POLICY_FORMAT_OK(mock.policy),
+                "1080p fits after moving to L4");
+
+    mock.public.layer = 2;
+    TEST_ASSERT(dsv4l2_check_capture_allowed(&mock.public, "test") == -EPERM,
+                "1080p exceeds the L2 limit");
+
+    fmt.fmt.pix.width = 640;
+    fmt.fmt.pix.height = 480;
+    rc = dsv4l2_set_format(&mock.public, &fmt);
+    TEST_ASSERT(rc == 0 && dsv4l2_check_capture_allowed(&mock.public, "test") == 0,
+                "Switching to VGA lifts the block");
+
+    mock_close(&mock);
+}
+
+/* FRAME_DROPPED events seen by the runtime sink */
+static uint32_t dropped_events;
+static uint32_t dropped_aux;
+
+static void on_dropped(const dsv4l2_event_t *events, size_t count, void *user_data)
+{
+    size_t i;
+
+    (void)user_data;
+    for (i = 0; i < count; i++) {
+        if (events[i].event_type == DSV4L2_EVENT_FRAME_DROPPED) {
+            dropped_events++;
+            dropped_aux = events[i].aux;
+        }
+    }
+}
+
+/**
+ * Test batch capture: draining to EAGAIN versus a failing device
+ */
+static void test_capture_frames(void)
+{
+    static dsv4l2_device_internal_t mock;
+    dsv4l2rt_config_t config;
+    dsv4l2_frame_t frames[4];
+    int i, n, rc;
+
+    printf("\n=== Testing Batch Capture ===\n");
+
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    /* Fresh session: earlier tests' events auto-initialized the runtime */
+    dsv4l2rt_shutdown();
+    memset(&config, 0, sizeof(config));
+    config.profile = DSV4L2_PROFILE_EXERCISE;
+    dsv4l2rt_init(&config);
+    dsv4l2rt_register_sink(on_dropped, NULL);
+    dropped_events = 0;
+
+    /* Two of three buffers ready: the batch ends at EAGAIN, quietly */
+    rc = dsv4l2_request_buffers(&mock.public, 3);
+    rc |= dsv4l2_mmap_buffers(&mock.public);
+    rc |= dsv4l2_queue_buffer(&mock.public, 0);
+    rc |= dsv4l2_queue_buffer(&mock.public, 1);
+    rc |= dsv4l2_start_streaming(&mock.public);
+    n = dsv4l2_capture_frames(&mock.public, frames, 4, 0);
+    dsv4l2rt_flush();
+    TEST_ASSERT(rc == 0 && n == 2 && dropped_events == 0,
+                "Drained queue ends the batch without an error");
+    for (i = 0; i < n; i++) {
+        dsv4l2_frame_release(&mock.public, &frames[i]);
+    }
+
+    /* Device fails after one frame: frame returned, failure reported */
+    mockq.dq_errno = EIO;
+    mockq.dq_ok = 1;
+    n = dsv4l2_capture_frames(&mock.public, frames, 4, 0);
+    dsv4l2rt_flush();
+    TEST_ASSERT(n == 1 && dropped_events == 1 && dropped_aux == EIO,
+                "Mid-batch device error emits FRAME_DROPPED");
+    if (n > 0) {
+        dsv4l2_frame_release(&mock.public, &frames[0]);
+    }
+
+    /* Device fails outright: the error is returned, not 0 */
+    mockq.dq_errno = ENODEV;
+    mockq.dq_ok = 0;
+    n = dsv4l2_capture_frames(&mock.public, frames, 4, 0);
+    dsv4l2rt_flush();
+    TEST_ASSERT(n == -ENODEV && dropped_events == 2 && dropped_aux == ENODEV,
+                "Device error before any frame is returned");
+
+    mockq.dq_errno = 0;
+    dsv4l2rt_shutdown();
+    mock_close(&mock);
+}
+
+/**
+ * Test the sequence-gap tracker on a synthetic sequence
+ */
+static void test_seq_tracker(void)
+{
+    static const struct {
+        uint32_t sequence;
+        uint32_t gap;
+    } feed[] = {
+        { 0, 0 }, { 1, 0 }, { 2, 0 },
+        { 5, 2 },                       /* 3 and 4 lost */
+        { 6, 0 },
+        { 10, 3 },                      /* 7..9 lost */
+        { 4, 0 },                       /* Restart, not a loss */
+    };
+    dsv4l2_seq_tracker_t t;
+    struct v4l2_buffer buf;
+    int ok = 1;
+    size_t i;
+
+    printf("\n=== Testing Sequence Gap Tracker ===\n");
+
+    memset(&t, 0, sizeof(t));
+    memset(&buf, 0, sizeof(buf));
+
+    for (i = 0; i < sizeof(feed) / sizeof(feed[0]); i++) {
+        buf.sequence = feed[i].sequence;
+        ok &= dsv4l2_seq_track(&t, &buf) == feed[i].gap;
+    }
+    TEST_ASSERT(ok, "Gap per buffer matches the skipped sequence numbers");
+    TEST_ASSERT(t.stats.frames == 7 && t.stats.dropped == 5 && t.stats.gaps == 2,
+                "Loss counters: 7 frames, 5 dropped in 2 gaps");
+
+    /* The first buffer after STREAMON never counts as a gap */
+    t.have_sequence = 0;
+    buf.sequence = 0xFFFFFFFE;
+    ok = dsv4l2_seq_track(&t, &buf) == 0;
+    buf.sequence = 0xFFFFFFFF;
+    ok &= dsv4l2_seq_track(&t, &buf) == 0;
+    buf.sequence = 0;
+    ok &= dsv4l2_seq_track(&t, &buf) == 0;
+    buf.sequence = 3;
+    ok &= dsv4l2_seq_track(&t, &buf) == 2;
+    TEST_ASSERT(ok && t.stats.dropped == 7 && t.stats.gaps == 3,
+                "Sequence wrap-around is not a loss");
+}
+
+/* Acquire and release one frame, returning the lease's driver sequence */
+static int mock_cycle(dsv4l2_device_internal_t *mock, uint32_t *sequence)
+{
+    dsv4l2_frame_t frame;
+    int rc;
+
+    rc = dsv4l2_frame_acquire(&mock->public, &frame, 0);
+    if (rc < 0) {
+        return rc;
+    }
+    if (sequence) {
+        *sequence = frame.sequence;
+    }
+
+    return dsv4l2_frame_release(&mock->public, &frame);
+}
+
+/**
+ * Test the adaptive depth controller against driver-side drops
+ */
+static void test_adaptive_depth(void)
+{
+    static dsv4l2_device_internal_t mock;
+    dsv4l2_capture_stats_t stats;
+    uint32_t sequence = 0;
+    int i, rc;
+
+    printf("\n=== Testing Adaptive Queue Depth ===\n");
+
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    rc = mock_stream_mmap(&mock, 4, 2, 6);
+    TEST_ASSERT(rc == 0 && mock.buffer_capacity == 6, "Stream 4 buffers, depth 2..6");
+    TEST_ASSERT(dsv4l2_set_adaptive_depth(&mock.public, 2, 6) == -EBUSY,
+                "Limits cannot change while streaming");
+
+    /* Quiet stream: no loss, no growth */
+    for (i = 0, rc = 0; i < 10; i++) {
+        rc |= mock_cycle(&mock, NULL);
+    }
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && stats.frames == 10 && stats.dropped == 0 &&
+                stats.gaps == 0 && stats.buffer_count == 4 && stats.active_count == 4,
+                "Gap-free frames keep the depth");
+
+    /* Driver drops three frames: counted, and one buffer is added */
+    mockq.skip = 3;
+    rc = mock_cycle(&mock, &sequence);
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && sequence == 13 && stats.dropped == 3 && stats.gaps == 1,
+                "Skipped sequence numbers are counted as drops");
+    TEST_ASSERT(stats.buffer_count == 5 && stats.active_count == 5 &&
+                mockq.count == 5 && mock.buffers[4].mapped,
+                "First gap grows the set with CREATE_BUFS");
+
+    /* A second gap in the same window does not grow again */
+    mockq.skip = 2;
+    rc = mock_cycle(&mock, &sequence);
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && sequence == 16 && stats.dropped == 5 && stats.gaps == 2 &&
+                stats.buffer_count == 5, "One growth step per window");
+
+    /* 16 gap-free windows after the gapped one park a buffer */
+    for (rc = 0; rc == 0 && stats.frames < 64 * 17 - 1; stats.frames++) {
+        rc = mock_cycle(&mock, NULL);
+    }
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && stats.frames == 64 * 17 - 1 && stats.active_count == 5,
+                "No shrink before 16 quiet windows");
+    rc = mock_cycle(&mock, NULL);
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && stats.dropped == 5 && stats.buffer_count == 5 &&
+                stats.active_count == 4 && mock.parked_count == 1 &&
+                mock_queued() == 4, "Quiet stream parks one buffer on release");
+
+    /* Next drop brings the parked buffer back instead of allocating */
+    mockq.skip = 1;
+    rc = mock_cycle(&mock, NULL);
+    dsv4l2_get_capture_stats(&mock.public, &stats);
+    TEST_ASSERT(rc == 0 && stats.dropped == 6 && stats.gaps == 3 &&
+                stats.active_count == 5 && mock.parked_count == 0 &&
+                mockq.count == 5 && mock_queued() == 5,
+                "Drop requeues the parked buffer");
+
+    mock_close(&mock);
+}
+
+/**
+ * Test zero-copy buffer sets: dmabuf export, dmabuf import and USERPTR
+ */
+static void test_zero_copy(void)
+{
+    static dsv4l2_device_internal_t mock;
+    dsv4l2_frame_t frame;
+    int fds[2] = { -1, -1 };
+    void *ptrs[2] = { NULL, NULL };
+    char byte = 0;
+    int i, fd, rc;
+
+    printf("\n=== Testing Zero-Copy Buffers ===\n");
+
+    /* Export: the leased frame carries the buffer's dmabuf */
+    rc = mock_open(&mock);
+    TEST_ASSERT(rc == 0, "Create mock buffer queue");
+    if (rc != 0) {
+        return;
+    }
+
+    rc = dsv4l2_request_buffers(&mock.public, 2);
+    rc |= dsv4l2_mmap_buffers(&mock.public);
+    TEST_ASSERT(rc == 0 && dsv4l2_get_buffer_fd(&mock.public, 0) == -ENOENT,
+                "No dmabuf before export");
+    TEST_ASSERT(dsv4l2_export_buffers(&mock.public) == 0, "Export MMAP buffers");
+    fd = dsv4l2_get_buffer_fd(&mock.public, 1);
+    TEST_ASSERT(fd >= 0 && fd != mockq.fd && fd != dsv4l2_get_buffer_fd(&mock.public, 0),
+                "Each buffer has its own dmabuf fd");
+    TEST_ASSERT(dsv4l2_get_buffer_fd(&mock.public, 2) == -EINVAL,
+                "Out-of-range index is rejected");
+
+    rc = dsv4l2_queue_buffer(&mock.public, 0);
+    rc |= dsv4l2_queue_buffer(&mock.public, 1);
+    rc |= dsv4l2_start_streaming(&mock.public);
+    rc |= dsv4l2_frame_acquire(&mock.public, &frame, 0);
+    TEST_ASSERT(rc == 0 && frame.dmabuf_fd == dsv4l2_get_buffer_fd(&mock.public, frame.index),
+                "Leased frame carries the exported fd");
+
+    /* The mock exports the backing memfd: a CPU write shows through the fd */
+    ((char *)frame.data)[0] = 'X';
+    rc = (int)pread(frame.dmabuf_fd, &byte, 1, frame.index * MOCK_BUF_SIZE);
+    TEST_ASSERT(rc == 1 && byte == 'X', "Frame data and dmabuf share memory");
+    dsv4l2_frame_release(&mock.public, &frame);
+    mock_close(&mock);
+
+    /* Import: caller dmabufs become the buffer set */
+    rc = mock_open(&mock);
+    for (i = 0; rc == 0 && i < 2; i++) {
+        fds[i] = memfd_create("dsv4l2-import", MFD_CLOEXEC);
+        if (fds[i] < 0 || ftruncate(fds[i], MOCK_BUF_SIZE) < 0 ||
+            pwrite(fds[i], i ? "B" : "A", 1, 0) != 1) {
+            rc = -1;
+        }
+    }
+    TEST_ASSERT(rc == 0, "Create caller dmabufs");
+    if (rc == 0) {
+        rc = dsv4l2_import_dmabuf(&mock.public, fds, 2);
+        TEST_ASSERT(rc == 0 && mock.memory == V4L2_MEMORY_DMABUF &&
+                    mock.buffers[0].length == MOCK_BUF_SIZE &&
+                    mock.buffers[0].dmabuf_fd != fds[0],
+                    "Import dmabufs (fds duplicated, size from lseek)");
+
+        close(fds[0]);
+        close(fds[1]);
+
+        rc = dsv4l2_queue_buffer(&mock.public, 0);
+        TEST_ASSERT(rc == 0 && mockq.last_qbuf.m.fd == mock.buffers[0].dmabuf_fd &&
+                    mockq.last_qbuf.length == MOCK_BUF_SIZE,
+                    "QBUF passes the imported fd");
+        rc = dsv4l2_queue_buffer(&mock.public, 1);
+        rc |= dsv4l2_start_streaming(&mock.public);
+        rc |= dsv4l2_frame_acquire(&mock.public, &frame, 0);
+        TEST_ASSERT(rc == 0 && frame.index == 0 && frame.data &&
+                    ((char *)frame.data)[0] == 'A' &&
+                    frame.dmabuf_fd == mock.buffers[0].dmabuf_fd,
+                    "Frame maps the caller's memory after the caller closed its fd");
+        dsv4l2_frame_release(&mock.public, &frame);
+    } else {
+        for (i = 0; i < 2; i++) {
+            if (fds[i] >= 0) {
+                close(fds[i]);
+            }
+        }
+    }
+    mock_close(&mock);
+
+    /* USERPTR: frames point straight into caller memory */
+    rc = mock_open(&mock);
+    for (i = 0; rc == 0 && i < 2; i++) {
+        ptrs[i] = aligned_alloc(MOCK_BUF_SIZE, MOCK_BUF_SIZE);
+        rc = ptrs[i] ? 0 : -1;
+    }
+    TEST_ASSERT(rc == 0, "Allocate caller memory");
+    if (rc == 0) {
+        rc = dsv4l2_import_userptr(&mock.public, ptrs, MOCK_BUF_SIZE, 2);
+        TEST_ASSERT(rc == 0 && mock.memory == V4L2_MEMORY_USERPTR &&
+                    dsv4l2_get_buffer_fd(&mock.public, 0) == -ENOENT,
+                    "Import USERPTR buffers");
+
+        rc = dsv4l2_queue_buffer(&mock.public, 1);
+        rc |= dsv4l2_queue_buffer(&mock.public, 0);
+        rc |= dsv4l2_start_streaming(&mock.public);
+        TEST_ASSERT(rc == 0 && mockq.last_qbuf.m.userptr == (unsigned long)ptrs[0],
+                    "QBUF passes the caller's address");
+        rc = dsv4l2_frame_acquire(&mock.public, &frame, 0);
+        TEST_ASSERT(rc == 0 && frame.index == 1 && frame.data == ptrs[1] &&
+                    frame.dmabuf_fd < 0, "Frame points into caller memory");
+        dsv4l2_frame_release(&mock.public, &frame);
+    }
+    mock_close(&mock);
+    free(ptrs[0]);
+    free(ptrs[1]);
+}
+
+static void on_stream_frame(dsv4l2_device_t *dev, const dsv4l2_frame_t *frame,
+                            void *user_data)
+{
+    (void)dev;
+    (void)frame;
+    (void)user_data;
+}
+
+/**
+ * Test device stream argument handling
+ */
+static void test_stream_api(void)
+{
+    dsv4l2_stream_opts_t opts;
+    dsv4l2_stream_stats_t stats;
+    dsv4l2_stream_t *stream = NULL;
+
+    printf("\n=== Testing Device Streams ===\n");
+
+    dsv4l2_stream_opts_init(&opts);
+    TEST_ASSERT(opts.workers == 1, "Default one worker");
+    TEST_ASSERT(opts.queue_depth == 0, "Default queue depth follows buffer count");
+    TEST_ASSERT(opts.dequeue_cpu == -1 && opts.worker_cpu_first == -1,
+                "Default affinity unpinned");
+    TEST_ASSERT(opts.rt_priority == 0, "Default normal scheduling");
+
+    TEST_ASSERT(dsv4l2_stream_start(NULL, on_stream_frame, NULL, &opts, &stream) == -EINVAL,
+                "Start rejects NULL device");
+    TEST_ASSERT(stream == NULL, "No stream on failure");
+    TEST_ASSERT(dsv4l2_stream_stop(NULL) == -EINVAL, "Stop rejects NULL");
+    TEST_ASSERT(dsv4l2_stream_get_stats(NULL, &stats) == -EINVAL, "Stats reject NULL");
+}
+
+/**
+ * Main test runner
+ */
+int main(void)
+{
+    printf("DSV4L2 Streaming Tests\n");
+    printf("======================\n");
+
+    test_reactor();
+    test_reactor_leased();
+    test_frame_lease();
+    test_capture_lease();
+    test_resolution_limit();
+    test_capture_frames();
+    test_seq_tracker();
+    test_adaptive_depth();
+    test_zero_copy();
+    test_stream_api();
+
+    /* Print summary */
+    printf("\n======================\n");
+    printf("Test Results:\n");
+    printf("  Passed: %d\n", tests_passed);
+    printf("  Failed: %d\n", tests_failed);
+    printf("  Total:  %d\n", tests_passed + tests_failed);
+
+    if (tests_failed > 0) {
+        printf("\nSome tests FAILED!\n");
+        return 1;
+    }
+
+    printf("\nAll tests PASSED!\n");
+    return 0;
+}
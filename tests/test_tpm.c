@@ -7,6 +7,7 @@
  */
 
 #include "dsv4l2rt.h"
+#include "../src/runtime/sha256.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -181,8 +182,14 @@ static void test_runtime_integration(void)
     TEST_ASSERT(count == 10, "Correct event count in chunk");
 
 #ifdef HAVE_TPM2
-    /* Verify the signature if TPM is available */
-    rc = dsv4l2_tpm_verify_signature(events, count, header.tpm_signature);
+    /* Verify the chunk against its signed batch root if TPM is available */
+    dsv4l2_tpm_proof_t proof;
+
+    dsv4l2rt_flush();
+    rc = dsv4l2_tpm_get_proof(header.chunk_id, &proof);
+    if (rc == 0) {
+        rc = dsv4l2_tpm_verify_chunk(&header, events, &proof);
+    }
     if (rc == 0) {
         TEST_ASSERT(1, "Chunk signature verified successfully");
     } else if (rc == -ENOSYS || rc == -EIO) {
@@ -199,6 +206,162 @@ static void test_runtime_integration(void)
     dsv4l2rt_shutdown();
 }
 
+static void test_merkle_pipeline(void)
+{
+    dsv4l2_event_t events[13][8];
+    dsv4l2rt_chunk_header_t headers[13];
+    dsv4l2_tpm_proof_t proof;
+    uint8_t prev[32], digest[32];
+    int rc, i, j, chained = 1, verified = 1;
+
+    printf("\n=== Test 5: Merkle Signing Pipeline ===\n");
+
+    /* Odd batch size exercises promoted nodes */
+    rc = dsv4l2_tpm_pipeline_start(5);
+    TEST_ASSERT(rc == 0, "Signing pipeline started");
+    TEST_ASSERT(dsv4l2_tpm_pipeline_start(0) == 0, "Start is idempotent while running");
+    TEST_ASSERT(dsv4l2_tpm_pipeline_start(DSV4L2_TPM_BATCH_MAX + 1) == -EINVAL,
+                "Oversized batch rejected");
+
+    memset(events, 0, sizeof(events));
+    for (i = 0; i < 13; i++) {
+        for (j = 0; j < 8; j++) {
+            events[i][j].ts_ns = 1000ULL * (i * 8 + j + 1);
+            events[i][j].event_type = DSV4L2_EVENT_FRAME_ACQUIRED;
+            events[i][j].aux = i * 8 + j;
+        }
+        memset(&headers[i], 0, sizeof(headers[i]));
+        headers[i].timestamp_ns = events[i][0].ts_ns;
+        headers[i].event_count = 1 + (i % 8);
+        dsv4l2_tpm_chain_chunk(&headers[i], events[i]);
+    }
+    dsv4l2_tpm_pipeline_flush();
+
+    /* Hash chain: each digest covers the previous one */
+    memset(prev, 0, sizeof(prev));
+    for (i = 0; i < 13; i++) {
+        dsv4l2_tpm_chunk_digest(prev, &headers[i], events[i], digest);
+        if (headers[i].chunk_id != (uint64_t)i ||
+            memcmp(digest, headers[i].chain_digest, 32) != 0) {
+            chained = 0;
+        }
+        memcpy(prev, digest, 32);
+    }
+    TEST_ASSERT(chained, "Chunks are hash-chained in order");
+
+    /* Every chunk verifies from its own proof */
+    for (i = 0; i < 13; i++) {
+        rc = dsv4l2_tpm_get_proof(i, &proof);
+        if (rc == 0) {
+            rc = dsv4l2_tpm_verify_chunk(&headers[i], events[i], &proof);
+        }
+        if (!(rc == 0 || (rc == -ENOSYS && proof.stub_signature))) {
+            verified = 0;
+        }
+    }
+    TEST_ASSERT(verified, "All 13 chunks verify against 3 batch roots");
+
+    rc = dsv4l2_tpm_get_proof(7, &proof);
+    TEST_ASSERT(rc == 0 && proof.batch_id == 1 && proof.leaf_index == 2 &&
+                proof.leaf_count == 5, "Proof locates chunk in its batch");
+
+    /* Tampering is detected before the signature check */
+    events[7][0].aux ^= 1;
+    TEST_ASSERT(dsv4l2_tpm_verify_chunk(&headers[7], events[7], &proof) == -EBADMSG,
+                "Modified event detected");
+    events[7][0].aux ^= 1;
+
+    proof.siblings[0][0] ^= 1;
+    TEST_ASSERT(dsv4l2_tpm_verify_chunk(&headers[7], events[7], &proof) == -EBADMSG,
+                "Modified proof detected");
+    proof.siblings[0][0] ^= 1;
+
+    TEST_ASSERT(dsv4l2_tpm_verify_chunk(&headers[8], events[8], &proof) == -EBADMSG,
+                "Proof of another chunk rejected");
+
+    TEST_ASSERT(dsv4l2_tpm_get_proof(13, &proof) == -ENOENT, "Unknown chunk has no proof");
+
+    dsv4l2_tpm_pipeline_stop();
+    TEST_ASSERT(dsv4l2_tpm_get_proof(12, &proof) == 0, "Proofs survive pipeline stop");
+    TEST_ASSERT(dsv4l2_tpm_chain_chunk(&headers[0], events[0]) == -EAGAIN,
+                "Chaining requires a running pipeline");
+}
+
+/* Lowercase hex of a digest */
+static void sha256_hex(const uint8_t digest[DSV4L2_SHA256_LEN], char hex[65])
+{
+    int i;
+
+    for (i = 0; i < DSV4L2_SHA256_LEN; i++) {
+        snprintf(&hex[i * 2], 3, "%02x", digest[i]);
+    }
+}
+
+/**
+ * FIPS 180-4 known answers through the dispatched and the generic kernel
+ */
+static void test_sha256_vectors(void)
+{
+    static const struct {
+        const char *msg;
+        const char *digest;
+    } vectors[] = {
+        { "",
+          "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+        { "abc",
+          "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+        { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    };
+    static const char million_a[] =
+        "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+    static const size_t steps[] = { 1, 3, 7, 61, 63, 64, 65, 127, 129, 1001 };
+    static const char *impls[] = { NULL, "generic" };
+    static char a[1001];
+    uint8_t digest[DSV4L2_SHA256_LEN];
+    char hex[65], msg[96];
+    dsv4l2_sha256_t ctx;
+    size_t i, j, left, step;
+    int ok;
+
+    printf("\n=== Test 6: SHA-256 Known Answers ===\n");
+
+    memset(a, 'a', sizeof(a));
+
+    for (i = 0; i < sizeof(impls) / sizeof(impls[0]); i++) {
+        TEST_ASSERT(dsv4l2_sha256_set_impl(impls[i]) == 0, "Select SHA-256 kernel");
+
+        ok = 1;
+        for (j = 0; j < sizeof(vectors) / sizeof(vectors[0]); j++) {
+            dsv4l2_sha256(vectors[j].msg, strlen(vectors[j].msg), digest);
+            sha256_hex(digest, hex);
+            ok &= strcmp(hex, vectors[j].digest) == 0;
+        }
+        snprintf(msg, sizeof(msg), "%s: empty, \"abc\" and 448-bit vectors",
+                 dsv4l2_sha256_impl());
+        TEST_ASSERT(ok, msg);
+
+        /* One million 'a' in odd-sized updates across block boundaries */
+        dsv4l2_sha256_init(&ctx);
+        for (left = 1000000, j = 0; left > 0; left -= step, j++) {
+            step = steps[j % (sizeof(steps) / sizeof(steps[0]))];
+            if (step > left) {
+                step = left;
+            }
+            dsv4l2_sha256_update(&ctx, a, step);
+        }
+        dsv4l2_sha256_final(&ctx, digest);
+        sha256_hex(digest, hex);
+        snprintf(msg, sizeof(msg), "%s: 1,000,000 x 'a' incremental",
+                 dsv4l2_sha256_impl());
+        TEST_ASSERT(strcmp(hex, million_a) == 0, msg);
+    }
+
+    TEST_ASSERT(dsv4l2_sha256_set_impl("no-such-kernel") == -ENOTSUP,
+                "Unknown kernel is rejected");
+    dsv4l2_sha256_set_impl(NULL);
+}
+
 int main(void)
 {
     printf("╔════════════════════════════════════════════════════════╗\n");
@@ -215,6 +378,8 @@ int main(void)
     test_tpm_signing();
     test_tpm_verification();
     test_runtime_integration();
+    test_merkle_pipeline();
+    test_sha256_vectors();
 
     printf("\n");
     printf("╔════════════════════════════════════════════════════════╗\n");
@@ -1340,7 +1340,7 @@ cdef extern from  "linux/videodev2.h":
         v4l2_format format
         __u32 reserved[8]
 
-cdef extern from 'libv4l2.h':
+cdef extern from 'libv4l2.h' nogil:
     cdef struct v4lconvert_data:
         pass
 
@@ -1361,7 +1361,7 @@ cdef extern from 'libv4lconvert.h':
                            unsigned char *src, int src_size,
                            unsigned char *dest, int dest_size)
 
-cdef inline int xioctl(int fd, unsigned long int request, void *arg):
+cdef inline int xioctl(int fd, unsigned long int request, void *arg) nogil:
     cdef int r = v4l2_ioctl(fd, request, arg)
     while -1 == r and EINTR == errno:
         r = v4l2_ioctl(fd, request, arg)
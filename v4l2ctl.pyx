@@ -6,10 +6,13 @@ from libc.stdlib cimport malloc, calloc, free
 from typing import Any, List
 from posix.fcntl cimport O_RDWR
 from posix.ioctl cimport ioctl
-from libc.errno cimport errno,EINTR,EINVAL,EAGAIN,EIO,ERANGE
+from libc.errno cimport errno,EINTR,EINVAL,EAGAIN,EIO,ERANGE,ETIMEDOUT
 from libc.string cimport strerror
 from posix.select cimport fd_set, timeval, FD_ZERO, FD_SET, select
 from posix.mman cimport PROT_READ, PROT_WRITE, MAP_SHARED
+from cpython.buffer cimport PyBuffer_FillInfo
+from cpython.bytes cimport PyBytes_FromStringAndSize, PyBytes_AS_STRING
+from cpython.exc cimport PyErr_CheckSignals
 
 from os import listdir as oslistdir
 
@@ -87,14 +90,53 @@ cdef class Info:
         self.fd = -1
 
 
+cdef int dequeue_buffer(int fd, v4l2_buffer *buf, double timeout) nogil:
+    """
+    Wait for a filled buffer and dequeue it. Runs without the GIL.
+
+    Returns 0, or -errno (-ETIMEDOUT when nothing arrived in time, -EINTR
+    so the caller can run Python signal handlers before retrying).
+    """
+    cdef fd_set fds
+    cdef timeval tv
+    cdef int r
+
+    FD_ZERO(&fds)
+    FD_SET(fd, &fds)
+    tv.tv_sec = <long>timeout
+    tv.tv_usec = <long>((timeout - <double>tv.tv_sec) * 1e6)
+
+    r = select(fd + 1, &fds, NULL, NULL, &tv)
+    if -1 == r:
+        return -errno
+    if 0 == r:
+        return -ETIMEDOUT
+
+    memset(buf, 0, sizeof(buf[0]))
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE
+    buf.memory = V4L2_MEMORY_MMAP
+
+    if -1 == xioctl(fd, VIDIOC_DQBUF, buf):
+        return -errno
+
+    return 0
+
+
+cdef class FrameBuffer
+
+
 cdef class Frame:
     """
     class used to get Frames of device.
 
+    get_frame() returns a copy of each frame as bytes. acquire() and
+    get_frames() hand out FrameBuffer objects instead, which expose the
+    mmap'd driver buffer itself through the buffer protocol; the buffer
+    returns to the driver only when the FrameBuffer is released.
+
     """
 
     cdef int fd
-    cdef fd_set fds
 
     cdef v4l2_format fmt
 
@@ -102,9 +144,11 @@ cdef class Frame:
     cdef v4l2_buffer buf
     cdef buffer_info *buffers
 
-    cdef timeval tv
+    cdef int leased              # Buffers held by FrameBuffer objects
+    cdef Py_ssize_t exports      # Views exported by those FrameBuffers
+    cdef bint closed
 
-    def __cinit__(self, device_path):
+    def __cinit__(self, device_path, buffer_count=4):
         device_path = device_path.encode()
 
         self.fd = v4l2_open(device_path, O_RDWR)
@@ -123,7 +167,7 @@ cdef class Frame:
 
 
         memset(&self.buf_req, 0, sizeof(self.buf_req))
-        self.buf_req.count = 4
+        self.buf_req.count = buffer_count
         self.buf_req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE
         self.buf_req.memory = V4L2_MEMORY_MMAP
 
@@ -170,57 +214,248 @@ cdef class Frame:
 
         return 0
 
+    cdef int check_open(self) except -1:
+        if self.closed:
+            raise ValueError('Frame is closed')
+        return 0
 
-    cpdef bytes get_frame(self):
-        FD_ZERO(&self.fds)
-        FD_SET(self.fd, &self.fds)
+    cdef int wait_buffer(self, v4l2_buffer *buf, double timeout) except -1:
+        """Dequeue one frame with the GIL released during the wait."""
+        cdef int r
 
-        self.tv.tv_sec = 2
+        while True:
+            with nogil:
+                r = dequeue_buffer(self.fd, buf, timeout)
+            if r != -EINTR:
+                break
+            PyErr_CheckSignals()
+
+        if -ETIMEDOUT == r:
+            raise CameraError('Timed out waiting for frame')
+        if r < 0:
+            raise CameraError('Retrieving frame failed: {}'.format(
+                strerror(-r).decode())
+            )
+        return 0
 
-        r = select(self.fd + 1, &self.fds, NULL, NULL, &self.tv)
-        while -1 == r and errno == EINTR:
-            FD_ZERO(&self.fds)
-            FD_SET(self.fd, &self.fds)
+    cdef int requeue(self, v4l2_buffer *buf) except -1:
+        if self.closed:
+            return 0
+        if -1 == xioctl(self.fd, VIDIOC_QBUF, buf):
+            raise CameraError('Exchanging buffer with device failed')
+        return 0
 
-            self.tv.tv_sec = 2
+    cdef FrameBuffer wrap(self, v4l2_buffer *buf):
+        cdef FrameBuffer frame = FrameBuffer.__new__(FrameBuffer)
 
-            r = select(self.fd + 1, &self.fds, NULL, NULL, &self.tv)
+        frame.owner = self
+        frame.buf = buf[0]
+        frame.data = <unsigned char *>self.buffers[buf.index].start
+        frame.length = buf.bytesused
+        self.leased += 1
+        return frame
+
+    cpdef bytes get_frame(self):
+        cdef v4l2_buffer buf
+        cdef bytes frame
+        cdef char *dst
+        cdef const void *src
+
+        self.check_open()
+        self.wait_buffer(&buf, 2.0)
+
+        src = self.buffers[buf.index].start
+        try:
+            frame = PyBytes_FromStringAndSize(NULL, buf.bytesused)
+            dst = PyBytes_AS_STRING(frame)
+            with nogil:
+                memcpy(dst, src, buf.bytesused)
+        finally:
+            self.requeue(&buf)
 
-        if -1 == r:
-            raise CameraError('Waiting for frame failed')
+        return frame
 
-        memset(&self.buf, 0, sizeof(self.buf))
-        self.buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE
-        self.buf.memory = V4L2_MEMORY_MMAP
+    def acquire(self, double timeout=2.0):
+        """
+        Dequeue the next frame without copying it.
 
-        if -1 == xioctl(self.fd, VIDIOC_DQBUF, &self.buf):
-            raise CameraError('Retrieving frame failed')
+        Returns a FrameBuffer backed by the driver's buffer. Release it
+        (release() or a ``with`` block) to give the buffer back; while it
+        is held the driver has one buffer fewer to fill.
+        """
+        cdef v4l2_buffer buf
 
-        buf =  self.buffers[self.buf.index].start
-        buf_len = self.buf.bytesused
+        self.check_open()
+        if self.leased >= <int>self.buf_req.count:
+            raise BufferError('All {} buffers are held; release a frame first'.format(
+                self.buf_req.count))
+
+        self.wait_buffer(&buf, timeout)
+        return self.wrap(&buf)
+
+    def get_frames(self, int n, double timeout=2.0):
+        """
+        Dequeue n frames in one call, without copying them.
+
+        The waits for all n frames run with the GIL released. At most as
+        many frames as there are unheld buffers can be taken at once.
+        Returns a list of FrameBuffer objects in capture order.
+        """
+        cdef v4l2_buffer *bufs
+        cdef int got = 0
+        cdef int r = 0
+        cdef int i
+
+        self.check_open()
+        if n < 1:
+            return []
+        if n > <int>self.buf_req.count - self.leased:
+            raise BufferError('{} frames requested but only {} buffers are free'.format(
+                n, <int>self.buf_req.count - self.leased))
+
+        bufs = <v4l2_buffer *>malloc(n * sizeof(bufs[0]))
+        if bufs == NULL:
+            raise MemoryError()
 
-        frame_data = <unsigned char *>malloc(buf_len * sizeof(char))
         try:
-            memcpy(frame_data, buf, buf_len)
-            if -1 == xioctl(self.fd, VIDIOC_QBUF, &self.buf):
-                raise CameraError('Exchanging buffer with device failed')
-            return frame_data[:buf_len]
+            while got < n:
+                with nogil:
+                    while got < n:
+                        r = dequeue_buffer(self.fd, &bufs[got], timeout)
+                        if r != 0:
+                            break
+                        got += 1
+                if r != -EINTR:
+                    break
+                PyErr_CheckSignals()
+
+            # Wrapped frames give their buffers back when dropped
+            frames = [self.wrap(&bufs[i]) for i in range(got)]
         finally:
-            free(frame_data)
+            free(bufs)
+
+        if got < n:
+            if -ETIMEDOUT == r:
+                raise CameraError('Timed out waiting for frame')
+            raise CameraError('Retrieving frame failed: {}'.format(
+                strerror(-r).decode())
+            )
+        return frames
 
     @property
     def fd(self):
         return self.fd
 
+    @property
+    def buffer_count(self):
+        return self.buf_req.count
+
     def close(self):
+        if self.closed:
+            return
+        if self.exports:
+            raise BufferError('{} frame view(s) still exported'.format(self.exports))
+
+        self.closed = True
         xioctl(self.fd, VIDIOC_STREAMOFF, &self.buf.type)
 
         for i in range(self.buf_req.count):
             v4l2_munmap(self.buffers[i].start, self.buffers[i].length)
+        free(self.buffers)
+        self.buffers = NULL
 
         v4l2_close(self.fd)
 
 
+@cython.no_gc_clear
+cdef class FrameBuffer:
+    """
+    A dequeued frame, read in place from the driver's mmap'd buffer.
+
+    Supports the buffer protocol, so memoryview(frame), bytes(frame) and
+    numpy.frombuffer(frame) work without a copy. The buffer goes back to
+    the driver on release(), at the end of a ``with`` block, or when the
+    object is garbage collected. release() raises BufferError while
+    views are still exported, so the driver never refills memory that
+    Python can still read.
+
+    """
+
+    cdef Frame owner
+    cdef v4l2_buffer buf
+    cdef unsigned char *data
+    cdef Py_ssize_t length
+    cdef Py_ssize_t exports
+    cdef bint released
+
+    def __getbuffer__(self, Py_buffer *view, int flags):
+        self.check_valid()
+        PyBuffer_FillInfo(view, self, self.data, self.length, 1, flags)
+        self.exports += 1
+        self.owner.exports += 1
+
+    def __releasebuffer__(self, Py_buffer *view):
+        self.exports -= 1
+        self.owner.exports -= 1
+
+    cdef int check_valid(self) except -1:
+        if self.released:
+            raise ValueError('Frame buffer already released')
+        if self.owner.closed:
+            raise ValueError('Frame is closed')
+        return 0
+
+    def release(self):
+        """Give the buffer back to the driver (idempotent)."""
+        if self.released:
+            return
+        if self.exports:
+            raise BufferError('{} view(s) of this frame still exported'.format(self.exports))
+
+        self.released = True
+        self.owner.leased -= 1
+        self.owner.requeue(&self.buf)
+
+    def numpy(self, dtype=np.uint8, shape=None):
+        """ndarray view of the frame (holds the buffer until it is gone)."""
+        array = np.frombuffer(self, dtype=dtype)
+        if shape is not None:
+            array = array.reshape(shape)
+        return array
+
+    def tobytes(self):
+        self.check_valid()
+        return <bytes>self.data[:self.length]
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.release()
+        return False
+
+    def __len__(self):
+        return self.length
+
+    def __dealloc__(self):
+        if not self.released and self.owner is not None:
+            self.owner.leased -= 1
+            if not self.owner.closed:
+                xioctl(self.owner.fd, VIDIOC_QBUF, &self.buf)
+
+    @property
+    def index(self):
+        return self.buf.index
+
+    @property
+    def sequence(self):
+        return self.buf.sequence
+
+    @property
+    def timestamp(self):
+        return self.buf.timestamp.tv_sec + <double>self.buf.timestamp.tv_usec * 1e-6
+
+
 cdef class V4l2:
     """
     Video Control class.